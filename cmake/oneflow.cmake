@@ -5,6 +5,7 @@ include(python)
 if (BUILD_CUDA)
   list(APPEND of_main_cc ${PROJECT_SOURCE_DIR}/oneflow/core/job/oneflow_worker.cpp)
 endif()
+list(APPEND of_bench_main_cc ${PROJECT_SOURCE_DIR}/oneflow/core/common/benchmark_main.cpp)
 function(oneflow_add_executable)
   if (BUILD_CUDA)
     cuda_add_executable(${ARGV})
@@ -127,13 +128,17 @@ foreach(oneflow_single_file ${oneflow_all_src})
     if("${oneflow_single_file}" MATCHES "^${PROJECT_SOURCE_DIR}/oneflow/(core|user|xrt)/.*_test\\.cpp$")
       # test file
       list(APPEND of_all_test_cc ${oneflow_single_file})
+    elseif("${oneflow_single_file}" MATCHES "^${PROJECT_SOURCE_DIR}/oneflow/(core|user|xrt)/.*_bench\\.cpp$")
+      # benchmark file
+      list(APPEND of_all_bench_cc ${oneflow_single_file})
     elseif("${oneflow_single_file}" MATCHES "^${PROJECT_SOURCE_DIR}/oneflow/.*\\.pybind\\.cpp$")
       list(APPEND of_pybind_obj_cc ${oneflow_single_file})
       set(group_this ON)
     else()
       # not test file
       list(FIND of_main_cc ${oneflow_single_file} main_found)
-      if(${main_found} EQUAL -1) # not main entry
+      list(FIND of_bench_main_cc ${oneflow_single_file} bench_main_found)
+      if(${main_found} EQUAL -1 AND ${bench_main_found} EQUAL -1) # not main entry
         list(APPEND of_all_obj_cc ${oneflow_single_file})
       endif()
     endif()
@@ -321,6 +326,15 @@ if(BUILD_TESTING)
   endif()
 endif()
 
+# build benchmark
+if(BUILD_BENCHMARK)
+  if (of_all_bench_cc)
+    oneflow_add_executable(oneflow_benchexe ${of_bench_main_cc} ${of_all_bench_cc})
+    target_link_libraries(oneflow_benchexe ${of_libs} ${oneflow_third_party_libs})
+    set_target_properties(oneflow_benchexe PROPERTIES RUNTIME_OUTPUT_DIRECTORY "${PROJECT_BINARY_DIR}/bin")
+  endif()
+endif()
+
 # build include
 set(ONEFLOW_INCLUDE_DIR "${PROJECT_BINARY_DIR}/python_scripts/oneflow/include")
 add_custom_target(of_include_copy ALL
@@ -216,6 +216,20 @@ if(BUILD_RDMA)
   endif()
 endif()
 
+if(BUILD_IO_URING)
+  if(UNIX)
+    include(CheckSymbolExists)
+    CHECK_SYMBOL_EXISTS(IORING_RECV_MULTISHOT linux/io_uring.h HAVE_IO_URING_MULTISHOT)
+    if(HAVE_IO_URING_MULTISHOT)
+      add_definitions(-DWITH_IO_URING)
+    else()
+      message(FATAL_ERROR "io_uring head file with multishot receive not found")
+    endif()
+  else()
+    message(FATAL_ERROR "UNIMPLEMENTED")
+  endif()
+endif()
+
 include_directories(${ONEFLOW_INCLUDE_SRC_DIRS})
 
 if(WITH_XLA)
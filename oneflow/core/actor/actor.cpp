@@ -611,10 +611,11 @@ void Actor::AsyncSendEORDMsgForAllProducedRegstDesc() {
     CHECK(!pair.second.empty());
     const RtRegstDesc* regst_desc = pair.second.front()->regst_desc();
     device_ctx_->AddCallBack([regst_desc]() {
+      std::vector<ActorMsg> msgs;
       for (int64_t consumer : regst_desc->consumers_actor_id()) {
-        Global<ActorMsgBus>::Get()->SendMsg(
-            ActorMsg::BuildEordMsg(consumer, regst_desc->regst_desc_id()));
+        msgs.push_back(ActorMsg::BuildEordMsg(consumer, regst_desc->regst_desc_id()));
       }
+      Global<ActorMsgBus>::Get()->SendMsgBatch(msgs);
     });
   }
 }
@@ -711,11 +712,9 @@ std::unique_ptr<Actor> NewActor(const TaskProto& task_proto, const ThreadCtx& th
 
 void Actor::AsyncSendQueuedMsg() {
   if (!async_msg_queue_.empty()) {
-    std::deque<ActorMsg> msgs;
+    std::vector<ActorMsg> msgs;
     msgs.swap(async_msg_queue_);
-    device_ctx_->AddCallBack([msgs]() {
-      for (const ActorMsg& msg : msgs) { Global<ActorMsgBus>::Get()->SendMsg(msg); }
-    });
+    device_ctx_->AddCallBack([msgs]() { Global<ActorMsgBus>::Get()->SendMsgBatch(msgs); });
   }
 }
 
@@ -37,4 +37,61 @@ void ActorMsgBus::SendMsgWithoutCommNet(const ActorMsg& msg) {
   Global<ThreadMgr>::Get()->GetThrd(thrd_id)->EnqueueActorMsg(msg);
 }
 
+void ActorMsgBus::SendMsgBatch(const std::vector<ActorMsg>& msgs) {
+  if (msgs.size() == 1) { return SendMsg(msgs.front()); }
+  const int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  std::vector<std::pair<int64_t, const ActorMsg*>> thrd_id_msg_pairs;
+  HashMap<int64_t, std::vector<ActorMsg>> machine_id2msgs;
+  for (const ActorMsg& msg : msgs) {
+    const int64_t dst_machine_id = Global<IDMgr>::Get()->MachineId4ActorId(msg.dst_actor_id());
+    if (dst_machine_id == this_machine_id) {
+      thrd_id_msg_pairs.emplace_back(Global<IDMgr>::Get()->ThrdId4ActorId(msg.dst_actor_id()),
+                                     &msg);
+    } else {
+      machine_id2msgs[dst_machine_id].push_back(msg);
+    }
+  }
+  EnqueueGroupedByThrd(&thrd_id_msg_pairs);
+  for (const auto& pair : machine_id2msgs) {
+    Global<CommNet>::Get()->SendActorMsgBatch(pair.first, pair.second);
+  }
+}
+
+void ActorMsgBus::SendMsgBatchWithoutCommNet(const std::vector<ActorMsg>& msgs) {
+  const int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  std::vector<std::pair<int64_t, const ActorMsg*>> thrd_id_msg_pairs;
+  thrd_id_msg_pairs.reserve(msgs.size());
+  for (const ActorMsg& msg : msgs) {
+    CHECK_EQ(Global<IDMgr>::Get()->MachineId4ActorId(msg.dst_actor_id()), this_machine_id);
+    thrd_id_msg_pairs.emplace_back(Global<IDMgr>::Get()->ThrdId4ActorId(msg.dst_actor_id()), &msg);
+  }
+  EnqueueGroupedByThrd(&thrd_id_msg_pairs);
+}
+
+void ActorMsgBus::EnqueueGroupedByThrd(
+    std::vector<std::pair<int64_t, const ActorMsg*>>* thrd_id_msg_pairs) const {
+  // the msgs of one act go to a handful of threads, sorting them is cheaper than a map of
+  // vectors; the sort is stable since an actor has to see the msgs for it in the sent order
+  std::stable_sort(thrd_id_msg_pairs->begin(), thrd_id_msg_pairs->end(),
+                   [](const std::pair<int64_t, const ActorMsg*>& lhs,
+                      const std::pair<int64_t, const ActorMsg*>& rhs) {
+                     return lhs.first < rhs.first;
+                   });
+  std::vector<ActorMsg> group;
+  FOR_RANGE(size_t, i, 0, thrd_id_msg_pairs->size()) {
+    const int64_t thrd_id = thrd_id_msg_pairs->at(i).first;
+    group.push_back(*thrd_id_msg_pairs->at(i).second);
+    if (i + 1 < thrd_id_msg_pairs->size() && thrd_id_msg_pairs->at(i + 1).first == thrd_id) {
+      continue;
+    }
+    Thread* thrd = Global<ThreadMgr>::Get()->GetThrd(thrd_id);
+    if (group.size() == 1) {
+      thrd->EnqueueActorMsg(group.front());
+    } else {
+      thrd->EnqueueActorMsgBatch(group);
+    }
+    group.clear();
+  }
+}
+
 }  // namespace oneflow
@@ -28,10 +28,17 @@ class ActorMsgBus final {
 
   void SendMsg(const ActorMsg& msg);
   void SendMsgWithoutCommNet(const ActorMsg& msg);
+  // local msgs are delivered with one enqueue per destination thread, remote msgs with one
+  // CommNet batch per machine
+  void SendMsgBatch(const std::vector<ActorMsg>& msgs);
+  void SendMsgBatchWithoutCommNet(const std::vector<ActorMsg>& msgs);
 
  private:
   friend class Global<ActorMsgBus>;
   ActorMsgBus() = default;
+
+  void EnqueueGroupedByThrd(
+      std::vector<std::pair<int64_t, const ActorMsg*>>* thrd_id_msg_pairs) const;
 };
 
 }  // namespace oneflow
@@ -14,20 +14,163 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/comm_network/comm_network.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
 
 namespace oneflow {
 
+namespace {
+
+const size_t kLatencyBucketNum = 32;
+// reading the clock twice per event costs about as much as handling it
+const uint32_t kLatencySampleInterval = 16;
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+size_t LatencyBucket(int64_t latency_ns) {
+  uint64_t latency_us = latency_ns > 0 ? latency_ns / 1000 : 0;
+  size_t bucket = 0;
+  while (latency_us > 0 && bucket + 1 < kLatencyBucketNum) {
+    latency_us >>= 1;
+    bucket += 1;
+  }
+  return bucket;
+}
+
+}  // namespace
+
+// Runs the actor read streams assigned to it on one thread. Work reaches the thread through a
+// lock-free mailbox and only that thread touches the waiting lists, so a stream stays ordered
+// without locks while streams on different shards make progress in parallel.
+class CommNet::StreamShard final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(StreamShard);
+  StreamShard() : latency_buckets_(kLatencyBucketNum) {
+    for (std::atomic<int64_t>& bucket : latency_buckets_) { bucket.store(0); }
+    thread_ = std::thread(&StreamShard::PollEvents, this);
+  }
+  ~StreamShard() {
+    events_.Close();
+    thread_.join();
+  }
+
+  void AddWork(ActorReadContext* actor_read_ctx, const std::function<void()>& cb, bool is_read) {
+    Event event;
+    event.type = EventType::kAddWork;
+    event.item = CommNetItem(is_read, cb);
+    PostEvent(actor_read_ctx, &event);
+  }
+  void ReadDone(ActorReadContext* actor_read_ctx) {
+    Event event;
+    event.type = EventType::kReadDone;
+    PostEvent(actor_read_ctx, &event);
+  }
+  void DeleteStream(ActorReadContext* actor_read_ctx) {
+    Event event;
+    event.type = EventType::kDeleteStream;
+    PostEvent(actor_read_ctx, &event);
+  }
+
+  std::vector<int64_t> LatencyHistogram() const {
+    std::vector<int64_t> histogram;
+    for (const std::atomic<int64_t>& bucket : latency_buckets_) {
+      histogram.push_back(bucket.load(std::memory_order_relaxed));
+    }
+    return histogram;
+  }
+
+ private:
+  enum class EventType { kAddWork, kReadDone, kDeleteStream };
+  struct Event {
+    EventType type;
+    ActorReadContext* actor_read_ctx;
+    CommNetItem item;
+    // 0 if the event is not sampled
+    int64_t post_time_ns;
+  };
+
+  void PostEvent(ActorReadContext* actor_read_ctx, Event* event) {
+    event->actor_read_ctx = actor_read_ctx;
+    static thread_local uint32_t post_cnt = 0;
+    event->post_time_ns = (post_cnt++ % kLatencySampleInterval == 0) ? NowNs() : 0;
+    CHECK_EQ(events_.Send(*event), kChannelStatusSuccess);
+  }
+
+  void PollEvents() {
+    std::queue<Event> events;
+    while (events_.ReceiveMany(&events) == kChannelStatusSuccess) {
+      while (!events.empty()) {
+        const Event& event = events.front();
+        if (event.post_time_ns != 0) {
+          latency_buckets_.at(LatencyBucket(NowNs() - event.post_time_ns))
+              .fetch_add(1, std::memory_order_relaxed);
+        }
+        HandleEvent(event);
+        events.pop();
+      }
+    }
+  }
+
+  void HandleEvent(const Event& event) {
+    std::list<CommNetItem>* waiting_list = &event.actor_read_ctx->waiting_list;
+    if (event.type == EventType::kAddWork) {
+      const bool is_stream_idle = waiting_list->empty();
+      if (!is_stream_idle) { waiting_list->push_back(event.item); }
+      // an empty item stands for the read in flight
+      if (event.item.is_read) { waiting_list->push_back(CommNetItem()); }
+      if (is_stream_idle) { event.item.callback(); }
+    } else if (event.type == EventType::kReadDone) {
+      CHECK(!waiting_list->empty());
+      CHECK(waiting_list->front().callback == nullptr);
+      waiting_list->pop_front();
+      while (!waiting_list->empty()) {
+        CommNetItem item = waiting_list->front();
+        waiting_list->pop_front();
+        CHECK(item.callback);
+        item.callback();
+        if (item.is_read) { break; }
+      }
+    } else if (event.type == EventType::kDeleteStream) {
+      CHECK(waiting_list->empty());
+      delete event.actor_read_ctx;
+    } else {
+      UNIMPLEMENTED();
+    }
+  }
+
+  MpscChannel<Event> events_;
+  std::thread thread_;
+  std::vector<std::atomic<int64_t>> latency_buckets_;
+};
+
 CommNet::~CommNet() {
-  ready_cbs_.Close();
-  ready_cb_poller_.join();
+  FOR_RANGE(size_t, i, 0, stream_shards_.size()) {
+    std::stringstream histogram;
+    const std::vector<int64_t> buckets = stream_shards_.at(i)->LatencyHistogram();
+    FOR_RANGE(size_t, bucket, 0, buckets.size()) {
+      if (buckets.at(bucket) > 0) {
+        histogram << " <" << (1LL << bucket) << "us:" << buckets.at(bucket);
+      }
+    }
+    LOG(INFO) << "CommNet stream shard " << i << " latency" << histogram.str();
+  }
+  stream_shards_.clear();
 }
 
-void* CommNet::NewActorReadId() { return new ActorReadContext; }
+void* CommNet::NewActorReadId() {
+  ActorReadContext* actor_read_ctx = new ActorReadContext;
+  const size_t shard_idx = next_stream_shard_idx_.fetch_add(1, std::memory_order_relaxed);
+  actor_read_ctx->shard = stream_shards_.at(shard_idx % stream_shards_.size()).get();
+  return actor_read_ctx;
+}
 
 void CommNet::DeleteActorReadId(void* actor_read_id) {
   auto actor_read_ctx = static_cast<ActorReadContext*>(actor_read_id);
-  CHECK(actor_read_ctx->waiting_list.empty());
-  delete actor_read_ctx;
+  actor_read_ctx->shard->DeleteStream(actor_read_ctx);
 }
 
 void CommNet::Read(void* actor_read_id, int64_t src_machine_id, void* src_token, void* dst_token) {
@@ -37,50 +180,47 @@ void CommNet::Read(void* actor_read_id, int64_t src_machine_id, void* src_token,
   auto do_read = [this, read_ctx, src_machine_id, src_token, dst_token]() {
     DoRead(read_ctx, src_machine_id, src_token, dst_token);
   };
-  AddWorkToStream(actor_read_id, do_read, true);
+  actor_read_ctx->shard->AddWork(actor_read_ctx, do_read, true);
 }
 
 void CommNet::AddReadCallBack(void* actor_read_id, std::function<void()> callback) {
-  AddWorkToStream(actor_read_id, callback, false);
+  auto actor_read_ctx = static_cast<ActorReadContext*>(actor_read_id);
+  actor_read_ctx->shard->AddWork(actor_read_ctx, callback, false);
 }
 
 void CommNet::ReadDone(void* read_id) {
   ReadContext* read_ctx = static_cast<ReadContext*>(read_id);
   ActorReadContext* actor_read_ctx = read_ctx->actor_read_ctx;
-  CommNetItem item;
-  {
-    std::unique_lock<std::mutex> lck(actor_read_ctx->waiting_list_mtx);
-    CHECK(!actor_read_ctx->waiting_list.empty());
-    CHECK(actor_read_ctx->waiting_list.front().callback == nullptr);
-    actor_read_ctx->waiting_list.pop_front();
-  }
-  while (true) {
-    {
-      std::unique_lock<std::mutex> lck(actor_read_ctx->waiting_list_mtx);
-      if (actor_read_ctx->waiting_list.empty()) { break; }
-      item = actor_read_ctx->waiting_list.front();
-      actor_read_ctx->waiting_list.pop_front();
-    }
-    CHECK(item.callback);
-    ready_cbs_.Send(item.callback);
-    if (item.is_read) { break; }
-  }
+  actor_read_ctx->shard->ReadDone(actor_read_ctx);
   delete read_ctx;
 }
 
-void CommNet::AddWorkToStream(void* actor_read_id, const std::function<void()>& cb, bool is_read) {
-  auto actor_read_ctx = static_cast<ActorReadContext*>(actor_read_id);
-  std::unique_lock<std::mutex> lck(actor_read_ctx->waiting_list_mtx);
-  if (actor_read_ctx->waiting_list.empty()) {
-    ready_cbs_.Send(cb);
-  } else {
-    CommNetItem work_item(is_read, cb);
-    actor_read_ctx->waiting_list.push_back(work_item);
-  }
-  if (is_read) {
-    CommNetItem empty_cb;
-    actor_read_ctx->waiting_list.push_back(empty_cb);
+std::vector<std::vector<int64_t>> CommNet::StreamLatencyHistograms() const {
+  std::vector<std::vector<int64_t>> histograms;
+  for (const auto& shard : stream_shards_) { histograms.push_back(shard->LatencyHistogram()); }
+  return histograms;
+}
+
+void CommNet::RegisterCustomMsgHandler(int64_t handler_id, const CustomMsgHandler& handler) {
+  std::unique_lock<std::mutex> lck(custom_msg_handlers_mtx_);
+  CHECK(custom_msg_handlers_.emplace(handler_id, handler).second);
+}
+
+void CommNet::UnRegisterCustomMsgHandler(int64_t handler_id) {
+  std::unique_lock<std::mutex> lck(custom_msg_handlers_mtx_);
+  CHECK_EQ(custom_msg_handlers_.erase(handler_id), 1);
+}
+
+void CommNet::HandleCustomMsg(int64_t src_machine_id, int64_t handler_id,
+                              std::vector<char>* data) {
+  CustomMsgHandler handler;
+  {
+    std::unique_lock<std::mutex> lck(custom_msg_handlers_mtx_);
+    auto it = custom_msg_handlers_.find(handler_id);
+    CHECK(it != custom_msg_handlers_.end());
+    handler = it->second;
   }
+  handler(src_machine_id, data);
 }
 
 CommNet::CommNet(const Plan& plan) {
@@ -92,10 +232,13 @@ CommNet::CommNet(const Plan& plan) {
   std::vector<int64_t> peer_machine_ids = PbRf2StdVec(machine_ids_it->second.machine_id());
   peer_machine_id_.insert(peer_machine_ids.begin(), peer_machine_ids.end());
 
-  ready_cb_poller_ = std::thread([this]() {
-    std::function<void()> cb;
-    while (ready_cbs_.Receive(&cb) == kChannelStatusSuccess) { cb(); }
-  });
+  // shards beyond the number of cores cannot run in parallel and only add thread switches
+  const int32_t stream_shard_num =
+      std::min<int32_t>(Global<ResourceDesc, ForSession>::Get()->CommNetStreamShardNum(),
+                        std::max<int32_t>(std::thread::hardware_concurrency(), 1));
+  CHECK_GE(stream_shard_num, 1);
+  FOR_RANGE(int32_t, i, 0, stream_shard_num) { stream_shards_.emplace_back(new StreamShard); }
+  next_stream_shard_idx_.store(0, std::memory_order_relaxed);
 }
 
 }  // namespace oneflow
@@ -20,7 +20,7 @@ limitations under the License.
 #include "oneflow/core/common/platform.h"
 #include "oneflow/core/job/plan.pb.h"
 #include "oneflow/core/job/machine_context.h"
-#include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/mpsc_channel.h"
 
 namespace oneflow {
 
@@ -49,9 +49,27 @@ class CommNet {
   void Read(void* actor_read_id, int64_t src_machine_id, void* src_token, void* dst_token);
   void AddReadCallBack(void* actor_read_id, std::function<void()> callback);
   void ReadDone(void* read_id);
+  // One histogram per stream shard of the delay between posting work to an actor read stream
+  // and the shard handling it, bucket i counts delays in [2^(i-1), 2^i) microseconds. One in 16
+  // events is sampled.
+  std::vector<std::vector<int64_t>> StreamLatencyHistograms() const;
 
   //
   virtual void SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) = 0;
+  virtual void SendActorMsgBatch(int64_t dst_machine_id, const std::vector<ActorMsg>& msgs) {
+    for (const ActorMsg& msg : msgs) { SendActorMsg(dst_machine_id, msg); }
+  }
+
+  // Custom messages carry raw bytes to a handler registered on the destination machine, messages
+  // from one machine to another are handled in the order they were sent. The handler runs on a
+  // CommNet thread and may take over the data.
+  using CustomMsgHandler = std::function<void(int64_t src_machine_id, std::vector<char>* data)>;
+  void RegisterCustomMsgHandler(int64_t handler_id, const CustomMsgHandler& handler);
+  void UnRegisterCustomMsgHandler(int64_t handler_id);
+  virtual void SendCustomMsg(int64_t dst_machine_id, int64_t handler_id, std::vector<char>&& data) {
+    UNIMPLEMENTED();
+  }
+  void HandleCustomMsg(int64_t src_machine_id, int64_t handler_id, std::vector<char>* data);
 
  protected:
   CommNet(const Plan& plan);
@@ -59,21 +77,23 @@ class CommNet {
   virtual void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) = 0;
   const HashSet<int64_t>& peer_machine_id() { return peer_machine_id_; }
 
-  Channel<std::function<void()>> ready_cbs_;
-
  private:
   friend class Global<CommNet>;
-  void AddWorkToStream(void* actor_read_id, const std::function<void()>& cb, bool is_read);
+  class StreamShard;
   struct ActorReadContext;
   struct ReadContext {
     ActorReadContext* actor_read_ctx;
   };
+  // the waiting list is only touched by the thread of the stream's shard
   struct ActorReadContext {
-    std::mutex waiting_list_mtx;
+    StreamShard* shard;
     std::list<CommNetItem> waiting_list;
   };
   HashSet<int64_t> peer_machine_id_;
-  std::thread ready_cb_poller_;
+  std::vector<std::unique_ptr<StreamShard>> stream_shards_;
+  std::atomic<size_t> next_stream_shard_idx_;
+  std::mutex custom_msg_handlers_mtx_;
+  HashMap<int64_t, CustomMsgHandler> custom_msg_handlers_;
 };
 
 template<typename MemDescType>
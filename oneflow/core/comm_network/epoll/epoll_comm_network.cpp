@@ -14,71 +14,28 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
+#include "oneflow/core/comm_network/epoll/socket_util.h"
 #include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/common/balanced_splitter.h"
 #include "oneflow/core/job/machine_context.h"
 #include "oneflow/core/job/resource_desc.h"
-#include "oneflow/core/job/env_desc.h"
 #include "oneflow/core/job/global_for.h"
 
 #ifdef PLATFORM_POSIX
 
-#include <netinet/tcp.h>
-
 namespace oneflow {
 
-namespace {
-
-sockaddr_in GetSockAddr(const std::string& addr, uint16_t port) {
-  sockaddr_in sa;
-  sa.sin_family = AF_INET;
-  sa.sin_port = htons(port);
-  PCHECK(inet_pton(AF_INET, addr.c_str(), &(sa.sin_addr)) == 1);
-  return sa;
-}
-
-int SockListen(int listen_sockfd, uint16_t listen_port, int32_t total_machine_num) {
-  sockaddr_in sa = GetSockAddr("0.0.0.0", listen_port);
-  int bind_result = bind(listen_sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
-  if (bind_result == 0) {
-    PCHECK(listen(listen_sockfd, total_machine_num) == 0);
-    LOG(INFO) << "CommNet:Epoll listening on "
-              << "0.0.0.0:" + std::to_string(listen_port);
-  } else {
-    PCHECK(errno == EACCES || errno == EADDRINUSE);
-  }
-  return bind_result;
-}
-
-int64_t GetMachineId(const sockaddr_in& sa) {
-  char addr[INET_ADDRSTRLEN];
-  memset(addr, '\0', sizeof(addr));
-  PCHECK(inet_ntop(AF_INET, &(sa.sin_addr), addr, INET_ADDRSTRLEN));
-  for (int64_t i = 0; i < Global<ResourceDesc, ForSession>::Get()->TotalMachineNum(); ++i) {
-    if (Global<ResourceDesc, ForSession>::Get()->machine(i).addr() == addr) { return i; }
-  }
-  UNIMPLEMENTED();
-}
-
-std::string GenPortKey(int64_t machine_id) { return "EpollPort/" + std::to_string(machine_id); }
-void PushPort(int64_t machine_id, uint16_t port) {
-  Global<CtrlClient>::Get()->PushKV(GenPortKey(machine_id), std::to_string(port));
-}
-void ClearPort(int64_t machine_id) { Global<CtrlClient>::Get()->ClearKV(GenPortKey(machine_id)); }
-uint16_t PullPort(int64_t machine_id) {
-  uint16_t port = 0;
-  Global<CtrlClient>::Get()->PullKV(
-      GenPortKey(machine_id), [&](const std::string& v) { port = oneflow_cast<uint16_t>(v); });
-  return port;
-}
-
-}  // namespace
+struct EpollCommNet::StripedRead {
+  void* read_id;
+  std::atomic<int64_t> remaining_chunk_num;
+};
 
 EpollCommNet::~EpollCommNet() {
   for (size_t i = 0; i < pollers_.size(); ++i) {
     LOG(INFO) << "CommNet Thread " << i << " finish";
     pollers_[i]->Stop();
   }
-  OF_BARRIER();
+  if (sync_peers_on_destroy_) { OF_BARRIER(); }
   for (IOEventPoller* poller : pollers_) { delete poller; }
   for (auto& pair : sockfd2helper_) { delete pair.second; }
 }
@@ -94,10 +51,38 @@ void EpollCommNet::SendActorMsg(int64_t dst_machine_id, const ActorMsg& actor_ms
   GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
 }
 
-void EpollCommNet::SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg) {
+void EpollCommNet::SendActorMsgBatch(int64_t dst_machine_id,
+                                     const std::vector<ActorMsg>& actor_msgs) {
+  if (actor_msgs.size() == 1) { return SendActorMsg(dst_machine_id, actor_msgs.front()); }
+  SocketMsg msg;
+  msg.msg_type = SocketMsgType::kActorBatch;
+  msg.actor_batch_msg.actor_msg_num = actor_msgs.size();
+  msg.actor_batch_msg.actor_msgs = new ActorMsg[actor_msgs.size()];
+  std::copy(actor_msgs.begin(), actor_msgs.end(), msg.actor_batch_msg.actor_msgs);
   GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
 }
 
+void EpollCommNet::SendCustomMsg(int64_t dst_machine_id, int64_t handler_id,
+                                 std::vector<char>&& data) {
+  SocketMsg msg;
+  msg.msg_type = SocketMsgType::kCustom;
+  msg.custom_msg.src_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  msg.custom_msg.handler_id = handler_id;
+  msg.custom_msg.data_size = data.size();
+  msg.custom_msg.data = new std::vector<char>(std::move(data));
+  GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
+}
+
+void EpollCommNet::ChunkReadDone(void* read_id, int64_t chunk_num) {
+  if (chunk_num == 1) { return ReadDone(read_id); }
+  auto striped_read = static_cast<StripedRead*>(read_id);
+  // the chunks arrive on different poller threads
+  if (striped_read->remaining_chunk_num.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    ReadDone(striped_read->read_id);
+    delete striped_read;
+  }
+}
+
 SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
   SocketMemDesc* mem_desc = new SocketMemDesc;
   mem_desc->mem_ptr = ptr;
@@ -105,95 +90,76 @@ SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
   return mem_desc;
 }
 
-EpollCommNet::EpollCommNet(const Plan& plan) : CommNetIf(plan) {
+EpollCommNet::EpollCommNet(const Plan& plan)
+    : CommNetIf(plan), sync_peers_on_destroy_(true), read_cnt_(0) {
+  InitPollersAndSockets(ConnectPeerSockets(
+      peer_machine_id(), Global<ResourceDesc, ForSession>::Get()->CommNetConnectionNumPerPeer()));
+}
+
+EpollCommNet::EpollCommNet(const Plan& plan, std::vector<std::vector<int>>&& machine_id2sockfds)
+    : CommNetIf(plan), sync_peers_on_destroy_(false), read_cnt_(0) {
+  InitPollersAndSockets(std::move(machine_id2sockfds));
+}
+
+void EpollCommNet::InitPollersAndSockets(std::vector<std::vector<int>>&& machine_id2sockfds) {
+  connection_num_per_peer_ =
+      Global<ResourceDesc, ForSession>::Get()->CommNetConnectionNumPerPeer();
+  CHECK_GE(connection_num_per_peer_, 1);
+  stripe_min_byte_ = Global<ResourceDesc, ForSession>::Get()->comm_net_stripe_min_byte();
   pollers_.resize(Global<ResourceDesc, ForSession>::Get()->CommNetWorkerNum(), nullptr);
   for (size_t i = 0; i < pollers_.size(); ++i) { pollers_[i] = new IOEventPoller; }
+  machine_id2sockfds_ = std::move(machine_id2sockfds);
   InitSockets();
   for (IOEventPoller* poller : pollers_) { poller->Start(); }
 }
 
 void EpollCommNet::InitSockets() {
-  int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
-  auto this_machine = Global<ResourceDesc, ForSession>::Get()->machine(this_machine_id);
-  int64_t total_machine_num = Global<ResourceDesc, ForSession>::Get()->TotalMachineNum();
-  machine_id2sockfd_.assign(total_machine_num, -1);
   sockfd2helper_.clear();
   size_t poller_idx = 0;
-  auto NewSocketHelper = [&](int sockfd) {
-    IOEventPoller* poller = pollers_[poller_idx];
-    poller_idx = (poller_idx + 1) % pollers_.size();
-    return new SocketHelper(sockfd, poller);
-  };
-
-  // listen
-  int listen_sockfd = socket(AF_INET, SOCK_STREAM, 0);
-  int32_t this_listen_port = Global<EnvDesc>::Get()->data_port();
-  if (this_listen_port != -1) {
-    CHECK_EQ(SockListen(listen_sockfd, this_listen_port, total_machine_num), 0);
-    PushPort(this_machine_id,
-             ((this_machine.data_port_agent() != -1) ? (this_machine.data_port_agent())
-                                                     : (this_listen_port)));
-  } else {
-    for (this_listen_port = 1024; this_listen_port < GetMaxVal<uint16_t>(); ++this_listen_port) {
-      if (SockListen(listen_sockfd, this_listen_port, total_machine_num) == 0) {
-        PushPort(this_machine_id, this_listen_port);
-        break;
-      }
-    }
-    CHECK_LT(this_listen_port, GetMaxVal<uint16_t>());
-  }
-  int32_t src_machine_count = 0;
-
-  // connect
-  for (int64_t peer_id : peer_machine_id()) {
-    if (peer_id < this_machine_id) {
-      ++src_machine_count;
-      continue;
+  for (const std::vector<int>& sockfds : machine_id2sockfds_) {
+    for (int sockfd : sockfds) {
+      IOEventPoller* poller = pollers_[poller_idx];
+      poller_idx = (poller_idx + 1) % pollers_.size();
+      CHECK(sockfd2helper_.emplace(sockfd, new SocketHelper(sockfd, poller)).second);
     }
-    uint16_t peer_port = PullPort(peer_id);
-    auto peer_machine = Global<ResourceDesc, ForSession>::Get()->machine(peer_id);
-    sockaddr_in peer_sockaddr = GetSockAddr(peer_machine.addr(), peer_port);
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    const int val = 1;
-    PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
-    PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
-           == 0);
-    CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    machine_id2sockfd_[peer_id] = sockfd;
-  }
-
-  // accept
-  FOR_RANGE(int32_t, idx, 0, src_machine_count) {
-    sockaddr_in peer_sockaddr;
-    socklen_t len = sizeof(peer_sockaddr);
-    int sockfd = accept(listen_sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), &len);
-    PCHECK(sockfd != -1);
-    CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    int64_t peer_machine_id = GetMachineId(peer_sockaddr);
-    machine_id2sockfd_[peer_machine_id] = sockfd;
-  }
-  PCHECK(close(listen_sockfd) == 0);
-  ClearPort(this_machine_id);
-
-  // useful log
-  FOR_RANGE(int64_t, machine_id, 0, total_machine_num) {
-    LOG(INFO) << "machine " << machine_id << " sockfd " << machine_id2sockfd_[machine_id];
   }
 }
 
 SocketHelper* EpollCommNet::GetSocketHelper(int64_t machine_id) {
-  int sockfd = machine_id2sockfd_.at(machine_id);
+  return GetSocketHelper(machine_id, 0);
+}
+
+SocketHelper* EpollCommNet::GetSocketHelper(int64_t machine_id, int64_t connection_idx) {
+  int sockfd = machine_id2sockfds_.at(machine_id).at(connection_idx);
   return sockfd2helper_.at(sockfd);
 }
 
 void EpollCommNet::DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) {
-  SocketMsg msg;
-  msg.msg_type = SocketMsgType::kRequestWrite;
-  msg.request_write_msg.src_token = src_token;
-  msg.request_write_msg.dst_machine_id = Global<MachineCtx>::Get()->this_machine_id();
-  msg.request_write_msg.dst_token = dst_token;
-  msg.request_write_msg.read_id = read_id;
-  GetSocketHelper(src_machine_id)->AsyncWrite(msg);
+  const int64_t byte_size = static_cast<const SocketMemDesc*>(dst_token)->byte_size;
+  int64_t chunk_num = 1;
+  void* chunk_read_id = read_id;
+  if (connection_num_per_peer_ > 1 && byte_size >= static_cast<int64_t>(stripe_min_byte_)) {
+    chunk_num = connection_num_per_peer_;
+    StripedRead* striped_read = new StripedRead;
+    striped_read->read_id = read_id;
+    striped_read->remaining_chunk_num = chunk_num;
+    chunk_read_id = striped_read;
+  }
+  const int64_t first_connection_idx = read_cnt_.fetch_add(1, std::memory_order_relaxed);
+  BalancedSplitter splitter(byte_size, chunk_num);
+  FOR_RANGE(int64_t, chunk_idx, 0, chunk_num) {
+    SocketMsg msg;
+    msg.msg_type = SocketMsgType::kRequestWrite;
+    msg.request_write_msg.src_token = src_token;
+    msg.request_write_msg.dst_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+    msg.request_write_msg.dst_token = dst_token;
+    msg.request_write_msg.read_id = chunk_read_id;
+    msg.request_write_msg.offset = splitter.At(chunk_idx).begin();
+    msg.request_write_msg.byte_size = splitter.At(chunk_idx).size();
+    msg.request_write_msg.chunk_num = chunk_num;
+    const int64_t connection_idx = (first_connection_idx + chunk_idx) % connection_num_per_peer_;
+    GetSocketHelper(src_machine_id, connection_idx)->AsyncWrite(msg);
+  }
 }
 
 }  // namespace oneflow
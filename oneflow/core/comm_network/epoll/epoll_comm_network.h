@@ -30,23 +30,45 @@ class EpollCommNet final : public CommNetIf<SocketMemDesc> {
   ~EpollCommNet();
 
   static void Init(const Plan& plan) { Global<CommNet>::SetAllocated(new EpollCommNet(plan)); }
+  // takes connected sockets indexed by machine id instead of connecting to the peers through the
+  // control plane, lets a single process talk to itself over loopback
+  static void InitWithSockets(const Plan& plan,
+                              std::vector<std::vector<int>>&& machine_id2sockfds) {
+    Global<CommNet>::SetAllocated(new EpollCommNet(plan, std::move(machine_id2sockfds)));
+  }
 
   void RegisterMemoryDone() override;
 
   void SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) override;
-  void SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg);
+  void SendActorMsgBatch(int64_t dst_machine_id, const std::vector<ActorMsg>& msgs) override;
+  void SendCustomMsg(int64_t dst_machine_id, int64_t handler_id,
+                     std::vector<char>&& data) override;
+  // one chunk of the read has arrived, the read is done with its last chunk
+  void ChunkReadDone(void* read_id, int64_t chunk_num);
 
  private:
   SocketMemDesc* NewMemDesc(void* ptr, size_t byte_size) override;
 
   EpollCommNet(const Plan& plan);
+  EpollCommNet(const Plan& plan, std::vector<std::vector<int>>&& machine_id2sockfds);
+  void InitPollersAndSockets(std::vector<std::vector<int>>&& machine_id2sockfds);
   void InitSockets();
+  // messages which have to stay in order go through the first connection to a machine
   SocketHelper* GetSocketHelper(int64_t machine_id);
+  SocketHelper* GetSocketHelper(int64_t machine_id, int64_t connection_idx);
   void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) override;
 
+  struct StripedRead;
+
+  // peers of sockets handed in are not known to the control plane
+  const bool sync_peers_on_destroy_;
   std::vector<IOEventPoller*> pollers_;
-  std::vector<int> machine_id2sockfd_;
+  int32_t connection_num_per_peer_;
+  size_t stripe_min_byte_;
+  std::vector<std::vector<int>> machine_id2sockfds_;
   HashMap<int, SocketHelper*> sockfd2helper_;
+  // spreads unstriped reads over the connections
+  std::atomic<int64_t> read_cnt_;
 };
 
 template<>
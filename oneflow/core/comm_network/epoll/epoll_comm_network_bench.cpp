@@ -0,0 +1,129 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
+#include "oneflow/core/comm_network/epoll/socket_util.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/job/resource_desc.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace {
+
+// an EpollCommNet of machine 0 whose only peer is itself, over loopback sockets
+class LoopbackEpollCommNet final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(LoopbackEpollCommNet);
+  explicit LoopbackEpollCommNet(int32_t connection_num) {
+    Resource resource;
+    resource.set_machine_num(1);
+    resource.set_comm_net_worker_num(4);
+    resource.set_comm_net_connection_num_per_peer(connection_num);
+    Global<ResourceDesc, ForSession>::New(resource);
+    Global<MachineCtx>::New(0);
+    Plan plan;
+    (*plan.mutable_net_topo()->mutable_peer_machine_ids())[0].add_machine_id(0);
+    std::vector<std::vector<int>> machine_id2sockfds(1);
+    machine_id2sockfds.at(0) = ConnectLoopbackSockets(connection_num);
+    EpollCommNet::InitWithSockets(plan, std::move(machine_id2sockfds));
+  }
+  ~LoopbackEpollCommNet() {
+    Global<CommNet>::Delete();
+    Global<MachineCtx>::Delete();
+    Global<ResourceDesc, ForSession>::Delete();
+  }
+};
+
+// machine 0 reads from itself over loopback, with one read in flight like an actor stream
+void BenchmarkLoopbackRead(BenchmarkState* state, int32_t connection_num, size_t byte_size) {
+  LoopbackEpollCommNet loopback(connection_num);
+  CommNet* comm_net = Global<CommNet>::Get();
+
+  std::vector<char> src(byte_size, 1);
+  std::vector<char> dst(byte_size, 0);
+  void* src_token = comm_net->RegisterMemory(src.data(), byte_size);
+  void* dst_token = comm_net->RegisterMemory(dst.data(), byte_size);
+  comm_net->RegisterMemoryDone();
+  void* actor_read_id = comm_net->NewActorReadId();
+  while (state->KeepRunning()) {
+    BlockingCounter counter(1);
+    comm_net->Read(actor_read_id, 0, src_token, dst_token);
+    comm_net->AddReadCallBack(actor_read_id, [&counter]() { counter.Decrease(); });
+    counter.WaitUntilCntEqualZero();
+  }
+  CHECK_EQ(dst.front(), 1);
+  CHECK_EQ(dst.back(), 1);
+  state->SetBytesProcessed(state->iterations() * byte_size);
+  state->SetLabel(std::to_string(connection_num) + " connection(s)");
+
+  comm_net->DeleteActorReadId(actor_read_id);
+  comm_net->UnRegisterMemory(src_token);
+  comm_net->UnRegisterMemory(dst_token);
+}
+
+// machine 0 sends msg_num custom messages of byte_size bytes to itself back to back and waits
+// for all of them, the small message traffic of control messages between actors
+void BenchmarkLoopbackCustomMsgs(BenchmarkState* state, int64_t msg_num, size_t byte_size) {
+  LoopbackEpollCommNet loopback(1);
+  CommNet* comm_net = Global<CommNet>::Get();
+  const int64_t handler_id = 0;
+  BlockingCounter* counter = nullptr;
+  comm_net->RegisterCustomMsgHandler(
+      handler_id, [&counter](int64_t src_machine_id, std::vector<char>* data) {
+        counter->Decrease();
+      });
+  while (state->KeepRunning()) {
+    BlockingCounter cur_counter(msg_num);
+    counter = &cur_counter;
+    FOR_RANGE(int64_t, i, 0, msg_num) {
+      comm_net->SendCustomMsg(0, handler_id, std::vector<char>(byte_size, 1));
+    }
+    cur_counter.WaitUntilCntEqualZero();
+  }
+  comm_net->UnRegisterCustomMsgHandler(handler_id);
+  state->SetItemsProcessed(state->iterations() * msg_num);
+  state->SetBytesProcessed(state->iterations() * msg_num * byte_size);
+}
+
+}  // namespace
+
+OF_BENCHMARK(EpollCommNetLoopbackRead4KiB_1Connection) {
+  BenchmarkLoopbackRead(state, 1, 4 << 10);
+}
+
+OF_BENCHMARK(EpollCommNetLoopbackRead1MiB_1Connection) {
+  BenchmarkLoopbackRead(state, 1, 1 << 20);
+}
+
+OF_BENCHMARK(EpollCommNetLoopbackRead64MiB_1Connection) {
+  BenchmarkLoopbackRead(state, 1, 64 << 20);
+}
+
+OF_BENCHMARK(EpollCommNetLoopbackRead64MiB_4Connections) {
+  BenchmarkLoopbackRead(state, 4, 64 << 20);
+}
+
+OF_BENCHMARK(EpollCommNetLoopbackCustomMsgs64B) { BenchmarkLoopbackCustomMsgs(state, 4096, 64); }
+
+OF_BENCHMARK(EpollCommNetLoopbackCustomMsgs0B) { BenchmarkLoopbackCustomMsgs(state, 4096, 0); }
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
@@ -23,7 +23,20 @@ namespace oneflow {
 
 const int IOEventPoller::max_event_num_ = 32;
 
-IOEventPoller::IOEventPoller() {
+namespace {
+
+std::string SyscallStatsToString(int64_t syscall_cnt, int64_t bytes) {
+  const double mb = bytes / (1024.0 * 1024.0);
+  std::stringstream ss;
+  ss << syscall_cnt << " syscalls for " << mb << " MB";
+  if (bytes > 0) { ss << " (" << syscall_cnt / mb << " syscalls per MB)"; }
+  return ss.str();
+}
+
+}  // namespace
+
+IOEventPoller::IOEventPoller()
+    : read_syscall_cnt_(0), read_bytes_(0), write_syscall_cnt_(0), write_bytes_(0) {
   epfd_ = epoll_create1(0);
   ep_events_ = new epoll_event[max_event_num_];
   io_handlers_.clear();
@@ -56,6 +69,18 @@ void IOEventPoller::Stop() {
   uint64_t break_epoll_loop_event = 1;
   PCHECK(write(break_epoll_loop_fd_, &break_epoll_loop_event, 8) == 8);
   thread_.join();
+  LOG(INFO) << "IOEventPoller read: " << SyscallStatsToString(read_syscall_cnt_, read_bytes_)
+            << ", write: " << SyscallStatsToString(write_syscall_cnt_, write_bytes_);
+}
+
+void IOEventPoller::AddReadSyscall(ssize_t ret) {
+  read_syscall_cnt_ += 1;
+  if (ret > 0) { read_bytes_ += ret; }
+}
+
+void IOEventPoller::AddWriteSyscall(ssize_t ret) {
+  write_syscall_cnt_ += 1;
+  if (ret > 0) { write_bytes_ += ret; }
 }
 
 void IOEventPoller::AddFd(int fd, std::function<void()>* read_handler,
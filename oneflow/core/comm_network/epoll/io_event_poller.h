@@ -34,6 +34,11 @@ class IOEventPoller final {
   void Start();
   void Stop();
 
+  // socket syscall bookkeeping of the helpers running on this poller's thread, ret is the
+  // syscall's return value; the totals are logged when the poller stops
+  void AddReadSyscall(ssize_t ret);
+  void AddWriteSyscall(ssize_t ret);
+
  private:
   struct IOHandler {
     IOHandler() {
@@ -56,6 +61,11 @@ class IOEventPoller final {
   std::forward_list<IOHandler*> io_handlers_;
   int break_epoll_loop_fd_;
   std::thread thread_;
+
+  int64_t read_syscall_cnt_;
+  int64_t read_bytes_;
+  int64_t write_syscall_cnt_;
+  int64_t write_bytes_;
 };
 
 }  // namespace oneflow
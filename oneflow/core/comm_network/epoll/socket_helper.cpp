@@ -20,8 +20,8 @@ limitations under the License.
 namespace oneflow {
 
 SocketHelper::SocketHelper(int sockfd, IOEventPoller* poller) {
-  read_helper_ = new SocketReadHelper(sockfd);
   write_helper_ = new SocketWriteHelper(sockfd, poller);
+  read_helper_ = new SocketReadHelper(sockfd, poller, write_helper_);
   poller->AddFd(sockfd, [this]() { read_helper_->NotifyMeSocketReadable(); },
                 [this]() { write_helper_->NotifyMeSocketWriteable(); });
 }
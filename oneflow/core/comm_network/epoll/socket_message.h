@@ -37,7 +37,9 @@ namespace oneflow {
 #define SOCKET_MSG_TYPE_SEQ                         \
   OF_PP_MAKE_TUPLE_SEQ(RequestWrite, request_write) \
   OF_PP_MAKE_TUPLE_SEQ(RequestRead, request_read)   \
-  OF_PP_MAKE_TUPLE_SEQ(Actor, actor)
+  OF_PP_MAKE_TUPLE_SEQ(Actor, actor)                \
+  OF_PP_MAKE_TUPLE_SEQ(ActorBatch, actor_batch)     \
+  OF_PP_MAKE_TUPLE_SEQ(Custom, custom)
 
 enum class SocketMsgType {
 #define MAKE_ENTRY(x, y) k##x,
@@ -45,17 +47,41 @@ enum class SocketMsgType {
 #undef MAKE_ENTRY
 };
 
+// a read transfers [offset, offset + byte_size) of the registered memory, when it is striped
+// into chunk_num > 1 chunks read_id refers to the StripedRead which collects the chunks
 struct RequestWriteMsg {
   void* src_token;
   int64_t dst_machine_id;
   void* dst_token;
   void* read_id;
+  int64_t offset;
+  int64_t byte_size;
+  int64_t chunk_num;
 };
 
 struct RequestReadMsg {
   void* src_token;
   void* dst_token;
   void* read_id;
+  int64_t offset;
+  int64_t byte_size;
+  int64_t chunk_num;
+};
+
+// the body following the head is actor_msg_num ActorMsgs,
+// actor_msgs is only meaningful on the sender side
+struct ActorBatchMsg {
+  int64_t actor_msg_num;
+  ActorMsg* actor_msgs;
+};
+
+// the body following the head is data_size bytes,
+// data is only meaningful on the sender side
+struct CustomMsg {
+  int64_t src_machine_id;
+  int64_t handler_id;
+  int64_t data_size;
+  std::vector<char>* data;
 };
 
 struct SocketMsg {
@@ -27,42 +27,48 @@ SocketReadHelper::~SocketReadHelper() {
   // do nothing
 }
 
-SocketReadHelper::SocketReadHelper(int sockfd) {
+const size_t SocketReadHelper::kRecvBufSize;
+
+SocketReadHelper::SocketReadHelper(int sockfd, IOEventPoller* poller,
+                                   SocketWriteHelper* reply_helper) {
   sockfd_ = sockfd;
+  poller_ = poller;
+  reply_helper_ = reply_helper;
+  recv_buf_.resize(kRecvBufSize);
   SwitchToMsgHeadReadHandle();
 }
 
 void SocketReadHelper::NotifyMeSocketReadable() { ReadUntilSocketNotReadable(); }
 
 void SocketReadHelper::SwitchToMsgHeadReadHandle() {
-  cur_read_handle_ = &SocketReadHelper::MsgHeadReadHandle;
+  set_cur_read_done_ = &SocketReadHelper::SetStatusWhenMsgHeadDone;
   read_ptr_ = reinterpret_cast<char*>(&cur_msg_);
   read_size_ = sizeof(cur_msg_);
 }
 
 void SocketReadHelper::ReadUntilSocketNotReadable() {
-  while ((this->*cur_read_handle_)()) {}
-}
-
-bool SocketReadHelper::MsgHeadReadHandle() {
-  return DoCurRead(&SocketReadHelper::SetStatusWhenMsgHeadDone);
-}
-
-bool SocketReadHelper::MsgBodyReadHandle() {
-  return DoCurRead(&SocketReadHelper::SetStatusWhenMsgBodyDone);
+  while (DoRead()) {}
 }
 
-bool SocketReadHelper::DoCurRead(void (SocketReadHelper::*set_cur_read_done)()) {
-  ssize_t n = read(sockfd_, read_ptr_, read_size_);
+bool SocketReadHelper::DoRead() {
+  const bool read_in_place = read_size_ >= recv_buf_.size();
+  char* dst = read_in_place ? read_ptr_ : recv_buf_.data();
+  const size_t dst_size = read_in_place ? read_size_ : recv_buf_.size();
+  ssize_t n = read(sockfd_, dst, dst_size);
+  poller_->AddReadSyscall(n);
   const int val = 1;
   PCHECK(setsockopt(sockfd_, IPPROTO_TCP, TCP_QUICKACK, (char*)&val, sizeof(int)) == 0);
-  if (n == read_size_) {
-    (this->*set_cur_read_done)();
-    return true;
-  } else if (n >= 0) {
-    read_ptr_ += n;
-    read_size_ -= n;
+  if (n > 0) {
+    if (read_in_place) {
+      read_ptr_ += n;
+      read_size_ -= n;
+      FinishCurReadIfDone();
+    } else {
+      ConsumeRecvBuf(recv_buf_.data(), n);
+    }
     return true;
+  } else if (n == 0) {
+    return false;
   } else {
     CHECK_EQ(n, -1);
     PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
@@ -70,6 +76,23 @@ bool SocketReadHelper::DoCurRead(void (SocketReadHelper::*set_cur_read_done)())
   }
 }
 
+void SocketReadHelper::ConsumeRecvBuf(const char* data, size_t size) {
+  while (size > 0) {
+    const size_t copy_size = std::min(size, read_size_);
+    std::memcpy(read_ptr_, data, copy_size);
+    read_ptr_ += copy_size;
+    read_size_ -= copy_size;
+    data += copy_size;
+    size -= copy_size;
+    FinishCurReadIfDone();
+  }
+}
+
+void SocketReadHelper::FinishCurReadIfDone() {
+  // a body may be empty, then its head completes it as well
+  while (read_size_ == 0) { (this->*set_cur_read_done_)(); }
+}
+
 void SocketReadHelper::SetStatusWhenMsgHeadDone() {
   switch (cur_msg_.msg_type) {
 #define MAKE_ENTRY(x, y) \
@@ -82,7 +105,13 @@ void SocketReadHelper::SetStatusWhenMsgHeadDone() {
 
 void SocketReadHelper::SetStatusWhenMsgBodyDone() {
   if (cur_msg_.msg_type == SocketMsgType::kRequestRead) {
-    Global<EpollCommNet>::Get()->ReadDone(cur_msg_.request_read_msg.read_id);
+    Global<EpollCommNet>::Get()->ChunkReadDone(cur_msg_.request_read_msg.read_id,
+                                               cur_msg_.request_read_msg.chunk_num);
+  } else if (cur_msg_.msg_type == SocketMsgType::kActorBatch) {
+    Global<ActorMsgBus>::Get()->SendMsgBatchWithoutCommNet(actor_batch_buf_);
+  } else if (cur_msg_.msg_type == SocketMsgType::kCustom) {
+    Global<EpollCommNet>::Get()->HandleCustomMsg(cur_msg_.custom_msg.src_machine_id,
+                                                 cur_msg_.custom_msg.handler_id, &custom_msg_buf_);
   }
   SwitchToMsgHeadReadHandle();
 }
@@ -93,16 +122,18 @@ void SocketReadHelper::SetStatusWhenRequestWriteMsgHeadDone() {
   msg_to_send.request_read_msg.src_token = cur_msg_.request_write_msg.src_token;
   msg_to_send.request_read_msg.dst_token = cur_msg_.request_write_msg.dst_token;
   msg_to_send.request_read_msg.read_id = cur_msg_.request_write_msg.read_id;
-  Global<EpollCommNet>::Get()->SendSocketMsg(cur_msg_.request_write_msg.dst_machine_id,
-                                             msg_to_send);
+  msg_to_send.request_read_msg.offset = cur_msg_.request_write_msg.offset;
+  msg_to_send.request_read_msg.byte_size = cur_msg_.request_write_msg.byte_size;
+  msg_to_send.request_read_msg.chunk_num = cur_msg_.request_write_msg.chunk_num;
+  reply_helper_->AsyncWrite(msg_to_send);
   SwitchToMsgHeadReadHandle();
 }
 
 void SocketReadHelper::SetStatusWhenRequestReadMsgHeadDone() {
   auto mem_desc = static_cast<const SocketMemDesc*>(cur_msg_.request_read_msg.dst_token);
-  read_ptr_ = reinterpret_cast<char*>(mem_desc->mem_ptr);
-  read_size_ = mem_desc->byte_size;
-  cur_read_handle_ = &SocketReadHelper::MsgBodyReadHandle;
+  read_ptr_ = reinterpret_cast<char*>(mem_desc->mem_ptr) + cur_msg_.request_read_msg.offset;
+  read_size_ = cur_msg_.request_read_msg.byte_size;
+  set_cur_read_done_ = &SocketReadHelper::SetStatusWhenMsgBodyDone;
 }
 
 void SocketReadHelper::SetStatusWhenActorMsgHeadDone() {
@@ -110,6 +141,26 @@ void SocketReadHelper::SetStatusWhenActorMsgHeadDone() {
   SwitchToMsgHeadReadHandle();
 }
 
+void SocketReadHelper::SetStatusWhenActorBatchMsgHeadDone() {
+  actor_batch_buf_.resize(cur_msg_.actor_batch_msg.actor_msg_num);
+  read_ptr_ = reinterpret_cast<char*>(actor_batch_buf_.data());
+  read_size_ = actor_batch_buf_.size() * sizeof(ActorMsg);
+  set_cur_read_done_ = &SocketReadHelper::SetStatusWhenMsgBodyDone;
+}
+
+void SocketReadHelper::SetStatusWhenCustomMsgHeadDone() {
+  custom_msg_buf_.resize(cur_msg_.custom_msg.data_size);
+  if (custom_msg_buf_.empty()) {
+    Global<EpollCommNet>::Get()->HandleCustomMsg(cur_msg_.custom_msg.src_machine_id,
+                                                 cur_msg_.custom_msg.handler_id, &custom_msg_buf_);
+    SwitchToMsgHeadReadHandle();
+  } else {
+    read_ptr_ = custom_msg_buf_.data();
+    read_size_ = custom_msg_buf_.size();
+    set_cur_read_done_ = &SocketReadHelper::SetStatusWhenMsgBodyDone;
+  }
+}
+
 }  // namespace oneflow
 
 #endif  // PLATFORM_POSIX
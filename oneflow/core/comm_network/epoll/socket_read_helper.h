@@ -16,7 +16,9 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_READ_HELPER_H_
 #define ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_READ_HELPER_H_
 
+#include "oneflow/core/comm_network/epoll/io_event_poller.h"
 #include "oneflow/core/comm_network/epoll/socket_message.h"
+#include "oneflow/core/comm_network/epoll/socket_write_helper.h"
 
 #ifdef PLATFORM_POSIX
 
@@ -28,7 +30,8 @@ class SocketReadHelper final {
   SocketReadHelper() = delete;
   ~SocketReadHelper();
 
-  SocketReadHelper(int sockfd);
+  // requests for data are answered through reply_helper, on the connection they came in
+  SocketReadHelper(int sockfd, IOEventPoller* poller, SocketWriteHelper* reply_helper);
 
   void NotifyMeSocketReadable();
 
@@ -36,10 +39,11 @@ class SocketReadHelper final {
   void SwitchToMsgHeadReadHandle();
   void ReadUntilSocketNotReadable();
 
-  bool MsgHeadReadHandle();
-  bool MsgBodyReadHandle();
-
-  bool DoCurRead(void (SocketReadHelper::*set_cur_read_done)());
+  // one read() fills recv_buf_ and every message in it is parsed, only a body which does not
+  // fit into recv_buf_ is read straight into its destination
+  bool DoRead();
+  void ConsumeRecvBuf(const char* data, size_t size);
+  void FinishCurReadIfDone();
   void SetStatusWhenMsgHeadDone();
   void SetStatusWhenMsgBodyDone();
 
@@ -47,12 +51,19 @@ class SocketReadHelper final {
   OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
 #undef MAKE_ENTRY
 
+  static const size_t kRecvBufSize = 64 * 1024;
+
   int sockfd_;
+  IOEventPoller* poller_;
+  SocketWriteHelper* reply_helper_;
+  std::vector<char> recv_buf_;
 
   SocketMsg cur_msg_;
-  bool (SocketReadHelper::*cur_read_handle_)();
+  void (SocketReadHelper::*set_cur_read_done_)();
   char* read_ptr_;
   size_t read_size_;
+  std::vector<ActorMsg> actor_batch_buf_;
+  std::vector<char> custom_msg_buf_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,176 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/epoll/socket_util.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/job/global_for.h"
+
+#ifdef PLATFORM_POSIX
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace {
+
+sockaddr_in GetSockAddr(const std::string& addr, uint16_t port) {
+  sockaddr_in sa;
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(port);
+  PCHECK(inet_pton(AF_INET, addr.c_str(), &(sa.sin_addr)) == 1);
+  return sa;
+}
+
+int SockListen(int listen_sockfd, uint16_t listen_port, int32_t backlog) {
+  sockaddr_in sa = GetSockAddr("0.0.0.0", listen_port);
+  int bind_result = bind(listen_sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+  if (bind_result == 0) {
+    PCHECK(listen(listen_sockfd, backlog) == 0);
+    LOG(INFO) << "CommNet listening on "
+              << "0.0.0.0:" + std::to_string(listen_port);
+  } else {
+    PCHECK(errno == EACCES || errno == EADDRINUSE);
+  }
+  return bind_result;
+}
+
+int64_t GetMachineId(const sockaddr_in& sa) {
+  char addr[INET_ADDRSTRLEN];
+  memset(addr, '\0', sizeof(addr));
+  PCHECK(inet_ntop(AF_INET, &(sa.sin_addr), addr, INET_ADDRSTRLEN));
+  for (int64_t i = 0; i < Global<ResourceDesc, ForSession>::Get()->TotalMachineNum(); ++i) {
+    if (Global<ResourceDesc, ForSession>::Get()->machine(i).addr() == addr) { return i; }
+  }
+  UNIMPLEMENTED();
+}
+
+std::string GenPortKey(int64_t machine_id) { return "EpollPort/" + std::to_string(machine_id); }
+void PushPort(int64_t machine_id, uint16_t port) {
+  Global<CtrlClient>::Get()->PushKV(GenPortKey(machine_id), std::to_string(port));
+}
+void ClearPort(int64_t machine_id) { Global<CtrlClient>::Get()->ClearKV(GenPortKey(machine_id)); }
+uint16_t PullPort(int64_t machine_id) {
+  uint16_t port = 0;
+  Global<CtrlClient>::Get()->PullKV(
+      GenPortKey(machine_id), [&](const std::string& v) { port = oneflow_cast<uint16_t>(v); });
+  return port;
+}
+
+}  // namespace
+
+std::vector<std::vector<int>> ConnectPeerSockets(const HashSet<int64_t>& peer_machine_ids,
+                                                 int32_t connection_num_per_peer) {
+  int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  auto this_machine = Global<ResourceDesc, ForSession>::Get()->machine(this_machine_id);
+  int64_t total_machine_num = Global<ResourceDesc, ForSession>::Get()->TotalMachineNum();
+  std::vector<std::vector<int>> machine_id2sockfds(total_machine_num);
+
+  // listen, every peer may connect all of its connections before this machine accepts
+  const int32_t backlog = total_machine_num * connection_num_per_peer;
+  int listen_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  int32_t this_listen_port = Global<EnvDesc>::Get()->data_port();
+  if (this_listen_port != -1) {
+    CHECK_EQ(SockListen(listen_sockfd, this_listen_port, backlog), 0);
+    PushPort(this_machine_id,
+             ((this_machine.data_port_agent() != -1) ? (this_machine.data_port_agent())
+                                                     : (this_listen_port)));
+  } else {
+    for (this_listen_port = 1024; this_listen_port < GetMaxVal<uint16_t>(); ++this_listen_port) {
+      if (SockListen(listen_sockfd, this_listen_port, backlog) == 0) {
+        PushPort(this_machine_id, this_listen_port);
+        break;
+      }
+    }
+    CHECK_LT(this_listen_port, GetMaxVal<uint16_t>());
+  }
+  int32_t src_machine_count = 0;
+
+  // connect
+  for (int64_t peer_id : peer_machine_ids) {
+    if (peer_id < this_machine_id) {
+      ++src_machine_count;
+      continue;
+    }
+    uint16_t peer_port = PullPort(peer_id);
+    auto peer_machine = Global<ResourceDesc, ForSession>::Get()->machine(peer_id);
+    sockaddr_in peer_sockaddr = GetSockAddr(peer_machine.addr(), peer_port);
+    FOR_RANGE(int32_t, connection_idx, 0, connection_num_per_peer) {
+      int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+      const int val = 1;
+      PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
+      PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
+             == 0);
+      machine_id2sockfds[peer_id].push_back(sockfd);
+    }
+  }
+
+  // accept
+  FOR_RANGE(int32_t, idx, 0, src_machine_count * connection_num_per_peer) {
+    sockaddr_in peer_sockaddr;
+    socklen_t len = sizeof(peer_sockaddr);
+    int sockfd = accept(listen_sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), &len);
+    PCHECK(sockfd != -1);
+    int64_t peer_machine_id = GetMachineId(peer_sockaddr);
+    machine_id2sockfds[peer_machine_id].push_back(sockfd);
+  }
+  PCHECK(close(listen_sockfd) == 0);
+  ClearPort(this_machine_id);
+
+  // useful log
+  FOR_RANGE(int64_t, machine_id, 0, total_machine_num) {
+    std::stringstream sockfds;
+    for (int sockfd : machine_id2sockfds[machine_id]) { sockfds << " " << sockfd; }
+    LOG(INFO) << "machine " << machine_id << " sockfd" << sockfds.str();
+  }
+  return machine_id2sockfds;
+}
+
+std::vector<int> ConnectLoopbackSockets(int32_t connection_num) {
+  int listen_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  PCHECK(listen_sockfd != -1);
+  sockaddr_in sa = GetSockAddr("127.0.0.1", 0);
+  PCHECK(bind(listen_sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0);
+  PCHECK(listen(listen_sockfd, connection_num) == 0);
+  socklen_t len = sizeof(sa);
+  PCHECK(getsockname(listen_sockfd, reinterpret_cast<sockaddr*>(&sa), &len) == 0);
+  std::vector<int> sockfds;
+  FOR_RANGE(int32_t, i, 0, connection_num) {
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0);
+    sockfds.push_back(sockfd);
+  }
+  FOR_RANGE(int32_t, i, 0, connection_num) {
+    int sockfd = accept(listen_sockfd, nullptr, nullptr);
+    PCHECK(sockfd != -1);
+    sockfds.push_back(sockfd);
+  }
+  for (int sockfd : sockfds) {
+    int val = 1;
+    PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
+  }
+  PCHECK(close(listen_sockfd) == 0);
+  return sockfds;
+}
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
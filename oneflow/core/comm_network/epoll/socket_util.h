@@ -0,0 +1,39 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_UTIL_H_
+#define ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_UTIL_H_
+
+#include "oneflow/core/common/platform.h"
+#include "oneflow/core/common/util.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+// Opens connection_num_per_peer blocking TCP connections between this machine and every peer,
+// the result is indexed by machine id. Both sides may number the connections to a peer
+// differently, ordered messages only need the sender to stick to one connection.
+std::vector<std::vector<int>> ConnectPeerSockets(const HashSet<int64_t>& peer_machine_ids,
+                                                 int32_t connection_num_per_peer);
+// Opens connection_num TCP connections from this process to itself over loopback, the
+// connecting ends come first, for tests and benchmarks
+std::vector<int> ConnectLoopbackSockets(int32_t connection_num);
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_EPOLL_SOCKET_UTIL_H_
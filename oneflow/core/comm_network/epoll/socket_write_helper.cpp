@@ -22,7 +22,39 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+// the bytes following the head of msg on the wire
+void GetMsgBody(const SocketMsg& msg, const char** body_ptr, size_t* body_size) {
+  *body_ptr = nullptr;
+  *body_size = 0;
+  if (msg.msg_type == SocketMsgType::kRequestRead) {
+    auto src_mem_desc = static_cast<const SocketMemDesc*>(msg.request_read_msg.src_token);
+    *body_ptr = reinterpret_cast<const char*>(src_mem_desc->mem_ptr) + msg.request_read_msg.offset;
+    *body_size = msg.request_read_msg.byte_size;
+  } else if (msg.msg_type == SocketMsgType::kActorBatch) {
+    *body_ptr = reinterpret_cast<const char*>(msg.actor_batch_msg.actor_msgs);
+    *body_size = msg.actor_batch_msg.actor_msg_num * sizeof(ActorMsg);
+  } else if (msg.msg_type == SocketMsgType::kCustom) {
+    *body_ptr = msg.custom_msg.data->data();
+    *body_size = msg.custom_msg.data_size;
+  }
+}
+
+void ReleaseMsgBody(const SocketMsg& msg) {
+  if (msg.msg_type == SocketMsgType::kActorBatch) {
+    delete[] msg.actor_batch_msg.actor_msgs;
+  } else if (msg.msg_type == SocketMsgType::kCustom) {
+    delete msg.custom_msg.data;
+  }
+}
+
+}  // namespace
+
+const size_t SocketWriteHelper::kMaxIovNum;
+
 SocketWriteHelper::~SocketWriteHelper() {
+  for (const SocketMsg& msg : gathered_msgs_) { ReleaseMsgBody(msg); }
   delete cur_msg_queue_;
   cur_msg_queue_ = nullptr;
   {
@@ -38,11 +70,10 @@ SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller) {
   PCHECK(queue_not_empty_fd_ != -1);
   poller->AddFdWithOnlyReadHandler(queue_not_empty_fd_,
                                    std::bind(&SocketWriteHelper::ProcessQueueNotEmptyEvent, this));
+  poller_ = poller;
   cur_msg_queue_ = new std::queue<SocketMsg>;
   pending_msg_queue_ = new std::queue<SocketMsg>;
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-  write_ptr_ = nullptr;
-  write_size_ = 0;
+  iov_begin_ = 0;
 }
 
 void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
@@ -67,77 +98,72 @@ void SocketWriteHelper::ProcessQueueNotEmptyEvent() {
 }
 
 void SocketWriteHelper::WriteUntilMsgQueueEmptyOrSocketNotWriteable() {
-  while ((this->*cur_write_handle_)()) {}
-}
-
-bool SocketWriteHelper::InitMsgWriteHandle() {
-  if (cur_msg_queue_->empty()) {
-    {
-      std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
-      std::swap(cur_msg_queue_, pending_msg_queue_);
+  while (true) {
+    GatherMsgs();
+    if (iov_begin_ == iovs_.size()) { return; }
+    const int iov_num = static_cast<int>(std::min(iovs_.size() - iov_begin_, kMaxIovNum));
+    ssize_t n = writev(sockfd_, iovs_.data() + iov_begin_, iov_num);
+    poller_->AddWriteSyscall(n);
+    if (n == -1) {
+      PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+      return;
     }
-    if (cur_msg_queue_->empty()) { return false; }
+    ConsumeWritten(n);
   }
-  cur_msg_ = cur_msg_queue_->front();
-  cur_msg_queue_->pop();
-  write_ptr_ = reinterpret_cast<const char*>(&cur_msg_);
-  write_size_ = sizeof(cur_msg_);
-  cur_write_handle_ = &SocketWriteHelper::MsgHeadWriteHandle;
-  return true;
-}
-
-bool SocketWriteHelper::MsgHeadWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgHeadDone);
 }
 
-bool SocketWriteHelper::MsgBodyWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgBodyDone);
-}
-
-bool SocketWriteHelper::DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)()) {
-  ssize_t n = write(sockfd_, write_ptr_, write_size_);
-  if (n == write_size_) {
-    (this->*set_cur_write_done)();
-    return true;
-  } else if (n >= 0) {
-    write_ptr_ += n;
-    write_size_ -= n;
-    return true;
-  } else {
-    CHECK_EQ(n, -1);
-    PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
-    return false;
+void SocketWriteHelper::GatherMsgs() {
+  if (iov_begin_ == iovs_.size() || iov_begin_ >= kMaxIovNum) {
+    iovs_.erase(iovs_.begin(), iovs_.begin() + iov_begin_);
+    iov_ends_msg_.erase(iov_ends_msg_.begin(), iov_ends_msg_.begin() + iov_begin_);
+    iov_begin_ = 0;
   }
-}
-
-void SocketWriteHelper::SetStatusWhenMsgHeadDone() {
-  switch (cur_msg_.msg_type) {
-#define MAKE_ENTRY(x, y) \
-  case SocketMsgType::k##x: return SetStatusWhen##x##MsgHeadDone();
-    OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
-    default: UNIMPLEMENTED();
+  while (iovs_.size() - iov_begin_ < kMaxIovNum) {
+    if (cur_msg_queue_->empty()) {
+      {
+        std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
+        std::swap(cur_msg_queue_, pending_msg_queue_);
+      }
+      if (cur_msg_queue_->empty()) { return; }
+    }
+    GatherMsg(cur_msg_queue_->front());
+    cur_msg_queue_->pop();
   }
 }
 
-void SocketWriteHelper::SetStatusWhenMsgBodyDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestWriteMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestReadMsgHeadDone() {
-  const void* src_token = cur_msg_.request_read_msg.src_token;
-  auto src_mem_desc = static_cast<const SocketMemDesc*>(src_token);
-  write_ptr_ = reinterpret_cast<const char*>(src_mem_desc->mem_ptr);
-  write_size_ = src_mem_desc->byte_size;
-  cur_write_handle_ = &SocketWriteHelper::MsgBodyWriteHandle;
+void SocketWriteHelper::GatherMsg(const SocketMsg& msg) {
+  gathered_msgs_.push_back(msg);
+  iovec head_iov;
+  head_iov.iov_base = &gathered_msgs_.back();
+  head_iov.iov_len = sizeof(SocketMsg);
+  iovs_.push_back(head_iov);
+  const char* body_ptr = nullptr;
+  size_t body_size = 0;
+  GetMsgBody(msg, &body_ptr, &body_size);
+  iov_ends_msg_.push_back(body_size == 0);
+  if (body_size == 0) { return; }
+  iovec body_iov;
+  body_iov.iov_base = const_cast<char*>(body_ptr);
+  body_iov.iov_len = body_size;
+  iovs_.push_back(body_iov);
+  iov_ends_msg_.push_back(true);
 }
 
-void SocketWriteHelper::SetStatusWhenActorMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+void SocketWriteHelper::ConsumeWritten(size_t written_size) {
+  while (written_size > 0) {
+    iovec* iov = &iovs_.at(iov_begin_);
+    if (written_size < iov->iov_len) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + written_size;
+      iov->iov_len -= written_size;
+      return;
+    }
+    written_size -= iov->iov_len;
+    if (iov_ends_msg_.at(iov_begin_)) {
+      ReleaseMsgBody(gathered_msgs_.front());
+      gathered_msgs_.pop_front();
+    }
+    iov_begin_ += 1;
+  }
 }
 
 }  // namespace oneflow
@@ -21,6 +21,8 @@ limitations under the License.
 
 #ifdef PLATFORM_POSIX
 
+#include <sys/uio.h>
+
 namespace oneflow {
 
 class SocketWriteHelper final {
@@ -39,31 +41,30 @@ class SocketWriteHelper final {
   void SendQueueNotEmptyEvent();
   void ProcessQueueNotEmptyEvent();
 
+  // queued messages are gathered into iovecs, head and body of each message, and sent with
+  // one writev() per batch instead of one write() per head or body
   void WriteUntilMsgQueueEmptyOrSocketNotWriteable();
-  bool InitMsgWriteHandle();
-  bool MsgHeadWriteHandle();
-  bool MsgBodyWriteHandle();
-
-  bool DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)());
-  void SetStatusWhenMsgHeadDone();
-  void SetStatusWhenMsgBodyDone();
+  void GatherMsgs();
+  void GatherMsg(const SocketMsg& msg);
+  void ConsumeWritten(size_t written_size);
 
-#define MAKE_ENTRY(x, y) void SetStatusWhen##x##MsgHeadDone();
-  OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
+  static const size_t kMaxIovNum = 128;
 
   int sockfd_;
   int queue_not_empty_fd_;
+  IOEventPoller* poller_;
 
   std::queue<SocketMsg>* cur_msg_queue_;
 
   std::mutex pending_msg_queue_mtx_;
   std::queue<SocketMsg>* pending_msg_queue_;
 
-  SocketMsg cur_msg_;
-  bool (SocketWriteHelper::*cur_write_handle_)();
-  const char* write_ptr_;
-  size_t write_size_;
+  // gathered messages not completely written yet, the iovecs of their heads point into it
+  std::deque<SocketMsg> gathered_msgs_;
+  std::vector<iovec> iovs_;
+  // whether iovs_[i] is the last one of its message
+  std::vector<bool> iov_ends_msg_;
+  size_t iov_begin_;
 };
 
 }  // namespace oneflow
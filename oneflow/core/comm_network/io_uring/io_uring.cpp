@@ -0,0 +1,184 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/io_uring/io_uring.h"
+
+#if defined(WITH_IO_URING) && defined(PLATFORM_POSIX)
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace {
+
+char* MapRing(int fd, size_t size, off_t offset) {
+  void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+  PCHECK(ptr != MAP_FAILED);
+  return static_cast<char*>(ptr);
+}
+
+char* MapAnonymous(size_t size) {
+  void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  PCHECK(ptr != MAP_FAILED);
+  return static_cast<char*>(ptr);
+}
+
+}  // namespace
+
+const uint16_t IoUring::kBufGroupId;
+
+IoUring::IoUring(uint32_t entries)
+    : buf_ring_(nullptr),
+      buf_ring_size_(0),
+      bufs_(nullptr),
+      buf_num_(0),
+      buf_size_(0),
+      buf_ring_tail_(0),
+      enter_cnt_(0),
+      submitted_sqe_cnt_(0) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  // a multishot receive completes many times for one submission
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * 4;
+  fd_ = syscall(__NR_io_uring_setup, entries, &params);
+  PCHECK(fd_ >= 0) << "io_uring_setup failed";
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    sq_ring_ptr_ = MapRing(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+    cq_ring_ptr_ = sq_ring_ptr_;
+    cq_ring_size_ = 0;
+  } else {
+    sq_ring_ptr_ = MapRing(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+    cq_ring_ptr_ = MapRing(fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = reinterpret_cast<io_uring_sqe*>(MapRing(fd_, sqes_size_, IORING_OFF_SQES));
+
+  sq_head_ = reinterpret_cast<uint32_t*>(sq_ring_ptr_ + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<uint32_t*>(sq_ring_ptr_ + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<uint32_t*>(sq_ring_ptr_ + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  sqe_tail_ = *sq_tail_;
+  // entries are always submitted in ring order
+  uint32_t* sq_array = reinterpret_cast<uint32_t*>(sq_ring_ptr_ + params.sq_off.array);
+  FOR_RANGE(uint32_t, i, 0, sq_entries_) { sq_array[i] = i; }
+  cq_head_ = reinterpret_cast<uint32_t*>(cq_ring_ptr_ + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<uint32_t*>(cq_ring_ptr_ + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<uint32_t*>(cq_ring_ptr_ + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring_ptr_ + params.cq_off.cqes);
+}
+
+IoUring::~IoUring() {
+  // closing the ring cancels its requests and drops the registrations
+  PCHECK(close(fd_) == 0);
+  if (buf_ring_ != nullptr) {
+    PCHECK(munmap(bufs_, buf_num_ * buf_size_) == 0);
+    PCHECK(munmap(buf_ring_, buf_ring_size_) == 0);
+  }
+  PCHECK(munmap(sqes_, sqes_size_) == 0);
+  if (cq_ring_size_ > 0) { PCHECK(munmap(cq_ring_ptr_, cq_ring_size_) == 0); }
+  PCHECK(munmap(sq_ring_ptr_, sq_ring_size_) == 0);
+}
+
+io_uring_sqe* IoUring::GetSqe() {
+  const uint32_t head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (sqe_tail_ - head >= sq_entries_) { return nullptr; }
+  io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+  sqe_tail_ += 1;
+  std::memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+bool IoUring::Submit(uint32_t wait_nr) {
+  __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+  const uint32_t flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+  while (true) {
+    const uint32_t to_submit = sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (to_submit == 0 && wait_nr == 0) { return true; }
+    const int ret = syscall(__NR_io_uring_enter, fd_, to_submit, wait_nr, flags, nullptr, 0);
+    enter_cnt_ += 1;
+    if (ret >= 0) {
+      submitted_sqe_cnt_ += ret;
+      return true;
+    }
+    // EBUSY/EAGAIN: the completion queue is full, the caller reaps and submits again
+    PCHECK(errno == EINTR || errno == EBUSY || errno == EAGAIN);
+    if (errno != EINTR) { return false; }
+  }
+}
+
+size_t IoUring::ReapCqes(const std::function<void(const io_uring_cqe&)>& handler) {
+  const uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  size_t cnt = 0;
+  // a nested call from a handler may have consumed completions up to and beyond tail
+  while (static_cast<int32_t>(tail - *cq_head_) > 0) {
+    const uint32_t head = *cq_head_;
+    const io_uring_cqe cqe = cqes_[head & cq_mask_];
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    handler(cqe);
+    cnt += 1;
+  }
+  return cnt;
+}
+
+bool IoUring::RegisterBuffers(const std::vector<iovec>& iovs) {
+  if (iovs.empty()) { return true; }
+  if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iovs.data(), iovs.size())
+      != 0) {
+    PLOG(WARNING) << "io_uring refused " << iovs.size() << " fixed buffers";
+    return false;
+  }
+  return true;
+}
+
+void IoUring::SetupBufRing(uint32_t buf_num, uint32_t buf_size) {
+  CHECK(buf_ring_ == nullptr);
+  CHECK_EQ(buf_num & (buf_num - 1), 0) << "buf_num must be a power of two";
+  CHECK_LE(buf_num, 1 << 15);
+  buf_ring_size_ = RoundUp(buf_num * sizeof(io_uring_buf), sysconf(_SC_PAGESIZE));
+  buf_ring_ = reinterpret_cast<io_uring_buf_ring*>(MapAnonymous(buf_ring_size_));
+  io_uring_buf_reg reg;
+  std::memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+  reg.ring_entries = buf_num;
+  reg.bgid = kBufGroupId;
+  PCHECK(syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1) == 0)
+      << "io_uring provided buffer rings need Linux 5.19 or later";
+  buf_num_ = buf_num;
+  buf_size_ = buf_size;
+  bufs_ = MapAnonymous(buf_num_ * buf_size_);
+  FOR_RANGE(uint32_t, i, 0, buf_num_) { RecycleBuf(i); }
+}
+
+void IoUring::RecycleBuf(uint16_t buf_id) {
+  // the entries start at the ring itself, io_uring_buf_ring::bufs is placed after an empty
+  // struct by __DECLARE_FLEX_ARRAY and that struct is not empty in C++
+  io_uring_buf* buf =
+      reinterpret_cast<io_uring_buf*>(buf_ring_) + (buf_ring_tail_ & (buf_num_ - 1));
+  buf->addr = reinterpret_cast<uint64_t>(GetBuf(buf_id));
+  buf->len = buf_size_;
+  buf->bid = buf_id;
+  buf_ring_tail_ += 1;
+  __atomic_store_n(&buf_ring_->tail, buf_ring_tail_, __ATOMIC_RELEASE);
+}
+
+}  // namespace oneflow
+
+#endif  // WITH_IO_URING && PLATFORM_POSIX
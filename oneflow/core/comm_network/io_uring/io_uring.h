@@ -0,0 +1,95 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_H_
+#define ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_H_
+
+#include "oneflow/core/common/platform.h"
+#include "oneflow/core/common/util.h"
+
+#if defined(WITH_IO_URING) && defined(PLATFORM_POSIX)
+
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+namespace oneflow {
+
+// An io_uring instance on the raw syscalls, owned by one thread. Entries queued with GetSqe()
+// are handed to the kernel together by one Submit().
+class IoUring final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(IoUring);
+  explicit IoUring(uint32_t entries);
+  ~IoUring();
+
+  // returns nullptr when the submission queue is full, Submit() makes room
+  io_uring_sqe* GetSqe();
+  // submits the queued entries and waits for at least wait_nr completions, returns false if the
+  // kernel refused them because the completion queue is full, reaping makes room
+  bool Submit(uint32_t wait_nr);
+  // handler runs for the completions there are, returns their number. A completion is consumed
+  // before its handler runs, so the handler may reap and submit itself
+  size_t ReapCqes(const std::function<void(const io_uring_cqe&)>& handler);
+
+  // fixed buffers of IORING_OP_READ_FIXED/WRITE_FIXED, returns false if the kernel refuses them,
+  // e.g. because of RLIMIT_MEMLOCK
+  bool RegisterBuffers(const std::vector<iovec>& iovs);
+  // buffers picked by the kernel for receives with IOSQE_BUFFER_SELECT from kBufGroupId,
+  // buf_num must be a power of two
+  void SetupBufRing(uint32_t buf_num, uint32_t buf_size);
+  const char* GetBuf(uint16_t buf_id) const { return bufs_ + buf_id * buf_size_; }
+  // gives a buffer back to the kernel once its data has been consumed
+  void RecycleBuf(uint16_t buf_id);
+
+  int64_t enter_cnt() const { return enter_cnt_; }
+  int64_t submitted_sqe_cnt() const { return submitted_sqe_cnt_; }
+
+  static const uint16_t kBufGroupId = 0;
+
+ private:
+  int fd_;
+  char* sq_ring_ptr_;
+  size_t sq_ring_size_;
+  char* cq_ring_ptr_;
+  size_t cq_ring_size_;
+  io_uring_sqe* sqes_;
+  size_t sqes_size_;
+
+  uint32_t* sq_head_;
+  uint32_t* sq_tail_;
+  uint32_t sq_mask_;
+  uint32_t sq_entries_;
+  uint32_t sqe_tail_;
+  uint32_t* cq_head_;
+  uint32_t* cq_tail_;
+  uint32_t cq_mask_;
+  io_uring_cqe* cqes_;
+
+  io_uring_buf_ring* buf_ring_;
+  size_t buf_ring_size_;
+  char* bufs_;
+  uint32_t buf_num_;
+  uint32_t buf_size_;
+  uint16_t buf_ring_tail_;
+
+  int64_t enter_cnt_;
+  int64_t submitted_sqe_cnt_;
+};
+
+}  // namespace oneflow
+
+#endif  // WITH_IO_URING && PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_H_
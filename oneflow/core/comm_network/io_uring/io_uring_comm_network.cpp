@@ -0,0 +1,160 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/io_uring/io_uring_comm_network.h"
+#include "oneflow/core/comm_network/epoll/socket_util.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
+
+#if defined(WITH_IO_URING) && defined(PLATFORM_POSIX)
+
+namespace oneflow {
+
+namespace {
+
+// limits of the kernel on fixed buffers
+const size_t kMaxFixedBufSize = 1UL << 30;
+const size_t kMaxFixedBufNum = 1 << 14;
+
+}  // namespace
+
+IoUringCommNet::~IoUringCommNet() {
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    LOG(INFO) << "CommNet Thread " << i << " finish";
+    workers_[i]->Stop();
+  }
+  if (sync_peers_on_destroy_) { OF_BARRIER(); }
+  for (IoUringWorker* worker : workers_) { delete worker; }
+  for (const auto& conns : machine_id2conns_) {
+    for (IoUringConnection* conn : conns) { delete conn; }
+  }
+}
+
+void IoUringCommNet::RegisterMemoryDone() {
+  // every ring gets the same fixed buffers, so the index of a buffer is valid on all of them
+  std::vector<iovec> iovs;
+  for (IoUringMemDesc* mem_desc : mem_descs()) {
+    if (iovs.size() == kMaxFixedBufNum) { break; }
+    if (mem_desc->byte_size > kMaxFixedBufSize) { continue; }
+    mem_desc->buf_index = iovs.size();
+    iovec iov;
+    iov.iov_base = mem_desc->mem_ptr;
+    iov.iov_len = mem_desc->byte_size;
+    iovs.push_back(iov);
+  }
+  bool is_registered = true;
+  for (IoUringWorker* worker : workers_) {
+    is_registered = is_registered && worker->RegisterBuffers(iovs);
+  }
+  if (!is_registered) {
+    LOG(WARNING) << "CommNet:IoUring runs without fixed buffers";
+    for (IoUringMemDesc* mem_desc : mem_descs()) { mem_desc->buf_index = -1; }
+  }
+}
+
+void IoUringCommNet::SendActorMsg(int64_t dst_machine_id, const ActorMsg& actor_msg) {
+  SocketMsg msg;
+  msg.msg_type = SocketMsgType::kActor;
+  msg.actor_msg = actor_msg;
+  GetConnection(dst_machine_id, 0)->AsyncWrite(msg);
+}
+
+void IoUringCommNet::SendActorMsgBatch(int64_t dst_machine_id,
+                                       const std::vector<ActorMsg>& actor_msgs) {
+  if (actor_msgs.size() == 1) { return SendActorMsg(dst_machine_id, actor_msgs.front()); }
+  SocketMsg msg;
+  msg.msg_type = SocketMsgType::kActorBatch;
+  msg.actor_batch_msg.actor_msg_num = actor_msgs.size();
+  msg.actor_batch_msg.actor_msgs = new ActorMsg[actor_msgs.size()];
+  std::copy(actor_msgs.begin(), actor_msgs.end(), msg.actor_batch_msg.actor_msgs);
+  GetConnection(dst_machine_id, 0)->AsyncWrite(msg);
+}
+
+void IoUringCommNet::SendCustomMsg(int64_t dst_machine_id, int64_t handler_id,
+                                   std::vector<char>&& data) {
+  SocketMsg msg;
+  msg.msg_type = SocketMsgType::kCustom;
+  msg.custom_msg.src_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  msg.custom_msg.handler_id = handler_id;
+  msg.custom_msg.data_size = data.size();
+  msg.custom_msg.data = new std::vector<char>(std::move(data));
+  GetConnection(dst_machine_id, 0)->AsyncWrite(msg);
+}
+
+IoUringMemDesc* IoUringCommNet::NewMemDesc(void* ptr, size_t byte_size) {
+  IoUringMemDesc* mem_desc = new IoUringMemDesc;
+  mem_desc->mem_ptr = ptr;
+  mem_desc->byte_size = byte_size;
+  mem_desc->buf_index = -1;
+  return mem_desc;
+}
+
+IoUringCommNet::IoUringCommNet(const Plan& plan)
+    : CommNetIf(plan), sync_peers_on_destroy_(true), read_cnt_(0) {
+  const int32_t connection_num_per_peer =
+      Global<ResourceDesc, ForSession>::Get()->CommNetConnectionNumPerPeer();
+  CHECK_GE(connection_num_per_peer, 1);
+  InitWorkersAndConnections(ConnectPeerSockets(peer_machine_id(), connection_num_per_peer));
+}
+
+IoUringCommNet::IoUringCommNet(const Plan& plan,
+                               std::vector<std::vector<int>>&& machine_id2sockfds)
+    : CommNetIf(plan), sync_peers_on_destroy_(false), read_cnt_(0) {
+  InitWorkersAndConnections(machine_id2sockfds);
+}
+
+void IoUringCommNet::InitWorkersAndConnections(
+    const std::vector<std::vector<int>>& machine_id2sockfds) {
+  workers_.resize(Global<ResourceDesc, ForSession>::Get()->CommNetWorkerNum(), nullptr);
+  for (size_t i = 0; i < workers_.size(); ++i) { workers_[i] = new IoUringWorker; }
+  machine_id2conns_.resize(machine_id2sockfds.size());
+  size_t worker_idx = 0;
+  FOR_RANGE(size_t, machine_id, 0, machine_id2sockfds.size()) {
+    for (int sockfd : machine_id2sockfds.at(machine_id)) {
+      IoUringWorker* worker = workers_.at(worker_idx);
+      worker_idx = (worker_idx + 1) % workers_.size();
+      IoUringConnection* conn = new IoUringConnection(sockfd, worker);
+      worker->AddConnection(conn);
+      machine_id2conns_.at(machine_id).push_back(conn);
+    }
+  }
+  for (IoUringWorker* worker : workers_) { worker->Start(); }
+}
+
+IoUringConnection* IoUringCommNet::GetConnection(int64_t machine_id, int64_t connection_idx) {
+  return machine_id2conns_.at(machine_id).at(connection_idx);
+}
+
+void IoUringCommNet::DoRead(void* read_id, int64_t src_machine_id, void* src_token,
+                            void* dst_token) {
+  SocketMsg msg;
+  msg.msg_type = SocketMsgType::kRequestWrite;
+  msg.request_write_msg.src_token = src_token;
+  msg.request_write_msg.dst_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  msg.request_write_msg.dst_token = dst_token;
+  msg.request_write_msg.read_id = read_id;
+  msg.request_write_msg.offset = 0;
+  msg.request_write_msg.byte_size = static_cast<const IoUringMemDesc*>(dst_token)->byte_size;
+  msg.request_write_msg.chunk_num = 1;
+  const int64_t connection_num = machine_id2conns_.at(src_machine_id).size();
+  const int64_t read_cnt = read_cnt_.fetch_add(1, std::memory_order_relaxed);
+  GetConnection(src_machine_id, read_cnt % connection_num)->AsyncWrite(msg);
+}
+
+}  // namespace oneflow
+
+#endif  // WITH_IO_URING && PLATFORM_POSIX
@@ -0,0 +1,76 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_COMM_NETWORK_H_
+#define ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_COMM_NETWORK_H_
+
+#include "oneflow/core/comm_network/comm_network.h"
+#include "oneflow/core/comm_network/io_uring/io_uring_memory_desc.h"
+#include "oneflow/core/comm_network/io_uring/io_uring_worker.h"
+
+#if defined(WITH_IO_URING) && defined(PLATFORM_POSIX)
+
+namespace oneflow {
+
+// CommNet over TCP like EpollCommNet, with the same messages on the wire, driven by io_uring
+// instead of readiness notifications. Registered memory becomes fixed buffers of the rings.
+class IoUringCommNet final : public CommNetIf<IoUringMemDesc> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(IoUringCommNet);
+  ~IoUringCommNet();
+
+  static void Init(const Plan& plan) { Global<CommNet>::SetAllocated(new IoUringCommNet(plan)); }
+  // takes connected sockets indexed by machine id like EpollCommNet::InitWithSockets
+  static void InitWithSockets(const Plan& plan,
+                              std::vector<std::vector<int>>&& machine_id2sockfds) {
+    Global<CommNet>::SetAllocated(new IoUringCommNet(plan, std::move(machine_id2sockfds)));
+  }
+
+  void RegisterMemoryDone() override;
+
+  void SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) override;
+  void SendActorMsgBatch(int64_t dst_machine_id, const std::vector<ActorMsg>& msgs) override;
+  void SendCustomMsg(int64_t dst_machine_id, int64_t handler_id,
+                     std::vector<char>&& data) override;
+
+ private:
+  IoUringMemDesc* NewMemDesc(void* ptr, size_t byte_size) override;
+
+  IoUringCommNet(const Plan& plan);
+  IoUringCommNet(const Plan& plan, std::vector<std::vector<int>>&& machine_id2sockfds);
+  void InitWorkersAndConnections(const std::vector<std::vector<int>>& machine_id2sockfds);
+  // messages which have to stay in order go through the first connection to a machine
+  IoUringConnection* GetConnection(int64_t machine_id, int64_t connection_idx);
+  void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) override;
+
+  // peers of sockets handed in are not known to the control plane
+  const bool sync_peers_on_destroy_;
+  std::vector<IoUringWorker*> workers_;
+  std::vector<std::vector<IoUringConnection*>> machine_id2conns_;
+  // spreads reads over the connections
+  std::atomic<int64_t> read_cnt_;
+};
+
+template<>
+class Global<IoUringCommNet> final {
+ public:
+  static IoUringCommNet* Get() { return static_cast<IoUringCommNet*>(Global<CommNet>::Get()); }
+};
+
+}  // namespace oneflow
+
+#endif  // WITH_IO_URING && PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_COMM_NETWORK_H_
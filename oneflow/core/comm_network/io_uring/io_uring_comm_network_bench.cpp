@@ -0,0 +1,78 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/io_uring/io_uring_comm_network.h"
+#include "oneflow/core/comm_network/epoll/socket_util.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/resource_desc.h"
+
+#if defined(WITH_IO_URING) && defined(PLATFORM_POSIX)
+
+namespace oneflow {
+
+namespace {
+
+// the same loopback reads as the EpollCommNet benchmark, so that the two can be compared
+void BenchmarkLoopbackRead(BenchmarkState* state, size_t byte_size) {
+  Resource resource;
+  resource.set_machine_num(1);
+  resource.set_comm_net_worker_num(4);
+  resource.set_comm_net_connection_num_per_peer(1);
+  Global<ResourceDesc, ForSession>::New(resource);
+  Global<MachineCtx>::New(0);
+  Plan plan;
+  (*plan.mutable_net_topo()->mutable_peer_machine_ids())[0].add_machine_id(0);
+  std::vector<std::vector<int>> machine_id2sockfds(1);
+  machine_id2sockfds.at(0) = ConnectLoopbackSockets(1);
+  IoUringCommNet::InitWithSockets(plan, std::move(machine_id2sockfds));
+  CommNet* comm_net = Global<CommNet>::Get();
+
+  std::vector<char> src(byte_size, 1);
+  std::vector<char> dst(byte_size, 0);
+  void* src_token = comm_net->RegisterMemory(src.data(), byte_size);
+  void* dst_token = comm_net->RegisterMemory(dst.data(), byte_size);
+  comm_net->RegisterMemoryDone();
+  void* actor_read_id = comm_net->NewActorReadId();
+  while (state->KeepRunning()) {
+    BlockingCounter counter(1);
+    comm_net->Read(actor_read_id, 0, src_token, dst_token);
+    comm_net->AddReadCallBack(actor_read_id, [&counter]() { counter.Decrease(); });
+    counter.WaitUntilCntEqualZero();
+  }
+  CHECK_EQ(dst.front(), 1);
+  CHECK_EQ(dst.back(), 1);
+  state->SetBytesProcessed(state->iterations() * byte_size);
+
+  comm_net->DeleteActorReadId(actor_read_id);
+  comm_net->UnRegisterMemory(src_token);
+  comm_net->UnRegisterMemory(dst_token);
+  Global<CommNet>::Delete();
+  Global<MachineCtx>::Delete();
+  Global<ResourceDesc, ForSession>::Delete();
+}
+
+}  // namespace
+
+OF_BENCHMARK(IoUringCommNetLoopbackRead4KiB) { BenchmarkLoopbackRead(state, 4 << 10); }
+
+OF_BENCHMARK(IoUringCommNetLoopbackRead1MiB) { BenchmarkLoopbackRead(state, 1 << 20); }
+
+OF_BENCHMARK(IoUringCommNetLoopbackRead64MiB) { BenchmarkLoopbackRead(state, 64 << 20); }
+
+}  // namespace oneflow
+
+#endif  // WITH_IO_URING && PLATFORM_POSIX
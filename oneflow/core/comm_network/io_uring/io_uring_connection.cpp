@@ -0,0 +1,329 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/io_uring/io_uring_connection.h"
+#include "oneflow/core/comm_network/io_uring/io_uring_comm_network.h"
+#include "oneflow/core/comm_network/io_uring/io_uring_worker.h"
+#include "oneflow/core/actor/actor_message_bus.h"
+
+#if defined(WITH_IO_URING) && defined(PLATFORM_POSIX)
+
+namespace oneflow {
+
+namespace {
+
+// the bytes following the head of msg on the wire
+void GetMsgBody(const SocketMsg& msg, const char** body_ptr, size_t* body_size) {
+  *body_ptr = nullptr;
+  *body_size = 0;
+  if (msg.msg_type == SocketMsgType::kRequestRead) {
+    auto src_mem_desc = static_cast<const IoUringMemDesc*>(msg.request_read_msg.src_token);
+    *body_ptr = reinterpret_cast<const char*>(src_mem_desc->mem_ptr) + msg.request_read_msg.offset;
+    *body_size = msg.request_read_msg.byte_size;
+  } else if (msg.msg_type == SocketMsgType::kActorBatch) {
+    *body_ptr = reinterpret_cast<const char*>(msg.actor_batch_msg.actor_msgs);
+    *body_size = msg.actor_batch_msg.actor_msg_num * sizeof(ActorMsg);
+  } else if (msg.msg_type == SocketMsgType::kCustom) {
+    *body_ptr = msg.custom_msg.data->data();
+    *body_size = msg.custom_msg.data_size;
+  }
+}
+
+void ReleaseMsgBody(const SocketMsg& msg) {
+  if (msg.msg_type == SocketMsgType::kActorBatch) {
+    delete[] msg.actor_batch_msg.actor_msgs;
+  } else if (msg.msg_type == SocketMsgType::kCustom) {
+    delete msg.custom_msg.data;
+  }
+}
+
+}  // namespace
+
+const size_t IoUringConnection::kMaxIovNum;
+const size_t IoUringConnection::kDirectBodyMinSize;
+
+IoUringConnection::IoUringConnection(int sockfd, IoUringWorker* worker)
+    : sockfd_(sockfd),
+      worker_(worker),
+      iov_begin_(0),
+      is_sending_(false),
+      is_multishot_armed_(false),
+      is_multishot_cancelling_(false) {
+  SwitchToMsgHeadReadHandle();
+}
+
+IoUringConnection::~IoUringConnection() {
+  for (const SocketMsg& msg : out_msgs_) { ReleaseMsgBody(msg); }
+  for (const SocketMsg& msg : gathered_msgs_) { ReleaseMsgBody(msg); }
+  PCHECK(close(sockfd_) == 0);
+}
+
+void IoUringConnection::AsyncWrite(const SocketMsg& msg) { worker_->PostMsg(this, msg); }
+
+void IoUringConnection::PushOutMsg(const SocketMsg& msg) { out_msgs_.push_back(msg); }
+
+void IoUringConnection::Start() { ContinueRecv(); }
+
+void IoUringConnection::PrepareSend() {
+  if (is_sending_) { return; }
+  GatherMsgs();
+  if (iov_begin_ == iovs_.size()) { return; }
+  io_uring_sqe* sqe = worker_->GetSqe();
+  sqe->fd = sockfd_;
+  sqe->user_data = UserData(IoUringReqType::kSend);
+  const int32_t buf_index = iov_buf_indexes_.at(iov_begin_);
+  if (buf_index >= 0) {
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->addr = reinterpret_cast<uint64_t>(iovs_.at(iov_begin_).iov_base);
+    sqe->len = iovs_.at(iov_begin_).iov_len;
+    sqe->buf_index = buf_index;
+  } else {
+    size_t iov_num = 1;
+    while (iov_begin_ + iov_num < iovs_.size() && iov_num < kMaxIovNum
+           && iov_buf_indexes_.at(iov_begin_ + iov_num) < 0) {
+      iov_num += 1;
+    }
+    // the kernel copies the iovecs when the request is submitted
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->addr = reinterpret_cast<uint64_t>(iovs_.data() + iov_begin_);
+    sqe->len = iov_num;
+  }
+  is_sending_ = true;
+}
+
+void IoUringConnection::OnSendDone(int32_t res) {
+  CHECK_GT(res, 0) << "io_uring send failed: " << strerror(-res);
+  is_sending_ = false;
+  ConsumeWritten(res);
+}
+
+void IoUringConnection::GatherMsgs() {
+  if (iov_begin_ == iovs_.size() || iov_begin_ >= kMaxIovNum) {
+    iovs_.erase(iovs_.begin(), iovs_.begin() + iov_begin_);
+    iov_ends_msg_.erase(iov_ends_msg_.begin(), iov_ends_msg_.begin() + iov_begin_);
+    iov_buf_indexes_.erase(iov_buf_indexes_.begin(), iov_buf_indexes_.begin() + iov_begin_);
+    iov_begin_ = 0;
+  }
+  while (iovs_.size() - iov_begin_ < kMaxIovNum && !out_msgs_.empty()) {
+    GatherMsg(out_msgs_.front());
+    out_msgs_.pop_front();
+  }
+}
+
+void IoUringConnection::GatherMsg(const SocketMsg& msg) {
+  gathered_msgs_.push_back(msg);
+  iovec head_iov;
+  head_iov.iov_base = &gathered_msgs_.back();
+  head_iov.iov_len = sizeof(SocketMsg);
+  iovs_.push_back(head_iov);
+  iov_buf_indexes_.push_back(-1);
+  const char* body_ptr = nullptr;
+  size_t body_size = 0;
+  GetMsgBody(msg, &body_ptr, &body_size);
+  iov_ends_msg_.push_back(body_size == 0);
+  if (body_size == 0) { return; }
+  iovec body_iov;
+  body_iov.iov_base = const_cast<char*>(body_ptr);
+  body_iov.iov_len = body_size;
+  iovs_.push_back(body_iov);
+  iov_ends_msg_.push_back(true);
+  int32_t buf_index = -1;
+  if (msg.msg_type == SocketMsgType::kRequestRead && body_size >= kDirectBodyMinSize) {
+    buf_index = static_cast<const IoUringMemDesc*>(msg.request_read_msg.src_token)->buf_index;
+  }
+  iov_buf_indexes_.push_back(buf_index);
+}
+
+void IoUringConnection::ConsumeWritten(size_t written_size) {
+  while (written_size > 0) {
+    iovec* iov = &iovs_.at(iov_begin_);
+    if (written_size < iov->iov_len) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + written_size;
+      iov->iov_len -= written_size;
+      return;
+    }
+    written_size -= iov->iov_len;
+    if (iov_ends_msg_.at(iov_begin_)) {
+      ReleaseMsgBody(gathered_msgs_.front());
+      gathered_msgs_.pop_front();
+    }
+    iov_begin_ += 1;
+  }
+}
+
+void IoUringConnection::OnRecvDone(const io_uring_cqe& cqe) {
+  if (cqe.res > 0) {
+    CHECK(cqe.flags & IORING_CQE_F_BUFFER);
+    const uint16_t buf_id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+    ConsumeRecvBuf(worker_->ring()->GetBuf(buf_id), cqe.res);
+    worker_->ring()->RecycleBuf(buf_id);
+  } else if (cqe.res < 0) {
+    // the provided buffers ran out or the receive was cancelled for a regst body
+    CHECK(cqe.res == -ENOBUFS || cqe.res == -ECANCELED)
+        << "io_uring receive failed: " << strerror(-cqe.res);
+  }
+  if (cqe.flags & IORING_CQE_F_MORE) {
+    if (NeedDirectRecv() && !is_multishot_cancelling_) {
+      is_multishot_cancelling_ = true;
+      io_uring_sqe* sqe = worker_->GetSqe();
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd = -1;
+      sqe->addr = UserData(IoUringReqType::kRecv);
+      sqe->user_data = UserData(IoUringReqType::kCancel);
+    }
+  } else {
+    is_multishot_armed_ = false;
+    is_multishot_cancelling_ = false;
+    // the peer closed the connection
+    if (cqe.res == 0) { return; }
+    ContinueRecv();
+  }
+}
+
+void IoUringConnection::OnDirectRecvDone(int32_t res) {
+  CHECK_GT(res, 0) << "io_uring receive failed: " << strerror(-res);
+  read_ptr_ += res;
+  read_size_ -= res;
+  FinishCurReadIfDone();
+  ContinueRecv();
+}
+
+bool IoUringConnection::NeedDirectRecv() const {
+  return is_reading_regst_body_ && read_size_ >= kDirectBodyMinSize;
+}
+
+void IoUringConnection::ContinueRecv() {
+  CHECK(!is_multishot_armed_);
+  io_uring_sqe* sqe = worker_->GetSqe();
+  sqe->fd = sockfd_;
+  if (NeedDirectRecv()) {
+    sqe->addr = reinterpret_cast<uint64_t>(read_ptr_);
+    sqe->len = read_size_;
+    sqe->user_data = UserData(IoUringReqType::kDirectRecv);
+    if (body_buf_index_ >= 0) {
+      sqe->opcode = IORING_OP_READ_FIXED;
+      sqe->buf_index = body_buf_index_;
+    } else {
+      sqe->opcode = IORING_OP_RECV;
+      sqe->msg_flags = MSG_WAITALL;
+    }
+  } else {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = IoUring::kBufGroupId;
+    sqe->user_data = UserData(IoUringReqType::kRecv);
+    is_multishot_armed_ = true;
+  }
+}
+
+void IoUringConnection::ConsumeRecvBuf(const char* data, size_t size) {
+  while (size > 0) {
+    const size_t copy_size = std::min(size, read_size_);
+    std::memcpy(read_ptr_, data, copy_size);
+    read_ptr_ += copy_size;
+    read_size_ -= copy_size;
+    data += copy_size;
+    size -= copy_size;
+    FinishCurReadIfDone();
+  }
+}
+
+void IoUringConnection::FinishCurReadIfDone() {
+  // a body may be empty, then its head completes it as well
+  while (read_size_ == 0) { (this->*set_cur_read_done_)(); }
+}
+
+void IoUringConnection::SwitchToMsgHeadReadHandle() {
+  set_cur_read_done_ = &IoUringConnection::SetStatusWhenMsgHeadDone;
+  read_ptr_ = reinterpret_cast<char*>(&cur_msg_);
+  read_size_ = sizeof(cur_msg_);
+  body_buf_index_ = -1;
+  is_reading_regst_body_ = false;
+}
+
+void IoUringConnection::SetStatusWhenMsgHeadDone() {
+  switch (cur_msg_.msg_type) {
+#define MAKE_ENTRY(x, y) \
+  case SocketMsgType::k##x: SetStatusWhen##x##MsgHeadDone(); break;
+    OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
+#undef MAKE_ENTRY
+    default: UNIMPLEMENTED();
+  }
+}
+
+void IoUringConnection::SetStatusWhenMsgBodyDone() {
+  if (cur_msg_.msg_type == SocketMsgType::kRequestRead) {
+    Global<IoUringCommNet>::Get()->ReadDone(cur_msg_.request_read_msg.read_id);
+  } else if (cur_msg_.msg_type == SocketMsgType::kActorBatch) {
+    Global<ActorMsgBus>::Get()->SendMsgBatchWithoutCommNet(actor_batch_buf_);
+  } else if (cur_msg_.msg_type == SocketMsgType::kCustom) {
+    Global<IoUringCommNet>::Get()->HandleCustomMsg(
+        cur_msg_.custom_msg.src_machine_id, cur_msg_.custom_msg.handler_id, &custom_msg_buf_);
+  }
+  SwitchToMsgHeadReadHandle();
+}
+
+void IoUringConnection::SetStatusWhenRequestWriteMsgHeadDone() {
+  SocketMsg msg_to_send;
+  msg_to_send.msg_type = SocketMsgType::kRequestRead;
+  msg_to_send.request_read_msg.src_token = cur_msg_.request_write_msg.src_token;
+  msg_to_send.request_read_msg.dst_token = cur_msg_.request_write_msg.dst_token;
+  msg_to_send.request_read_msg.read_id = cur_msg_.request_write_msg.read_id;
+  msg_to_send.request_read_msg.offset = cur_msg_.request_write_msg.offset;
+  msg_to_send.request_read_msg.byte_size = cur_msg_.request_write_msg.byte_size;
+  msg_to_send.request_read_msg.chunk_num = cur_msg_.request_write_msg.chunk_num;
+  // the reply goes out on this connection, the worker sends it on its next turn
+  PushOutMsg(msg_to_send);
+  SwitchToMsgHeadReadHandle();
+}
+
+void IoUringConnection::SetStatusWhenRequestReadMsgHeadDone() {
+  auto mem_desc = static_cast<const IoUringMemDesc*>(cur_msg_.request_read_msg.dst_token);
+  read_ptr_ = reinterpret_cast<char*>(mem_desc->mem_ptr) + cur_msg_.request_read_msg.offset;
+  read_size_ = cur_msg_.request_read_msg.byte_size;
+  body_buf_index_ = mem_desc->buf_index;
+  is_reading_regst_body_ = true;
+  set_cur_read_done_ = &IoUringConnection::SetStatusWhenMsgBodyDone;
+}
+
+void IoUringConnection::SetStatusWhenActorMsgHeadDone() {
+  Global<ActorMsgBus>::Get()->SendMsgWithoutCommNet(cur_msg_.actor_msg);
+  SwitchToMsgHeadReadHandle();
+}
+
+void IoUringConnection::SetStatusWhenActorBatchMsgHeadDone() {
+  actor_batch_buf_.resize(cur_msg_.actor_batch_msg.actor_msg_num);
+  read_ptr_ = reinterpret_cast<char*>(actor_batch_buf_.data());
+  read_size_ = actor_batch_buf_.size() * sizeof(ActorMsg);
+  set_cur_read_done_ = &IoUringConnection::SetStatusWhenMsgBodyDone;
+}
+
+void IoUringConnection::SetStatusWhenCustomMsgHeadDone() {
+  custom_msg_buf_.resize(cur_msg_.custom_msg.data_size);
+  if (custom_msg_buf_.empty()) {
+    Global<IoUringCommNet>::Get()->HandleCustomMsg(
+        cur_msg_.custom_msg.src_machine_id, cur_msg_.custom_msg.handler_id, &custom_msg_buf_);
+    SwitchToMsgHeadReadHandle();
+  } else {
+    read_ptr_ = custom_msg_buf_.data();
+    read_size_ = custom_msg_buf_.size();
+    set_cur_read_done_ = &IoUringConnection::SetStatusWhenMsgBodyDone;
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // WITH_IO_URING && PLATFORM_POSIX
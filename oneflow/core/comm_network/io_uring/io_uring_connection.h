@@ -0,0 +1,113 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_CONNECTION_H_
+#define ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_CONNECTION_H_
+
+#include "oneflow/core/comm_network/epoll/socket_message.h"
+#include "oneflow/core/comm_network/io_uring/io_uring.h"
+
+#if defined(WITH_IO_URING) && defined(PLATFORM_POSIX)
+
+namespace oneflow {
+
+class IoUringWorker;
+
+// the low bits of a request's user_data tell its type, the rest points to the connection
+enum class IoUringReqType : uint64_t {
+  kWakeup = 0,
+  kSend,
+  kRecv,
+  kDirectRecv,
+  kCancel,
+};
+const uint64_t kIoUringReqTypeMask = 7;
+
+// A TCP connection driven by the requests of its worker's ring, everything but AsyncWrite()
+// runs on the worker's thread. Messages go out in gathering writes, one in flight at a time,
+// and come in through a multishot receive into the ring's provided buffers. A large regst body
+// is received straight into the regst instead, the multishot receive is cancelled for it.
+class IoUringConnection final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(IoUringConnection);
+  IoUringConnection(int sockfd, IoUringWorker* worker);
+  ~IoUringConnection();
+
+  void AsyncWrite(const SocketMsg& msg);
+
+  void PushOutMsg(const SocketMsg& msg);
+  void Start();
+  // queues a send if none is in flight and there is something to send
+  void PrepareSend();
+  void OnSendDone(int32_t res);
+  void OnRecvDone(const io_uring_cqe& cqe);
+  void OnDirectRecvDone(int32_t res);
+
+ private:
+  static const size_t kMaxIovNum = 128;
+  // regst bodies from this size on are sent from fixed buffers and received in place
+  static const size_t kDirectBodyMinSize = 256 * 1024;
+
+  uint64_t UserData(IoUringReqType type) const {
+    return reinterpret_cast<uint64_t>(this) | static_cast<uint64_t>(type);
+  }
+
+  // send
+  void GatherMsgs();
+  void GatherMsg(const SocketMsg& msg);
+  void ConsumeWritten(size_t written_size);
+
+  // receive
+  bool NeedDirectRecv() const;
+  void ContinueRecv();
+  void ConsumeRecvBuf(const char* data, size_t size);
+  void FinishCurReadIfDone();
+  void SwitchToMsgHeadReadHandle();
+  void SetStatusWhenMsgHeadDone();
+  void SetStatusWhenMsgBodyDone();
+#define MAKE_ENTRY(x, y) void SetStatusWhen##x##MsgHeadDone();
+  OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
+#undef MAKE_ENTRY
+
+  int sockfd_;
+  IoUringWorker* worker_;
+
+  std::deque<SocketMsg> out_msgs_;
+  std::deque<SocketMsg> gathered_msgs_;
+  std::vector<iovec> iovs_;
+  std::vector<bool> iov_ends_msg_;
+  // fixed buffer index of an iovec which is sent by itself, -1 for the gathered ones
+  std::vector<int32_t> iov_buf_indexes_;
+  size_t iov_begin_;
+  bool is_sending_;
+
+  SocketMsg cur_msg_;
+  char* read_ptr_;
+  size_t read_size_;
+  void (IoUringConnection::*set_cur_read_done_)();
+  // fixed buffer index of the regst the current body goes to, -1 if it is no regst body
+  int32_t body_buf_index_;
+  bool is_reading_regst_body_;
+  std::vector<ActorMsg> actor_batch_buf_;
+  std::vector<char> custom_msg_buf_;
+  bool is_multishot_armed_;
+  bool is_multishot_cancelling_;
+};
+
+}  // namespace oneflow
+
+#endif  // WITH_IO_URING && PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_CONNECTION_H_
@@ -0,0 +1,37 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_MEMORY_DESC_H_
+#define ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_MEMORY_DESC_H_
+
+#include "oneflow/core/common/platform.h"
+#include "oneflow/core/common/util.h"
+
+#if defined(WITH_IO_URING) && defined(PLATFORM_POSIX)
+
+namespace oneflow {
+
+struct IoUringMemDesc {
+  void* mem_ptr;
+  size_t byte_size;
+  // index among the fixed buffers of every worker's ring, -1 if the memory is not registered
+  int32_t buf_index;
+};
+
+}  // namespace oneflow
+
+#endif  // WITH_IO_URING && PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_MEMORY_DESC_H_
@@ -0,0 +1,128 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/io_uring/io_uring.h"
+
+#if defined(WITH_IO_URING) && defined(PLATFORM_POSIX)
+
+#include <numeric>
+#include <sys/socket.h>
+
+namespace oneflow {
+
+namespace {
+
+std::vector<io_uring_cqe> WaitCqes(IoUring* ring) {
+  std::vector<io_uring_cqe> cqes;
+  while (cqes.empty()) {
+    ring->Submit(1);
+    ring->ReapCqes([&](const io_uring_cqe& cqe) { cqes.push_back(cqe); });
+  }
+  return cqes;
+}
+
+}  // namespace
+
+TEST(IoUring, fixed_write_and_multishot_recv) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  IoUring ring(16);
+  ring.SetupBufRing(4, 4096);
+  std::vector<char> data(10000);
+  FOR_RANGE(size_t, i, 0, data.size()) { data[i] = static_cast<char>(i * 7); }
+  iovec iov;
+  iov.iov_base = data.data();
+  iov.iov_len = data.size();
+  ASSERT_TRUE(ring.RegisterBuffers({iov}));
+
+  io_uring_sqe* recv_sqe = ring.GetSqe();
+  recv_sqe->opcode = IORING_OP_RECV;
+  recv_sqe->fd = fds[1];
+  recv_sqe->ioprio = IORING_RECV_MULTISHOT;
+  recv_sqe->flags = IOSQE_BUFFER_SELECT;
+  recv_sqe->buf_group = IoUring::kBufGroupId;
+  recv_sqe->user_data = 1;
+  io_uring_sqe* write_sqe = ring.GetSqe();
+  write_sqe->opcode = IORING_OP_WRITE_FIXED;
+  write_sqe->fd = fds[0];
+  write_sqe->addr = reinterpret_cast<uint64_t>(data.data());
+  write_sqe->len = data.size();
+  write_sqe->buf_index = 0;
+  write_sqe->user_data = 2;
+
+  std::vector<char> received;
+  bool is_written = false;
+  while (!is_written || received.size() < data.size()) {
+    for (const io_uring_cqe& cqe : WaitCqes(&ring)) {
+      ASSERT_GT(cqe.res, 0);
+      if (cqe.user_data == 2) {
+        ASSERT_EQ(cqe.res, data.size());
+        is_written = true;
+      } else {
+        ASSERT_EQ(cqe.user_data, 1);
+        ASSERT_TRUE(cqe.flags & IORING_CQE_F_MORE);
+        const uint16_t buf_id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+        const char* buf = ring.GetBuf(buf_id);
+        received.insert(received.end(), buf, buf + cqe.res);
+        ring.RecycleBuf(buf_id);
+      }
+    }
+  }
+  ASSERT_EQ(received, data);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(IoUring, reap_from_handler_when_completion_queue_is_full) {
+  IoUring ring(4);
+  const uint64_t nop_num = 64;
+  std::vector<int32_t> user_data2cnt(nop_num + 1, 0);
+  // overflows the completion queue of 16 entries
+  uint64_t queued_num = 0;
+  while (queued_num < nop_num) {
+    io_uring_sqe* sqe = ring.GetSqe();
+    if (sqe == nullptr) {
+      ring.Submit(0);
+      continue;
+    }
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = queued_num++;
+  }
+  ring.Submit(0);
+  // the first handler queues one more request and reaps, as the worker does when the kernel
+  // refuses entries because of the full completion queue, no completion may be handled twice
+  std::function<void(const io_uring_cqe&)> Handler = [&](const io_uring_cqe& cqe) {
+    ASSERT_EQ(cqe.res, 0);
+    ASSERT_LE(cqe.user_data, nop_num);
+    user_data2cnt.at(cqe.user_data) += 1;
+    if (cqe.user_data != 0) { return; }
+    io_uring_sqe* sqe = ring.GetSqe();
+    ASSERT_TRUE(sqe != nullptr);
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = nop_num;
+    ring.Submit(0);
+    ring.ReapCqes(Handler);
+  };
+  while (user_data2cnt.at(nop_num) == 0
+         || std::accumulate(user_data2cnt.begin(), user_data2cnt.end(), 0) < nop_num + 1) {
+    ring.Submit(1);
+    ring.ReapCqes(Handler);
+  }
+  for (int32_t cnt : user_data2cnt) { ASSERT_EQ(cnt, 1); }
+}
+
+}  // namespace oneflow
+
+#endif  // WITH_IO_URING && PLATFORM_POSIX
@@ -0,0 +1,169 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/io_uring/io_uring_worker.h"
+#include "oneflow/core/common/blocking_counter.h"
+
+#if defined(WITH_IO_URING) && defined(PLATFORM_POSIX)
+
+#include <sys/eventfd.h>
+
+namespace oneflow {
+
+namespace {
+
+const uint32_t kRingEntries = 256;
+const uint32_t kRecvBufNum = 64;
+const uint32_t kRecvBufSize = 64 * 1024;
+
+}  // namespace
+
+IoUringWorker::IoUringWorker()
+    : ring_(new IoUring(kRingEntries)),
+      cqe_handler_(std::bind(&IoUringWorker::HandleCqe, this, std::placeholders::_1)),
+      has_pending_(false),
+      is_parked_(false),
+      is_stopped_(false),
+      wakeup_buf_(0) {
+  ring_->SetupBufRing(kRecvBufNum, kRecvBufSize);
+  wakeup_fd_ = eventfd(0, EFD_CLOEXEC);
+  PCHECK(wakeup_fd_ != -1);
+}
+
+IoUringWorker::~IoUringWorker() {
+  ring_.reset();
+  PCHECK(close(wakeup_fd_) == 0);
+}
+
+void IoUringWorker::AddConnection(IoUringConnection* conn) { conns_.push_back(conn); }
+
+void IoUringWorker::Start() { thread_ = std::thread(&IoUringWorker::Loop, this); }
+
+void IoUringWorker::Stop() {
+  RunOnWorkerThread([this]() { is_stopped_.store(true, std::memory_order_release); });
+  thread_.join();
+  LOG(INFO) << "CommNet:IoUring " << ring_->submitted_sqe_cnt() << " requests in "
+            << ring_->enter_cnt() << " io_uring_enter";
+}
+
+void IoUringWorker::PostMsg(IoUringConnection* conn, const SocketMsg& msg) {
+  {
+    std::unique_lock<std::mutex> lck(pending_mtx_);
+    pending_msgs_.emplace_back(conn, msg);
+    has_pending_.store(true, std::memory_order_relaxed);
+  }
+  WakeupIfParked();
+}
+
+bool IoUringWorker::RegisterBuffers(const std::vector<iovec>& iovs) {
+  bool ret = false;
+  BlockingCounter bc(1);
+  RunOnWorkerThread([&]() {
+    ret = ring_->RegisterBuffers(iovs);
+    bc.Decrease();
+  });
+  bc.WaitUntilCntEqualZero();
+  return ret;
+}
+
+io_uring_sqe* IoUringWorker::GetSqe() {
+  io_uring_sqe* sqe = ring_->GetSqe();
+  while (sqe == nullptr) {
+    // the kernel refuses entries while the completion queue is full
+    if (!ring_->Submit(0)) { ring_->ReapCqes(cqe_handler_); }
+    sqe = ring_->GetSqe();
+  }
+  return sqe;
+}
+
+void IoUringWorker::RunOnWorkerThread(const std::function<void()>& task) {
+  {
+    std::unique_lock<std::mutex> lck(pending_mtx_);
+    pending_tasks_.push_back(task);
+    has_pending_.store(true, std::memory_order_relaxed);
+  }
+  WakeupIfParked();
+}
+
+void IoUringWorker::WakeupIfParked() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (is_parked_.load(std::memory_order_relaxed)
+      && is_parked_.exchange(false, std::memory_order_relaxed)) {
+    uint64_t event_num = 1;
+    PCHECK(write(wakeup_fd_, &event_num, 8) == 8);
+  }
+}
+
+void IoUringWorker::Loop() {
+  ArmWakeupRead();
+  for (IoUringConnection* conn : conns_) { conn->Start(); }
+  std::vector<std::pair<IoUringConnection*, SocketMsg>> msgs;
+  std::vector<std::function<void()>> tasks;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lck(pending_mtx_);
+      msgs.swap(pending_msgs_);
+      tasks.swap(pending_tasks_);
+      has_pending_.store(false, std::memory_order_relaxed);
+    }
+    for (const auto& pair : msgs) { pair.first->PushOutMsg(pair.second); }
+    msgs.clear();
+    for (const std::function<void()>& task : tasks) { task(); }
+    tasks.clear();
+    if (is_stopped_.load(std::memory_order_acquire)) { break; }
+    for (IoUringConnection* conn : conns_) { conn->PrepareSend(); }
+    // park in the kernel unless more work was posted meanwhile, the posting thread writes the
+    // eventfd only if it sees the worker parked
+    is_parked_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (has_pending_.load(std::memory_order_relaxed)) {
+      is_parked_.store(false, std::memory_order_relaxed);
+      ring_->Submit(0);
+    } else {
+      ring_->Submit(1);
+      is_parked_.store(false, std::memory_order_relaxed);
+    }
+    ring_->ReapCqes(cqe_handler_);
+  }
+}
+
+void IoUringWorker::ArmWakeupRead() {
+  io_uring_sqe* sqe = GetSqe();
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = wakeup_fd_;
+  sqe->addr = reinterpret_cast<uint64_t>(&wakeup_buf_);
+  sqe->len = sizeof(wakeup_buf_);
+  sqe->user_data = static_cast<uint64_t>(IoUringReqType::kWakeup);
+}
+
+void IoUringWorker::HandleCqe(const io_uring_cqe& cqe) {
+  const auto type = static_cast<IoUringReqType>(cqe.user_data & kIoUringReqTypeMask);
+  auto conn = reinterpret_cast<IoUringConnection*>(cqe.user_data & ~kIoUringReqTypeMask);
+  switch (type) {
+    case IoUringReqType::kWakeup:
+      CHECK_EQ(cqe.res, sizeof(wakeup_buf_));
+      ArmWakeupRead();
+      break;
+    case IoUringReqType::kSend: conn->OnSendDone(cqe.res); break;
+    case IoUringReqType::kRecv: conn->OnRecvDone(cqe); break;
+    case IoUringReqType::kDirectRecv: conn->OnDirectRecvDone(cqe.res); break;
+    case IoUringReqType::kCancel: break;
+    default: UNIMPLEMENTED();
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // WITH_IO_URING && PLATFORM_POSIX
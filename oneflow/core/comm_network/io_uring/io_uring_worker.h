@@ -0,0 +1,74 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_WORKER_H_
+#define ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_WORKER_H_
+
+#include "oneflow/core/comm_network/io_uring/io_uring_connection.h"
+
+#if defined(WITH_IO_URING) && defined(PLATFORM_POSIX)
+
+namespace oneflow {
+
+// A thread with its own ring serving a set of connections. Each loop turn hands all requests
+// queued by the connections to the kernel with one io_uring_enter, which also waits for
+// completions. Other threads post messages under a mutex and only write the wakeup eventfd
+// when the worker is parked in the kernel.
+class IoUringWorker final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(IoUringWorker);
+  IoUringWorker();
+  ~IoUringWorker();
+
+  void AddConnection(IoUringConnection* conn);
+  void Start();
+  void Stop();
+
+  void PostMsg(IoUringConnection* conn, const SocketMsg& msg);
+  // registers the fixed buffers on the worker's thread, blocks until it is done
+  bool RegisterBuffers(const std::vector<iovec>& iovs);
+
+  // for the connections, on the worker's thread. Reaps completions if the ring is full, so the
+  // handlers of other requests may run before it returns
+  io_uring_sqe* GetSqe();
+  IoUring* ring() { return ring_.get(); }
+
+ private:
+  void Loop();
+  void RunOnWorkerThread(const std::function<void()>& task);
+  void WakeupIfParked();
+  void ArmWakeupRead();
+  void HandleCqe(const io_uring_cqe& cqe);
+
+  std::unique_ptr<IoUring> ring_;
+  std::function<void(const io_uring_cqe&)> cqe_handler_;
+  std::vector<IoUringConnection*> conns_;
+  std::thread thread_;
+
+  std::mutex pending_mtx_;
+  std::vector<std::pair<IoUringConnection*, SocketMsg>> pending_msgs_;
+  std::vector<std::function<void()>> pending_tasks_;
+  std::atomic<bool> has_pending_;
+  std::atomic<bool> is_parked_;
+  std::atomic<bool> is_stopped_;
+  int wakeup_fd_;
+  uint64_t wakeup_buf_;
+};
+
+}  // namespace oneflow
+
+#endif  // WITH_IO_URING && PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_IO_URING_IO_URING_WORKER_H_
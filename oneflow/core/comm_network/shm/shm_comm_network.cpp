@@ -0,0 +1,431 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/shm/shm_comm_network.h"
+#include "oneflow/core/actor/actor_message_bus.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
+
+#ifdef PLATFORM_POSIX
+
+#include <sys/statvfs.h>
+
+namespace oneflow {
+
+namespace {
+
+const size_t kRingCapacity = 8 << 20;
+const int64_t kReceiveSpinCount = 4096;
+const int64_t kReceiveParkTimeoutUs = 1000;
+const int64_t kSendSpinCount = 1024;
+
+enum ShmRecordType : uint32_t {
+  kShmActorMsg = 0,
+  kShmCustomMsg,
+  kShmCustomMsgFragment,
+};
+
+// head of a custom message, the data follows it and continues in fragments when it does not fit
+// into one record
+struct ShmCustomMsgHead {
+  int64_t handler_id;
+  uint64_t data_size;
+};
+
+std::string GenRingKey(int64_t src_machine_id, int64_t dst_machine_id) {
+  return "ShmCommNetRing/" + std::to_string(src_machine_id) + "/"
+         + std::to_string(dst_machine_id);
+}
+
+std::string GenTokensMsgKey(int64_t machine_id) {
+  return "ShmTokensMsg/" + std::to_string(machine_id);
+}
+
+void CpuRelax(int64_t* spin_cnt) {
+  if (*spin_cnt < kSendSpinCount) {
+    ++*spin_cnt;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  } else {
+    std::this_thread::yield();
+  }
+}
+
+}  // namespace
+
+struct ShmCommNet::Peer {
+  struct RemoteMem {
+    const char* ptr;
+    size_t byte_size;
+  };
+
+  int64_t machine_id;
+  // records from the peer to this machine, created here
+  std::unique_ptr<ShmSegment> in_segment;
+  std::unique_ptr<ShmRing> in_ring;
+  // records from this machine to the peer, created by the peer
+  std::unique_ptr<ShmSegment> out_segment;
+  std::unique_ptr<ShmRing> out_ring;
+  MpscChannel<OutMsg> out_msgs;
+  std::thread send_thread;
+  std::thread receive_thread;
+  std::atomic<bool> is_receive_stopped;
+  // the peer's registered memory, mapped read only
+  HashMap<std::string, std::unique_ptr<ShmSegment>> name2segment;
+  HashMap<void*, RemoteMem> token2remote_mem;
+};
+
+ShmCommNet::~ShmCommNet() {
+  for (const auto& peer : peers_) {
+    if (!peer) { continue; }
+    peer->out_msgs.Close();
+    peer->send_thread.join();
+  }
+  // every machine has pushed all its records, the receivers drain the rings and stop
+  if (!is_loopback_) { OF_BARRIER(); }
+  for (const auto& peer : peers_) {
+    if (!peer) { continue; }
+    peer->is_receive_stopped.store(true, std::memory_order_release);
+    peer->receive_thread.join();
+  }
+  read_tasks_.Close();
+  for (std::thread& copy_thread : copy_threads_) { copy_thread.join(); }
+}
+
+bool ShmCommNet::IsUsable(const Plan& plan) {
+  const ResourceDesc* resource_desc = Global<ResourceDesc, ForSession>::Get();
+  if (!resource_desc->enable_shm_comm_net()) { return false; }
+  const int64_t machine_num = resource_desc->TotalMachineNum();
+  const std::string& addr = resource_desc->machine(0).addr();
+  FOR_RANGE(int64_t, i, 1, machine_num) {
+    if (resource_desc->machine(i).addr() != addr) { return false; }
+  }
+  // the free space of /dev/shm changes while the processes start, so the master decides for all
+  const std::string key = "ShmCommNetIsUsable";
+  bool is_usable = false;
+  if (Global<MachineCtx>::Get()->IsThisMachineMaster()) {
+    const size_t required_size = RequiredSharedMemSize(plan);
+    const size_t free_size = FreeSharedMemSize();
+    is_usable = free_size >= required_size;
+    if (!is_usable) {
+      LOG(WARNING) << "/dev/shm has " << free_size << " bytes free, ShmCommNet needs "
+                   << required_size << ", falling back to the socket CommNet";
+    }
+    Global<CtrlClient>::Get()->PushKVT(key, static_cast<int32_t>(is_usable));
+  } else {
+    int32_t is_usable_val = 0;
+    Global<CtrlClient>::Get()->PullKVT(key, &is_usable_val);
+    is_usable = is_usable_val != 0;
+  }
+  OF_BARRIER();
+  if (Global<MachineCtx>::Get()->IsThisMachineMaster()) { Global<CtrlClient>::Get()->ClearKV(key); }
+  return is_usable;
+}
+
+size_t ShmCommNet::RequiredSharedMemSize(const Plan& plan) {
+  const int64_t machine_num = Global<ResourceDesc, ForSession>::Get()->TotalMachineNum();
+  size_t size = machine_num * (machine_num - 1) * ShmRing::SegmentSize4Capacity(kRingCapacity);
+  auto IsUsedByNetwork = [](const MemoryCase& mem_case) {
+    return mem_case.has_host_mem() && mem_case.host_mem().used_by_network();
+  };
+  for (const ChunkProto& chunk : plan.block_chunk_list().chunk()) {
+    if (IsUsedByNetwork(chunk.mem_case())) { size += chunk.mem_size(); }
+  }
+  for (const MemBlockProto& mem_block : plan.block_chunk_list().mem_block()) {
+    if (mem_block.has_chunk_id()) { continue; }
+    if (IsUsedByNetwork(mem_block.mem_case())) { size += mem_block.mem_size(); }
+  }
+  return size;
+}
+
+size_t ShmCommNet::FreeSharedMemSize() {
+  struct statvfs stat;
+  if (statvfs("/dev/shm", &stat) != 0) { return 0; }
+  return static_cast<size_t>(stat.f_bavail) * stat.f_frsize;
+}
+
+void ShmCommNet::RegisterMemoryDone() {
+  int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  ShmTokensMsg this_tokens_msg;
+  for (ShmMemDesc* mem_desc : mem_descs()) {
+    this_tokens_msg.mutable_token2mem_desc()->insert(
+        {reinterpret_cast<uint64_t>(mem_desc), mem_desc->ToProto()});
+  }
+  if (!is_loopback_) {
+    Global<CtrlClient>::Get()->PushKV(GenTokensMsgKey(this_machine_id), this_tokens_msg);
+  }
+  for (int64_t peer_id : peer_machine_id()) {
+    Peer* peer = peers_.at(peer_id).get();
+    ShmTokensMsg peer_tokens_msg;
+    if (is_loopback_) {
+      peer_tokens_msg = this_tokens_msg;
+    } else {
+      Global<CtrlClient>::Get()->PullKV(GenTokensMsgKey(peer_id), &peer_tokens_msg);
+    }
+    for (const auto& pair : peer_tokens_msg.token2mem_desc()) {
+      const ShmMemDescProto& mem_desc = pair.second;
+      auto segment_it = peer->name2segment.find(mem_desc.segment_name());
+      if (segment_it == peer->name2segment.end()) {
+        segment_it =
+            peer->name2segment
+                .emplace(mem_desc.segment_name(),
+                         std::unique_ptr<ShmSegment>(ShmSegment::Open(
+                             mem_desc.segment_name(), mem_desc.segment_size(), false)))
+                .first;
+      }
+      CHECK_LE(mem_desc.offset() + mem_desc.byte_size(), segment_it->second->size());
+      Peer::RemoteMem remote_mem;
+      remote_mem.ptr = segment_it->second->ptr() + mem_desc.offset();
+      remote_mem.byte_size = mem_desc.byte_size();
+      CHECK(peer->token2remote_mem.emplace(reinterpret_cast<void*>(pair.first), remote_mem)
+                .second);
+    }
+  }
+  // all peers have mapped the segments of this machine, the names are not needed any more
+  if (!is_loopback_) { OF_BARRIER(); }
+  {
+    std::unique_lock<std::mutex> lck(segments_mtx_);
+    for (const auto& pair : ptr2segment_) { pair.second->Unlink(); }
+  }
+  if (!is_loopback_) { Global<CtrlClient>::Get()->ClearKV(GenTokensMsgKey(this_machine_id)); }
+}
+
+void ShmCommNet::SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) {
+  OutMsg out_msg;
+  out_msg.is_custom = false;
+  out_msg.actor_msg = msg;
+  out_msg.handler_id = -1;
+  out_msg.data = nullptr;
+  CHECK_EQ(peers_.at(dst_machine_id)->out_msgs.Send(out_msg), kChannelStatusSuccess);
+}
+
+void ShmCommNet::SendActorMsgBatch(int64_t dst_machine_id, const std::vector<ActorMsg>& msgs) {
+  std::vector<OutMsg> out_msgs(msgs.size());
+  FOR_RANGE(size_t, i, 0, msgs.size()) {
+    out_msgs.at(i).is_custom = false;
+    out_msgs.at(i).actor_msg = msgs.at(i);
+    out_msgs.at(i).handler_id = -1;
+    out_msgs.at(i).data = nullptr;
+  }
+  CHECK_EQ(peers_.at(dst_machine_id)->out_msgs.SendMany(out_msgs), kChannelStatusSuccess);
+}
+
+void ShmCommNet::SendCustomMsg(int64_t dst_machine_id, int64_t handler_id,
+                               std::vector<char>&& data) {
+  OutMsg out_msg;
+  out_msg.is_custom = true;
+  out_msg.handler_id = handler_id;
+  out_msg.data = new std::vector<char>(std::move(data));
+  CHECK_EQ(peers_.at(dst_machine_id)->out_msgs.Send(out_msg), kChannelStatusSuccess);
+}
+
+char* ShmCommNet::AllocateSharedMem(size_t size) {
+  ShmSegment* segment = ShmSegment::Create(RoundUp(size, sysconf(_SC_PAGESIZE)));
+  std::unique_lock<std::mutex> lck(segments_mtx_);
+  CHECK(ptr2segment_.emplace(segment->ptr(), std::unique_ptr<ShmSegment>(segment)).second);
+  return segment->ptr();
+}
+
+void ShmCommNet::DeallocateSharedMem(char* ptr) {
+  std::unique_lock<std::mutex> lck(segments_mtx_);
+  CHECK_EQ(ptr2segment_.erase(ptr), 1);
+}
+
+ShmMemDesc* ShmCommNet::NewMemDesc(void* ptr, size_t byte_size) {
+  char* mem_ptr = static_cast<char*>(ptr);
+  std::unique_lock<std::mutex> lck(segments_mtx_);
+  auto it = ptr2segment_.upper_bound(mem_ptr);
+  CHECK(it != ptr2segment_.begin()) << "memory registered to ShmCommNet must be shared";
+  --it;
+  const ShmSegment* segment = it->second.get();
+  CHECK_LE(mem_ptr + byte_size, segment->ptr() + segment->size())
+      << "memory registered to ShmCommNet must be shared";
+  ShmMemDesc* mem_desc = new ShmMemDesc;
+  mem_desc->mem_ptr = ptr;
+  mem_desc->byte_size = byte_size;
+  mem_desc->segment = segment;
+  return mem_desc;
+}
+
+ShmCommNet::ShmCommNet(const Plan& plan, bool is_loopback)
+    : CommNetIf(plan),
+      is_loopback_(is_loopback),
+      peers_(Global<ResourceDesc, ForSession>::Get()->TotalMachineNum()) {
+  int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  // segments of processes which died before unlinking them
+  ShmSegment::UnlinkStale();
+  const size_t segment_size = ShmRing::SegmentSize4Capacity(kRingCapacity);
+  for (int64_t peer_id : peer_machine_id()) {
+    Peer* peer = new Peer;
+    peer->machine_id = peer_id;
+    peer->is_receive_stopped.store(false, std::memory_order_relaxed);
+    peer->in_segment.reset(ShmSegment::Create(segment_size));
+    peer->in_ring.reset(new ShmRing(peer->in_segment.get(), true));
+    peers_.at(peer_id).reset(peer);
+    if (is_loopback_) {
+      CHECK_EQ(peer_id, this_machine_id);
+    } else {
+      Global<CtrlClient>::Get()->PushKV(GenRingKey(peer_id, this_machine_id),
+                                        peer->in_segment->name());
+    }
+  }
+  for (int64_t peer_id : peer_machine_id()) {
+    Peer* peer = peers_.at(peer_id).get();
+    std::string ring_name;
+    if (is_loopback_) {
+      ring_name = peer->in_segment->name();
+    } else {
+      Global<CtrlClient>::Get()->PullKV(GenRingKey(this_machine_id, peer_id), &ring_name);
+    }
+    peer->out_segment.reset(ShmSegment::Open(ring_name, segment_size, true));
+    peer->out_ring.reset(new ShmRing(peer->out_segment.get(), false));
+  }
+  if (!is_loopback_) { OF_BARRIER(); }
+  for (int64_t peer_id : peer_machine_id()) {
+    Peer* peer = peers_.at(peer_id).get();
+    peer->in_segment->Unlink();
+    if (!is_loopback_) {
+      Global<CtrlClient>::Get()->ClearKV(GenRingKey(peer_id, this_machine_id));
+    }
+    peer->send_thread = std::thread(&ShmCommNet::SendLoop, this, peer);
+    peer->receive_thread = std::thread(&ShmCommNet::ReceiveLoop, this, peer);
+  }
+  const size_t copy_thread_num = Global<ResourceDesc, ForSession>::Get()->CommNetWorkerNum();
+  FOR_RANGE(size_t, i, 0, copy_thread_num) {
+    copy_threads_.emplace_back(&ShmCommNet::CopyLoop, this);
+  }
+}
+
+void ShmCommNet::DoRead(void* read_id, int64_t src_machine_id, void* src_token,
+                        void* dst_token) {
+  const Peer::RemoteMem& src_mem = peers_.at(src_machine_id)->token2remote_mem.at(src_token);
+  auto dst_mem_desc = static_cast<const ShmMemDesc*>(dst_token);
+  CHECK_EQ(src_mem.byte_size, dst_mem_desc->byte_size);
+  ReadTask task;
+  task.read_id = read_id;
+  task.src = src_mem.ptr;
+  task.dst = static_cast<char*>(dst_mem_desc->mem_ptr);
+  task.size = src_mem.byte_size;
+  CHECK_EQ(read_tasks_.Send(task), kChannelStatusSuccess);
+}
+
+void ShmCommNet::PushOutMsg(Peer* peer, const OutMsg& msg) {
+  ShmRing* ring = peer->out_ring.get();
+  auto Push = [ring](uint32_t type, const void* head, size_t head_size, const void* body,
+                     size_t body_size) {
+    int64_t spin_cnt = 0;
+    while (!ring->TryPush(type, head, head_size, body, body_size)) { CpuRelax(&spin_cnt); }
+  };
+  if (!msg.is_custom) {
+    Push(kShmActorMsg, &msg.actor_msg, sizeof(ActorMsg), nullptr, 0);
+    return;
+  }
+  ShmCustomMsgHead head;
+  head.handler_id = msg.handler_id;
+  head.data_size = msg.data->size();
+  const char* data = msg.data->data();
+  size_t offset = std::min(msg.data->size(), ring->max_payload_size() - sizeof(head));
+  Push(kShmCustomMsg, &head, sizeof(head), data, offset);
+  while (offset < msg.data->size()) {
+    const size_t size = std::min(msg.data->size() - offset, ring->max_payload_size());
+    Push(kShmCustomMsgFragment, nullptr, 0, data + offset, size);
+    offset += size;
+  }
+  delete msg.data;
+}
+
+void ShmCommNet::SendLoop(Peer* peer) {
+  std::queue<OutMsg> msgs;
+  while (peer->out_msgs.ReceiveMany(&msgs) == kChannelStatusSuccess) {
+    while (!msgs.empty()) {
+      PushOutMsg(peer, msgs.front());
+      msgs.pop();
+    }
+  }
+}
+
+void ShmCommNet::ReceiveLoop(Peer* peer) {
+  std::vector<ActorMsg> actor_msgs;
+  ShmCustomMsgHead custom_head;
+  std::vector<char> custom_data;
+  auto FlushActorMsgs = [&actor_msgs]() {
+    if (actor_msgs.empty()) { return; }
+    if (actor_msgs.size() == 1) {
+      Global<ActorMsgBus>::Get()->SendMsgWithoutCommNet(actor_msgs.front());
+    } else {
+      Global<ActorMsgBus>::Get()->SendMsgBatchWithoutCommNet(actor_msgs);
+    }
+    actor_msgs.clear();
+  };
+  auto HandleCustomMsgIfDone = [&]() {
+    if (custom_data.size() < custom_head.data_size) { return; }
+    HandleCustomMsg(peer->machine_id, custom_head.handler_id, &custom_data);
+    custom_data.clear();
+  };
+  const std::function<void(uint32_t, const char*, size_t)> HandleRecord =
+      [&](uint32_t type, const char* payload, size_t size) {
+    if (type == kShmActorMsg) {
+      CHECK_EQ(size, sizeof(ActorMsg));
+      actor_msgs.emplace_back(*reinterpret_cast<const ActorMsg*>(payload));
+    } else if (type == kShmCustomMsg) {
+      // actor messages sent before the custom message are delivered before it
+      FlushActorMsgs();
+      CHECK_GE(size, sizeof(custom_head));
+      std::memcpy(&custom_head, payload, sizeof(custom_head));
+      custom_data.reserve(custom_head.data_size);
+      custom_data.assign(payload + sizeof(custom_head), payload + size);
+      HandleCustomMsgIfDone();
+    } else if (type == kShmCustomMsgFragment) {
+      custom_data.insert(custom_data.end(), payload, payload + size);
+      HandleCustomMsgIfDone();
+    } else {
+      UNIMPLEMENTED();
+    }
+  };
+  ShmRing* ring = peer->in_ring.get();
+  int64_t spin_cnt = 0;
+  while (true) {
+    // read the flag first, records pushed before it was set are still drained below
+    const bool is_stopped = peer->is_receive_stopped.load(std::memory_order_acquire);
+    const size_t record_cnt = ring->PopAll(HandleRecord);
+    FlushActorMsgs();
+    if (record_cnt > 0) {
+      spin_cnt = 0;
+    } else if (is_stopped) {
+      break;
+    } else if (spin_cnt < kReceiveSpinCount) {
+      // yields rather than pauses, a busy receiver must not starve the sender on a shared core
+      ++spin_cnt;
+      std::this_thread::yield();
+    } else {
+      ring->Wait(kReceiveParkTimeoutUs);
+    }
+  }
+}
+
+void ShmCommNet::CopyLoop() {
+  ReadTask task;
+  while (read_tasks_.Receive(&task) == kChannelStatusSuccess) {
+    std::memcpy(task.dst, task.src, task.size);
+    ReadDone(task.read_id);
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
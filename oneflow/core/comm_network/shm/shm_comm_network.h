@@ -0,0 +1,106 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_COMM_NETWORK_H_
+#define ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_COMM_NETWORK_H_
+
+#include "oneflow/core/comm_network/comm_network.h"
+#include "oneflow/core/comm_network/shm/shm_memory_desc.h"
+#include "oneflow/core/comm_network/shm/shm_ring.h"
+#include "oneflow/core/common/mpsc_channel.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+// CommNet between processes on one host. Host memory used by the network is allocated in shared
+// segments which every peer maps, so a read is one memcpy from the peer's mapping. Actor and
+// custom messages go through one shared memory ring per ordered pair of machines. The segment
+// names are unlinked once all peers have mapped them; if a process dies before that, its
+// segments stay in /dev/shm until the next ShmCommNet on the host sweeps them.
+class ShmCommNet final : public CommNetIf<ShmMemDesc> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ShmCommNet);
+  ~ShmCommNet();
+
+  static void Init(const Plan& plan) {
+    Global<CommNet>::SetAllocated(new ShmCommNet(plan, false));
+  }
+  // a session of one machine which is its own peer, the rings and the registered memory are
+  // mapped without going through the control plane
+  static void InitLoopback(const Plan& plan) {
+    Global<CommNet>::SetAllocated(new ShmCommNet(plan, true));
+  }
+  // whether all machines of the session run on this host and /dev/shm has room for the rings
+  // and the host memory used by the network of the plan, all machines get the same answer
+  static bool IsUsable(const Plan& plan);
+
+  void RegisterMemoryDone() override;
+
+  void SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) override;
+  void SendActorMsgBatch(int64_t dst_machine_id, const std::vector<ActorMsg>& msgs) override;
+  void SendCustomMsg(int64_t dst_machine_id, int64_t handler_id,
+                     std::vector<char>&& data) override;
+
+  // the memory allocator takes host memory used by the network from here
+  char* AllocateSharedMem(size_t size);
+  void DeallocateSharedMem(char* ptr);
+
+ private:
+  struct OutMsg {
+    bool is_custom;
+    ActorMsg actor_msg;
+    int64_t handler_id;
+    std::vector<char>* data;
+  };
+  struct ReadTask {
+    void* read_id;
+    const char* src;
+    char* dst;
+    size_t size;
+  };
+  struct Peer;
+
+  ShmMemDesc* NewMemDesc(void* ptr, size_t byte_size) override;
+
+  ShmCommNet(const Plan& plan, bool is_loopback);
+  static size_t RequiredSharedMemSize(const Plan& plan);
+  static size_t FreeSharedMemSize();
+  void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) override;
+  void PushOutMsg(Peer* peer, const OutMsg& msg);
+  void SendLoop(Peer* peer);
+  void ReceiveLoop(Peer* peer);
+  void CopyLoop();
+
+  const bool is_loopback_;
+  std::vector<std::unique_ptr<Peer>> peers_;
+  std::vector<std::thread> copy_threads_;
+  Channel<ReadTask> read_tasks_;
+
+  std::mutex segments_mtx_;
+  std::map<char*, std::unique_ptr<ShmSegment>> ptr2segment_;
+};
+
+template<>
+class Global<ShmCommNet> final {
+ public:
+  static ShmCommNet* Get() { return dynamic_cast<ShmCommNet*>(Global<CommNet>::Get()); }
+};
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_COMM_NETWORK_H_
@@ -0,0 +1,166 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/shm/shm_comm_network.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/job/resource_desc.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace {
+
+// a ShmCommNet of machine 0 whose only peer is itself, the same set-up as the epoll loopback
+// benchmarks so that both backends can be compared
+class LoopbackShmCommNet final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(LoopbackShmCommNet);
+  LoopbackShmCommNet() {
+    EnvProto env_proto;
+    Machine* machine = env_proto.add_machine();
+    machine->set_id(0);
+    machine->set_addr("127.0.0.1");
+    env_proto.set_ctrl_port(0);
+    Global<EnvDesc>::New(env_proto);
+    Resource resource;
+    resource.set_machine_num(1);
+    resource.set_comm_net_worker_num(4);
+    Global<ResourceDesc, ForSession>::New(resource);
+    Global<MachineCtx>::New(0);
+    Plan plan;
+    (*plan.mutable_net_topo()->mutable_peer_machine_ids())[0].add_machine_id(0);
+    ShmCommNet::InitLoopback(plan);
+  }
+  ~LoopbackShmCommNet() {
+    Global<CommNet>::Delete();
+    Global<MachineCtx>::Delete();
+    Global<ResourceDesc, ForSession>::Delete();
+    Global<EnvDesc>::Delete();
+  }
+};
+
+// machine 0 reads from itself, with one read in flight like an actor stream
+void BenchmarkLoopbackRead(BenchmarkState* state, size_t byte_size) {
+  LoopbackShmCommNet loopback;
+  ShmCommNet* comm_net = Global<ShmCommNet>::Get();
+  char* src = comm_net->AllocateSharedMem(byte_size);
+  char* dst = comm_net->AllocateSharedMem(byte_size);
+  std::memset(src, 1, byte_size);
+  std::memset(dst, 0, byte_size);
+  void* src_token = comm_net->RegisterMemory(src, byte_size);
+  void* dst_token = comm_net->RegisterMemory(dst, byte_size);
+  comm_net->RegisterMemoryDone();
+  void* actor_read_id = comm_net->NewActorReadId();
+  while (state->KeepRunning()) {
+    BlockingCounter counter(1);
+    comm_net->Read(actor_read_id, 0, src_token, dst_token);
+    comm_net->AddReadCallBack(actor_read_id, [&counter]() { counter.Decrease(); });
+    counter.WaitUntilCntEqualZero();
+  }
+  CHECK_EQ(dst[0], 1);
+  CHECK_EQ(dst[byte_size - 1], 1);
+  state->SetBytesProcessed(state->iterations() * byte_size);
+
+  comm_net->DeleteActorReadId(actor_read_id);
+  comm_net->UnRegisterMemory(src_token);
+  comm_net->UnRegisterMemory(dst_token);
+  comm_net->DeallocateSharedMem(src);
+  comm_net->DeallocateSharedMem(dst);
+}
+
+// stream_num actor read streams each queue depth reads of byte_size bytes at once, with every
+// read followed by a callback; the copies are small so the cost is mostly in the streams
+void BenchmarkLoopbackStreams(BenchmarkState* state, int64_t stream_num, int64_t depth,
+                              size_t byte_size) {
+  LoopbackShmCommNet loopback;
+  ShmCommNet* comm_net = Global<ShmCommNet>::Get();
+  char* src = comm_net->AllocateSharedMem(byte_size);
+  char* dst = comm_net->AllocateSharedMem(stream_num * byte_size);
+  void* src_token = comm_net->RegisterMemory(src, byte_size);
+  std::vector<void*> dst_tokens(stream_num);
+  std::vector<void*> actor_read_ids(stream_num);
+  FOR_RANGE(int64_t, i, 0, stream_num) {
+    dst_tokens.at(i) = comm_net->RegisterMemory(dst + i * byte_size, byte_size);
+  }
+  comm_net->RegisterMemoryDone();
+  FOR_RANGE(int64_t, i, 0, stream_num) { actor_read_ids.at(i) = comm_net->NewActorReadId(); }
+  while (state->KeepRunning()) {
+    BlockingCounter counter(stream_num * depth);
+    FOR_RANGE(int64_t, i, 0, depth) {
+      FOR_RANGE(int64_t, j, 0, stream_num) {
+        comm_net->Read(actor_read_ids.at(j), 0, src_token, dst_tokens.at(j));
+        comm_net->AddReadCallBack(actor_read_ids.at(j), [&counter]() { counter.Decrease(); });
+      }
+    }
+    counter.WaitUntilCntEqualZero();
+  }
+  state->SetItemsProcessed(state->iterations() * stream_num * depth);
+  state->SetLabel(std::to_string(stream_num) + " streams x " + std::to_string(depth));
+
+  for (void* actor_read_id : actor_read_ids) { comm_net->DeleteActorReadId(actor_read_id); }
+  comm_net->UnRegisterMemory(src_token);
+  for (void* dst_token : dst_tokens) { comm_net->UnRegisterMemory(dst_token); }
+  comm_net->DeallocateSharedMem(src);
+  comm_net->DeallocateSharedMem(dst);
+}
+
+// machine 0 sends msg_num custom messages of byte_size bytes to itself back to back and waits
+// for all of them
+void BenchmarkLoopbackCustomMsgs(BenchmarkState* state, int64_t msg_num, size_t byte_size) {
+  LoopbackShmCommNet loopback;
+  CommNet* comm_net = Global<CommNet>::Get();
+  const int64_t handler_id = 0;
+  BlockingCounter* counter = nullptr;
+  comm_net->RegisterCustomMsgHandler(
+      handler_id, [&counter](int64_t src_machine_id, std::vector<char>* data) {
+        counter->Decrease();
+      });
+  while (state->KeepRunning()) {
+    BlockingCounter cur_counter(msg_num);
+    counter = &cur_counter;
+    FOR_RANGE(int64_t, i, 0, msg_num) {
+      comm_net->SendCustomMsg(0, handler_id, std::vector<char>(byte_size, 1));
+    }
+    cur_counter.WaitUntilCntEqualZero();
+  }
+  comm_net->UnRegisterCustomMsgHandler(handler_id);
+  state->SetItemsProcessed(state->iterations() * msg_num);
+  state->SetBytesProcessed(state->iterations() * msg_num * byte_size);
+}
+
+}  // namespace
+
+OF_BENCHMARK(ShmCommNetLoopbackRead4KiB) { BenchmarkLoopbackRead(state, 4 << 10); }
+
+OF_BENCHMARK(ShmCommNetLoopbackRead1MiB) { BenchmarkLoopbackRead(state, 1 << 20); }
+
+OF_BENCHMARK(ShmCommNetLoopbackRead64MiB) { BenchmarkLoopbackRead(state, 64 << 20); }
+
+OF_BENCHMARK(ShmCommNetLoopbackStreams64x1) { BenchmarkLoopbackStreams(state, 64, 1, 64); }
+
+OF_BENCHMARK(ShmCommNetLoopbackStreams8x16) { BenchmarkLoopbackStreams(state, 8, 16, 64); }
+
+OF_BENCHMARK(ShmCommNetLoopbackCustomMsgs64B) { BenchmarkLoopbackCustomMsgs(state, 4096, 64); }
+
+OF_BENCHMARK(ShmCommNetLoopbackCustomMsgs0B) { BenchmarkLoopbackCustomMsgs(state, 4096, 0); }
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
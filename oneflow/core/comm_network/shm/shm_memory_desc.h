@@ -0,0 +1,46 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_MEMORY_DESC_H_
+#define ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_MEMORY_DESC_H_
+
+#include "oneflow/core/comm_network/shm/shm.pb.h"
+#include "oneflow/core/comm_network/shm/shm_segment.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+// registered memory lies in a shared segment, peers read it through their own mapping
+struct ShmMemDesc {
+  void* mem_ptr;
+  size_t byte_size;
+  const ShmSegment* segment;
+
+  ShmMemDescProto ToProto() const {
+    ShmMemDescProto proto;
+    proto.set_segment_name(segment->name());
+    proto.set_segment_size(segment->size());
+    proto.set_offset(static_cast<char*>(mem_ptr) - segment->ptr());
+    proto.set_byte_size(byte_size);
+    return proto;
+  }
+};
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_MEMORY_DESC_H_
@@ -0,0 +1,144 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/shm/shm_ring.h"
+
+#ifdef PLATFORM_POSIX
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace {
+
+const size_t kRecordAlignment = 8;
+
+void FutexWait(std::atomic<uint32_t>* addr, uint32_t val, int64_t timeout_us) {
+  timespec timeout;
+  timeout.tv_sec = timeout_us / 1000000;
+  timeout.tv_nsec = (timeout_us % 1000000) * 1000;
+  // the futex is shared between processes, so FUTEX_PRIVATE_FLAG must not be set
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT, val, &timeout, nullptr, 0);
+}
+
+void FutexWakeOne(std::atomic<uint32_t>* addr) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+}  // namespace
+
+// positions count bytes since the ring was created, they are kept on separate cache lines
+struct ShmRing::Header {
+  std::atomic<uint64_t> head;
+  char pad0[64 - sizeof(std::atomic<uint64_t>)];
+  std::atomic<uint64_t> tail;
+  char pad1[64 - sizeof(std::atomic<uint64_t>)];
+  std::atomic<uint32_t> is_consumer_parked;
+  std::atomic<uint32_t> wake_seq;
+  char pad2[64 - 2 * sizeof(std::atomic<uint32_t>)];
+};
+
+const uint32_t ShmRing::kPaddingType;
+
+ShmRing::ShmRing(ShmSegment* segment, bool init) {
+  CHECK_GT(segment->size(), sizeof(Header));
+  header_ = reinterpret_cast<Header*>(segment->ptr());
+  data_ = segment->ptr() + sizeof(Header);
+  capacity_ = segment->size() - sizeof(Header);
+  CHECK_EQ(capacity_ & (capacity_ - 1), 0) << "capacity must be a power of two";
+  if (init) {
+    new (&header_->head) std::atomic<uint64_t>(0);
+    new (&header_->tail) std::atomic<uint64_t>(0);
+    new (&header_->is_consumer_parked) std::atomic<uint32_t>(0);
+    new (&header_->wake_seq) std::atomic<uint32_t>(0);
+  }
+  // atomics shared between processes must not fall back to a process local lock
+  CHECK(header_->head.is_lock_free() && header_->wake_seq.is_lock_free());
+}
+
+size_t ShmRing::SegmentSize4Capacity(size_t capacity) { return sizeof(Header) + capacity; }
+
+bool ShmRing::TryPush(uint32_t type, const void* head, size_t head_size, const void* body,
+                      size_t body_size) {
+  CHECK_NE(type, kPaddingType);
+  const size_t record_size = sizeof(RecordHeader) + head_size + body_size;
+  CHECK_LE(head_size + body_size, max_payload_size());
+  const size_t aligned_record_size = RoundUp(record_size, kRecordAlignment);
+  uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+  const uint64_t head_pos = header_->head.load(std::memory_order_acquire);
+  const size_t offset = tail & (capacity_ - 1);
+  const size_t size_to_end = capacity_ - offset;
+  // a record never wraps, the end of the ring is skipped with a padding record instead
+  const size_t padding_size = size_to_end < aligned_record_size ? size_to_end : 0;
+  if (tail + padding_size + aligned_record_size - head_pos > capacity_) { return false; }
+  if (padding_size > 0) {
+    RecordHeader* padding = reinterpret_cast<RecordHeader*>(data_ + offset);
+    padding->size = padding_size;
+    padding->type = kPaddingType;
+    tail += padding_size;
+  }
+  char* record = data_ + (tail & (capacity_ - 1));
+  RecordHeader* record_header = reinterpret_cast<RecordHeader*>(record);
+  record_header->size = record_size;
+  record_header->type = type;
+  if (head_size > 0) { std::memcpy(record + sizeof(RecordHeader), head, head_size); }
+  if (body_size > 0) { std::memcpy(record + sizeof(RecordHeader) + head_size, body, body_size); }
+  header_->tail.store(tail + aligned_record_size, std::memory_order_release);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (header_->is_consumer_parked.load(std::memory_order_relaxed)) {
+    header_->wake_seq.fetch_add(1, std::memory_order_relaxed);
+    FutexWakeOne(&header_->wake_seq);
+  }
+  return true;
+}
+
+size_t ShmRing::PopAll(const std::function<void(uint32_t, const char*, size_t)>& handler) {
+  size_t cnt = 0;
+  uint64_t head = header_->head.load(std::memory_order_relaxed);
+  const uint64_t tail = header_->tail.load(std::memory_order_acquire);
+  while (head < tail) {
+    const char* record = data_ + (head & (capacity_ - 1));
+    const RecordHeader* record_header = reinterpret_cast<const RecordHeader*>(record);
+    if (record_header->type == kPaddingType) {
+      head += record_header->size;
+    } else {
+      handler(record_header->type, record + sizeof(RecordHeader),
+              record_header->size - sizeof(RecordHeader));
+      head += RoundUp(record_header->size, kRecordAlignment);
+      cnt += 1;
+    }
+    header_->head.store(head, std::memory_order_release);
+  }
+  return cnt;
+}
+
+void ShmRing::Wait(int64_t timeout_us) {
+  header_->is_consumer_parked.store(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const uint32_t wake_seq = header_->wake_seq.load(std::memory_order_relaxed);
+  if (!HasRecord()) { FutexWait(&header_->wake_seq, wake_seq, timeout_us); }
+  header_->is_consumer_parked.store(0, std::memory_order_relaxed);
+}
+
+bool ShmRing::HasRecord() const {
+  return header_->head.load(std::memory_order_relaxed)
+         != header_->tail.load(std::memory_order_acquire);
+}
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
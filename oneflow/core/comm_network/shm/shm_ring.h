@@ -0,0 +1,69 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_RING_H_
+#define ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_RING_H_
+
+#include "oneflow/core/comm_network/shm/shm_segment.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+// Single-producer single-consumer ring of variable sized records in a shared memory segment,
+// the producer and the consumer live in different processes. Records are published with
+// release/acquire on the positions only, a consumer which runs dry parks on a futex in the
+// segment and is woken by the producer.
+class ShmRing final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ShmRing);
+  // the consumer creates the segment and initializes the ring
+  ShmRing(ShmSegment* segment, bool init);
+  ~ShmRing() = default;
+
+  static size_t SegmentSize4Capacity(size_t capacity);
+
+  // producer side, the payload of the record is head followed by body; returns false if the ring
+  // has no room for it
+  bool TryPush(uint32_t type, const void* head, size_t head_size, const void* body,
+               size_t body_size);
+  size_t max_payload_size() const { return capacity_ / 4; }
+
+  // consumer side, handler(type, payload, payload_size) runs for every published record and must
+  // not keep the payload; returns the number of records
+  size_t PopAll(const std::function<void(uint32_t, const char*, size_t)>& handler);
+  // parks until a record is published or timeout_us has passed
+  void Wait(int64_t timeout_us);
+
+ private:
+  struct Header;
+  struct RecordHeader {
+    uint32_t size;
+    uint32_t type;
+  };
+  static const uint32_t kPaddingType = 0xffffffff;
+
+  bool HasRecord() const;
+
+  Header* header_;
+  char* data_;
+  size_t capacity_;
+};
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_RING_H_
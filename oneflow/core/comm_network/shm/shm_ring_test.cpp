@@ -0,0 +1,68 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/shm/shm_ring.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace {
+
+// the consumer maps the segment created by the producer side, as a peer process does
+void TestShmRing(size_t capacity, int64_t record_num) {
+  std::unique_ptr<ShmSegment> consumer_segment(
+      ShmSegment::Create(ShmRing::SegmentSize4Capacity(capacity)));
+  ShmRing consumer_ring(consumer_segment.get(), true);
+  std::unique_ptr<ShmSegment> producer_segment(
+      ShmSegment::Open(consumer_segment->name(), consumer_segment->size(), true));
+  consumer_segment->Unlink();
+  ShmRing producer_ring(producer_segment.get(), false);
+  std::thread producer([&]() {
+    FOR_RANGE(int64_t, i, 0, record_num) {
+      // record sizes vary so that records are skipped at the end of the ring
+      std::vector<char> body(i % 97, static_cast<char>(i));
+      while (!producer_ring.TryPush(i % 3, &i, sizeof(i), body.data(), body.size())) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  int64_t expected = 0;
+  while (expected < record_num) {
+    consumer_ring.PopAll([&](uint32_t type, const char* payload, size_t size) {
+      ASSERT_EQ(type, expected % 3);
+      ASSERT_EQ(size, sizeof(int64_t) + expected % 97);
+      int64_t value = 0;
+      std::memcpy(&value, payload, sizeof(value));
+      ASSERT_EQ(value, expected);
+      FOR_RANGE(size_t, j, sizeof(int64_t), size) {
+        ASSERT_EQ(payload[j], static_cast<char>(expected));
+      }
+      ++expected;
+    });
+    if (expected < record_num) { consumer_ring.Wait(1000); }
+  }
+  producer.join();
+}
+
+}  // namespace
+
+TEST(ShmRing, small_ring) { TestShmRing(4096, 100000); }
+
+TEST(ShmRing, large_ring) { TestShmRing(1 << 20, 100000); }
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
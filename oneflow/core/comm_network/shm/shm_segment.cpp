@@ -0,0 +1,116 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/shm/shm_segment.h"
+
+#ifdef PLATFORM_POSIX
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cctype>
+
+namespace oneflow {
+
+namespace {
+
+// pids are only meaningful inside their pid namespace, containers sharing /dev/shm may have
+// different ones
+const std::string& PidNamespace() {
+  static const std::string pid_namespace = []() {
+    char link[64];
+    const ssize_t len = readlink("/proc/self/ns/pid", link, sizeof(link));
+    std::string digits;
+    FOR_RANGE(ssize_t, i, 0, len) {
+      if (std::isdigit(link[i])) { digits.push_back(link[i]); }
+    }
+    return digits.empty() ? std::string("0") : digits;
+  }();
+  return pid_namespace;
+}
+
+// segments are named "oneflow-<pid namespace>-<pid>-<count>"
+std::string SegmentNamePrefix() { return "oneflow-" + PidNamespace() + "-"; }
+
+std::string NewSegmentName() {
+  static std::atomic<int64_t> segment_cnt(0);
+  return "/" + SegmentNamePrefix() + std::to_string(getpid()) + "-"
+         + std::to_string(segment_cnt++);
+}
+
+char* MapSegment(int fd, size_t size, bool writable) {
+  const int prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+  void* ptr = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+  PCHECK(ptr != MAP_FAILED);
+  PCHECK(close(fd) == 0);
+  return static_cast<char*>(ptr);
+}
+
+}  // namespace
+
+ShmSegment::ShmSegment(const std::string& name, char* ptr, size_t size, bool is_owner)
+    : name_(name), ptr_(ptr), size_(size), is_linked_(is_owner) {}
+
+ShmSegment::~ShmSegment() {
+  Unlink();
+  PCHECK(munmap(ptr_, size_) == 0);
+}
+
+ShmSegment* ShmSegment::Create(size_t size) {
+  const std::string name = NewSegmentName();
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  PCHECK(fd != -1) << name;
+  // the pages of a new object read as zeros
+  PCHECK(ftruncate(fd, size) == 0) << name;
+  return new ShmSegment(name, MapSegment(fd, size, true), size, true);
+}
+
+ShmSegment* ShmSegment::Open(const std::string& name, size_t size, bool writable) {
+  int fd = shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+  PCHECK(fd != -1) << name;
+  return new ShmSegment(name, MapSegment(fd, size, writable), size, false);
+}
+
+void ShmSegment::UnlinkStale() {
+  const std::string prefix = SegmentNamePrefix();
+  DIR* dir = opendir("/dev/shm");
+  if (dir == nullptr) { return; }
+  while (const struct dirent* entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name.compare(0, prefix.size(), prefix) != 0) { continue; }
+    const size_t pid_end = name.find('-', prefix.size());
+    if (pid_end == std::string::npos || pid_end == prefix.size()) { continue; }
+    const std::string pid_str = name.substr(prefix.size(), pid_end - prefix.size());
+    if (!std::all_of(pid_str.cbegin(), pid_str.cend(), ::isdigit)) { continue; }
+    if (kill(std::stoi(pid_str), 0) == 0 || errno != ESRCH) { continue; }
+    // another process may sweep the same segment at the same time
+    if (shm_unlink(("/" + name).c_str()) == 0) {
+      LOG(INFO) << "unlinked shared memory segment " << name << " of a dead process";
+    }
+  }
+  PCHECK(closedir(dir) == 0);
+}
+
+void ShmSegment::Unlink() {
+  if (!is_linked_) { return; }
+  PCHECK(shm_unlink(name_.c_str()) == 0) << name_;
+  is_linked_ = false;
+}
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
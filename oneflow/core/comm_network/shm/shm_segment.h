@@ -0,0 +1,59 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_SEGMENT_H_
+#define ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_SEGMENT_H_
+
+#include "oneflow/core/common/platform.h"
+#include "oneflow/core/common/util.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+// A POSIX shared memory object mapped into this process. Other processes open it by name, the
+// creator unlinks the name once they have, the mapping stays valid until the segment is deleted.
+// Names carry the pid of the creator, so that the segments of a process which died before
+// unlinking them can be found.
+class ShmSegment final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ShmSegment);
+  ~ShmSegment();
+
+  static ShmSegment* Create(size_t size);
+  static ShmSegment* Open(const std::string& name, size_t size, bool writable);
+  // unlinks the segments left behind by dead processes of this pid namespace
+  static void UnlinkStale();
+
+  void Unlink();
+
+  const std::string& name() const { return name_; }
+  char* ptr() const { return ptr_; }
+  size_t size() const { return size_; }
+
+ private:
+  ShmSegment(const std::string& name, char* ptr, size_t size, bool is_owner);
+
+  std::string name_;
+  char* ptr_;
+  size_t size_;
+  bool is_linked_;
+};
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_SEGMENT_H_
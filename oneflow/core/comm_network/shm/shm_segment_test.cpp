@@ -0,0 +1,69 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/shm/shm_segment.h"
+
+#ifdef PLATFORM_POSIX
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace {
+
+bool IsLinked(const std::string& name) {
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd == -1) { return false; }
+  PCHECK(close(fd) == 0);
+  return true;
+}
+
+}  // namespace
+
+TEST(ShmSegment, unlink_stale_segments_of_dead_processes) {
+  int fds[2];
+  PCHECK(pipe(fds) == 0);
+  const pid_t pid = fork();
+  PCHECK(pid != -1);
+  if (pid == 0) {
+    // dies like a crashed process, without unlinking its segment
+    ShmSegment* segment = ShmSegment::Create(4096);
+    const std::string& name = segment->name();
+    PCHECK(write(fds[1], name.data(), name.size()) == static_cast<ssize_t>(name.size()));
+    _exit(0);
+  }
+  PCHECK(close(fds[1]) == 0);
+  std::string dead_name;
+  char buf[256];
+  ssize_t len = 0;
+  while ((len = read(fds[0], buf, sizeof(buf))) > 0) { dead_name.append(buf, len); }
+  PCHECK(close(fds[0]) == 0);
+  int status = 0;
+  PCHECK(waitpid(pid, &status, 0) == pid);
+  ASSERT_FALSE(dead_name.empty());
+  ASSERT_TRUE(IsLinked(dead_name));
+
+  std::unique_ptr<ShmSegment> live_segment(ShmSegment::Create(4096));
+  ShmSegment::UnlinkStale();
+  ASSERT_FALSE(IsLinked(dead_name));
+  ASSERT_TRUE(IsLinked(live_segment->name()));
+}
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
@@ -0,0 +1,88 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/benchmark.h"
+
+namespace oneflow {
+
+namespace {
+
+HashMap<std::string, std::function<void(BenchmarkState*)>>* MutName2Benchmark() {
+  static HashMap<std::string, std::function<void(BenchmarkState*)>> name2benchmark;
+  return &name2benchmark;
+}
+
+}  // namespace
+
+BenchmarkState::BenchmarkState(double min_time_sec)
+    : min_time_sec_(min_time_sec),
+      iterations_(-1),
+      next_check_iteration_(0),
+      elapsed_sec_(0),
+      bytes_processed_(0),
+      items_processed_(0) {}
+
+bool BenchmarkState::KeepRunning() {
+  if (iterations_ < 0) {
+    iterations_ = 0;
+    start_time_ = std::chrono::steady_clock::now();
+    return true;
+  }
+  iterations_ += 1;
+  if (iterations_ < next_check_iteration_) { return true; }
+  elapsed_sec_ =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+  if (elapsed_sec_ >= min_time_sec_) { return false; }
+  // reads the clock about ten more times, so that it does not weigh on short iterations
+  const double sec_per_iteration = elapsed_sec_ / iterations_;
+  const double step = (min_time_sec_ - elapsed_sec_) / 10 / std::max(sec_per_iteration, 1e-9);
+  next_check_iteration_ = iterations_ + std::max<int64_t>(1, static_cast<int64_t>(step));
+  return true;
+}
+
+void RegisterBenchmark(const std::string& name, const std::function<void(BenchmarkState*)>& Fn) {
+  CHECK(MutName2Benchmark()->emplace(name, Fn).second) << name;
+}
+
+void RunBenchmarks(const std::string& filter, double min_time_sec) {
+  std::vector<std::string> names;
+  for (const auto& pair : *MutName2Benchmark()) {
+    if (pair.first.find(filter) != std::string::npos) { names.push_back(pair.first); }
+  }
+  std::sort(names.begin(), names.end());
+  std::printf("%-56s %12s %14s %12s %14s\n", "benchmark", "iterations", "time/iter", "GB/s",
+              "items/s");
+  for (const std::string& name : names) {
+    BenchmarkState state(min_time_sec);
+    MutName2Benchmark()->at(name)(&state);
+    CHECK_GT(state.iterations(), 0) << name;
+    const double sec = state.elapsed_sec();
+    const double ns_per_iteration = sec * 1e9 / state.iterations();
+    char gb_per_sec[32] = "-";
+    char items_per_sec[32] = "-";
+    if (state.bytes_processed() > 0) {
+      std::snprintf(gb_per_sec, sizeof(gb_per_sec), "%.3f", state.bytes_processed() / sec / 1e9);
+    }
+    if (state.items_processed() > 0) {
+      std::snprintf(items_per_sec, sizeof(items_per_sec), "%.4g", state.items_processed() / sec);
+    }
+    std::printf("%-56s %12lld %11.0f ns %12s %14s %s\n", name.c_str(),
+                static_cast<long long>(state.iterations()), ns_per_iteration, gb_per_sec,
+                items_per_sec, state.label().c_str());
+    std::fflush(stdout);
+  }
+}
+
+}  // namespace oneflow
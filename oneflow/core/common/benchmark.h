@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_BENCHMARK_H_
+#define ONEFLOW_CORE_COMMON_BENCHMARK_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Micro benchmarks live in *_bench.cpp files next to the code they measure and are built into
+// oneflow_benchexe when BUILD_BENCHMARK is on. A benchmark times the iterations of its loop:
+//
+//   OF_BENCHMARK(Memcpy1MiB) {
+//     std::vector<char> src(1 << 20), dst(1 << 20);
+//     while (state->KeepRunning()) { std::memcpy(dst.data(), src.data(), src.size()); }
+//     state->SetBytesProcessed(state->iterations() * src.size());
+//   }
+class BenchmarkState final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(BenchmarkState);
+  explicit BenchmarkState(double min_time_sec);
+  ~BenchmarkState() = default;
+
+  // the first call starts the clock, returns false once min_time_sec has passed
+  bool KeepRunning();
+  int64_t iterations() const { return iterations_; }
+  double elapsed_sec() const { return elapsed_sec_; }
+
+  // totals over all iterations, reported as rates
+  void SetBytesProcessed(int64_t bytes) { bytes_processed_ = bytes; }
+  void SetItemsProcessed(int64_t items) { items_processed_ = items; }
+  void SetLabel(const std::string& label) { label_ = label; }
+
+  int64_t bytes_processed() const { return bytes_processed_; }
+  int64_t items_processed() const { return items_processed_; }
+  const std::string& label() const { return label_; }
+
+ private:
+  double min_time_sec_;
+  int64_t iterations_;
+  int64_t next_check_iteration_;
+  std::chrono::steady_clock::time_point start_time_;
+  double elapsed_sec_;
+  int64_t bytes_processed_;
+  int64_t items_processed_;
+  std::string label_;
+};
+
+// keeps the compiler from dropping a computation whose result is unused
+template<typename T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+void RegisterBenchmark(const std::string& name, const std::function<void(BenchmarkState*)>& Fn);
+// runs the benchmarks whose name contains filter in name order, one line of output each
+void RunBenchmarks(const std::string& filter, double min_time_sec);
+
+#define OF_BENCHMARK(name)                                           \
+  static void OF_PP_CAT(Benchmark, name)(BenchmarkState * state);    \
+  COMMAND(RegisterBenchmark(#name, &OF_PP_CAT(Benchmark, name)));    \
+  static void OF_PP_CAT(Benchmark, name)(BenchmarkState * state)
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_BENCHMARK_H_
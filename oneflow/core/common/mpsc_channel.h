@@ -0,0 +1,265 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+#define ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/channel.h"
+
+namespace oneflow {
+
+// Multi-producer single-consumer channel.
+// Send() pushes into a bounded lock-free ring; when the ring is full, messages spill into a
+// mutex-guarded overflow queue so that senders never block (actor threads send to each other,
+// a blocking Send() could deadlock). The consumer spins for a while before parking on a
+// condition variable, producers only touch the mutex when the consumer is parked.
+template<typename T>
+class MpscChannel final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MpscChannel);
+  MpscChannel() : MpscChannel(kDefaultCapacity) {}
+  explicit MpscChannel(size_t capacity);
+  ~MpscChannel() = default;
+
+  ChannelStatus Send(const T& item);
+  // items are published with one slot claim and at most one wakeup
+  ChannelStatus SendMany(const std::vector<T>& items);
+  ChannelStatus ReceiveMany(std::queue<T>* items);
+  void Close();
+
+  // every actor thread owns a mailbox, so the ring is kept small (about 64 KiB of ActorMsg), a
+  // burst beyond it goes to the overflow queue
+  static const size_t kDefaultCapacity = 1 << 10;
+
+ private:
+  static const size_t kCacheLineSize = 64;
+  static const int64_t kSpinCount = 1024;
+  // spinning only pays off if a producer can run meanwhile on another core
+  static int64_t SpinCount() {
+    static const int64_t spin_count = std::thread::hardware_concurrency() > 1 ? kSpinCount : 0;
+    return spin_count;
+  }
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  bool TryPushToRing(const T& item);
+  bool TryPushManyToRing(const std::vector<T>& items);
+  void PushToOverflow(const T& item);
+  void PushManyToOverflow(const std::vector<T>& items);
+  size_t PopAllFromRing(std::queue<T>* items);
+  size_t PopAllFromOverflow(std::queue<T>* items);
+  bool HasPendingItem() const;
+  void NotifyIfParked();
+
+  std::vector<Cell> ring_;
+  size_t mask_;
+  char pad0_[kCacheLineSize];
+  std::atomic<size_t> enqueue_pos_;
+  char pad1_[kCacheLineSize];
+  size_t dequeue_pos_;
+  std::atomic<bool> is_overflowed_;
+  std::atomic<bool> is_parked_;
+  std::atomic<bool> is_closed_;
+  char pad2_[kCacheLineSize];
+  std::queue<T> overflow_queue_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};
+
+template<typename T>
+MpscChannel<T>::MpscChannel(size_t capacity)
+    : ring_(capacity),
+      mask_(capacity - 1),
+      enqueue_pos_(0),
+      dequeue_pos_(0),
+      is_overflowed_(false),
+      is_parked_(false),
+      is_closed_(false) {
+  CHECK_GE(capacity, 2);
+  CHECK_EQ(capacity & (capacity - 1), 0) << "capacity must be a power of two";
+  FOR_RANGE(size_t, i, 0, capacity) { ring_.at(i).sequence.store(i, std::memory_order_relaxed); }
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::Send(const T& item) {
+  if (is_closed_.load(std::memory_order_acquire)) { return kChannelStatusErrorClosed; }
+  // once an item spilled, later items have to follow it into the overflow queue to keep the
+  // per-producer order, until the consumer has drained the overflow queue
+  if (is_overflowed_.load(std::memory_order_acquire) || !TryPushToRing(item)) {
+    PushToOverflow(item);
+  }
+  NotifyIfParked();
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::SendMany(const std::vector<T>& items) {
+  if (is_closed_.load(std::memory_order_acquire)) { return kChannelStatusErrorClosed; }
+  if (items.empty()) { return kChannelStatusSuccess; }
+  if (is_overflowed_.load(std::memory_order_acquire) || !TryPushManyToRing(items)) {
+    PushManyToOverflow(items);
+  }
+  NotifyIfParked();
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::ReceiveMany(std::queue<T>* items) {
+  int64_t spin_cnt = 0;
+  while (true) {
+    size_t cnt = PopAllFromRing(items);
+    if (is_overflowed_.load(std::memory_order_acquire)) { cnt += PopAllFromOverflow(items); }
+    if (cnt > 0) { return kChannelStatusSuccess; }
+    if (is_closed_.load(std::memory_order_acquire)) { return kChannelStatusErrorClosed; }
+    if (spin_cnt < SpinCount()) {
+      ++spin_cnt;
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    is_parked_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    cond_.wait(lock, [this]() {
+      return HasPendingItem() || is_closed_.load(std::memory_order_acquire);
+    });
+    is_parked_.store(false, std::memory_order_relaxed);
+    spin_cnt = 0;
+  }
+}
+
+template<typename T>
+void MpscChannel<T>::Close() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  is_closed_.store(true, std::memory_order_release);
+  cond_.notify_all();
+}
+
+template<typename T>
+bool MpscChannel<T>::TryPushToRing(const T& item) {
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  Cell* cell = nullptr;
+  while (true) {
+    cell = &ring_[pos & mask_];
+    const size_t seq = cell->sequence.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+  cell->data = item;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+bool MpscChannel<T>::TryPushManyToRing(const std::vector<T>& items) {
+  const size_t num = items.size();
+  if (num > mask_ + 1) { return false; }
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    // the consumer releases slots in order, so once the last slot of the range is free for this
+    // lap, all slots before it are free as well
+    const Cell& last_cell = ring_[(pos + num - 1) & mask_];
+    const size_t seq = last_cell.sequence.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + num - 1);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + num, std::memory_order_relaxed)) { break; }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+  FOR_RANGE(size_t, i, 0, num) {
+    Cell* cell = &ring_[(pos + i) & mask_];
+    cell->data = items[i];
+    cell->sequence.store(pos + i + 1, std::memory_order_release);
+  }
+  return true;
+}
+
+template<typename T>
+void MpscChannel<T>::PushToOverflow(const T& item) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  overflow_queue_.push(item);
+  is_overflowed_.store(true, std::memory_order_release);
+}
+
+template<typename T>
+void MpscChannel<T>::PushManyToOverflow(const std::vector<T>& items) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (const T& item : items) { overflow_queue_.push(item); }
+  is_overflowed_.store(true, std::memory_order_release);
+}
+
+template<typename T>
+size_t MpscChannel<T>::PopAllFromRing(std::queue<T>* items) {
+  size_t cnt = 0;
+  while (true) {
+    Cell* cell = &ring_[dequeue_pos_ & mask_];
+    if (cell->sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) { break; }
+    items->push(std::move(cell->data));
+    cell->sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+    ++dequeue_pos_;
+    ++cnt;
+  }
+  return cnt;
+}
+
+template<typename T>
+size_t MpscChannel<T>::PopAllFromOverflow(std::queue<T>* items) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // items which made it into the ring before the spill must be delivered first, a slot may be
+  // claimed by a sender but not yet filled, in which case the overflow queue has to wait
+  size_t cnt = PopAllFromRing(items);
+  if (dequeue_pos_ != enqueue_pos_.load(std::memory_order_acquire)) { return cnt; }
+  while (!overflow_queue_.empty()) {
+    items->push(std::move(overflow_queue_.front()));
+    overflow_queue_.pop();
+    ++cnt;
+  }
+  is_overflowed_.store(false, std::memory_order_release);
+  return cnt;
+}
+
+template<typename T>
+bool MpscChannel<T>::HasPendingItem() const {
+  if (is_overflowed_.load(std::memory_order_acquire)) { return true; }
+  const Cell& cell = ring_[dequeue_pos_ & mask_];
+  return cell.sequence.load(std::memory_order_acquire) == dequeue_pos_ + 1;
+}
+
+template<typename T>
+void MpscChannel<T>::NotifyIfParked() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (is_parked_.load(std::memory_order_relaxed)) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.notify_one();
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
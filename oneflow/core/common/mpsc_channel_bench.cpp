@@ -0,0 +1,273 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/mpsc_channel.h"
+#include "oneflow/core/common/benchmark.h"
+#include <array>
+
+namespace oneflow {
+
+namespace {
+
+// about the size of an ActorMsg
+struct Msg {
+  int64_t words[8];
+};
+
+// producer_num threads send batches of msgs to one consumer, like actor threads to a mailbox
+template<typename ChannelType>
+void BenchmarkMailbox(BenchmarkState* state, int32_t producer_num) {
+  const int64_t msg_num_per_producer = 4096;
+  ChannelType channel;
+  int64_t received_num = 0;
+  while (state->KeepRunning()) {
+    std::vector<std::thread> producers;
+    FOR_RANGE(int32_t, i, 0, producer_num) {
+      producers.emplace_back([&channel, msg_num_per_producer]() {
+        Msg msg = {};
+        FOR_RANGE(int64_t, j, 0, msg_num_per_producer) {
+          msg.words[0] = j;
+          channel.Send(msg);
+        }
+      });
+    }
+    std::queue<Msg> msgs;
+    int64_t cnt = 0;
+    while (cnt < producer_num * msg_num_per_producer) {
+      CHECK_EQ(channel.ReceiveMany(&msgs), kChannelStatusSuccess);
+      cnt += msgs.size();
+      std::queue<Msg>().swap(msgs);
+    }
+    for (std::thread& producer : producers) { producer.join(); }
+    received_num += cnt;
+  }
+  state->SetItemsProcessed(received_num);
+  state->SetLabel(std::to_string(producer_num) + " producer(s)");
+}
+
+// sends each msg to the mailbox in its words[1] like ActorMsgBus::SendMsgBatch() does: with
+// is_batched the msgs are sorted by mailbox and each group is pushed with one SendMany()
+void SendToMailboxes(std::vector<Msg>* msgs, bool is_batched,
+                     const std::vector<std::unique_ptr<MpscChannel<Msg>>>& channels) {
+  if (!is_batched) {
+    for (const Msg& msg : *msgs) { channels.at(msg.words[1])->Send(msg); }
+    return;
+  }
+  std::stable_sort(msgs->begin(), msgs->end(),
+                   [](const Msg& lhs, const Msg& rhs) { return lhs.words[1] < rhs.words[1]; });
+  std::vector<Msg> group;
+  FOR_RANGE(size_t, i, 0, msgs->size()) {
+    group.push_back(msgs->at(i));
+    if (i + 1 < msgs->size() && msgs->at(i + 1).words[1] == msgs->at(i).words[1]) { continue; }
+    if (group.size() == 1) {
+      channels.at(group.front().words[1])->Send(group.front());
+    } else {
+      channels.at(group.front().words[1])->SendMany(group);
+    }
+    group.clear();
+  }
+}
+
+// one actor thread acts act_num times, each act emits fan_out msgs spread over consumer_num
+// mailboxes; with is_batched the msgs are grouped by mailbox and each group is pushed with
+// SendMany(), otherwise every msg is sent on its own
+void BenchmarkActFanOut(BenchmarkState* state, int32_t consumer_num, int32_t fan_out,
+                        bool is_batched) {
+  const int64_t act_num = 4096;
+  std::vector<std::unique_ptr<MpscChannel<Msg>>> channels;
+  FOR_RANGE(int32_t, i, 0, consumer_num) { channels.emplace_back(new MpscChannel<Msg>()); }
+  std::atomic<int64_t> receive_call_num(0);
+  int64_t received_num = 0;
+  while (state->KeepRunning()) {
+    std::vector<std::thread> consumers;
+    FOR_RANGE(int32_t, i, 0, consumer_num) {
+      consumers.emplace_back([&channels, &receive_call_num, i, act_num, fan_out, consumer_num]() {
+        const int64_t expected_num = act_num * fan_out / consumer_num;
+        std::queue<Msg> msgs;
+        int64_t cnt = 0;
+        while (cnt < expected_num) {
+          CHECK_EQ(channels.at(i)->ReceiveMany(&msgs), kChannelStatusSuccess);
+          cnt += msgs.size();
+          std::queue<Msg>().swap(msgs);
+          ++receive_call_num;
+        }
+      });
+    }
+    std::vector<Msg> act_msgs(fan_out);
+    FOR_RANGE(int64_t, j, 0, act_num) {
+      FOR_RANGE(int32_t, k, 0, fan_out) {
+        act_msgs.at(k).words[0] = j;
+        act_msgs.at(k).words[1] = k % consumer_num;
+      }
+      SendToMailboxes(&act_msgs, is_batched, channels);
+    }
+    for (std::thread& consumer : consumers) { consumer.join(); }
+    received_num += act_num * fan_out;
+  }
+  state->SetItemsProcessed(received_num);
+  state->SetLabel(std::to_string(fan_out) + " msgs/act to " + std::to_string(consumer_num)
+                  + " mailbox(es), "
+                  + std::to_string(static_cast<double>(received_num) / receive_call_num.load())
+                  + " msgs/receive");
+}
+
+const int32_t kPipelineConsumerNum = 2;
+const int64_t kPipelineRegstNum = 2;
+
+// A chain of stage_num actors placed round robin on thread_num actor threads. The regst of a
+// stage is consumed by the next kPipelineConsumerNum stages, so an act acks its producers and
+// tells its consumers. Msgs for an actor of the sending thread are handled in place, like the
+// local msg queue of an actor thread does, the others go through the mailboxes, per msg or
+// grouped by thread.
+void BenchmarkDeepPipeline(BenchmarkState* state, int32_t stage_num, int32_t thread_num,
+                           bool is_batched) {
+  const int64_t piece_num = 1024;
+  enum { kReady = 0, kAck = 1 };
+  int64_t sent_num = 0;
+  while (state->KeepRunning()) {
+    std::vector<std::unique_ptr<MpscChannel<Msg>>> channels;
+    FOR_RANGE(int32_t, i, 0, thread_num) { channels.emplace_back(new MpscChannel<Msg>()); }
+    std::atomic<int64_t> iter_sent_num(0);
+    std::vector<std::thread> threads;
+    FOR_RANGE(int32_t, thrd_id, 0, thread_num) {
+      threads.emplace_back([&channels, &iter_sent_num, thrd_id, stage_num, thread_num,
+                            is_batched, piece_num]() {
+        // per stage: ready regsts of each producer, acks received and acts done
+        std::vector<std::array<int64_t, kPipelineConsumerNum>> ready_cnts(stage_num);
+        std::vector<int64_t> ack_cnts(stage_num, 0);
+        std::vector<int64_t> act_cnts(stage_num, 0);
+        for (auto& cnts : ready_cnts) { cnts.fill(0); }
+        auto ProducerNum = [&](int32_t stage) { return std::min(stage, kPipelineConsumerNum); };
+        auto ConsumerNum = [&](int32_t stage) {
+          return std::min(stage_num - 1 - stage, kPipelineConsumerNum);
+        };
+        auto Handle = [&](const Msg& msg) {
+          if (msg.words[2] == kReady) {
+            ready_cnts.at(msg.words[0]).at(msg.words[3]) += 1;
+          } else {
+            ack_cnts.at(msg.words[0]) += 1;
+          }
+        };
+        auto CanAct = [&](int32_t stage) {
+          if (act_cnts.at(stage) == piece_num) { return false; }
+          FOR_RANGE(int32_t, k, 0, ProducerNum(stage)) {
+            if (ready_cnts.at(stage).at(k) == 0) { return false; }
+          }
+          if (ConsumerNum(stage) == 0) { return true; }
+          const int64_t free_regst_num =
+              kPipelineRegstNum - act_cnts.at(stage) + ack_cnts.at(stage) / ConsumerNum(stage);
+          return free_regst_num > 0;
+        };
+        std::vector<Msg> act_msgs;
+        auto Act = [&](int32_t stage) {
+          act_msgs.clear();
+          Msg msg = {};
+          FOR_RANGE(int32_t, k, 0, ProducerNum(stage)) {
+            ready_cnts.at(stage).at(k) -= 1;
+            msg.words[0] = stage - 1 - k;
+            msg.words[2] = kAck;
+            act_msgs.push_back(msg);
+          }
+          FOR_RANGE(int32_t, k, 0, ConsumerNum(stage)) {
+            msg.words[0] = stage + 1 + k;
+            msg.words[2] = kReady;
+            msg.words[3] = k;
+            act_msgs.push_back(msg);
+          }
+          act_cnts.at(stage) += 1;
+          iter_sent_num += act_msgs.size();
+          std::vector<Msg> remote_msgs;
+          for (Msg& act_msg : act_msgs) {
+            act_msg.words[1] = act_msg.words[0] % thread_num;
+            if (act_msg.words[1] == thrd_id) {
+              Handle(act_msg);
+            } else {
+              remote_msgs.push_back(act_msg);
+            }
+          }
+          SendToMailboxes(&remote_msgs, is_batched, channels);
+        };
+        std::queue<Msg> msgs;
+        while (true) {
+          bool is_acted = true;
+          while (is_acted) {
+            is_acted = false;
+            for (int32_t stage = thrd_id; stage < stage_num; stage += thread_num) {
+              while (CanAct(stage)) {
+                Act(stage);
+                is_acted = true;
+              }
+            }
+          }
+          bool is_done = true;
+          for (int32_t stage = thrd_id; stage < stage_num; stage += thread_num) {
+            if (act_cnts.at(stage) < piece_num) { is_done = false; }
+          }
+          if (is_done) { break; }
+          CHECK_EQ(channels.at(thrd_id)->ReceiveMany(&msgs), kChannelStatusSuccess);
+          while (!msgs.empty()) {
+            Handle(msgs.front());
+            msgs.pop();
+          }
+        }
+      });
+    }
+    for (std::thread& thread : threads) { thread.join(); }
+    sent_num += iter_sent_num.load();
+  }
+  state->SetItemsProcessed(sent_num);
+  state->SetLabel(std::to_string(stage_num) + " stages on " + std::to_string(thread_num)
+                  + " threads");
+}
+
+}  // namespace
+
+// from one producer up to more producers than cores, the names are padded to list in order
+COMMAND(for (int32_t producer_num : {1, 2, 4, 8, 16, 32, 64}) {
+  const std::string suffix =
+      std::string(producer_num < 10 ? "0" : "") + std::to_string(producer_num) + "Producers";
+  RegisterBenchmark("ChannelMailbox_" + suffix, [producer_num](BenchmarkState* state) {
+    BenchmarkMailbox<Channel<Msg>>(state, producer_num);
+  });
+  RegisterBenchmark("MpscChannelMailbox_" + suffix, [producer_num](BenchmarkState* state) {
+    BenchmarkMailbox<MpscChannel<Msg>>(state, producer_num);
+  });
+});
+
+OF_BENCHMARK(ActFanOut_1Mailbox_PerMsgSend) { BenchmarkActFanOut(state, 1, 8, false); }
+
+OF_BENCHMARK(ActFanOut_1Mailbox_BatchedSend) { BenchmarkActFanOut(state, 1, 8, true); }
+
+OF_BENCHMARK(ActFanOut_2Mailboxes_PerMsgSend) { BenchmarkActFanOut(state, 2, 8, false); }
+
+OF_BENCHMARK(ActFanOut_2Mailboxes_GroupedSend) { BenchmarkActFanOut(state, 2, 8, true); }
+
+OF_BENCHMARK(DeepPipeline_64Stages_2Threads_PerMsgSend) {
+  BenchmarkDeepPipeline(state, 64, 2, false);
+}
+
+OF_BENCHMARK(DeepPipeline_64Stages_2Threads_GroupedSend) {
+  BenchmarkDeepPipeline(state, 64, 2, true);
+}
+
+OF_BENCHMARK(DeepPipeline_64Stages_4Threads_PerMsgSend) {
+  BenchmarkDeepPipeline(state, 64, 4, false);
+}
+
+OF_BENCHMARK(DeepPipeline_64Stages_4Threads_GroupedSend) {
+  BenchmarkDeepPipeline(state, 64, 4, true);
+}
+
+}  // namespace oneflow
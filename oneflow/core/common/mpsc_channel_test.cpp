@@ -0,0 +1,89 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/mpsc_channel.h"
+#include "oneflow/core/common/range.h"
+
+namespace oneflow {
+
+namespace {
+
+void SendFromSenderThread(MpscChannel<std::pair<int, int>>* channel, int sender_id, Range range,
+                          int batch_size) {
+  std::vector<std::pair<int, int>> batch;
+  for (int i = range.begin(); i < range.end(); ++i) {
+    if (batch_size == 1) {
+      if (channel->Send(std::make_pair(sender_id, i)) != kChannelStatusSuccess) { break; }
+    } else {
+      batch.push_back(std::make_pair(sender_id, i));
+      if (batch.size() == static_cast<size_t>(batch_size) || i + 1 == range.end()) {
+        if (channel->SendMany(batch) != kChannelStatusSuccess) { break; }
+        batch.clear();
+      }
+    }
+  }
+}
+
+void TestMpscChannel(size_t capacity, int sender_num, int range_num, int batch_size) {
+  MpscChannel<std::pair<int, int>> channel(capacity);
+  std::vector<int> next_expected(sender_num, 0);
+  std::thread receiver([&]() {
+    std::queue<std::pair<int, int>> items;
+    while (channel.ReceiveMany(&items) == kChannelStatusSuccess) {
+      while (!items.empty()) {
+        // items from the same sender are received in order
+        ASSERT_EQ(items.front().second, next_expected.at(items.front().first));
+        ++next_expected.at(items.front().first);
+        items.pop();
+      }
+    }
+  });
+  std::vector<std::thread> senders;
+  for (int i = 0; i < sender_num; ++i) {
+    senders.push_back(
+        std::thread(SendFromSenderThread, &channel, i, Range(0, range_num), batch_size));
+  }
+  for (std::thread& this_thread : senders) { this_thread.join(); }
+  channel.Close();
+  receiver.join();
+  for (int i = 0; i < sender_num; ++i) { ASSERT_EQ(next_expected.at(i), range_num); }
+}
+
+}  // namespace
+
+TEST(MpscChannel, 30sender1receiver) {
+  TestMpscChannel(MpscChannel<int>::kDefaultCapacity, 30, 2000, 1);
+}
+
+TEST(MpscChannel, overflow) { TestMpscChannel(4, 30, 2000, 1); }
+
+TEST(MpscChannel, send_many) {
+  TestMpscChannel(MpscChannel<int>::kDefaultCapacity, 30, 2000, 7);
+  TestMpscChannel(8, 30, 2000, 3);
+  TestMpscChannel(4, 30, 2000, 7);
+}
+
+TEST(MpscChannel, send_after_close) {
+  MpscChannel<int> channel;
+  ASSERT_EQ(channel.Send(0), kChannelStatusSuccess);
+  channel.Close();
+  ASSERT_EQ(channel.Send(1), kChannelStatusErrorClosed);
+  std::queue<int> items;
+  ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusSuccess);
+  ASSERT_EQ(items.size(), 1);
+  ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusErrorClosed);
+}
+
+}  // namespace oneflow
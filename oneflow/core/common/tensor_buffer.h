@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/common/shape.h"
 #include "oneflow/core/common/data_type.h"
 #include "oneflow/core/common/util.h"
+#include "oneflow/core/common/tensor_buffer_pool.h"
 #include "oneflow/core/memory/memory_allocator.h"
 
 namespace oneflow {
@@ -31,7 +32,17 @@ inline void CheckTensorBufferDataType(DataType val) {
 class TensorBuffer {
  public:
   struct Deleter {
-    void operator()(void* ptr) { MemoryAllocatorImpl::DeallocateUnPinnedHostMem(ptr); }
+    void operator()(void* ptr) {
+      if (mem_holder) {
+        mem_holder.reset();
+      } else {
+        TensorBufferPool::Get()->Deallocate(ptr, capacity);
+      }
+    }
+    // set when the buffer shares memory owned by someone else
+    std::shared_ptr<const void> mem_holder;
+    // size of an owned buffer, as returned by TensorBufferPool::Allocate
+    size_t capacity;
   };
   typedef std::unique_ptr<void, Deleter> BufferType;
 
@@ -59,6 +70,8 @@ class TensorBuffer {
   inline T* mut_data() {
     if (data_ == nullptr) { return nullptr; }
     CheckDataType<T>(data_type_);
+    // shared memory may be read only or read by others, writes go to a copy of it
+    if (is_shared_mem()) { Unshare(num_bytes_); }
     return static_cast<T*>(data_.get());
   }
 
@@ -76,11 +89,32 @@ class TensorBuffer {
     num_bytes_ = 0;
   }
 
+  // Makes the buffer refer to the memory at ptr without copying, mem_holder keeps the memory
+  // alive until the buffer is reset or destroyed. The memory is never written through the buffer,
+  // mut_data(), resizing or reserving copy the shared bytes into memory of its own first.
+  void ShareMem(const std::shared_ptr<const void>& mem_holder, const void* ptr, const Shape& shape,
+                DataType data_type) {
+    CheckTensorBufferDataType(data_type);
+    data_.reset();
+    data_ = BufferType(const_cast<void*>(ptr), Deleter{mem_holder, 0});
+    num_bytes_ = shape.elem_cnt() * GetSizeOfDataType(data_type);
+    shape_ = shape;
+    data_type_ = data_type;
+  }
+
+  bool is_shared_mem() const { return static_cast<bool>(data_.get_deleter().mem_holder); }
+
   void reserve(size_t new_num_bytes) {
+    if (is_shared_mem()) {
+      Unshare(std::max(new_num_bytes, num_bytes_));
+      return;
+    }
     if (new_num_bytes <= num_bytes_) { return; }
     data_.reset();
-    data_.reset(MemoryAllocatorImpl::AllocateUnPinnedHostMem(new_num_bytes));
-    num_bytes_ = new_num_bytes;
+    size_t capacity = 0;
+    void* ptr = TensorBufferPool::Get()->Allocate(new_num_bytes, &capacity);
+    data_ = BufferType(ptr, Deleter{nullptr, capacity});
+    num_bytes_ = capacity;
   }
 
   int64_t elem_cnt() const { return shape_.elem_cnt(); }
@@ -101,11 +135,14 @@ class TensorBuffer {
 
     size_t new_num_bytes = elem_cnt * GetSizeOfDataType(new_type);
     new_num_bytes = RoundUp(new_num_bytes, kTensorBufferAlignedSize);
-    if (new_num_bytes > num_bytes_) {
+    if (is_shared_mem()) {
+      Unshare(new_num_bytes);
+    } else if (new_num_bytes > num_bytes_) {
       new_num_bytes =
           std::max(new_num_bytes, RoundUp(num_bytes_ * growth_factor_, kTensorBufferAlignedSize));
       reserve(new_num_bytes);
-    } else if (new_num_bytes < num_bytes_ * shrink_threshold_) {
+    } else if (new_num_bytes < num_bytes_ * shrink_threshold_
+               && TensorBufferPool::Capacity4Size(new_num_bytes) < num_bytes_) {
       data_.reset();
       num_bytes_ = 0;
       reserve(new_num_bytes);
@@ -126,6 +163,15 @@ class TensorBuffer {
   }
 
  private:
+  // replaces shared memory with owned memory of at least new_num_bytes holding the same bytes
+  void Unshare(size_t new_num_bytes) {
+    size_t capacity = 0;
+    void* ptr = TensorBufferPool::Get()->Allocate(new_num_bytes, &capacity);
+    memcpy(ptr, data_.get(), std::min(num_bytes_, capacity));
+    data_ = BufferType(ptr, Deleter{nullptr, capacity});
+    num_bytes_ = capacity;
+  }
+
   // TODO(chengcheng)
   static double growth_factor_;
   static double shrink_threshold_;
@@ -0,0 +1,215 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/tensor_buffer_pool.h"
+#include <array>
+#include "oneflow/core/memory/memory_allocator.h"
+
+namespace oneflow {
+
+namespace {
+
+// size classes: 1KiB, then four classes per power of two up to 64MiB
+const size_t kMinClassSize = 1 << 10;
+const size_t kMaxClassSize = 64 << 20;
+const int32_t kNumSizeClasses = 65;
+const size_t kMaxThreadCacheBytesPerClass = 16 << 20;
+const size_t kMaxThreadCacheBytes = 64 << 20;
+const size_t kMaxSharedCachedBytes = 512 << 20;
+const int64_t kStatsLogInterval = 1 << 22;
+
+int32_t SizeClass4Size(size_t size) {
+  if (size <= kMinClassSize) { return 0; }
+  const uint64_t value = size - 1;
+  const int32_t lg = 63 ^ __builtin_clzll(value);
+  const int32_t sub = static_cast<int32_t>((value >> (lg - 2)) & 3);
+  return (lg - 10) * 4 + sub + 1;
+}
+
+size_t Size4SizeClass(int32_t size_class) {
+  if (size_class == 0) { return kMinClassSize; }
+  const int32_t lg = 10 + (size_class - 1) / 4;
+  const int32_t sub = (size_class - 1) % 4;
+  return (static_cast<size_t>(1) << lg) + (sub + 1) * (static_cast<size_t>(1) << (lg - 2));
+}
+
+size_t ThreadCacheCapacity4SizeClass(int32_t size_class) {
+  return std::max<size_t>(2, kMaxThreadCacheBytesPerClass / Size4SizeClass(size_class));
+}
+
+}  // namespace
+
+struct TensorBufferPool::SharedFreeList final {
+  std::mutex mutex;
+  std::vector<void*> ptrs;
+};
+
+struct TensorBufferPool::ThreadCache final {
+  ThreadCache()
+      : cached_bytes(0), trim_epoch(TensorBufferPool::Get()->trim_epoch_.load()) {}
+  ~ThreadCache() {
+    FOR_RANGE(int32_t, i, 0, kNumSizeClasses) {
+      for (void* ptr : free_lists[i]) { TensorBufferPool::Get()->PushToShared(i, ptr); }
+    }
+  }
+
+  std::array<std::vector<void*>, kNumSizeClasses> free_lists;
+  size_t cached_bytes;
+  int64_t trim_epoch;
+};
+
+TensorBufferPool::TensorBufferPool()
+    : shared_free_lists_(new SharedFreeList[kNumSizeClasses]),
+      shared_cached_bytes_(0),
+      trim_epoch_(0),
+      num_allocs_(0),
+      num_thread_cache_hits_(0),
+      num_shared_hits_(0) {}
+
+TensorBufferPool* TensorBufferPool::Get() {
+  static TensorBufferPool* pool = new TensorBufferPool();
+  return pool;
+}
+
+size_t TensorBufferPool::Capacity4Size(size_t size) {
+  if (size > kMaxClassSize) { return size; }
+  return Size4SizeClass(SizeClass4Size(size));
+}
+
+void* TensorBufferPool::Allocate(size_t size, size_t* capacity) {
+  const int64_t num_allocs = num_allocs_.fetch_add(1, std::memory_order_relaxed) + 1;
+  MaybeLogStats(num_allocs);
+  if (size > kMaxClassSize) {
+    *capacity = size;
+    return MemoryAllocatorImpl::AllocateUnPinnedHostMem(size);
+  }
+  const int32_t size_class = SizeClass4Size(size);
+  const size_t class_size = Size4SizeClass(size_class);
+  *capacity = class_size;
+  ThreadCache* thread_cache = GetThreadCache();
+  std::vector<void*>* free_list = &thread_cache->free_lists[size_class];
+  if (!free_list->empty()) {
+    void* ptr = free_list->back();
+    free_list->pop_back();
+    thread_cache->cached_bytes -= class_size;
+    num_thread_cache_hits_.fetch_add(1, std::memory_order_relaxed);
+    return ptr;
+  }
+  void* ptr = PopFromShared(size_class);
+  if (ptr != nullptr) {
+    num_shared_hits_.fetch_add(1, std::memory_order_relaxed);
+    return ptr;
+  }
+  return MemoryAllocatorImpl::AllocateUnPinnedHostMem(class_size);
+}
+
+void TensorBufferPool::Deallocate(void* ptr, size_t capacity) {
+  if (ptr == nullptr) { return; }
+  if (capacity > kMaxClassSize) {
+    MemoryAllocatorImpl::DeallocateUnPinnedHostMem(ptr, capacity);
+    return;
+  }
+  const int32_t size_class = SizeClass4Size(capacity);
+  CHECK_EQ(Size4SizeClass(size_class), capacity);
+  ThreadCache* thread_cache = GetThreadCache();
+  std::vector<void*>* free_list = &thread_cache->free_lists[size_class];
+  if (free_list->size() < ThreadCacheCapacity4SizeClass(size_class)
+      && thread_cache->cached_bytes + capacity <= kMaxThreadCacheBytes) {
+    free_list->push_back(ptr);
+    thread_cache->cached_bytes += capacity;
+  } else {
+    PushToShared(size_class, ptr);
+  }
+}
+
+TensorBufferPool::Stats TensorBufferPool::GetStats() const {
+  Stats stats;
+  stats.num_allocs = num_allocs_.load(std::memory_order_relaxed);
+  stats.num_thread_cache_hits = num_thread_cache_hits_.load(std::memory_order_relaxed);
+  stats.num_shared_hits = num_shared_hits_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void TensorBufferPool::Trim() {
+  trim_epoch_.fetch_add(1);
+  GetThreadCache();
+  FOR_RANGE(int32_t, i, 0, kNumSizeClasses) {
+    std::vector<void*> ptrs;
+    {
+      SharedFreeList* free_list = &shared_free_lists_[i];
+      std::unique_lock<std::mutex> lock(free_list->mutex);
+      ptrs.swap(free_list->ptrs);
+    }
+    const size_t class_size = Size4SizeClass(i);
+    shared_cached_bytes_.fetch_sub(ptrs.size() * class_size, std::memory_order_relaxed);
+    for (void* ptr : ptrs) { MemoryAllocatorImpl::DeallocateUnPinnedHostMem(ptr, class_size); }
+  }
+}
+
+TensorBufferPool::ThreadCache* TensorBufferPool::GetThreadCache() {
+  static thread_local ThreadCache thread_cache;
+  const int64_t trim_epoch = trim_epoch_.load(std::memory_order_relaxed);
+  if (thread_cache.trim_epoch != trim_epoch) {
+    FreeThreadCache(&thread_cache);
+    thread_cache.trim_epoch = trim_epoch;
+  }
+  return &thread_cache;
+}
+
+void TensorBufferPool::FreeThreadCache(ThreadCache* thread_cache) {
+  FOR_RANGE(int32_t, i, 0, kNumSizeClasses) {
+    const size_t class_size = Size4SizeClass(i);
+    for (void* ptr : thread_cache->free_lists[i]) {
+      MemoryAllocatorImpl::DeallocateUnPinnedHostMem(ptr, class_size);
+    }
+    thread_cache->free_lists[i].clear();
+  }
+  thread_cache->cached_bytes = 0;
+}
+
+void* TensorBufferPool::PopFromShared(int32_t size_class) {
+  SharedFreeList* free_list = &shared_free_lists_[size_class];
+  std::unique_lock<std::mutex> lock(free_list->mutex);
+  if (free_list->ptrs.empty()) { return nullptr; }
+  void* ptr = free_list->ptrs.back();
+  free_list->ptrs.pop_back();
+  shared_cached_bytes_.fetch_sub(Size4SizeClass(size_class), std::memory_order_relaxed);
+  return ptr;
+}
+
+void TensorBufferPool::PushToShared(int32_t size_class, void* ptr) {
+  const size_t class_size = Size4SizeClass(size_class);
+  if (shared_cached_bytes_.fetch_add(class_size, std::memory_order_relaxed) + class_size
+      > kMaxSharedCachedBytes) {
+    shared_cached_bytes_.fetch_sub(class_size, std::memory_order_relaxed);
+    MemoryAllocatorImpl::DeallocateUnPinnedHostMem(ptr, class_size);
+    return;
+  }
+  SharedFreeList* free_list = &shared_free_lists_[size_class];
+  std::unique_lock<std::mutex> lock(free_list->mutex);
+  free_list->ptrs.push_back(ptr);
+}
+
+void TensorBufferPool::MaybeLogStats(int64_t num_allocs) const {
+  if (num_allocs % kStatsLogInterval != 0) { return; }
+  const Stats stats = GetStats();
+  LOG(INFO) << "TensorBufferPool allocs: " << stats.num_allocs
+            << ", thread cache hits: " << stats.num_thread_cache_hits
+            << ", shared hits: " << stats.num_shared_hits << ", hit rate: "
+            << static_cast<double>(stats.num_thread_cache_hits + stats.num_shared_hits)
+                   / stats.num_allocs;
+}
+
+}  // namespace oneflow
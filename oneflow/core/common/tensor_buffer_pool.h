@@ -0,0 +1,75 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_TENSOR_BUFFER_POOL_H_
+#define ONEFLOW_CORE_COMMON_TENSOR_BUFFER_POOL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Recycles the storage of TensorBuffers. Sizes are rounded up to size classes, four per power of
+// two. Released buffers go to a cache of the releasing thread first and overflow into a shared
+// free list per size class, which any thread can take them from. Buffers larger than the largest
+// class, or released while the caches are full, go back to the host allocator. Trim() gives the
+// cached buffers back to it as well.
+class TensorBufferPool final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TensorBufferPool);
+  ~TensorBufferPool() = default;
+
+  struct Stats {
+    int64_t num_allocs;
+    int64_t num_thread_cache_hits;
+    int64_t num_shared_hits;
+  };
+
+  // never destroyed, thread caches flush into it when their threads exit
+  static TensorBufferPool* Get();
+
+  // returns a buffer of at least size bytes, *capacity receives its actual size which has to be
+  // passed to Deallocate
+  void* Allocate(size_t size, size_t* capacity);
+  void Deallocate(void* ptr, size_t capacity);
+  Stats GetStats() const;
+  // frees the shared free lists and the caller's cache now, the caches of other threads are freed
+  // the next time those threads use the pool, or flush into the shared free lists on exit
+  void Trim();
+
+  static size_t Capacity4Size(size_t size);
+
+ private:
+  struct ThreadCache;
+  struct SharedFreeList;
+
+  TensorBufferPool();
+  ThreadCache* GetThreadCache();
+  void* PopFromShared(int32_t size_class);
+  void PushToShared(int32_t size_class, void* ptr);
+  void FreeThreadCache(ThreadCache* thread_cache);
+  void MaybeLogStats(int64_t num_allocs) const;
+
+  std::unique_ptr<SharedFreeList[]> shared_free_lists_;
+  std::atomic<size_t> shared_cached_bytes_;
+  // bumped by Trim(), a thread cache which has seen an older value is freed before use
+  std::atomic<int64_t> trim_epoch_;
+  std::atomic<int64_t> num_allocs_;
+  std::atomic<int64_t> num_thread_cache_hits_;
+  std::atomic<int64_t> num_shared_hits_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_TENSOR_BUFFER_POOL_H_
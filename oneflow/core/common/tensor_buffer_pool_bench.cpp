@@ -0,0 +1,88 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <cstdlib>
+#include <thread>
+#include "oneflow/core/common/tensor_buffer_pool.h"
+#include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/benchmark.h"
+
+namespace oneflow {
+
+namespace {
+
+const int64_t kBatchSize = 64;
+
+// ptr and capacity of every sample of a batch
+using SampleBatch = std::vector<std::pair<void*, size_t>>;
+
+// The loading thread allocates and writes the samples of a batch, decoded images of 100-250KiB,
+// and the consuming thread releases them, as in a data pipeline where buffers die on another
+// thread than the one that filled them.
+void BenchmarkSampleBuffers(BenchmarkState* state, bool is_pooled) {
+  Channel<SampleBatch> channel;
+  std::thread consumer([&channel, is_pooled]() {
+    SampleBatch batch;
+    while (channel.Receive(&batch) == kChannelStatusSuccess) {
+      for (const auto& pair : batch) {
+        if (is_pooled) {
+          TensorBufferPool::Get()->Deallocate(pair.first, pair.second);
+        } else {
+          std::free(pair.first);
+        }
+      }
+    }
+  });
+  const TensorBufferPool::Stats before = TensorBufferPool::Get()->GetStats();
+  int64_t bytes = 0;
+  int64_t sample_id = 0;
+  while (state->KeepRunning()) {
+    SampleBatch batch(kBatchSize);
+    for (auto& pair : batch) {
+      const size_t size = (100 << 10) + (sample_id * 7919 % 150) * 1024;
+      sample_id += 1;
+      if (is_pooled) {
+        pair.first = TensorBufferPool::Get()->Allocate(size, &pair.second);
+      } else {
+        pair.first = std::malloc(size);
+        pair.second = size;
+      }
+      std::memset(pair.first, 1, size);
+      DoNotOptimize(pair.first);
+      bytes += size;
+    }
+    channel.Send(batch);
+  }
+  channel.Close();
+  consumer.join();
+  state->SetItemsProcessed(state->iterations() * kBatchSize);
+  state->SetBytesProcessed(bytes);
+  if (is_pooled) {
+    const TensorBufferPool::Stats after = TensorBufferPool::Get()->GetStats();
+    const int64_t hit_num = after.num_thread_cache_hits - before.num_thread_cache_hits
+                            + after.num_shared_hits - before.num_shared_hits;
+    state->SetLabel("hit rate "
+                    + std::to_string(hit_num * 100 / (after.num_allocs - before.num_allocs))
+                    + "%");
+  }
+}
+
+}  // namespace
+
+OF_BENCHMARK(SampleBuffersMalloc) { BenchmarkSampleBuffers(state, false); }
+
+OF_BENCHMARK(SampleBuffersPooled) { BenchmarkSampleBuffers(state, true); }
+
+}  // namespace oneflow
@@ -0,0 +1,104 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace test {
+
+TEST(TensorBufferPool, size_class) {
+  for (size_t size : {size_t(1), size_t(1000), size_t(1025), size_t(5000), size_t(3 << 20),
+                      size_t((64 << 20) - 1), size_t(64 << 20), size_t((64 << 20) + 1)}) {
+    const size_t capacity = TensorBufferPool::Capacity4Size(size);
+    ASSERT_GE(capacity, size);
+    ASSERT_LE(capacity, std::max<size_t>(1024, size + size / 4 + 1));
+    ASSERT_EQ(TensorBufferPool::Capacity4Size(capacity), capacity);
+  }
+}
+
+TEST(TensorBufferPool, recycle) {
+  TensorBufferPool* pool = TensorBufferPool::Get();
+  const TensorBufferPool::Stats before = pool->GetStats();
+  size_t capacity = 0;
+  void* ptr = pool->Allocate(150 * 1024, &capacity);
+  pool->Deallocate(ptr, capacity);
+  size_t reused_capacity = 0;
+  ASSERT_EQ(pool->Allocate(150 * 1024 - 100, &reused_capacity), ptr);
+  ASSERT_EQ(reused_capacity, capacity);
+  // released by another thread, whose cache flushes into the shared free lists when it exits
+  std::thread([&]() { pool->Deallocate(ptr, capacity); }).join();
+  ASSERT_EQ(pool->Allocate(capacity, &reused_capacity), ptr);
+  pool->Deallocate(ptr, reused_capacity);
+  const TensorBufferPool::Stats after = pool->GetStats();
+  ASSERT_EQ(after.num_allocs - before.num_allocs, 3);
+  ASSERT_EQ(after.num_thread_cache_hits - before.num_thread_cache_hits, 1);
+  ASSERT_EQ(after.num_shared_hits - before.num_shared_hits, 1);
+}
+
+TEST(TensorBufferPool, trim) {
+  TensorBufferPool* pool = TensorBufferPool::Get();
+  size_t capacity = 0;
+  void* cached = pool->Allocate(70 * 1024, &capacity);
+  void* shared = pool->Allocate(70 * 1024, &capacity);
+  pool->Deallocate(cached, capacity);
+  std::thread([&]() { pool->Deallocate(shared, capacity); }).join();
+  const TensorBufferPool::Stats before = pool->GetStats();
+  pool->Trim();
+  // neither the cache of this thread nor the shared free lists keep a buffer
+  void* ptr = pool->Allocate(capacity, &capacity);
+  const TensorBufferPool::Stats after = pool->GetStats();
+  ASSERT_EQ(after.num_thread_cache_hits, before.num_thread_cache_hits);
+  ASSERT_EQ(after.num_shared_hits, before.num_shared_hits);
+  pool->Deallocate(ptr, capacity);
+  // the cache of another thread is freed the next time that thread uses the pool
+  BlockingCounter cached_counter(1);
+  BlockingCounter trimmed_counter(1);
+  std::thread thread([&]() {
+    void* thread_ptr = pool->Allocate(capacity, &capacity);
+    pool->Deallocate(thread_ptr, capacity);
+    cached_counter.Decrease();
+    trimmed_counter.WaitUntilCntEqualZero();
+    const int64_t num_thread_cache_hits = pool->GetStats().num_thread_cache_hits;
+    pool->Deallocate(pool->Allocate(capacity, &capacity), capacity);
+    ASSERT_EQ(pool->GetStats().num_thread_cache_hits, num_thread_cache_hits);
+  });
+  cached_counter.WaitUntilCntEqualZero();
+  pool->Trim();
+  trimmed_counter.Decrease();
+  thread.join();
+}
+
+TEST(TensorBufferPool, tensor_buffer_resize) {
+  const int64_t num_allocs = TensorBufferPool::Get()->GetStats().num_allocs;
+  TensorBuffer buffer;
+  buffer.Resize(Shape({300, 400, 3}), DataType::kUInt8);
+  const void* ptr = buffer.data();
+  // sizes within the same size class keep the storage
+  buffer.Resize(Shape({290, 400, 3}), DataType::kUInt8);
+  buffer.Resize(Shape({300, 400, 3}), DataType::kUInt8);
+  ASSERT_EQ(buffer.data(), ptr);
+  ASSERT_EQ(TensorBufferPool::Get()->GetStats().num_allocs - num_allocs, 1);
+  buffer.reset();
+  TensorBuffer other;
+  other.Resize(Shape({300, 400, 3}), DataType::kUInt8);
+  ASSERT_EQ(other.data(), ptr);
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -0,0 +1,70 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/tensor_buffer.h"
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace test {
+
+TEST(TensorBuffer, copy_shared_mem_on_resize) {
+  std::shared_ptr<std::vector<float>> src(new std::vector<float>(256));
+  FOR_RANGE(size_t, i, 0, src->size()) { src->at(i) = static_cast<float>(i); }
+  TensorBuffer buffer;
+  buffer.ShareMem(src, src->data(), Shape({256}), DataType::kFloat);
+  ASSERT_TRUE(buffer.is_shared_mem());
+  ASSERT_EQ(buffer.data<float>(), src->data());
+
+  buffer.reserve(256 * sizeof(float));
+  ASSERT_FALSE(buffer.is_shared_mem());
+  ASSERT_NE(buffer.data<float>(), src->data());
+  FOR_RANGE(size_t, i, 0, 256) { ASSERT_EQ(buffer.data<float>()[i], static_cast<float>(i)); }
+
+  buffer.ShareMem(src, src->data(), Shape({256}), DataType::kFloat);
+  buffer.Resize(Shape({1024}));
+  ASSERT_FALSE(buffer.is_shared_mem());
+  ASSERT_GE(buffer.capacity(), 1024 * sizeof(float));
+  FOR_RANGE(size_t, i, 0, 256) { ASSERT_EQ(buffer.data<float>()[i], static_cast<float>(i)); }
+  buffer.mut_data<float>()[0] = -1.f;
+  ASSERT_EQ(src->at(0), 0.f);
+
+  buffer.ShareMem(src, src->data(), Shape({256}), DataType::kFloat);
+  buffer.Resize(Shape({16}));
+  ASSERT_FALSE(buffer.is_shared_mem());
+  FOR_RANGE(size_t, i, 0, 16) { ASSERT_EQ(buffer.data<float>()[i], static_cast<float>(i)); }
+}
+
+TEST(TensorBuffer, copy_shared_mem_on_mut_data) {
+  std::shared_ptr<std::vector<float>> src(new std::vector<float>(256));
+  FOR_RANGE(size_t, i, 0, src->size()) { src->at(i) = static_cast<float>(i); }
+  TensorBuffer buffer;
+  buffer.ShareMem(src, src->data(), Shape({256}), DataType::kFloat);
+  ASSERT_EQ(buffer.data<float>(), src->data());
+  ASSERT_TRUE(buffer.is_shared_mem());
+
+  float* dst = buffer.mut_data<float>();
+  ASSERT_FALSE(buffer.is_shared_mem());
+  ASSERT_NE(dst, src->data());
+  ASSERT_EQ(buffer.shape(), Shape({256}));
+  FOR_RANGE(size_t, i, 0, 256) { ASSERT_EQ(dst[i], static_cast<float>(i)); }
+  dst[0] = -1.f;
+  ASSERT_EQ(src->at(0), 0.f);
+  ASSERT_EQ(buffer.mut_data<float>(), dst);
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -171,20 +171,24 @@ void CudaDeviceGetCpuAffinity(int32_t dev_id, cpu_set_t* cpu_set) {
 
 #endif
 
-void NumaAwareCudaMallocHost(int32_t dev, void** ptr, size_t size) {
+void RunOnCudaDeviceLocalCpus(int32_t dev, const std::function<void()>& Fn) {
 #ifdef PLATFORM_POSIX
   cpu_set_t new_cpu_set;
   CudaDeviceGetCpuAffinity(dev, &new_cpu_set);
   cpu_set_t saved_cpu_set;
   CHECK_EQ(sched_getaffinity(0, sizeof(cpu_set_t), &saved_cpu_set), 0);
   CHECK_EQ(sched_setaffinity(0, sizeof(cpu_set_t), &new_cpu_set), 0);
-  OF_CUDA_CHECK(cudaMallocHost(ptr, size));
+  Fn();
   CHECK_EQ(sched_setaffinity(0, sizeof(cpu_set_t), &saved_cpu_set), 0);
 #else
   UNIMPLEMENTED();
 #endif
 }
 
+void NumaAwareCudaMallocHost(int32_t dev, void** ptr, size_t size) {
+  RunOnCudaDeviceLocalCpus(dev, [&]() { OF_CUDA_CHECK(cudaMallocHost(ptr, size)); });
+}
+
 cudaDataType_t GetCudaDataType(DataType val) {
 #define MAKE_ENTRY(type_cpp, type_cuda) \
   if (val == GetDataType<type_cpp>::value) { return type_cuda; }
@@ -119,6 +119,10 @@ enum class CudaWorkType {
 
 inline size_t GetCudaWorkTypeSize() { return OF_PP_SEQ_SIZE(CUDA_WORK_TYPE_SEQ); }
 
+// runs Fn with the calling thread bound to the CPUs of the NUMA node the device is attached to,
+// so that the pages Fn touches first are placed on that node
+void RunOnCudaDeviceLocalCpus(int32_t dev, const std::function<void()>& Fn);
+
 void NumaAwareCudaMallocHost(int32_t dev, void** ptr, size_t size);
 
 template<typename T>
@@ -15,7 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/device/memory_copier.h"
 #include "oneflow/core/common/auto_registration_factory.h"
-#include "oneflow/core/common/nd_index_offset_helper.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
@@ -75,30 +75,83 @@ MemoryCopyNdDesc GetDescInBytes(const MemoryCopyNdDesc& desc) {
   return desc_in_bytes;
 }
 
-}  // namespace
+// copies above this size are split across the thread pool
+const int64_t kParallelCopyMinByte = 1024 * 1024;
+const int64_t kParallelGrainByte = 256 * 1024;
+
+template<size_t size>
+void CopyFixedSizeRun(unsigned char* dst, const unsigned char* src) {
+  std::memcpy(dst, src, size);
+}
 
-template<int32_t NDIMS>
-void CopyNDCpuImpl(DeviceCtx* ctx, void* dst, const void* src, const MemoryCopyNdDesc& desc) {
-  NdIndexOffsetHelper<int64_t, NDIMS> src_helper(desc.src_shape.dim_vec().data());
-  NdIndexOffsetHelper<int64_t, NDIMS> dst_helper(desc.dst_shape.dim_vec().data());
-  NdIndexOffsetHelper<int64_t, NDIMS> copy_helper(desc.extent.dim_vec().data());
-  FOR_RANGE(int64_t, i, 0, desc.extent.elem_cnt()) {
-    int64_t copy_idx[NDIMS];
-    int64_t src_idx[NDIMS];
-    int64_t dst_idx[NDIMS];
-    copy_helper.OffsetToNdIndex(i, copy_idx);
-    FOR_RANGE(int64_t, j, 0, NDIMS) {
-      src_idx[j] = desc.src_pos.At(j) + copy_idx[j];
-      dst_idx[j] = desc.dst_pos.At(j) + copy_idx[j];
+// runs of a known small size are copied by a few moves instead of a call into memcpy
+void CopyRun(unsigned char* dst, const unsigned char* src, size_t size) {
+  switch (size) {
+    case 1: *dst = *src; break;
+    case 2: CopyFixedSizeRun<2>(dst, src); break;
+    case 4: CopyFixedSizeRun<4>(dst, src); break;
+    case 8: CopyFixedSizeRun<8>(dst, src); break;
+    case 16: CopyFixedSizeRun<16>(dst, src); break;
+    default: std::memcpy(dst, src, size);
+  }
+}
+
+// Copies the rows [row_begin, row_end) of a desc in bytes. A row is a contiguous run of the last
+// axis, rows are enumerated over the other axes of the extent in row major order.
+void CopyNdRows(unsigned char* dst, const unsigned char* src, const MemoryCopyNdDesc& desc,
+                int64_t row_begin, int64_t row_end) {
+  const int64_t num_axes = MemoryCopyNdDescGetNumAxes(desc);
+  const int64_t num_row_axes = num_axes - 1;
+  const size_t run_size = desc.extent.At(num_axes - 1);
+  int64_t index[SHAPE_MAX_AXIS_SIZE];
+  int64_t dst_strides[SHAPE_MAX_AXIS_SIZE];
+  int64_t src_strides[SHAPE_MAX_AXIS_SIZE];
+  int64_t dst_offset = desc.dst_pos.At(num_axes - 1);
+  int64_t src_offset = desc.src_pos.At(num_axes - 1);
+  int64_t remainder = row_begin;
+  for (int64_t i = num_row_axes - 1; i >= 0; --i) {
+    dst_strides[i] = desc.dst_shape.Count(i + 1);
+    src_strides[i] = desc.src_shape.Count(i + 1);
+    index[i] = remainder % desc.extent.At(i);
+    remainder /= desc.extent.At(i);
+    dst_offset += (desc.dst_pos.At(i) + index[i]) * dst_strides[i];
+    src_offset += (desc.src_pos.At(i) + index[i]) * src_strides[i];
+  }
+  FOR_RANGE(int64_t, row, row_begin, row_end) {
+    CopyRun(dst + dst_offset, src + src_offset, run_size);
+    // step to the next row, carrying into the outer axes
+    for (int64_t i = num_row_axes - 1; i >= 0; --i) {
+      index[i] += 1;
+      dst_offset += dst_strides[i];
+      src_offset += src_strides[i];
+      if (index[i] < desc.extent.At(i)) { break; }
+      index[i] = 0;
+      dst_offset -= desc.extent.At(i) * dst_strides[i];
+      src_offset -= desc.extent.At(i) * src_strides[i];
     }
-    const int64_t src_offset = src_helper.NdIndexToOffset(src_idx);
-    const int64_t dst_offset = dst_helper.NdIndexToOffset(dst_idx);
-    unsigned char* dst_ptr = reinterpret_cast<unsigned char*>(dst) + dst_offset;
-    const unsigned char* src_ptr = reinterpret_cast<const unsigned char*>(src) + src_offset;
-    *dst_ptr = *src_ptr;
   }
 }
 
+void CopyNdCpu(void* dst, const void* src, const MemoryCopyNdDesc& desc) {
+  const int64_t num_axes = MemoryCopyNdDescGetNumAxes(desc);
+  unsigned char* dst_ptr = reinterpret_cast<unsigned char*>(dst);
+  const unsigned char* src_ptr = reinterpret_cast<const unsigned char*>(src);
+  const int64_t run_size = desc.extent.At(num_axes - 1);
+  const int64_t row_num = desc.extent.elem_cnt() / run_size;
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (thread_pool == nullptr || row_num == 1
+      || desc.extent.elem_cnt() < kParallelCopyMinByte) {
+    CopyNdRows(dst_ptr, src_ptr, desc, 0, row_num);
+  } else {
+    const int64_t grain_size = std::max<int64_t>(1, kParallelGrainByte / run_size);
+    thread_pool->ParallelFor(0, row_num, grain_size, [&](int64_t begin, int64_t end) {
+      CopyNdRows(dst_ptr, src_ptr, desc, begin, end);
+    });
+  }
+}
+
+}  // namespace
+
 MemoryCopyNdDesc MemoryCopyNdDesc::CreateDimReducedDesc() const {
   MemoryCopyNdDesc reduced;
   DimVector dst_shape_vec;
@@ -194,22 +247,26 @@ void MemoryCopier::CopyND(DeviceCtx* ctx, void* dst, const void* src,
   UNIMPLEMENTED();
 }
 
+void HostMemoryCopier::Copy(DeviceCtx* ctx, void* dst, const void* src,
+                            const MemoryCopyNdDesc& desc) const {
+  CheckMemoryCopyNdDesc(desc);
+  // merging the axes which are copied as a whole makes the inner run as long as possible
+  const MemoryCopyNdDesc reduced = desc.CreateDimReducedDesc();
+  if (MemoryCopyNdDescGetNumAxes(reduced) == 1) {
+    Copy1D(ctx, (unsigned char*)dst + reduced.dst_pos.At(0),
+           (unsigned char*)src + reduced.src_pos.At(0), reduced.extent.At(0));
+  } else {
+    CopyND(ctx, dst, src, reduced);
+  }
+}
+
 void HostMemoryCopier::Copy1D(DeviceCtx* ctx, void* dst, const void* src, size_t count) const {
   memcpy(dst, src, count);
 }
 
 void HostMemoryCopier::CopyND(DeviceCtx* ctx, void* dst, const void* src,
                               const MemoryCopyNdDesc& desc) const {
-  const int32_t num_axes = desc.src_shape.NumAxes();
-  if (num_axes == 4) {
-    CopyNDCpuImpl<4>(ctx, dst, src, desc);
-  } else if (num_axes == 5) {
-    CopyNDCpuImpl<5>(ctx, dst, src, desc);
-  } else if (num_axes == 6) {
-    CopyNDCpuImpl<6>(ctx, dst, src, desc);
-  } else {
-    UNIMPLEMENTED();
-  }
+  CopyNdCpu(dst, src, desc);
 }
 
 #ifdef WITH_CUDA
@@ -290,11 +347,4 @@ SPECIALIZE_COPY_ELEM(int32_t)
 SPECIALIZE_COPY_ELEM(int64_t)
 SPECIALIZE_COPY_ELEM(int8_t)
 
-#define SPECIALIZE_COPY_ND_CPU_IMPL(NDIMS)                                        \
-  template void CopyNDCpuImpl<NDIMS>(DeviceCtx * ctx, void* dst, const void* src, \
-                                     const MemoryCopyNdDesc& desc);
-SPECIALIZE_COPY_ND_CPU_IMPL(4)
-SPECIALIZE_COPY_ND_CPU_IMPL(5)
-SPECIALIZE_COPY_ND_CPU_IMPL(6)
-
 }  // namespace oneflow
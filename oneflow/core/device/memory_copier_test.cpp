@@ -0,0 +1,90 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/device/memory_copier.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+int64_t Offset(const Shape& shape, const DimVector& index) {
+  int64_t offset = 0;
+  FOR_RANGE(int64_t, i, 0, shape.NumAxes()) { offset = offset * shape.At(i) + index.at(i); }
+  return offset;
+}
+
+void NaiveCopy(int32_t* dst, const int32_t* src, const MemoryCopyNdDesc& desc) {
+  const int64_t num_axes = desc.extent.NumAxes();
+  FOR_RANGE(int64_t, i, 0, desc.extent.elem_cnt()) {
+    DimVector dst_index(num_axes);
+    DimVector src_index(num_axes);
+    int64_t remainder = i;
+    for (int64_t j = num_axes - 1; j >= 0; --j) {
+      const int64_t idx = remainder % desc.extent.At(j);
+      remainder /= desc.extent.At(j);
+      dst_index.at(j) = desc.dst_pos.At(j) + idx;
+      src_index.at(j) = desc.src_pos.At(j) + idx;
+    }
+    dst[Offset(desc.dst_shape, dst_index)] = src[Offset(desc.src_shape, src_index)];
+  }
+}
+
+void TestRandomCopies(int64_t max_dim) {
+  std::mt19937 gen(0);
+  HostMemoryCopier copier;
+  FOR_RANGE(int64_t, num_axes, 1, 8) {
+    FOR_RANGE(int32_t, trial, 0, 20) {
+      DimVector dst_dims(num_axes);
+      DimVector src_dims(num_axes);
+      DimVector dst_pos(num_axes);
+      DimVector src_pos(num_axes);
+      DimVector extent(num_axes);
+      FOR_RANGE(int64_t, i, 0, num_axes) {
+        extent.at(i) = std::uniform_int_distribution<int64_t>(1, max_dim)(gen);
+        const bool whole = std::uniform_int_distribution<int32_t>(0, 1)(gen) == 0;
+        dst_pos.at(i) = whole ? 0 : std::uniform_int_distribution<int64_t>(0, 2)(gen);
+        src_pos.at(i) = whole ? 0 : std::uniform_int_distribution<int64_t>(0, 2)(gen);
+        dst_dims.at(i) = dst_pos.at(i) + extent.at(i) + (whole ? 0 : 1);
+        src_dims.at(i) = src_pos.at(i) + extent.at(i) + (whole ? 0 : 2);
+      }
+      MemoryCopyNdDesc desc;
+      desc.dst_shape = Shape(dst_dims);
+      desc.src_shape = Shape(src_dims);
+      desc.dst_pos = NdIndex(dst_pos);
+      desc.src_pos = NdIndex(src_pos);
+      desc.extent = Shape(extent);
+      std::vector<int32_t> src(desc.src_shape.elem_cnt());
+      FOR_RANGE(size_t, i, 0, src.size()) { src.at(i) = i; }
+      std::vector<int32_t> expected(desc.dst_shape.elem_cnt(), -1);
+      std::vector<int32_t> dst(desc.dst_shape.elem_cnt(), -1);
+      NaiveCopy(expected.data(), src.data(), desc);
+      copier.CopyElem<int32_t>(nullptr, dst.data(), src.data(), desc);
+      ASSERT_EQ(dst, expected);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(HostMemoryCopier, copy_nd) { TestRandomCopies(5); }
+
+TEST(HostMemoryCopier, parallel_copy_nd) {
+  Global<ThreadPool>::New(4);
+  TestRandomCopies(12);
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace oneflow
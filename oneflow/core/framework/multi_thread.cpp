@@ -20,8 +20,9 @@ namespace oneflow {
 
 namespace user_op {
 
-void MultiThreadLoopInOpKernel(size_t num, std::function<void(size_t i)> Callback) {
-  MultiThreadLoop(num, Callback);
+void MultiThreadLoopInOpKernel(size_t num, std::function<void(size_t i)> Callback,
+                               size_t grain_size) {
+  MultiThreadLoop(num, Callback, grain_size);
 }
 
 }  // namespace user_op
@@ -22,7 +22,8 @@ namespace oneflow {
 
 namespace user_op {
 
-void MultiThreadLoopInOpKernel(size_t num, std::function<void(size_t i)> Callback);
+void MultiThreadLoopInOpKernel(size_t num, std::function<void(size_t i)> Callback,
+                               size_t grain_size = 0);
 
 }  // namespace user_op
 
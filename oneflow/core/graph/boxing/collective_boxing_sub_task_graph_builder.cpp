@@ -19,6 +19,8 @@ limitations under the License.
 #include "oneflow/core/graph/boxing/sub_task_graph_builder_util.h"
 #include "oneflow/core/graph/collective_boxing_task_node.h"
 #include "oneflow/core/graph/slice_boxing_task_node.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
 
 namespace oneflow {
 
@@ -26,13 +28,32 @@ using namespace boxing::collective;
 
 namespace {
 
-void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
-                            const ParallelDesc& parallel_desc, int64_t parallel_id,
-                            const std::string& name, const LogicalBlobId& lbi,
-                            const BlobDesc& logical_blob_desc, OpType op_type, int64_t root) {
+bool IsCollectiveBoxingDeviceType(DeviceType device_type) {
+  if (device_type == DeviceType::kGPU) {
+    return true;
+  } else if (device_type == DeviceType::kCPU) {
+    // the cpu backend relies on CommNet custom messages, which are not supported by ibverbs
+    return Global<ResourceDesc, ForSession>::Get()->collective_boxing_conf().cpu_enable()
+           && !Global<ResourceDesc, ForSession>::Get()->use_rdma();
+  } else {
+    return false;
+  }
+}
+
+// the op runs on the backend of the parallel desc it is initialized with
+std::string NewCollectiveBoxingOpName(const ParallelDesc& parallel_desc,
+                                      const std::string& op_type_name) {
+  const std::string backend_name = parallel_desc.device_type() == DeviceType::kCPU ? "Cpu" : "Nccl";
+  return "System-Boxing-" + backend_name + "CollectiveBoxing" + op_type_name + "-" + NewUniqueId();
+}
+
+void InitCollectiveNode(CollectiveBoxingGenericTaskNode* node, const ParallelDesc& parallel_desc,
+                        int64_t parallel_id, const std::string& name, const LogicalBlobId& lbi,
+                        const BlobDesc& logical_blob_desc, OpType op_type, int64_t root) {
+  const DeviceType device_type = parallel_desc.device_type();
   OperatorConf op_conf;
   op_conf.set_name(name);
-  op_conf.set_device_tag(CHECK_JUST(DeviceTag4DeviceType(DeviceType::kGPU)));
+  op_conf.set_device_tag(CHECK_JUST(DeviceTag4DeviceType(device_type)));
   CollectiveBoxingGenericOpConf* conf = op_conf.mutable_collective_boxing_generic_conf();
   *conf->mutable_lbi() = lbi;
   RankDesc* rank_desc = conf->mutable_rank_desc();
@@ -53,12 +74,20 @@ void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
   } else {
     CHECK_EQ(root, -1);
   }
-  op_desc->set_backend(Backend::kBackendNCCL);
   rank_desc->set_rank(parallel_id);
 
   const int64_t machine_id = parallel_desc.MachineIdForParallelId(parallel_id);
   const int64_t device_id = parallel_desc.DeviceIdForParallelId(parallel_id);
-  const int64_t thrd_id = Global<IDMgr>::Get()->GetGpuNcclThrdId(device_id);
+  int64_t thrd_id = -1;
+  if (device_type == DeviceType::kGPU) {
+    op_desc->set_backend(Backend::kBackendNCCL);
+    thrd_id = Global<IDMgr>::Get()->GetGpuNcclThrdId(device_id);
+  } else if (device_type == DeviceType::kCPU) {
+    op_desc->set_backend(Backend::kBackendCPU);
+    thrd_id = Global<IDMgr>::Get()->GetCpuDeviceThrdId(device_id);
+  } else {
+    UNIMPLEMENTED();
+  }
   node->Init(machine_id, thrd_id, NewAreaId(), op_conf);
 }
 
@@ -81,11 +110,11 @@ bool IsSourceTimeShape(const Shape& shape) {
   return shape.elem_cnt() == GlobalJobDesc().TotalBatchNum() * GlobalJobDesc().NumOfPiecesInBatch();
 }
 
-class NcclCollectiveBoxingAllReduceSubTskGphBuilder final : public SubTskGphBuilder {
+class CollectiveBoxingAllReduceSubTskGphBuilder final : public SubTskGphBuilder {
  public:
-  OF_DISALLOW_COPY_AND_MOVE(NcclCollectiveBoxingAllReduceSubTskGphBuilder);
-  NcclCollectiveBoxingAllReduceSubTskGphBuilder() = default;
-  ~NcclCollectiveBoxingAllReduceSubTskGphBuilder() override = default;
+  OF_DISALLOW_COPY_AND_MOVE(CollectiveBoxingAllReduceSubTskGphBuilder);
+  CollectiveBoxingAllReduceSubTskGphBuilder() = default;
+  ~CollectiveBoxingAllReduceSubTskGphBuilder() override = default;
 
   Maybe<SubTskGphBuilderStatus> Build(SubTskGphBuilderCtx* ctx,
                                       const std::vector<CompTaskNode*>& sorted_src_comp_tasks,
@@ -97,34 +126,34 @@ class NcclCollectiveBoxingAllReduceSubTskGphBuilder final : public SubTskGphBuil
                                       const SbpParallel& dst_sbp_parallel) const override {
     if (dst_parallel_desc.Equals(src_parallel_desc)
         && !SubTskGphBuilderUtil::BlobHasDynamicShape(logical_blob_desc)
-        && dst_parallel_desc.device_type() == DeviceType::kGPU
+        && IsCollectiveBoxingDeviceType(dst_parallel_desc.device_type())
         && dst_parallel_desc.parallel_num() > 1
         && SubTskGphBuilderUtil::IsBoxingP2B(src_sbp_parallel, dst_sbp_parallel)) {
-      const std::string op_name = "System-Boxing-NcclCollectiveBoxingAllReduce-" + NewUniqueId();
+      const std::string op_name = NewCollectiveBoxingOpName(src_parallel_desc, "AllReduce");
       FOR_RANGE(int64_t, i, 0, src_parallel_desc.parallel_num()) {
         CompTaskNode* src_node = sorted_src_comp_tasks.at(i);
         CompTaskNode* dst_node = sorted_dst_comp_tasks.at(i);
         auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
-        NcclInitCollectiveNode(collective_node, src_parallel_desc, i, op_name, lbi,
-                               logical_blob_desc, OpType::kOpTypeAllReduce, -1);
+        InitCollectiveNode(collective_node, src_parallel_desc, i, op_name, lbi, logical_blob_desc,
+                           OpType::kOpTypeAllReduce, -1);
         Connect<TaskNode>(src_node, ctx->task_graph()->NewEdge(), collective_node);
         Connect<TaskNode>(collective_node, ctx->task_graph()->NewEdge(), dst_node);
       }
       return TRY(BuildSubTskGphBuilderStatus(
           sorted_src_comp_tasks.front(), sorted_dst_comp_tasks.front(), src_parallel_desc,
           dst_parallel_desc, src_sbp_parallel, dst_sbp_parallel, lbi, logical_blob_desc,
-          "NcclCollectiveBoxingAllReduceSubTskGphBuilder", ""));
+          "CollectiveBoxingAllReduceSubTskGphBuilder", ""));
     } else {
       return Error::BoxingNotSupportedError();
     }
   }
 };
 
-class NcclCollectiveBoxingReduceScatterSubTskGphBuilder final : public SubTskGphBuilder {
+class CollectiveBoxingReduceScatterSubTskGphBuilder final : public SubTskGphBuilder {
  public:
-  OF_DISALLOW_COPY_AND_MOVE(NcclCollectiveBoxingReduceScatterSubTskGphBuilder);
-  NcclCollectiveBoxingReduceScatterSubTskGphBuilder() = default;
-  ~NcclCollectiveBoxingReduceScatterSubTskGphBuilder() override = default;
+  OF_DISALLOW_COPY_AND_MOVE(CollectiveBoxingReduceScatterSubTskGphBuilder);
+  CollectiveBoxingReduceScatterSubTskGphBuilder() = default;
+  ~CollectiveBoxingReduceScatterSubTskGphBuilder() override = default;
 
   Maybe<SubTskGphBuilderStatus> Build(SubTskGphBuilderCtx* ctx,
                                       const std::vector<CompTaskNode*>& sorted_src_comp_tasks,
@@ -136,37 +165,36 @@ class NcclCollectiveBoxingReduceScatterSubTskGphBuilder final : public SubTskGph
                                       const SbpParallel& dst_sbp_parallel) const override {
     if (dst_parallel_desc.Equals(src_parallel_desc)
         && !SubTskGphBuilderUtil::BlobHasDynamicShape(logical_blob_desc)
-        && dst_parallel_desc.device_type() == DeviceType::kGPU
+        && IsCollectiveBoxingDeviceType(dst_parallel_desc.device_type())
         && dst_parallel_desc.parallel_num() > 1
         && logical_blob_desc.shape().At(0) % dst_parallel_desc.parallel_num() == 0
         && SubTskGphBuilderUtil::IsBoxingP2S(src_sbp_parallel, dst_sbp_parallel)
         && dst_sbp_parallel.split_parallel().axis() == 0) {
-      const std::string op_name =
-          "System-Boxing-NcclCollectiveBoxingReduceScatter-" + NewUniqueId();
+      const std::string op_name = NewCollectiveBoxingOpName(src_parallel_desc, "ReduceScatter");
       FOR_RANGE(int64_t, i, 0, src_parallel_desc.parallel_num()) {
         CompTaskNode* src_node = sorted_src_comp_tasks.at(i);
         CompTaskNode* dst_node = sorted_dst_comp_tasks.at(i);
         auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
-        NcclInitCollectiveNode(collective_node, src_parallel_desc, i, op_name, lbi,
-                               logical_blob_desc, OpType::kOpTypeReduceScatter, -1);
+        InitCollectiveNode(collective_node, src_parallel_desc, i, op_name, lbi, logical_blob_desc,
+                           OpType::kOpTypeReduceScatter, -1);
         Connect<TaskNode>(src_node, ctx->task_graph()->NewEdge(), collective_node);
         Connect<TaskNode>(collective_node, ctx->task_graph()->NewEdge(), dst_node);
       }
       return TRY(BuildSubTskGphBuilderStatus(
           sorted_src_comp_tasks.front(), sorted_dst_comp_tasks.front(), src_parallel_desc,
           dst_parallel_desc, src_sbp_parallel, dst_sbp_parallel, lbi, logical_blob_desc,
-          "NcclCollectiveBoxingReduceScatterSubTskGphBuilder", ""));
+          "CollectiveBoxingReduceScatterSubTskGphBuilder", ""));
     } else {
       return Error::BoxingNotSupportedError();
     }
   }
 };
 
-class NcclCollectiveBoxingAllGatherSubTskGphBuilder final : public SubTskGphBuilder {
+class CollectiveBoxingAllGatherSubTskGphBuilder final : public SubTskGphBuilder {
  public:
-  OF_DISALLOW_COPY_AND_MOVE(NcclCollectiveBoxingAllGatherSubTskGphBuilder);
-  NcclCollectiveBoxingAllGatherSubTskGphBuilder() = default;
-  ~NcclCollectiveBoxingAllGatherSubTskGphBuilder() override = default;
+  OF_DISALLOW_COPY_AND_MOVE(CollectiveBoxingAllGatherSubTskGphBuilder);
+  CollectiveBoxingAllGatherSubTskGphBuilder() = default;
+  ~CollectiveBoxingAllGatherSubTskGphBuilder() override = default;
 
   Maybe<SubTskGphBuilderStatus> Build(SubTskGphBuilderCtx* ctx,
                                       const std::vector<CompTaskNode*>& sorted_src_comp_tasks,
@@ -179,38 +207,38 @@ class NcclCollectiveBoxingAllGatherSubTskGphBuilder final : public SubTskGphBuil
     if (dst_parallel_desc.EqualsIgnoringDeviceType(src_parallel_desc)
         && !SubTskGphBuilderUtil::BlobHasDynamicShape(logical_blob_desc)
         && SubTskGphBuilderUtil::IsDeviceTypeCPUOrGPU(src_parallel_desc)
-        && dst_parallel_desc.device_type() == DeviceType::kGPU
+        && IsCollectiveBoxingDeviceType(dst_parallel_desc.device_type())
         && dst_parallel_desc.parallel_num() > 1
         && logical_blob_desc.shape().At(0) % dst_parallel_desc.parallel_num() == 0
         && SubTskGphBuilderUtil::IsBoxingS2B(src_sbp_parallel, dst_sbp_parallel)
         && src_sbp_parallel.split_parallel().axis() == 0) {
-      const std::string op_name = "System-Boxing-NcclCollectiveBoxingAllGather-" + NewUniqueId();
+      const std::string op_name = NewCollectiveBoxingOpName(dst_parallel_desc, "AllGather");
       FOR_RANGE(int64_t, i, 0, src_parallel_desc.parallel_num()) {
         CompTaskNode* src_comp_task = sorted_src_comp_tasks.at(i);
         CompTaskNode* dst_node = sorted_dst_comp_tasks.at(i);
         TaskNode* src_node = ctx->GetProxyNode(src_comp_task, src_comp_task->MemZoneId121(),
                                                dst_node->machine_id(), dst_node->MemZoneId121());
         auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
-        NcclInitCollectiveNode(collective_node, dst_parallel_desc, i, op_name, lbi,
-                               logical_blob_desc, OpType::kOpTypeAllGather, -1);
+        InitCollectiveNode(collective_node, dst_parallel_desc, i, op_name, lbi, logical_blob_desc,
+                           OpType::kOpTypeAllGather, -1);
         Connect<TaskNode>(src_node, ctx->task_graph()->NewEdge(), collective_node);
         Connect<TaskNode>(collective_node, ctx->task_graph()->NewEdge(), dst_node);
       }
       return TRY(BuildSubTskGphBuilderStatus(
           sorted_src_comp_tasks.front(), sorted_dst_comp_tasks.front(), src_parallel_desc,
           dst_parallel_desc, src_sbp_parallel, dst_sbp_parallel, lbi, logical_blob_desc,
-          "NcclCollectiveBoxingAllGatherSubTskGphBuilder", ""));
+          "CollectiveBoxingAllGatherSubTskGphBuilder", ""));
     } else {
       return Error::BoxingNotSupportedError();
     }
   }
 };
 
-class NcclCollectiveBoxingReduceSubTskGphBuilder final : public SubTskGphBuilder {
+class CollectiveBoxingReduceSubTskGphBuilder final : public SubTskGphBuilder {
  public:
-  OF_DISALLOW_COPY_AND_MOVE(NcclCollectiveBoxingReduceSubTskGphBuilder);
-  NcclCollectiveBoxingReduceSubTskGphBuilder() = default;
-  ~NcclCollectiveBoxingReduceSubTskGphBuilder() override = default;
+  OF_DISALLOW_COPY_AND_MOVE(CollectiveBoxingReduceSubTskGphBuilder);
+  CollectiveBoxingReduceSubTskGphBuilder() = default;
+  ~CollectiveBoxingReduceSubTskGphBuilder() override = default;
 
   Maybe<SubTskGphBuilderStatus> Build(SubTskGphBuilderCtx* ctx,
                                       const std::vector<CompTaskNode*>& sorted_src_comp_tasks,
@@ -221,19 +249,19 @@ class NcclCollectiveBoxingReduceSubTskGphBuilder final : public SubTskGphBuilder
                                       const SbpParallel& src_sbp_parallel,
                                       const SbpParallel& dst_sbp_parallel) const override {
     if (src_parallel_desc.parallel_num() > 1 && dst_parallel_desc.parallel_num() == 1
-        && src_parallel_desc.device_type() == DeviceType::kGPU
-        && dst_parallel_desc.device_type() == DeviceType::kGPU
+        && src_parallel_desc.device_type() == dst_parallel_desc.device_type()
+        && IsCollectiveBoxingDeviceType(src_parallel_desc.device_type())
         && !SubTskGphBuilderUtil::BlobHasDynamicShape(logical_blob_desc)
         && src_sbp_parallel.has_partial_sum_parallel()) {
       const int64_t root_parallel_id = FindRootParallelId(src_parallel_desc, dst_parallel_desc);
       if (root_parallel_id == -1) { return Error::BoxingNotSupportedError(); }
 
-      const std::string op_name = "System-Boxing-NcclCollectiveBoxingReduce-" + NewUniqueId();
+      const std::string op_name = NewCollectiveBoxingOpName(src_parallel_desc, "Reduce");
       FOR_RANGE(int64_t, i, 0, src_parallel_desc.parallel_num()) {
         CompTaskNode* src_node = sorted_src_comp_tasks.at(i);
         auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
-        NcclInitCollectiveNode(collective_node, src_parallel_desc, i, op_name, lbi,
-                               logical_blob_desc, OpType::kOpTypeReduce, root_parallel_id);
+        InitCollectiveNode(collective_node, src_parallel_desc, i, op_name, lbi, logical_blob_desc,
+                           OpType::kOpTypeReduce, root_parallel_id);
         Connect<TaskNode>(src_node, ctx->task_graph()->NewEdge(), collective_node);
         CompTaskNode* dst_node = sorted_dst_comp_tasks.front();
         if (i == root_parallel_id) {
@@ -246,18 +274,18 @@ class NcclCollectiveBoxingReduceSubTskGphBuilder final : public SubTskGphBuilder
       return TRY(BuildSubTskGphBuilderStatus(
           sorted_src_comp_tasks.front(), sorted_dst_comp_tasks.front(), src_parallel_desc,
           dst_parallel_desc, src_sbp_parallel, dst_sbp_parallel, lbi, logical_blob_desc,
-          "NcclCollectiveBoxingReduceSubTskGphBuilder", ""));
+          "CollectiveBoxingReduceSubTskGphBuilder", ""));
     } else {
       return Error::BoxingNotSupportedError();
     }
   }
 };
 
-class CollectiveBoxingScatterThenNcclAllGatherSubTskGphBuilder final : public SubTskGphBuilder {
+class CollectiveBoxingScatterThenAllGatherSubTskGphBuilder final : public SubTskGphBuilder {
  public:
-  OF_DISALLOW_COPY_AND_MOVE(CollectiveBoxingScatterThenNcclAllGatherSubTskGphBuilder);
-  CollectiveBoxingScatterThenNcclAllGatherSubTskGphBuilder() = default;
-  ~CollectiveBoxingScatterThenNcclAllGatherSubTskGphBuilder() override = default;
+  OF_DISALLOW_COPY_AND_MOVE(CollectiveBoxingScatterThenAllGatherSubTskGphBuilder);
+  CollectiveBoxingScatterThenAllGatherSubTskGphBuilder() = default;
+  ~CollectiveBoxingScatterThenAllGatherSubTskGphBuilder() override = default;
 
   Maybe<SubTskGphBuilderStatus> Build(SubTskGphBuilderCtx* ctx,
                                       const std::vector<CompTaskNode*>& sorted_src_comp_tasks,
@@ -281,7 +309,7 @@ class CollectiveBoxingScatterThenNcclAllGatherSubTskGphBuilder final : public Su
       split_sbp_parallel.mutable_split_parallel()->set_axis(0);
       std::vector<TensorSliceView> out_slices = SubTskGphBuilderUtil::GetTensorSliceView(
           dst_parallel_desc.parallel_num(), split_sbp_parallel, logical_blob_desc);
-      const std::string op_name = "System-Boxing-NcclCollectiveBoxingAllGather-" + NewUniqueId();
+      const std::string op_name = NewCollectiveBoxingOpName(dst_parallel_desc, "AllGather");
       FOR_RANGE(int64_t, out_id, 0, dst_parallel_desc.parallel_num()) {
         const TensorSliceView& out_slice = out_slices.at(out_id);
         CompTaskNode* dst_node = sorted_dst_comp_tasks.at(out_id);
@@ -299,26 +327,26 @@ class CollectiveBoxingScatterThenNcclAllGatherSubTskGphBuilder final : public Su
                               dst_node->MemZoneId121());
         // allgather
         auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
-        NcclInitCollectiveNode(collective_node, dst_parallel_desc, out_id, op_name, lbi,
-                               logical_blob_desc, OpType::kOpTypeAllGather, -1);
+        InitCollectiveNode(collective_node, dst_parallel_desc, out_id, op_name, lbi,
+                           logical_blob_desc, OpType::kOpTypeAllGather, -1);
         Connect<TaskNode>(slice_node_proxy, ctx->task_graph()->NewEdge(), collective_node);
         Connect<TaskNode>(collective_node, ctx->task_graph()->NewEdge(), dst_node);
       }
       return TRY(BuildSubTskGphBuilderStatus(
           sorted_src_comp_tasks.front(), sorted_dst_comp_tasks.front(), src_parallel_desc,
           dst_parallel_desc, src_sbp_parallel, dst_sbp_parallel, lbi, logical_blob_desc,
-          "CollectiveBoxingScatterThenNcclAllGatherSubTskGphBuilder", ""));
+          "CollectiveBoxingScatterThenAllGatherSubTskGphBuilder", ""));
     } else {
       return Error::BoxingNotSupportedError();
     }
   };
 };
 
-class NcclCollectiveBoxingBroadcastSubTskGphBuilder final : public SubTskGphBuilder {
+class CollectiveBoxingBroadcastSubTskGphBuilder final : public SubTskGphBuilder {
  public:
-  OF_DISALLOW_COPY_AND_MOVE(NcclCollectiveBoxingBroadcastSubTskGphBuilder);
-  NcclCollectiveBoxingBroadcastSubTskGphBuilder() = default;
-  ~NcclCollectiveBoxingBroadcastSubTskGphBuilder() override = default;
+  OF_DISALLOW_COPY_AND_MOVE(CollectiveBoxingBroadcastSubTskGphBuilder);
+  CollectiveBoxingBroadcastSubTskGphBuilder() = default;
+  ~CollectiveBoxingBroadcastSubTskGphBuilder() override = default;
 
   Maybe<SubTskGphBuilderStatus> Build(SubTskGphBuilderCtx* ctx,
                                       const std::vector<CompTaskNode*>& sorted_src_comp_tasks,
@@ -329,48 +357,47 @@ class NcclCollectiveBoxingBroadcastSubTskGphBuilder final : public SubTskGphBuil
                                       const SbpParallel& src_sbp_parallel,
                                       const SbpParallel& dst_sbp_parallel) const override {
     if (src_parallel_desc.parallel_num() == 1 && dst_parallel_desc.parallel_num() > 1
-        && (src_parallel_desc.device_type() == DeviceType::kGPU
-            || (src_parallel_desc.device_type() == DeviceType::kCPU
-                && logical_blob_desc.shape().elem_cnt() >= 1024))
-        && dst_parallel_desc.device_type() == DeviceType::kGPU
+        && IsCollectiveBoxingDeviceType(dst_parallel_desc.device_type())
         && !SubTskGphBuilderUtil::BlobHasDynamicShape(logical_blob_desc)
         && dst_sbp_parallel.has_broadcast_parallel()) {
-      TaskNode* gpu_src_node = nullptr;
+      TaskNode* src_node = nullptr;
       int64_t root_parallel_id = -1;
-      if (src_parallel_desc.device_type() == DeviceType::kCPU) {
+      if (src_parallel_desc.device_type() == dst_parallel_desc.device_type()) {
+        root_parallel_id = FindRootParallelId(dst_parallel_desc, src_parallel_desc);
+        src_node = sorted_src_comp_tasks.front();
+      } else if (src_parallel_desc.device_type() == DeviceType::kCPU
+                 && dst_parallel_desc.device_type() == DeviceType::kGPU
+                 && logical_blob_desc.shape().elem_cnt() >= 1024) {
         auto* cpu_src_node = sorted_src_comp_tasks.front();
         root_parallel_id =
             SubTskGphBuilderUtil::FindNearestNodeIndex(sorted_dst_comp_tasks, cpu_src_node);
         auto* nearest_dst_node = sorted_dst_comp_tasks.at(root_parallel_id);
-        gpu_src_node =
+        src_node =
             ctx->GetProxyNode(cpu_src_node, cpu_src_node->MemZoneId121(),
                               nearest_dst_node->machine_id(), nearest_dst_node->MemZoneId121());
-      } else if (src_parallel_desc.device_type() == DeviceType::kGPU) {
-        root_parallel_id = FindRootParallelId(dst_parallel_desc, src_parallel_desc);
-        gpu_src_node = sorted_src_comp_tasks.front();
       } else {
         return Error::BoxingNotSupportedError();
       }
       if (root_parallel_id == -1) { return Error::BoxingNotSupportedError(); }
 
-      const std::string op_name = "System-Boxing-NcclCollectiveBoxingBroadcast-" + NewUniqueId();
+      const std::string op_name = NewCollectiveBoxingOpName(dst_parallel_desc, "Broadcast");
       FOR_RANGE(int64_t, i, 0, dst_parallel_desc.parallel_num()) {
         CompTaskNode* dst_node = sorted_dst_comp_tasks.at(i);
         auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
-        NcclInitCollectiveNode(collective_node, dst_parallel_desc, i, op_name, lbi,
-                               logical_blob_desc, OpType::kOpTypeBroadcast, root_parallel_id);
+        InitCollectiveNode(collective_node, dst_parallel_desc, i, op_name, lbi, logical_blob_desc,
+                           OpType::kOpTypeBroadcast, root_parallel_id);
         if (i == root_parallel_id) {
-          Connect<TaskNode>(gpu_src_node, ctx->task_graph()->NewEdge(), collective_node);
+          Connect<TaskNode>(src_node, ctx->task_graph()->NewEdge(), collective_node);
         } else {
-          gpu_src_node->BuildCtrlRegstDesc(collective_node);
-          Connect<TaskNode>(gpu_src_node, ctx->task_graph()->NewEdge(), collective_node);
+          src_node->BuildCtrlRegstDesc(collective_node);
+          Connect<TaskNode>(src_node, ctx->task_graph()->NewEdge(), collective_node);
         }
         Connect<TaskNode>(collective_node, ctx->task_graph()->NewEdge(), dst_node);
       }
       return TRY(BuildSubTskGphBuilderStatus(
           sorted_src_comp_tasks.front(), sorted_dst_comp_tasks.front(), src_parallel_desc,
           dst_parallel_desc, src_sbp_parallel, dst_sbp_parallel, lbi, logical_blob_desc,
-          "NcclCollectiveBoxingBroadcastSubTskGphBuilder", ""));
+          "CollectiveBoxingBroadcastSubTskGphBuilder", ""));
     } else {
       return Error::BoxingNotSupportedError();
     }
@@ -380,12 +407,12 @@ class NcclCollectiveBoxingBroadcastSubTskGphBuilder final : public SubTskGphBuil
 
 CollectiveBoxingSubTskGphBuilder::CollectiveBoxingSubTskGphBuilder() {
   std::vector<std::shared_ptr<SubTskGphBuilder>> builders;
-  builders.emplace_back(new NcclCollectiveBoxingAllReduceSubTskGphBuilder());
-  builders.emplace_back(new NcclCollectiveBoxingReduceScatterSubTskGphBuilder());
-  builders.emplace_back(new NcclCollectiveBoxingAllGatherSubTskGphBuilder());
-  builders.emplace_back(new NcclCollectiveBoxingReduceSubTskGphBuilder());
-  builders.emplace_back(new CollectiveBoxingScatterThenNcclAllGatherSubTskGphBuilder());
-  builders.emplace_back(new NcclCollectiveBoxingBroadcastSubTskGphBuilder());
+  builders.emplace_back(new CollectiveBoxingAllReduceSubTskGphBuilder());
+  builders.emplace_back(new CollectiveBoxingReduceScatterSubTskGphBuilder());
+  builders.emplace_back(new CollectiveBoxingAllGatherSubTskGphBuilder());
+  builders.emplace_back(new CollectiveBoxingReduceSubTskGphBuilder());
+  builders.emplace_back(new CollectiveBoxingScatterThenAllGatherSubTskGphBuilder());
+  builders.emplace_back(new CollectiveBoxingBroadcastSubTskGphBuilder());
   chain_builder_.reset(new ChainSubTskGphBuilder(builders));
 }
 
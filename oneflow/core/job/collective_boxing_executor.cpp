@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/job/collective_boxing_executor.h"
+#include "oneflow/core/job/cpu_collective_boxing_executor_backend.h"
 #include "oneflow/core/device/nccl_util.h"
 #include "oneflow/core/graph/boxing/collective_boxing_util.h"
 #include "oneflow/core/job/resource_desc.h"
@@ -72,8 +73,6 @@ int64_t GetAlignedRequestSize(const RequestDesc* request) {
 
 }  // namespace
 
-#ifdef WITH_CUDA
-
 void CollectiveBoxingExecutorBackend::GroupRequests(
     const std::vector<const RequestDesc*>& requests,
     std::vector<std::vector<const RequestDesc*>>* groups) {
@@ -82,6 +81,8 @@ void CollectiveBoxingExecutorBackend::GroupRequests(
   }
 }
 
+#ifdef WITH_CUDA
+
 class NcclCollectiveBoxingExecutorBackend : public CollectiveBoxingExecutorBackend {
  public:
   OF_DISALLOW_COPY_AND_MOVE(NcclCollectiveBoxingExecutorBackend)
@@ -482,6 +483,13 @@ CollectiveBoxingExecutor::CollectiveBoxingExecutor(const Plan& plan)
           .first;
   it->second->Init(collective_boxing_plan_);
 #endif
+  if (Global<ResourceDesc, ForSession>::Get()->collective_boxing_conf().cpu_enable()) {
+    auto cpu_it =
+        backends_
+            .emplace(Backend::kBackendCPU, std::make_unique<CpuCollectiveBoxingExecutorBackend>())
+            .first;
+    cpu_it->second->Init(collective_boxing_plan_);
+  }
   Init();
   DumpSummary();
 }
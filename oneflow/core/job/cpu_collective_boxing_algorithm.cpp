@@ -0,0 +1,231 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/cpu_collective_boxing_algorithm.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+namespace {
+
+const int64_t kChunkHeadSize = sizeof(int64_t);
+
+}  // namespace
+
+CpuCollectiveBoxingAlgorithm::CpuCollectiveBoxingAlgorithm(Transport* transport,
+                                                           int64_t chunk_size,
+                                                           int64_t tree_threshold)
+    : transport_(transport),
+      chunk_size_(chunk_size),
+      tree_threshold_(tree_threshold),
+      machine_ids_(nullptr),
+      this_machine_idx_(-1),
+      group_tag_(-1),
+      sum_fn_(nullptr) {
+  CHECK_GT(chunk_size_, 0);
+  CHECK_GE(tree_threshold_, 0);
+}
+
+void CpuCollectiveBoxingAlgorithm::Reset(const std::vector<int64_t>* machine_ids,
+                                         int64_t this_machine_idx, int64_t group_tag,
+                                         SumFn sum_fn) {
+  CHECK_GE(this_machine_idx, 0);
+  CHECK_LT(this_machine_idx, static_cast<int64_t>(machine_ids->size()));
+  machine_ids_ = machine_ids;
+  this_machine_idx_ = this_machine_idx;
+  group_tag_ = group_tag;
+  sum_fn_ = sum_fn;
+}
+
+void CpuCollectiveBoxingAlgorithm::AllReduce(char* buf, int64_t size, int64_t size_of_data_type) {
+  if (num_machines() == 1) { return; }
+  if (size <= tree_threshold_) {
+    TreeReduce(buf, size, 0);
+    TreeBroadcast(buf, size, 0);
+  } else {
+    CHECK_EQ(size % size_of_data_type, 0);
+    const int64_t elem_cnt = size / size_of_data_type;
+    std::vector<int64_t> segment_offsets(num_machines() + 1);
+    FOR_RANGE(int64_t, i, 0, num_machines() + 1) {
+      segment_offsets.at(i) = elem_cnt * i / num_machines() * size_of_data_type;
+    }
+    RingReduceScatter(buf, segment_offsets);
+    RingAllGather(buf, segment_offsets);
+  }
+}
+
+// After step s machine m holds the partial sum of segment (m - s - 1) over machines
+// (m - s - 1)..m, which it forwards chunk by chunk as soon as each chunk is summed, so machine m
+// ends up with the complete segment m. Partial sums are accumulated in the received messages and
+// passed on in them, only the last step writes into buf.
+void CpuCollectiveBoxingAlgorithm::RingReduceScatter(char* buf,
+                                                     const std::vector<int64_t>& segment_offsets) {
+  if (num_machines() == 1) { return; }
+  const int64_t next_idx = SegmentIdx(this_machine_idx_ + 1);
+  const int64_t prev_idx = SegmentIdx(this_machine_idx_ - 1);
+  std::vector<char> msg;
+  {
+    const int64_t segment = SegmentIdx(this_machine_idx_ - 1);
+    const char* segment_ptr = buf + segment_offsets.at(segment);
+    ForEachChunk(segment_offsets.at(segment + 1) - segment_offsets.at(segment),
+                 [&](int64_t offset, int64_t size) {
+                   SendChunk(next_idx, segment_ptr + offset, size);
+                 });
+  }
+  FOR_RANGE(int64_t, step, 0, num_machines() - 1) {
+    const int64_t segment = SegmentIdx(this_machine_idx_ - step - 2);
+    char* segment_ptr = buf + segment_offsets.at(segment);
+    ForEachChunk(segment_offsets.at(segment + 1) - segment_offsets.at(segment),
+                 [&](int64_t offset, int64_t size) {
+                   char* chunk = RecvChunk(prev_idx, size, &msg);
+                   if (step < num_machines() - 2) {
+                     sum_fn_(chunk, segment_ptr + offset, size);
+                     ForwardChunk(next_idx, &msg);
+                   } else {
+                     sum_fn_(segment_ptr + offset, chunk, size);
+                   }
+                 });
+  }
+}
+
+void CpuCollectiveBoxingAlgorithm::RingAllGather(char* buf,
+                                                 const std::vector<int64_t>& segment_offsets) {
+  if (num_machines() == 1) { return; }
+  const int64_t next_idx = SegmentIdx(this_machine_idx_ + 1);
+  const int64_t prev_idx = SegmentIdx(this_machine_idx_ - 1);
+  std::vector<char> msg;
+  {
+    const char* segment_ptr = buf + segment_offsets.at(this_machine_idx_);
+    ForEachChunk(segment_offsets.at(this_machine_idx_ + 1) - segment_offsets.at(this_machine_idx_),
+                 [&](int64_t offset, int64_t size) {
+                   SendChunk(next_idx, segment_ptr + offset, size);
+                 });
+  }
+  FOR_RANGE(int64_t, step, 0, num_machines() - 1) {
+    const int64_t segment = SegmentIdx(this_machine_idx_ - step - 1);
+    char* segment_ptr = buf + segment_offsets.at(segment);
+    ForEachChunk(segment_offsets.at(segment + 1) - segment_offsets.at(segment),
+                 [&](int64_t offset, int64_t size) {
+                   std::memcpy(segment_ptr + offset, RecvChunk(prev_idx, size, &msg), size);
+                   if (step < num_machines() - 2) { ForwardChunk(next_idx, &msg); }
+                 });
+  }
+}
+
+// buf only holds the result on the root, inner nodes accumulate into the message from their
+// first child and forward it
+void CpuCollectiveBoxingAlgorithm::TreeReduce(char* buf, int64_t size, int64_t root_machine_idx) {
+  if (num_machines() == 1) { return; }
+  int64_t parent = -1;
+  std::vector<int64_t> children;
+  GetTreeNeighbors(root_machine_idx, &parent, &children);
+  std::vector<char> msg;
+  std::vector<char> child_msg;
+  ForEachChunk(size, [&](int64_t offset, int64_t chunk_size) {
+    if (children.empty()) {
+      SendChunk(parent, buf + offset, chunk_size);
+      return;
+    }
+    char* sum = buf + offset;
+    if (parent != -1) {
+      sum = RecvChunk(children.front(), chunk_size, &msg);
+      sum_fn_(sum, buf + offset, chunk_size);
+    }
+    FOR_RANGE(size_t, i, parent == -1 ? 0 : 1, children.size()) {
+      sum_fn_(sum, RecvChunk(children.at(i), chunk_size, &child_msg), chunk_size);
+    }
+    if (parent != -1) { ForwardChunk(parent, &msg); }
+  });
+}
+
+void CpuCollectiveBoxingAlgorithm::TreeBroadcast(char* buf, int64_t size,
+                                                 int64_t root_machine_idx) {
+  if (num_machines() == 1) { return; }
+  int64_t parent = -1;
+  std::vector<int64_t> children;
+  GetTreeNeighbors(root_machine_idx, &parent, &children);
+  std::vector<char> msg;
+  ForEachChunk(size, [&](int64_t offset, int64_t chunk_size) {
+    if (parent != -1) {
+      std::memcpy(buf + offset, RecvChunk(parent, chunk_size, &msg), chunk_size);
+    }
+    // the last child roots the largest subtree
+    for (auto it = children.crbegin(); it != children.crend(); ++it) {
+      if (parent != -1 && std::next(it) == children.crend()) {
+        ForwardChunk(*it, &msg);
+      } else {
+        SendChunk(*it, buf + offset, chunk_size);
+      }
+    }
+  });
+}
+
+int64_t CpuCollectiveBoxingAlgorithm::SegmentIdx(int64_t idx) const {
+  return ((idx % num_machines()) + num_machines()) % num_machines();
+}
+
+// binomial tree, the parent of relative index r is r with its lowest set bit cleared
+void CpuCollectiveBoxingAlgorithm::GetTreeNeighbors(int64_t root_machine_idx, int64_t* parent,
+                                                    std::vector<int64_t>* children) const {
+  const int64_t rel_idx = SegmentIdx(this_machine_idx_ - root_machine_idx);
+  *parent = -1;
+  children->clear();
+  for (int64_t mask = 1; mask < num_machines(); mask <<= 1) {
+    if (rel_idx & mask) {
+      *parent = SegmentIdx(rel_idx - mask + root_machine_idx);
+      break;
+    } else if (rel_idx + mask < num_machines()) {
+      children->push_back(SegmentIdx(rel_idx + mask + root_machine_idx));
+    }
+  }
+}
+
+void CpuCollectiveBoxingAlgorithm::ForEachChunk(
+    int64_t size, const std::function<void(int64_t, int64_t)>& Handler) const {
+  for (int64_t offset = 0; offset < size; offset += chunk_size_) {
+    Handler(offset, std::min(chunk_size_, size - offset));
+  }
+}
+
+void CpuCollectiveBoxingAlgorithm::SendChunk(int64_t machine_idx, const char* ptr, int64_t size) {
+  std::vector<char> msg(kChunkHeadSize + size);
+  std::memcpy(msg.data(), &group_tag_, kChunkHeadSize);
+  std::memcpy(msg.data() + kChunkHeadSize, ptr, size);
+  transport_->Send(machine_ids_->at(machine_idx), std::move(msg));
+}
+
+void CpuCollectiveBoxingAlgorithm::ForwardChunk(int64_t machine_idx, std::vector<char>* msg) {
+  transport_->Send(machine_ids_->at(machine_idx), std::move(*msg));
+  msg->clear();
+}
+
+char* CpuCollectiveBoxingAlgorithm::RecvChunk(int64_t machine_idx, int64_t size,
+                                              std::vector<char>* msg) {
+  transport_->Recv(machine_ids_->at(machine_idx), msg);
+  CHECK_EQ(msg->size(), kChunkHeadSize + size);
+  int64_t group_tag = -1;
+  std::memcpy(&group_tag, msg->data(), kChunkHeadSize);
+  CHECK_EQ(group_tag, group_tag_);
+  return msg->data() + kChunkHeadSize;
+}
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
@@ -0,0 +1,84 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_ALGORITHM_H_
+#define ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_ALGORITHM_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+// Ring reduce-scatter/all-gather and binomial tree reduce/broadcast between the machines of one
+// device set. Buffers are exchanged in chunks through a Transport, every chunk is tagged with the
+// group being executed. A chunk that is only passed on is forwarded in the message it arrived
+// in, so only locally produced data is copied into new messages.
+class CpuCollectiveBoxingAlgorithm final {
+ public:
+  using SumFn = void (*)(char* dst, const char* src, int64_t size);
+
+  class Transport {
+   public:
+    virtual ~Transport() = default;
+    virtual void Send(int64_t dst_machine_id, std::vector<char>&& msg) = 0;
+    // blocks until the next message from src_machine_id arrives
+    virtual void Recv(int64_t src_machine_id, std::vector<char>* msg) = 0;
+  };
+
+  OF_DISALLOW_COPY_AND_MOVE(CpuCollectiveBoxingAlgorithm);
+  CpuCollectiveBoxingAlgorithm(Transport* transport, int64_t chunk_size, int64_t tree_threshold);
+  ~CpuCollectiveBoxingAlgorithm() = default;
+
+  // machine_ids are in rank order and must outlive the following calls
+  void Reset(const std::vector<int64_t>* machine_ids, int64_t this_machine_idx, int64_t group_tag,
+             SumFn sum_fn);
+
+  void AllReduce(char* buf, int64_t size, int64_t size_of_data_type);
+  // machine i owns [segment_offsets[i], segment_offsets[i + 1])
+  void RingReduceScatter(char* buf, const std::vector<int64_t>& segment_offsets);
+  void RingAllGather(char* buf, const std::vector<int64_t>& segment_offsets);
+  void TreeReduce(char* buf, int64_t size, int64_t root_machine_idx);
+  void TreeBroadcast(char* buf, int64_t size, int64_t root_machine_idx);
+
+ private:
+  int64_t num_machines() const { return machine_ids_->size(); }
+  int64_t SegmentIdx(int64_t idx) const;
+  void GetTreeNeighbors(int64_t root_machine_idx, int64_t* parent,
+                        std::vector<int64_t>* children) const;
+  void ForEachChunk(int64_t size, const std::function<void(int64_t, int64_t)>& Handler) const;
+  void SendChunk(int64_t machine_idx, const char* ptr, int64_t size);
+  void ForwardChunk(int64_t machine_idx, std::vector<char>* msg);
+  char* RecvChunk(int64_t machine_idx, int64_t size, std::vector<char>* msg);
+
+  Transport* transport_;
+  const int64_t chunk_size_;
+  const int64_t tree_threshold_;
+
+  const std::vector<int64_t>* machine_ids_;
+  int64_t this_machine_idx_;
+  int64_t group_tag_;
+  SumFn sum_fn_;
+};
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_ALGORITHM_H_
@@ -0,0 +1,96 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <numeric>
+#include "oneflow/core/job/cpu_collective_boxing_loopback.h"
+#include "oneflow/core/common/benchmark.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+namespace {
+
+void SumFloat(char* dst, const char* src, int64_t size) {
+  float* dst_ptr = reinterpret_cast<float*>(dst);
+  const float* src_ptr = reinterpret_cast<const float*>(src);
+  FOR_RANGE(int64_t, i, 0, size / sizeof(float)) { dst_ptr[i] += src_ptr[i]; }
+}
+
+// every machine runs round_num all-reduces of size bytes, a tree_threshold of at least size
+// selects the tree, 0 the ring
+void BenchmarkCpuAllReduce(BenchmarkState* state, int64_t num_machines, int64_t size,
+                           int64_t chunk_size, int64_t tree_threshold) {
+  const int64_t round_num = std::max<int64_t>(1, (64 << 20) / size);
+  std::vector<int64_t> machine_ids(num_machines);
+  std::iota(machine_ids.begin(), machine_ids.end(), 0);
+  std::vector<std::vector<float>> bufs(num_machines,
+                                       std::vector<float>(size / sizeof(float), 1.0f));
+  int64_t reduced_bytes = 0;
+  while (state->KeepRunning()) {
+    LoopbackHub hub(num_machines);
+    std::vector<std::thread> threads;
+    FOR_RANGE(int64_t, m, 0, num_machines) {
+      threads.emplace_back([&, m]() {
+        LoopbackTransport transport(&hub, m);
+        CpuCollectiveBoxingAlgorithm algorithm(&transport, chunk_size, tree_threshold);
+        FOR_RANGE(int64_t, i, 0, round_num) {
+          algorithm.Reset(&machine_ids, m, i, &SumFloat);
+          algorithm.AllReduce(reinterpret_cast<char*>(bufs.at(m).data()), size, sizeof(float));
+        }
+      });
+    }
+    for (std::thread& thread : threads) { thread.join(); }
+    reduced_bytes += round_num * size;
+  }
+  state->SetBytesProcessed(reduced_bytes);
+  state->SetLabel(std::to_string(num_machines) + " machines, "
+                  + std::to_string(size >> 10) + " KiB in "
+                  + std::to_string(chunk_size >> 10) + " KiB chunks");
+}
+
+const int64_t kChunkSize = 512 << 10;
+
+}  // namespace
+
+OF_BENCHMARK(CpuAllReduce_4K_Tree) {
+  BenchmarkCpuAllReduce(state, 4, 4 << 10, kChunkSize, 4 << 10);
+}
+
+OF_BENCHMARK(CpuAllReduce_4K_Ring) { BenchmarkCpuAllReduce(state, 4, 4 << 10, kChunkSize, 0); }
+
+OF_BENCHMARK(CpuAllReduce_64K_Tree) {
+  BenchmarkCpuAllReduce(state, 4, 64 << 10, kChunkSize, 64 << 10);
+}
+
+OF_BENCHMARK(CpuAllReduce_64K_Ring) { BenchmarkCpuAllReduce(state, 4, 64 << 10, kChunkSize, 0); }
+
+OF_BENCHMARK(CpuAllReduce_16M_Tree) {
+  BenchmarkCpuAllReduce(state, 4, 16 << 20, kChunkSize, 16 << 20);
+}
+
+OF_BENCHMARK(CpuAllReduce_16M_TreeUnchunked) {
+  BenchmarkCpuAllReduce(state, 4, 16 << 20, 16 << 20, 16 << 20);
+}
+
+OF_BENCHMARK(CpuAllReduce_16M_Ring) { BenchmarkCpuAllReduce(state, 4, 16 << 20, kChunkSize, 0); }
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
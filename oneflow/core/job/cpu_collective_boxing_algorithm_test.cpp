@@ -0,0 +1,159 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/cpu_collective_boxing_loopback.h"
+#include <gtest/gtest.h>
+#include <numeric>
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+namespace test {
+
+namespace {
+
+void SumFloat(char* dst, const char* src, int64_t size) {
+  float* dst_ptr = reinterpret_cast<float*>(dst);
+  const float* src_ptr = reinterpret_cast<const float*>(src);
+  FOR_RANGE(int64_t, i, 0, size / sizeof(float)) { dst_ptr[i] += src_ptr[i]; }
+}
+
+// machine m starts with buf[i] = m * 1000 + i, small integers keep float sums exact
+std::vector<float> InitBuf(int64_t machine, int64_t elem_cnt) {
+  std::vector<float> buf(elem_cnt);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) { buf.at(i) = machine * 1000 + i % 1000; }
+  return buf;
+}
+
+float SumOverMachines(int64_t num_machines, int64_t i) {
+  float sum = 0;
+  FOR_RANGE(int64_t, m, 0, num_machines) { sum += m * 1000 + i % 1000; }
+  return sum;
+}
+
+// runs Fn(algorithm, machine, buf) on num_machines threads and returns the final buffers
+std::vector<std::vector<float>> RunOnMachines(
+    int64_t num_machines, int64_t elem_cnt, int64_t chunk_size, int64_t tree_threshold,
+    const std::function<void(CpuCollectiveBoxingAlgorithm*, int64_t, float*)>& Fn) {
+  LoopbackHub hub(num_machines);
+  std::vector<int64_t> machine_ids(num_machines);
+  std::iota(machine_ids.begin(), machine_ids.end(), 0);
+  std::vector<std::vector<float>> bufs(num_machines);
+  std::vector<std::thread> threads;
+  FOR_RANGE(int64_t, m, 0, num_machines) {
+    bufs.at(m) = InitBuf(m, elem_cnt);
+    threads.emplace_back([&, m]() {
+      LoopbackTransport transport(&hub, m);
+      CpuCollectiveBoxingAlgorithm algorithm(&transport, chunk_size, tree_threshold);
+      algorithm.Reset(&machine_ids, m, 7, &SumFloat);
+      Fn(&algorithm, m, bufs.at(m).data());
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  EXPECT_TRUE(hub.AllEmpty());
+  return bufs;
+}
+
+}  // namespace
+
+TEST(CpuCollectiveBoxingAlgorithm, all_reduce) {
+  const int64_t elem_cnt = 1001;
+  const int64_t size = elem_cnt * sizeof(float);
+  FOR_RANGE(int64_t, num_machines, 1, 8) {
+    // a threshold above size goes through the tree, 0 through the ring
+    for (int64_t tree_threshold : {size, int64_t(0)}) {
+      const auto bufs = RunOnMachines(
+          num_machines, elem_cnt, 64, tree_threshold,
+          [&](CpuCollectiveBoxingAlgorithm* algorithm, int64_t m, float* buf) {
+            algorithm->AllReduce(reinterpret_cast<char*>(buf), size, sizeof(float));
+          });
+      FOR_RANGE(int64_t, m, 0, num_machines) {
+        FOR_RANGE(int64_t, i, 0, elem_cnt) {
+          ASSERT_EQ(bufs.at(m).at(i), SumOverMachines(num_machines, i));
+        }
+      }
+    }
+  }
+}
+
+TEST(CpuCollectiveBoxingAlgorithm, ring_reduce_scatter_and_all_gather) {
+  FOR_RANGE(int64_t, num_machines, 2, 7) {
+    // uneven segments, machine i owns (i + 1) * 37 elements
+    std::vector<int64_t> segment_offsets(num_machines + 1, 0);
+    FOR_RANGE(int64_t, i, 0, num_machines) {
+      segment_offsets.at(i + 1) = segment_offsets.at(i) + (i + 1) * 37 * sizeof(float);
+    }
+    const int64_t elem_cnt = segment_offsets.back() / sizeof(float);
+    auto bufs = RunOnMachines(num_machines, elem_cnt, 48, 0,
+                              [&](CpuCollectiveBoxingAlgorithm* algorithm, int64_t m, float* buf) {
+                                algorithm->RingReduceScatter(reinterpret_cast<char*>(buf),
+                                                             segment_offsets);
+                              });
+    FOR_RANGE(int64_t, m, 0, num_machines) {
+      FOR_RANGE(int64_t, i, segment_offsets.at(m) / 4, segment_offsets.at(m + 1) / 4) {
+        ASSERT_EQ(bufs.at(m).at(i), SumOverMachines(num_machines, i));
+      }
+    }
+    bufs = RunOnMachines(num_machines, elem_cnt, 48, 0,
+                         [&](CpuCollectiveBoxingAlgorithm* algorithm, int64_t m, float* buf) {
+                           algorithm->RingAllGather(reinterpret_cast<char*>(buf), segment_offsets);
+                         });
+    FOR_RANGE(int64_t, m, 0, num_machines) {
+      FOR_RANGE(int64_t, owner, 0, num_machines) {
+        FOR_RANGE(int64_t, i, segment_offsets.at(owner) / 4, segment_offsets.at(owner + 1) / 4) {
+          ASSERT_EQ(bufs.at(m).at(i), owner * 1000 + i % 1000);
+        }
+      }
+    }
+  }
+}
+
+TEST(CpuCollectiveBoxingAlgorithm, tree_reduce_and_broadcast) {
+  const int64_t elem_cnt = 333;
+  const int64_t size = elem_cnt * sizeof(float);
+  FOR_RANGE(int64_t, num_machines, 2, 8) {
+    FOR_RANGE(int64_t, root, 0, num_machines) {
+      auto bufs = RunOnMachines(num_machines, elem_cnt, 100, size,
+                                [&](CpuCollectiveBoxingAlgorithm* algorithm, int64_t m,
+                                    float* buf) {
+                                  algorithm->TreeReduce(reinterpret_cast<char*>(buf), size, root);
+                                });
+      FOR_RANGE(int64_t, i, 0, elem_cnt) {
+        ASSERT_EQ(bufs.at(root).at(i), SumOverMachines(num_machines, i));
+      }
+      bufs = RunOnMachines(
+          num_machines, elem_cnt, 100, size,
+          [&](CpuCollectiveBoxingAlgorithm* algorithm, int64_t m, float* buf) {
+            algorithm->TreeBroadcast(reinterpret_cast<char*>(buf), size, root);
+          });
+      FOR_RANGE(int64_t, m, 0, num_machines) {
+        FOR_RANGE(int64_t, i, 0, elem_cnt) {
+          ASSERT_EQ(bufs.at(m).at(i), root * 1000 + i % 1000);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace test
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
@@ -0,0 +1,359 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/cpu_collective_boxing_executor_backend.h"
+#include "oneflow/core/comm_network/comm_network.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/job/global_for.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+namespace {
+
+const int64_t kCpuCollectiveBoxingMsgHandlerId = 1;
+
+void SortRequestsByOrder(std::vector<const RequestDesc*>* requests) {
+  std::sort(requests->begin(), requests->end(),
+            [](const RequestDesc* a, const RequestDesc* b) { return a->order() < b->order(); });
+}
+
+int64_t GetRequestSize(const RequestDesc* request) {
+  return Shape(request->op_desc().shape()).elem_cnt()
+         * GetSizeOfDataType(request->op_desc().data_type());
+}
+
+template<typename T>
+void SumTo(char* dst, const char* src, int64_t size) {
+  T* dst_ptr = reinterpret_cast<T*>(dst);
+  const T* src_ptr = reinterpret_cast<const T*>(src);
+  const int64_t elem_cnt = size / sizeof(T);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) { dst_ptr[i] += src_ptr[i]; }
+}
+
+void (*GetSumFn(DataType data_type))(char*, const char*, int64_t) {
+  switch (data_type) {
+#define MAKE_ENTRY(type_cpp, type_proto) \
+  case type_proto: return &SumTo<type_cpp>;
+    OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, ARITHMETIC_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ);
+#undef MAKE_ENTRY
+    default: UNIMPLEMENTED(); return nullptr;
+  }
+}
+
+// ring and tree only sum, other reduce methods must not be summed silently
+void CheckReduceMethod(const OpDesc& op_desc) {
+  const OpType op_type = op_desc.op_type();
+  if (op_type == OpType::kOpTypeAllReduce || op_type == OpType::kOpTypeReduceScatter
+      || op_type == OpType::kOpTypeReduce) {
+    CHECK(op_desc.has_reduce_method()) << op_desc.name();
+    CHECK_EQ(op_desc.reduce_method(), ReduceMethod::kReduceMethodSum)
+        << "the CPU collective boxing backend only supports sum, " << op_desc.name();
+  }
+}
+
+void CopyIfNotSame(void* dst, const void* src, int64_t size) {
+  if (dst != src) { std::memcpy(dst, src, size); }
+}
+
+}  // namespace
+
+CpuCollectiveBoxingCommNetTransport::CpuCollectiveBoxingCommNetTransport(
+    int64_t total_machine_num)
+    : is_custom_msg_handler_registered_(false) {
+  FOR_RANGE(int64_t, i, 0, total_machine_num) { machine_id2msg_queue_.emplace_back(new MsgQueue); }
+  if (Global<CommNet>::Get() != nullptr) {
+    Global<CommNet>::Get()->RegisterCustomMsgHandler(
+        kCpuCollectiveBoxingMsgHandlerId, [this](int64_t src_machine_id, std::vector<char>* data) {
+          MsgQueue* queue = machine_id2msg_queue_.at(src_machine_id).get();
+          std::unique_lock<std::mutex> lock(queue->mutex);
+          queue->msgs.emplace(std::move(*data));
+          queue->cond.notify_one();
+        });
+    is_custom_msg_handler_registered_ = true;
+  }
+}
+
+CpuCollectiveBoxingCommNetTransport::~CpuCollectiveBoxingCommNetTransport() {
+  if (is_custom_msg_handler_registered_) {
+    Global<CommNet>::Get()->UnRegisterCustomMsgHandler(kCpuCollectiveBoxingMsgHandlerId);
+  }
+}
+
+void CpuCollectiveBoxingCommNetTransport::Send(int64_t dst_machine_id, std::vector<char>&& msg) {
+  Global<CommNet>::Get()->SendCustomMsg(dst_machine_id, kCpuCollectiveBoxingMsgHandlerId,
+                                        std::move(msg));
+}
+
+void CpuCollectiveBoxingCommNetTransport::Recv(int64_t src_machine_id, std::vector<char>* msg) {
+  MsgQueue* queue = machine_id2msg_queue_.at(src_machine_id).get();
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  queue->cond.wait(lock, [queue]() { return !queue->msgs.empty(); });
+  msg->swap(queue->msgs.front());
+  queue->msgs.pop();
+}
+
+CpuCollectiveBoxingExecutorBackend::CpuCollectiveBoxingExecutorBackend()
+    : collective_boxing_conf_(Global<ResourceDesc, ForSession>::Get()->collective_boxing_conf()),
+      cur_topology_(nullptr),
+      cur_sum_fn_(nullptr) {
+  CHECK_GE(collective_boxing_conf_.cpu_fusion_threshold_mb(), 0);
+  fusion_threshold_ = collective_boxing_conf_.cpu_fusion_threshold_mb() * 1024 * 1024;
+  CHECK_GT(collective_boxing_conf_.cpu_chunk_size_kb(), 0);
+  CHECK_GE(collective_boxing_conf_.cpu_tree_threshold_kb(), 0);
+  transport_.reset(new CpuCollectiveBoxingCommNetTransport(
+      Global<ResourceDesc, ForSession>::Get()->TotalMachineNum()));
+  algorithm_.reset(new CpuCollectiveBoxingAlgorithm(
+      transport_.get(), collective_boxing_conf_.cpu_chunk_size_kb() * 1024,
+      collective_boxing_conf_.cpu_tree_threshold_kb() * 1024));
+  worker_thread_ = std::thread([this]() {
+    Task task;
+    while (task_chan_.Receive(&task) == kChannelStatusSuccess) { ExecuteTask(task); }
+  });
+}
+
+CpuCollectiveBoxingExecutorBackend::~CpuCollectiveBoxingExecutorBackend() {
+  task_chan_.Close();
+  worker_thread_.join();
+}
+
+void CpuCollectiveBoxingExecutorBackend::Init(const CollectiveBoxingPlan& collective_boxing_plan) {
+  // Groups are formed here from the requests of all machines instead of from the requests each
+  // machine sees in GroupRequests, so that every machine fuses the same requests.
+  const int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+  auto CanFuse = [&](const RequestDesc* lhs, const RequestDesc* rhs) -> bool {
+    return collective_boxing_conf_.enable_fusion()
+           && collective_boxing_conf_.cpu_fusion_all_reduce()
+           && lhs->op_desc().op_type() == OpType::kOpTypeAllReduce
+           && rhs->op_desc().op_type() == OpType::kOpTypeAllReduce
+           && lhs->device_set() == rhs->device_set()
+           && lhs->dependency_depth() == rhs->dependency_depth()
+           && lhs->op_desc().data_type() == rhs->op_desc().data_type()
+           && lhs->op_desc().reduce_method() == rhs->op_desc().reduce_method();
+  };
+  std::map<int64_t, const RequestSet*> job_id2request_set;
+  for (const auto& job_id7request_set : collective_boxing_plan.job_id2request_set()) {
+    job_id2request_set.emplace(job_id7request_set.first, &job_id7request_set.second);
+  }
+  int64_t group_tag = -1;
+  for (const auto& job_id7request_set : job_id2request_set) {
+    std::vector<const RequestDesc*> requests;
+    for (const RequestDesc& request : job_id7request_set.second->request()) {
+      requests.push_back(&request);
+    }
+    SortRequestsByOrder(&requests);
+    const RequestDesc* prev_request = nullptr;
+    int64_t group_size = 0;
+    for (const RequestDesc* request : requests) {
+      if (request->op_desc().backend() != Backend::kBackendCPU) {
+        prev_request = nullptr;
+        continue;
+      }
+      CheckReduceMethod(request->op_desc());
+      const int64_t size = GetRequestSize(request);
+      if (prev_request == nullptr || !CanFuse(prev_request, request)
+          || group_size + size > fusion_threshold_
+          || group_tag2num_requests_.at(group_tag)
+                 >= collective_boxing_conf_.cpu_fusion_max_ops()) {
+        group_tag += 1;
+        group_tag2num_requests_.emplace(group_tag, 0);
+        group_size = 0;
+      }
+      CHECK(request_name2group_tag_.emplace(request->op_desc().name(), group_tag).second);
+      group_tag2num_requests_.at(group_tag) += 1;
+      group_size += size;
+      prev_request = request;
+
+      const DeviceSet& device_set = request->device_set();
+      if (device_set2topology_.find(device_set) != device_set2topology_.end()) { continue; }
+      Topology topology;
+      topology.this_machine_idx = -1;
+      FOR_RANGE(int64_t, rank, 0, device_set.device_size()) {
+        const DeviceDesc& device_desc = device_set.device(rank);
+        CHECK_EQ(device_desc.device_type(), DeviceType::kCPU);
+        const int64_t machine_id = device_desc.machine_id();
+        if (topology.machine_ids.empty() || topology.machine_ids.back() != machine_id) {
+          CHECK(std::find(topology.machine_ids.cbegin(), topology.machine_ids.cend(), machine_id)
+                == topology.machine_ids.cend())
+              << "ranks on one machine must be contiguous";
+          if (machine_id == this_machine_id) {
+            topology.this_machine_idx = topology.machine_ids.size();
+          }
+          topology.machine_ids.push_back(machine_id);
+          topology.rank_offsets.push_back(rank);
+        }
+      }
+      topology.rank_offsets.push_back(device_set.device_size());
+      if (topology.this_machine_idx == -1) { continue; }
+      if (topology.machine_ids.size() > 1) { CHECK_NOTNULL(Global<CommNet>::Get()); }
+      device_set2topology_.emplace(device_set, std::move(topology));
+    }
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::GroupRequests(
+    const std::vector<const RequestDesc*>& requests,
+    std::vector<std::vector<const RequestDesc*>>* groups) {
+  int64_t prev_group_tag = -1;
+  for (const RequestDesc* request : requests) {
+    const int64_t group_tag = request_name2group_tag_.at(request->op_desc().name());
+    if (groups->empty() || group_tag != prev_group_tag) { groups->emplace_back(); }
+    groups->back().push_back(request);
+    prev_group_tag = group_tag;
+  }
+  for (const auto& group : *groups) {
+    const int64_t group_tag = request_name2group_tag_.at(group.front()->op_desc().name());
+    CHECK_EQ(group.size(), group_tag2num_requests_.at(group_tag));
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::ExecuteGroup(
+    const std::vector<const RequestDesc*>& group,
+    const std::vector<std::map<int64_t, RuntimeRequestInfo>>& ranks) {
+  CHECK_EQ(group.size(), ranks.size());
+  if (group.empty()) { return; }
+  Task task;
+  task.group_tag = request_name2group_tag_.at(group.front()->op_desc().name());
+  task.group = group;
+  task.ranks = ranks;
+  CHECK_EQ(task_chan_.Send(task), kChannelStatusSuccess);
+}
+
+void CpuCollectiveBoxingExecutorBackend::ExecuteTask(const Task& task) {
+  const RequestDesc* front = task.group.front();
+  cur_topology_ = &device_set2topology_.at(front->device_set());
+  cur_sum_fn_ = GetSumFn(front->op_desc().data_type());
+  algorithm_->Reset(&cur_topology_->machine_ids, cur_topology_->this_machine_idx, task.group_tag,
+                    cur_sum_fn_);
+  if (front->op_desc().op_type() == OpType::kOpTypeAllReduce) {
+    ExecuteAllReduceGroup(task);
+  } else {
+    CHECK_EQ(task.group.size(), 1);
+    ExecuteRequest(front, task.ranks.front());
+  }
+  for (const auto& rank2request_info : task.ranks) {
+    for (const auto& rank7request_info : rank2request_info) {
+      rank7request_info.second.callback(Maybe<void>::Ok());
+    }
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::ExecuteAllReduceGroup(const Task& task) {
+  int64_t total_size = 0;
+  for (const RequestDesc* request : task.group) {
+    CHECK_EQ(request->op_desc().data_type(), task.group.front()->op_desc().data_type());
+    total_size += GetRequestSize(request);
+  }
+  char* buf = WorkBuffer(total_size);
+  int64_t offset = 0;
+  FOR_RANGE(int64_t, i, 0, task.group.size()) {
+    const int64_t size = GetRequestSize(task.group.at(i));
+    LocalSum(task.ranks.at(i), size, buf + offset);
+    offset += size;
+  }
+  algorithm_->AllReduce(buf, total_size,
+                        GetSizeOfDataType(task.group.front()->op_desc().data_type()));
+  offset = 0;
+  FOR_RANGE(int64_t, i, 0, task.group.size()) {
+    const int64_t size = GetRequestSize(task.group.at(i));
+    for (const auto& rank7request_info : task.ranks.at(i)) {
+      CopyIfNotSame(rank7request_info.second.recv_buff, buf + offset, size);
+    }
+    offset += size;
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::ExecuteRequest(
+    const RequestDesc* request, const std::map<int64_t, RuntimeRequestInfo>& rank2request_info) {
+  const OpDesc& op_desc = request->op_desc();
+  const OpType op_type = op_desc.op_type();
+  const int64_t size = GetRequestSize(request);
+  const std::vector<int64_t>& rank_offsets = cur_topology_->rank_offsets;
+  const int64_t num_machines = cur_topology_->machine_ids.size();
+  char* buf = WorkBuffer(size);
+  if (op_type == OpType::kOpTypeReduceScatter || op_type == OpType::kOpTypeAllGather) {
+    CHECK_EQ(size % op_desc.num_ranks(), 0);
+    const int64_t rank_size = size / op_desc.num_ranks();
+    std::vector<int64_t> segment_offsets(num_machines + 1);
+    FOR_RANGE(int64_t, i, 0, num_machines + 1) {
+      segment_offsets.at(i) = rank_offsets.at(i) * rank_size;
+    }
+    if (op_type == OpType::kOpTypeReduceScatter) {
+      LocalSum(rank2request_info, size, buf);
+      algorithm_->RingReduceScatter(buf, segment_offsets);
+      for (const auto& rank7request_info : rank2request_info) {
+        CopyIfNotSame(rank7request_info.second.recv_buff, buf + rank7request_info.first * rank_size,
+                      rank_size);
+      }
+    } else {
+      for (const auto& rank7request_info : rank2request_info) {
+        CopyIfNotSame(buf + rank7request_info.first * rank_size,
+                      rank7request_info.second.send_buff, rank_size);
+      }
+      algorithm_->RingAllGather(buf, segment_offsets);
+      for (const auto& rank7request_info : rank2request_info) {
+        CopyIfNotSame(rank7request_info.second.recv_buff, buf, size);
+      }
+    }
+  } else if (op_type == OpType::kOpTypeReduce || op_type == OpType::kOpTypeBroadcast) {
+    const int64_t root = op_desc.root();
+    const int64_t root_machine_idx =
+        std::upper_bound(rank_offsets.cbegin(), rank_offsets.cend(), root) - rank_offsets.cbegin()
+        - 1;
+    auto root_it = rank2request_info.find(root);
+    if (op_type == OpType::kOpTypeReduce) {
+      LocalSum(rank2request_info, size, buf);
+      algorithm_->TreeReduce(buf, size, root_machine_idx);
+      if (root_it != rank2request_info.end()) {
+        CopyIfNotSame(root_it->second.recv_buff, buf, size);
+      }
+    } else {
+      if (root_it != rank2request_info.end()) {
+        CopyIfNotSame(buf, root_it->second.send_buff, size);
+      }
+      algorithm_->TreeBroadcast(buf, size, root_machine_idx);
+      for (const auto& rank7request_info : rank2request_info) {
+        CopyIfNotSame(rank7request_info.second.recv_buff, buf, size);
+      }
+    }
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::LocalSum(
+    const std::map<int64_t, RuntimeRequestInfo>& rank2request_info, int64_t size, char* buf) {
+  auto it = rank2request_info.cbegin();
+  CHECK(it != rank2request_info.cend());
+  CopyIfNotSame(buf, it->second.send_buff, size);
+  for (++it; it != rank2request_info.cend(); ++it) {
+    cur_sum_fn_(buf, static_cast<const char*>(it->second.send_buff), size);
+  }
+}
+
+char* CpuCollectiveBoxingExecutorBackend::WorkBuffer(int64_t size) {
+  if (static_cast<int64_t>(work_buf_.size()) < size) { work_buf_.resize(size); }
+  return work_buf_.data();
+}
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
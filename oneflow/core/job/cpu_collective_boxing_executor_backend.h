@@ -0,0 +1,113 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_EXECUTOR_BACKEND_H_
+#define ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_EXECUTOR_BACKEND_H_
+
+#include "oneflow/core/job/collective_boxing_executor.h"
+#include "oneflow/core/job/cpu_collective_boxing_algorithm.h"
+#include "oneflow/core/common/channel.h"
+#include "oneflow/core/graph/boxing/collective_boxing_util.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+// Chunks travel as CommNet custom messages and are queued per source machine.
+class CpuCollectiveBoxingCommNetTransport final : public CpuCollectiveBoxingAlgorithm::Transport {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuCollectiveBoxingCommNetTransport);
+  explicit CpuCollectiveBoxingCommNetTransport(int64_t total_machine_num);
+  ~CpuCollectiveBoxingCommNetTransport() override;
+
+  void Send(int64_t dst_machine_id, std::vector<char>&& msg) override;
+  void Recv(int64_t src_machine_id, std::vector<char>* msg) override;
+
+ private:
+  struct MsgQueue {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::queue<std::vector<char>> msgs;
+  };
+
+  std::vector<std::unique_ptr<MsgQueue>> machine_id2msg_queue_;
+  bool is_custom_msg_handler_registered_;
+};
+
+// Collective boxing between cpu devices. Ranks on one machine are combined in host memory, the
+// machines run CpuCollectiveBoxingAlgorithm over CommNet custom messages. Groups run one at a
+// time on a worker thread, every machine runs them in the plan order, so messages between two
+// machines always match up.
+class CpuCollectiveBoxingExecutorBackend final : public CollectiveBoxingExecutorBackend {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuCollectiveBoxingExecutorBackend);
+  CpuCollectiveBoxingExecutorBackend();
+  ~CpuCollectiveBoxingExecutorBackend() override;
+
+ private:
+  void Init(const CollectiveBoxingPlan& collective_boxing_plan) override;
+  void GroupRequests(const std::vector<const RequestDesc*>& requests,
+                     std::vector<std::vector<const RequestDesc*>>* groups) override;
+  void ExecuteGroup(const std::vector<const RequestDesc*>& group,
+                    const std::vector<std::map<int64_t, RuntimeRequestInfo>>& ranks) override;
+
+  struct Topology {
+    // machines in rank order, ranks on machine i are [rank_offsets[i], rank_offsets[i + 1])
+    std::vector<int64_t> machine_ids;
+    std::vector<int64_t> rank_offsets;
+    int64_t this_machine_idx;
+  };
+
+  struct Task {
+    int64_t group_tag;
+    std::vector<const RequestDesc*> group;
+    std::vector<std::map<int64_t, RuntimeRequestInfo>> ranks;
+  };
+
+  void ExecuteTask(const Task& task);
+  void ExecuteAllReduceGroup(const Task& task);
+  void ExecuteRequest(const RequestDesc* request,
+                      const std::map<int64_t, RuntimeRequestInfo>& rank2request_info);
+  void LocalSum(const std::map<int64_t, RuntimeRequestInfo>& rank2request_info, int64_t size,
+                char* buf);
+  char* WorkBuffer(int64_t size);
+
+  const CollectiveBoxingConf collective_boxing_conf_;
+  int64_t fusion_threshold_;
+
+  HashMap<std::string, int64_t> request_name2group_tag_;
+  HashMap<int64_t, int64_t> group_tag2num_requests_;
+  HashMap<DeviceSet, Topology> device_set2topology_;
+  std::unique_ptr<CpuCollectiveBoxingAlgorithm::Transport> transport_;
+  std::unique_ptr<CpuCollectiveBoxingAlgorithm> algorithm_;
+
+  Channel<Task> task_chan_;
+  std::thread worker_thread_;
+
+  // state of the task being executed, only touched by the worker thread
+  const Topology* cur_topology_;
+  CpuCollectiveBoxingAlgorithm::SumFn cur_sum_fn_;
+  std::vector<char> work_buf_;
+};
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_EXECUTOR_BACKEND_H_
@@ -0,0 +1,239 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/cpu_collective_boxing_executor_backend.h"
+#include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
+#include "oneflow/core/comm_network/epoll/socket_util.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/job/resource_desc.h"
+#include <gtest/gtest.h>
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+namespace test {
+
+namespace {
+
+// machine 0 of a one machine session whose EpollCommNet talks to itself over loopback sockets,
+// the ranks of a request are the cpu devices of machine 0
+class LoopbackSession final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(LoopbackSession);
+  LoopbackSession() {
+    Resource resource;
+    resource.set_machine_num(1);
+    resource.set_comm_net_worker_num(2);
+    resource.mutable_collective_boxing_conf()->set_cpu_enable(true);
+    Global<ResourceDesc, ForSession>::New(resource);
+    Global<MachineCtx>::New(0);
+    Plan plan;
+    (*plan.mutable_net_topo()->mutable_peer_machine_ids())[0].add_machine_id(0);
+    std::vector<std::vector<int>> machine_id2sockfds(1);
+    machine_id2sockfds.at(0) = ConnectLoopbackSockets(1);
+    EpollCommNet::InitWithSockets(plan, std::move(machine_id2sockfds));
+  }
+  ~LoopbackSession() {
+    Global<CommNet>::Delete();
+    Global<MachineCtx>::Delete();
+    Global<ResourceDesc, ForSession>::Delete();
+  }
+};
+
+RequestDesc MakeRequest(const std::string& name, OpType op_type, DataType data_type,
+                        int64_t elem_cnt, int64_t num_ranks, int64_t order) {
+  RequestDesc request;
+  OpDesc* op_desc = request.mutable_op_desc();
+  op_desc->set_name(name);
+  op_desc->set_op_type(op_type);
+  if (op_type == OpType::kOpTypeAllReduce || op_type == OpType::kOpTypeReduceScatter
+      || op_type == OpType::kOpTypeReduce) {
+    op_desc->set_reduce_method(ReduceMethod::kReduceMethodSum);
+  }
+  if (op_type == OpType::kOpTypeReduce || op_type == OpType::kOpTypeBroadcast) {
+    op_desc->set_root(num_ranks - 1);
+  }
+  op_desc->set_data_type(data_type);
+  op_desc->mutable_shape()->add_dim(elem_cnt);
+  op_desc->set_num_ranks(num_ranks);
+  op_desc->set_backend(Backend::kBackendCPU);
+  FOR_RANGE(int64_t, rank, 0, num_ranks) {
+    DeviceDesc* device_desc = request.mutable_device_set()->add_device();
+    device_desc->set_machine_id(0);
+    device_desc->set_device_type(DeviceType::kCPU);
+    device_desc->set_device_id(rank);
+  }
+  request.set_order(order);
+  request.set_dependency_depth(0);
+  return request;
+}
+
+// rank r sends buf[i] = r * 100 + i % 100, small integers keep float16 sums exact
+template<typename T>
+std::vector<T> InitSendBuf(int64_t rank, int64_t elem_cnt) {
+  std::vector<T> buf(elem_cnt);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) { buf.at(i) = static_cast<T>(rank * 100.0f + i % 100); }
+  return buf;
+}
+
+float SumOverRanks(int64_t num_ranks, int64_t i) {
+  float sum = 0;
+  FOR_RANGE(int64_t, rank, 0, num_ranks) { sum += rank * 100.0f + i % 100; }
+  return sum;
+}
+
+// groups the requests like the executor does, runs every group on all ranks and returns the
+// receive buffers indexed by request and rank
+template<typename T>
+std::vector<std::vector<std::vector<T>>> GroupAndExecute(
+    const std::vector<RequestDesc>& requests, int64_t num_ranks, int64_t elem_cnt,
+    std::vector<std::vector<const RequestDesc*>>* groups) {
+  CollectiveBoxingPlan collective_boxing_plan;
+  RequestSet* request_set = &(*collective_boxing_plan.mutable_job_id2request_set())[0];
+  for (const RequestDesc& request : requests) { *request_set->add_request() = request; }
+  std::vector<const RequestDesc*> request_ptrs;
+  for (const RequestDesc& request : request_set->request()) { request_ptrs.push_back(&request); }
+
+  std::unique_ptr<CollectiveBoxingExecutorBackend> backend(
+      new CpuCollectiveBoxingExecutorBackend());
+  backend->Init(collective_boxing_plan);
+  backend->GroupRequests(request_ptrs, groups);
+
+  std::vector<std::vector<std::vector<T>>> send_bufs(requests.size());
+  std::vector<std::vector<std::vector<T>>> recv_bufs(requests.size());
+  FOR_RANGE(size_t, i, 0, requests.size()) {
+    FOR_RANGE(int64_t, rank, 0, num_ranks) {
+      send_bufs.at(i).push_back(InitSendBuf<T>(rank, elem_cnt));
+      recv_bufs.at(i).emplace_back(elem_cnt, static_cast<T>(-1.0f));
+    }
+  }
+  BlockingCounter counter(requests.size() * num_ranks);
+  size_t request_idx = 0;
+  for (const auto& group : *groups) {
+    std::vector<std::map<int64_t, RuntimeRequestInfo>> ranks(group.size());
+    FOR_RANGE(size_t, i, 0, group.size()) {
+      FOR_RANGE(int64_t, rank, 0, num_ranks) {
+        RuntimeRequestInfo& request_info = ranks.at(i)[rank];
+        request_info.send_buff = send_bufs.at(request_idx).at(rank).data();
+        request_info.recv_buff = recv_bufs.at(request_idx).at(rank).data();
+        request_info.callback = [&counter](const Maybe<void>& status) {
+          CHECK(status.IsOk());
+          counter.Decrease();
+        };
+      }
+      request_idx += 1;
+    }
+    backend->ExecuteGroup(group, ranks);
+  }
+  counter.WaitUntilCntEqualZero();
+  return recv_bufs;
+}
+
+template<typename T>
+void TestFusedAllReduce() {
+  const int64_t num_ranks = 4;
+  const int64_t elem_cnt = 1001;
+  std::vector<RequestDesc> requests;
+  FOR_RANGE(int64_t, i, 0, 3) {
+    requests.push_back(MakeRequest("all_reduce_" + std::to_string(i), OpType::kOpTypeAllReduce,
+                                   GetDataType<T>::value, elem_cnt, num_ranks, i));
+  }
+  std::vector<std::vector<const RequestDesc*>> groups;
+  const auto recv_bufs = GroupAndExecute<T>(requests, num_ranks, elem_cnt, &groups);
+  ASSERT_EQ(groups.size(), 1);
+  ASSERT_EQ(groups.front().size(), requests.size());
+  FOR_RANGE(size_t, i, 0, requests.size()) {
+    FOR_RANGE(int64_t, rank, 0, num_ranks) {
+      FOR_RANGE(int64_t, j, 0, elem_cnt) {
+        ASSERT_EQ(static_cast<float>(recv_bufs.at(i).at(rank).at(j)),
+                  SumOverRanks(num_ranks, j));
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(CpuCollectiveBoxingExecutorBackend, fused_all_reduce) {
+  LoopbackSession session;
+  TestFusedAllReduce<float>();
+}
+
+TEST(CpuCollectiveBoxingExecutorBackend, fused_all_reduce_float16) {
+  LoopbackSession session;
+  TestFusedAllReduce<float16>();
+}
+
+TEST(CpuCollectiveBoxingExecutorBackend, execute_request) {
+  LoopbackSession session;
+  const int64_t num_ranks = 4;
+  const int64_t elem_cnt = 4 * 37;
+  const int64_t rank_elem_cnt = elem_cnt / num_ranks;
+  const int64_t root = num_ranks - 1;
+  std::vector<RequestDesc> requests;
+  for (OpType op_type : {OpType::kOpTypeReduceScatter, OpType::kOpTypeAllGather,
+                         OpType::kOpTypeReduce, OpType::kOpTypeBroadcast}) {
+    requests.push_back(MakeRequest("request_" + std::to_string(requests.size()), op_type,
+                                   DataType::kFloat, elem_cnt, num_ranks, requests.size()));
+  }
+  std::vector<std::vector<const RequestDesc*>> groups;
+  const auto recv_bufs = GroupAndExecute<float>(requests, num_ranks, elem_cnt, &groups);
+  // only all-reduces are fused
+  ASSERT_EQ(groups.size(), requests.size());
+  FOR_RANGE(int64_t, rank, 0, num_ranks) {
+    FOR_RANGE(int64_t, j, 0, rank_elem_cnt) {
+      ASSERT_EQ(recv_bufs.at(0).at(rank).at(j), SumOverRanks(num_ranks, rank * rank_elem_cnt + j));
+    }
+    FOR_RANGE(int64_t, j, 0, elem_cnt) {
+      const int64_t owner = j / rank_elem_cnt;
+      ASSERT_EQ(recv_bufs.at(1).at(rank).at(j), owner * 100.0f + (j % rank_elem_cnt) % 100);
+      ASSERT_EQ(recv_bufs.at(3).at(rank).at(j), root * 100.0f + j % 100);
+    }
+  }
+  FOR_RANGE(int64_t, j, 0, elem_cnt) {
+    ASSERT_EQ(recv_bufs.at(2).at(root).at(j), SumOverRanks(num_ranks, j));
+  }
+}
+
+TEST(CpuCollectiveBoxingCommNetTransport, custom_msgs_keep_their_order) {
+  LoopbackSession session;
+  CpuCollectiveBoxingCommNetTransport transport(1);
+  const int64_t msg_num = 100;
+  FOR_RANGE(int64_t, i, 0, msg_num) {
+    transport.Send(0, std::vector<char>(i * 1000, static_cast<char>(i)));
+  }
+  FOR_RANGE(int64_t, i, 0, msg_num) {
+    std::vector<char> msg;
+    transport.Recv(0, &msg);
+    ASSERT_EQ(msg, std::vector<char>(i * 1000, static_cast<char>(i)));
+  }
+}
+
+}  // namespace test
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
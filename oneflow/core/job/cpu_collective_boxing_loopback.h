@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_LOOPBACK_H_
+#define ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_LOOPBACK_H_
+
+#include "oneflow/core/job/cpu_collective_boxing_algorithm.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+// In-process machines for tests and benchmarks of CpuCollectiveBoxingAlgorithm, the machines are
+// threads and queues[src][dst] connects them, messages are moved, not copied.
+class LoopbackHub final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(LoopbackHub);
+  explicit LoopbackHub(int64_t num_machines)
+      : num_machines_(num_machines), queues_(num_machines * num_machines) {
+    for (auto& queue : queues_) { queue.reset(new Queue); }
+  }
+  ~LoopbackHub() = default;
+
+  void Send(int64_t src, int64_t dst, std::vector<char>&& msg) {
+    Queue* queue = At(src, dst);
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    queue->msgs.emplace(std::move(msg));
+    queue->cond.notify_one();
+  }
+
+  void Recv(int64_t src, int64_t dst, std::vector<char>* msg) {
+    Queue* queue = At(src, dst);
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    queue->cond.wait(lock, [queue]() { return !queue->msgs.empty(); });
+    *msg = std::move(queue->msgs.front());
+    queue->msgs.pop();
+  }
+
+  bool AllEmpty() const {
+    for (const auto& queue : queues_) {
+      if (!queue->msgs.empty()) { return false; }
+    }
+    return true;
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::queue<std::vector<char>> msgs;
+  };
+
+  Queue* At(int64_t src, int64_t dst) { return queues_.at(src * num_machines_ + dst).get(); }
+
+  const int64_t num_machines_;
+  std::vector<std::unique_ptr<Queue>> queues_;
+};
+
+class LoopbackTransport final : public CpuCollectiveBoxingAlgorithm::Transport {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(LoopbackTransport);
+  LoopbackTransport(LoopbackHub* hub, int64_t machine_id) : hub_(hub), machine_id_(machine_id) {}
+  ~LoopbackTransport() override = default;
+
+  void Send(int64_t dst_machine_id, std::vector<char>&& msg) override {
+    hub_->Send(machine_id_, dst_machine_id, std::move(msg));
+  }
+  void Recv(int64_t src_machine_id, std::vector<char>* msg) override {
+    hub_->Recv(src_machine_id, machine_id_, msg);
+  }
+
+ private:
+  LoopbackHub* hub_;
+  int64_t machine_id_;
+};
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_LOOPBACK_H_
@@ -180,6 +180,8 @@ void GetDeviceDesc(const TaskProto* task_proto, boxing::collective::DeviceDesc*
   device_desc->set_device_type(Global<IDMgr>::Get()->GetDeviceTypeFromThrdId(thrd_id));
   if (device_desc->device_type() == DeviceType::kGPU) {
     device_desc->set_device_id(Global<IDMgr>::Get()->GetGpuPhyIdFromThrdId(thrd_id));
+  } else if (device_desc->device_type() == DeviceType::kCPU) {
+    device_desc->set_device_id(Global<IDMgr>::Get()->GetCpuDevicePhyIdFromThrdId(thrd_id));
   } else {
     UNIMPLEMENTED();
   }
@@ -33,6 +33,11 @@ class ResourceDesc final {
   size_t TotalMachineNum() const;
   const Machine& machine(int32_t idx) const;
   size_t CommNetWorkerNum() const { return resource_.comm_net_worker_num(); }
+  int32_t CommNetConnectionNumPerPeer() const {
+    return resource_.comm_net_connection_num_per_peer();
+  }
+  int32_t CommNetStreamShardNum() const { return resource_.comm_net_stream_shard_num(); }
+  size_t comm_net_stripe_min_byte() const { return resource_.comm_net_stripe_min_kbyte() * 1024; }
   size_t rdma_mem_block_byte() const { return resource_.rdma_mem_block_mbyte() * kMB; }
   size_t rdma_recv_msg_buf_byte() const { return resource_.rdma_recv_msg_buf_mbyte() * kMB; }
   int32_t CpuDeviceNum() const { return resource_.cpu_device_num(); }
@@ -42,6 +47,8 @@ class ResourceDesc final {
   size_t reserved_host_mem_byte() const { return resource_.reserved_host_mem_mbyte() * kMB; }
   size_t reserved_device_mem_byte() const { return resource_.reserved_device_mem_mbyte() * kMB; }
   bool use_rdma() const { return resource_.use_rdma(); }
+  bool enable_shm_comm_net() const { return resource_.enable_shm_comm_net(); }
+  bool use_io_uring() const { return resource_.use_io_uring(); }
   bool enable_numa_aware_cuda_malloc_host() const {
     return resource_.enable_numa_aware_cuda_malloc_host();
   }
@@ -50,6 +57,10 @@ class ResourceDesc final {
   }
   bool enable_thread_local_cache() const { return resource_.enable_thread_local_cache(); }
   size_t thread_local_cache_max_size() const { return resource_.thread_local_cache_max_size(); }
+  bool enable_host_caching_allocator() const { return resource_.enable_host_caching_allocator(); }
+  bool host_caching_allocator_use_hugepage() const {
+    return resource_.host_caching_allocator_use_hugepage();
+  }
   int32_t ComputeThreadPoolSize() const;
   bool enable_debug_mode() const;
   CollectiveBoxingConf collective_boxing_conf() const;
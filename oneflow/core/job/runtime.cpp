@@ -17,6 +17,8 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
 #include "oneflow/core/comm_network/ibverbs/ibverbs_comm_network.h"
+#include "oneflow/core/comm_network/io_uring/io_uring_comm_network.h"
+#include "oneflow/core/comm_network/shm/shm_comm_network.h"
 #include "oneflow/core/control/ctrl_client.h"
 #include "oneflow/core/job/machine_context.h"
 #include "oneflow/core/job/resource_desc.h"
@@ -108,6 +110,14 @@ void Runtime::NewAllGlobal(const Plan& plan, size_t total_piece_num, bool is_exp
 #else
       LOG(FATAL) << "RDMA components not found";
 #endif
+    } else if (Global<ResourceDesc, ForSession>::Get()->use_io_uring()) {
+#ifdef WITH_IO_URING
+      IoUringCommNet::Init(plan);
+#else
+      LOG(FATAL) << "io_uring components not found";
+#endif
+    } else if (ShmCommNet::IsUsable(plan)) {
+      ShmCommNet::Init(plan);
     } else {
       EpollCommNet::Init(plan);
     }
@@ -24,7 +24,9 @@ limitations under the License.
 #include "oneflow/core/job/id_manager.h"
 #include "oneflow/core/job/profiler.h"
 #include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/snapshot_write_engine.h"
 #include "oneflow/core/common/buffer_manager.h"
+#include "oneflow/core/common/tensor_buffer_pool.h"
 #include "oneflow/core/job/foreign_job_instance.h"
 #include "oneflow/core/job/inter_user_job_info.pb.h"
 #include "oneflow/core/job/job_desc.h"
@@ -35,6 +37,7 @@ limitations under the License.
 #include "oneflow/core/job/runtime_buffer_managers_scope.h"
 #include "oneflow/core/framework/load_library.h"
 #include "oneflow/core/job/version.h"
+#include "oneflow/core/vm/cpu_allocator.h"
 #include "oneflow/core/job/global_for.h"
 
 namespace oneflow {
@@ -74,7 +77,14 @@ Maybe<void> SessionGlobalObjectsScope::Init(const ConfigProto& config_proto) {
   Global<ResourceDesc, ForSession>::Delete();
   DumpVersionInfo();
   Global<ResourceDesc, ForSession>::New(config_proto.resource());
+  if (Global<ResourceDesc, ForSession>::Get()->enable_host_caching_allocator()) {
+    Global<vm::CpuAllocator>::Get()->EnableCaching(
+        Global<ResourceDesc, ForSession>::Get()->host_caching_allocator_use_hugepage());
+  }
   Global<const IOConf>::New(config_proto.io_conf());
+  Global<SnapshotWriteEngine>::New(
+      Global<const IOConf>::Get()->snapshot_writer_thread_num(),
+      static_cast<size_t>(Global<const IOConf>::Get()->snapshot_staging_buffer_mbyte()) << 20);
   Global<const ProfilerConf>::New(config_proto.profiler_conf());
   Global<IDMgr>::New();
   if (Global<MachineCtx>::Get()->IsThisMachineMaster()
@@ -111,7 +121,10 @@ SessionGlobalObjectsScope::~SessionGlobalObjectsScope() {
   if (Global<Profiler>::Get() != nullptr) { Global<Profiler>::Delete(); }
   Global<IDMgr>::Delete();
   Global<const ProfilerConf>::Delete();
+  Global<SnapshotWriteEngine>::Delete();
   Global<const IOConf>::Delete();
+  Global<vm::CpuAllocator>::Get()->DisableCaching();
+  TensorBufferPool::Get()->Trim();
   Global<ResourceDesc, ForSession>::Delete();
   Global<ResourceDesc, ForSession>::New(Global<ResourceDesc, ForEnv>::Get()->resource());
 }
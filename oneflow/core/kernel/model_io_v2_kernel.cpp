@@ -66,6 +66,12 @@ class OnDemandHostBlob final {
 
   Blob* blob() const { return blob_.get(); }
 
+  // hands the body over, the blob must not be used afterwards
+  std::vector<char> ReleaseBody() {
+    blob_.reset();
+    return std::move(data);
+  }
+
  private:
   void Init() {
     header.resize(blob_desc_->ByteSizeOfBlobHeader());
@@ -166,6 +172,13 @@ class AutoSyncBlobAccessor final {
 
   Blob* host_blob() { return host_blob_.blob(); }
 
+  // the host copy is written as is, no further copy is made
+  void WriteTo(SnapshotWriter* writer, const std::string& key) {
+    CHECK(!write_sync_);
+    const size_t size = host_blob_.blob()->ByteSizeOfBlobBody();
+    writer->Write(key, host_blob_.ReleaseBody(), size);
+  }
+
  private:
   DeviceCtx* device_ctx_;
   Blob* underlying_;
@@ -184,6 +197,8 @@ class AutoSyncBlobAccessor<DeviceType::kCPU> final {
 
   Blob* host_blob() { return underlying_; }
 
+  void WriteTo(SnapshotWriter* writer, const std::string& key) { writer->Write(key, underlying_); }
+
  private:
   Blob* underlying_;
 };
@@ -337,8 +352,11 @@ class ModelSaveV2Kernel final : public KernelIf<device_type> {
     const std::string var_lbn =
         GenLogicalBlobName(conf.variable_op_name(), original_variable_conf.out());
     const std::string key = is_broadcast ? var_lbn : GetTmpPartKey(var_lbn, parallel_ctx);
-    writer.Write(key, in_accessor.host_blob());
+    in_accessor.WriteTo(&writer, key);
+    // files of broadcast variables are waited for when the save job finishes
     if (!is_broadcast) {
+      // the part files are read back by parallel_id 0 after the barrier
+      writer.Flush();
       const int64_t parallel_num = parallel_ctx.parallel_num();
       Global<CtrlClient>::Get()->Barrier(
           snapshot_path + "-" + var_lbn + "-Counter-" + std::to_string(*counter_), parallel_num);
@@ -354,7 +372,8 @@ class ModelSaveV2Kernel final : public KernelIf<device_type> {
         HostSliceCopy(total_blob.blob(), total_slice, part_blob.blob(), part_slice);
         SnapshotFS()->RecursivelyDeleteDir(Dirname(JoinPath(snapshot_path, part_key)));
       }
-      writer.Write(var_lbn, total_blob.blob());
+      const size_t total_size = total_blob.blob()->ByteSizeOfBlobBody();
+      writer.Write(var_lbn, total_blob.ReleaseBody(), total_size);
     }
   }
   std::unique_ptr<int64_t> counter_;
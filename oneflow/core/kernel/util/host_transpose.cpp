@@ -0,0 +1,311 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/util/host_transpose.h"
+#include <numeric>
+#include "oneflow/core/thread/thread_pool.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace oneflow {
+
+namespace {
+
+// a tile of kTileSize x kTileSize elements of up to 8 bytes fits into L1 with its output
+const int64_t kTileSize = 32;
+const int64_t kParallelMinElemCnt = 64 * 1024;
+const int64_t kParallelGrainElemCnt = 32 * 1024;
+
+struct TransposeDesc {
+  int32_t num_axes;
+  DimVector x_dims;
+  // y axis i is x axis perm[i]
+  std::vector<int32_t> perm;
+  DimVector x_strides;
+  // stride in y of each x axis
+  DimVector y_strides_of_x_axes;
+};
+
+TransposeDesc SimplifyTransposeDesc(int32_t num_axis, const ShapeView& x_shape,
+                                    const int32_t* permutation) {
+  // drop axes of size 1
+  std::vector<int32_t> kept_x_axes;
+  std::vector<int32_t> x_axis2kept(num_axis, -1);
+  FOR_RANGE(int32_t, i, 0, num_axis) {
+    if (x_shape.At(i) == 1) { continue; }
+    x_axis2kept.at(i) = kept_x_axes.size();
+    kept_x_axes.push_back(i);
+  }
+  std::vector<int32_t> perm;
+  FOR_RANGE(int32_t, i, 0, num_axis) {
+    if (x_axis2kept.at(permutation[i]) != -1) { perm.push_back(x_axis2kept.at(permutation[i])); }
+  }
+  // merge runs of y axes which are consecutive x axes
+  std::vector<int32_t> x_axis2group(perm.size(), -1);
+  std::vector<int32_t> group_heads;
+  FOR_RANGE(size_t, i, 0, perm.size()) {
+    if (i > 0 && perm.at(i) == perm.at(i - 1) + 1) {
+      x_axis2group.at(perm.at(i)) = x_axis2group.at(perm.at(i - 1));
+    } else {
+      x_axis2group.at(perm.at(i)) = group_heads.size();
+      group_heads.push_back(perm.at(i));
+    }
+  }
+  // groups numbered in x order
+  std::vector<int32_t> group2x_order(group_heads.size());
+  DimVector group_dims;
+  int32_t group_num = 0;
+  FOR_RANGE(size_t, i, 0, perm.size()) {
+    const int32_t group = x_axis2group.at(i);
+    if (i == 0 || x_axis2group.at(i - 1) != group) {
+      group2x_order.at(group) = group_num++;
+      group_dims.push_back(x_shape.At(kept_x_axes.at(i)));
+    } else {
+      group_dims.back() *= x_shape.At(kept_x_axes.at(i));
+    }
+  }
+  TransposeDesc desc;
+  desc.num_axes = group_num;
+  desc.x_dims = group_dims;
+  FOR_RANGE(int32_t, i, 0, group_num) { desc.perm.push_back(group2x_order.at(i)); }
+  desc.x_strides.resize(group_num);
+  desc.y_strides_of_x_axes.resize(group_num);
+  int64_t stride = 1;
+  for (int32_t i = group_num - 1; i >= 0; --i) {
+    desc.x_strides.at(i) = stride;
+    stride *= desc.x_dims.at(i);
+  }
+  stride = 1;
+  for (int32_t i = group_num - 1; i >= 0; --i) {
+    desc.y_strides_of_x_axes.at(desc.perm.at(i)) = stride;
+    stride *= desc.x_dims.at(desc.perm.at(i));
+  }
+  return desc;
+}
+
+// Enumerates the indexes of outer_axes (x axes, given in y order) from a flat index, keeping the
+// x and y offsets up to date.
+class OuterIndexIterator final {
+ public:
+  OuterIndexIterator(const TransposeDesc& desc, const std::vector<int32_t>& outer_axes,
+                     int64_t flat_index)
+      : desc_(desc), outer_axes_(outer_axes), index_(outer_axes.size()), x_offset_(0),
+        y_offset_(0) {
+    for (int64_t i = static_cast<int64_t>(outer_axes_.size()) - 1; i >= 0; --i) {
+      const int32_t axis = outer_axes_.at(i);
+      index_.at(i) = flat_index % desc_.x_dims.at(axis);
+      flat_index /= desc_.x_dims.at(axis);
+      x_offset_ += index_.at(i) * desc_.x_strides.at(axis);
+      y_offset_ += index_.at(i) * desc_.y_strides_of_x_axes.at(axis);
+    }
+  }
+
+  int64_t x_offset() const { return x_offset_; }
+  int64_t y_offset() const { return y_offset_; }
+
+  void Next() {
+    for (int64_t i = static_cast<int64_t>(outer_axes_.size()) - 1; i >= 0; --i) {
+      const int32_t axis = outer_axes_.at(i);
+      index_.at(i) += 1;
+      x_offset_ += desc_.x_strides.at(axis);
+      y_offset_ += desc_.y_strides_of_x_axes.at(axis);
+      if (index_.at(i) < desc_.x_dims.at(axis)) { return; }
+      index_.at(i) = 0;
+      x_offset_ -= desc_.x_dims.at(axis) * desc_.x_strides.at(axis);
+      y_offset_ -= desc_.x_dims.at(axis) * desc_.y_strides_of_x_axes.at(axis);
+    }
+  }
+
+ private:
+  const TransposeDesc& desc_;
+  const std::vector<int32_t>& outer_axes_;
+  DimVector index_;
+  int64_t x_offset_;
+  int64_t y_offset_;
+};
+
+template<typename U>
+struct BlockTransposer {
+  // y[c * y_ld + r] = x[r * x_ld + c]
+  static void Transpose(const U* x, int64_t x_ld, U* y, int64_t y_ld, int64_t rows,
+                        int64_t cols) {
+    FOR_RANGE(int64_t, c, 0, cols) {
+      FOR_RANGE(int64_t, r, 0, rows) { y[c * y_ld + r] = x[r * x_ld + c]; }
+    }
+  }
+};
+
+#if defined(__SSE2__)
+
+inline void Transpose4x4(const uint32_t* x, int64_t x_ld, uint32_t* y, int64_t y_ld) {
+  __m128 r0 = _mm_loadu_ps(reinterpret_cast<const float*>(x));
+  __m128 r1 = _mm_loadu_ps(reinterpret_cast<const float*>(x + x_ld));
+  __m128 r2 = _mm_loadu_ps(reinterpret_cast<const float*>(x + 2 * x_ld));
+  __m128 r3 = _mm_loadu_ps(reinterpret_cast<const float*>(x + 3 * x_ld));
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  _mm_storeu_ps(reinterpret_cast<float*>(y), r0);
+  _mm_storeu_ps(reinterpret_cast<float*>(y + y_ld), r1);
+  _mm_storeu_ps(reinterpret_cast<float*>(y + 2 * y_ld), r2);
+  _mm_storeu_ps(reinterpret_cast<float*>(y + 3 * y_ld), r3);
+}
+
+inline void Transpose2x2(const uint64_t* x, int64_t x_ld, uint64_t* y, int64_t y_ld) {
+  const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x));
+  const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + x_ld));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(y), _mm_unpacklo_epi64(r0, r1));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(y + y_ld), _mm_unpackhi_epi64(r0, r1));
+}
+
+template<>
+struct BlockTransposer<uint32_t> {
+  static void Transpose(const uint32_t* x, int64_t x_ld, uint32_t* y, int64_t y_ld, int64_t rows,
+                        int64_t cols) {
+    const int64_t rows4 = rows / 4 * 4;
+    const int64_t cols4 = cols / 4 * 4;
+    for (int64_t r = 0; r < rows4; r += 4) {
+      for (int64_t c = 0; c < cols4; c += 4) {
+        Transpose4x4(x + r * x_ld + c, x_ld, y + c * y_ld + r, y_ld);
+      }
+    }
+    // the border which is not covered by whole 4x4 blocks
+    FOR_RANGE(int64_t, c, 0, cols) {
+      const int64_t r_begin = c < cols4 ? rows4 : 0;
+      FOR_RANGE(int64_t, r, r_begin, rows) { y[c * y_ld + r] = x[r * x_ld + c]; }
+    }
+  }
+};
+
+template<>
+struct BlockTransposer<uint64_t> {
+  static void Transpose(const uint64_t* x, int64_t x_ld, uint64_t* y, int64_t y_ld, int64_t rows,
+                        int64_t cols) {
+    const int64_t rows2 = rows / 2 * 2;
+    const int64_t cols2 = cols / 2 * 2;
+    for (int64_t r = 0; r < rows2; r += 2) {
+      for (int64_t c = 0; c < cols2; c += 2) {
+        Transpose2x2(x + r * x_ld + c, x_ld, y + c * y_ld + r, y_ld);
+      }
+    }
+    FOR_RANGE(int64_t, c, 0, cols) {
+      const int64_t r_begin = c < cols2 ? rows2 : 0;
+      FOR_RANGE(int64_t, r, r_begin, rows) { y[c * y_ld + r] = x[r * x_ld + c]; }
+    }
+  }
+};
+
+#endif
+
+void ParallelForElems(int64_t work_num, int64_t elem_cnt_per_work,
+                      const std::function<void(int64_t, int64_t)>& Callback) {
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (thread_pool == nullptr || work_num * elem_cnt_per_work < kParallelMinElemCnt) {
+    Callback(0, work_num);
+  } else {
+    const int64_t grain_size = std::max<int64_t>(1, kParallelGrainElemCnt / elem_cnt_per_work);
+    thread_pool->ParallelFor(0, work_num, grain_size, Callback);
+  }
+}
+
+// the innermost x axis stays innermost in y, contiguous runs are copied
+void CopyRuns(const TransposeDesc& desc, size_t elem_size, const char* x, char* y) {
+  const int32_t inner_axis = desc.num_axes - 1;
+  const size_t run_size = desc.x_dims.at(inner_axis) * elem_size;
+  // runs are enumerated in x order so that x is read sequentially
+  std::vector<int32_t> outer_axes(inner_axis);
+  std::iota(outer_axes.begin(), outer_axes.end(), 0);
+  int64_t run_num = 1;
+  for (int32_t axis : outer_axes) { run_num *= desc.x_dims.at(axis); }
+  ParallelForElems(run_num, desc.x_dims.at(inner_axis), [&](int64_t begin, int64_t end) {
+    OuterIndexIterator it(desc, outer_axes, begin);
+    FOR_RANGE(int64_t, i, begin, end) {
+      std::memcpy(y + it.y_offset() * elem_size, x + it.x_offset() * elem_size, run_size);
+      it.Next();
+    }
+  });
+}
+
+// the innermost axis of x (a) and the x axis which becomes innermost in y (b) differ, every
+// (b, a) plane is transposed in tiles
+template<typename U>
+void TransposeTiles(const TransposeDesc& desc, const U* x, U* y) {
+  const int32_t a = desc.num_axes - 1;
+  const int32_t b = desc.perm.back();
+  const int64_t a_dim = desc.x_dims.at(a);
+  const int64_t b_dim = desc.x_dims.at(b);
+  const int64_t x_ld = desc.x_strides.at(b);
+  const int64_t y_ld = desc.y_strides_of_x_axes.at(a);
+  std::vector<int32_t> outer_axes;
+  int64_t plane_num = 1;
+  for (int32_t axis : desc.perm) {
+    if (axis == a || axis == b) { continue; }
+    outer_axes.push_back(axis);
+    plane_num *= desc.x_dims.at(axis);
+  }
+  // a work is a strip of kTileSize b indexes across all of a, in one plane
+  const int64_t strip_num = (b_dim + kTileSize - 1) / kTileSize;
+  ParallelForElems(plane_num * strip_num, kTileSize * a_dim, [&](int64_t begin, int64_t end) {
+    OuterIndexIterator it(desc, outer_axes, begin / strip_num);
+    int64_t strip = begin % strip_num;
+    FOR_RANGE(int64_t, i, begin, end) {
+      const int64_t b_begin = strip * kTileSize;
+      const int64_t rows = std::min(kTileSize, b_dim - b_begin);
+      const U* x_strip = x + it.x_offset() + b_begin * x_ld;
+      U* y_strip = y + it.y_offset() + b_begin;
+      for (int64_t a_begin = 0; a_begin < a_dim; a_begin += kTileSize) {
+        const int64_t cols = std::min(kTileSize, a_dim - a_begin);
+        BlockTransposer<U>::Transpose(x_strip + a_begin, x_ld, y_strip + a_begin * y_ld, y_ld,
+                                      rows, cols);
+      }
+      strip += 1;
+      if (strip == strip_num) {
+        strip = 0;
+        it.Next();
+      }
+    }
+  });
+}
+
+}  // namespace
+
+void HostTranspose(int32_t num_axis, const ShapeView& x_shape, const int32_t* permutation,
+                   size_t elem_size, const void* x, void* y) {
+  if (elem_size != 1 && elem_size != 2 && elem_size != 4 && elem_size != 8) {
+    // other element sizes become an extra innermost axis of bytes
+    DimVector dims;
+    x_shape.ToDimVector(&dims);
+    dims.push_back(elem_size);
+    std::vector<int32_t> perm(permutation, permutation + num_axis);
+    perm.push_back(num_axis);
+    HostTranspose(num_axis + 1, ShapeView(dims.data(), dims.size()), perm.data(), 1, x, y);
+    return;
+  }
+  const TransposeDesc desc = SimplifyTransposeDesc(num_axis, x_shape, permutation);
+  if (desc.num_axes <= 1) {
+    std::memcpy(y, x, x_shape.elem_cnt() * elem_size);
+  } else if (desc.perm.back() == desc.num_axes - 1) {
+    CopyRuns(desc, elem_size, static_cast<const char*>(x), static_cast<char*>(y));
+  } else if (elem_size == 1) {
+    TransposeTiles<uint8_t>(desc, static_cast<const uint8_t*>(x), static_cast<uint8_t*>(y));
+  } else if (elem_size == 2) {
+    TransposeTiles<uint16_t>(desc, static_cast<const uint16_t*>(x), static_cast<uint16_t*>(y));
+  } else if (elem_size == 4) {
+    TransposeTiles<uint32_t>(desc, static_cast<const uint32_t*>(x), static_cast<uint32_t*>(y));
+  } else {
+    TransposeTiles<uint64_t>(desc, static_cast<const uint64_t*>(x), static_cast<uint64_t*>(y));
+  }
+}
+
+}  // namespace oneflow
@@ -0,0 +1,31 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_KERNEL_UTIL_HOST_TRANSPOSE_H_
+#define ONEFLOW_CORE_KERNEL_UTIL_HOST_TRANSPOSE_H_
+
+#include "oneflow/core/common/shape_view.h"
+
+namespace oneflow {
+
+// y = transpose(x, permutation) for elements of elem_size bytes, y axis i is x axis
+// permutation[i]. Axes which stay adjacent are merged first. When the innermost axis moves, the
+// copy is done in cache-sized tiles; large transposes are split across Global<ThreadPool>.
+void HostTranspose(int32_t num_axis, const ShapeView& x_shape, const int32_t* permutation,
+                   size_t elem_size, const void* x, void* y);
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_KERNEL_UTIL_HOST_TRANSPOSE_H_
@@ -0,0 +1,117 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/util/host_transpose.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+// the loop KernelUtil<kCPU>::Transpose ran before: x in order, an inner_product per element
+void IndexWalkTranspose(const DimVector& x_dims, const std::vector<int32_t>& perm, const float* x,
+                        float* y) {
+  const int32_t num_axes = x_dims.size();
+  int64_t block_size = 1;
+  int32_t shared_idxs_num = 0;
+  for (int32_t i = num_axes - 1; i >= 0 && perm.at(i) == i; --i) {
+    block_size *= x_dims.at(i);
+    ++shared_idxs_num;
+  }
+  const int32_t trans_axis = num_axes - shared_idxs_num;
+  DimVector y_strides(trans_axis);
+  int64_t stride = 1;
+  for (int32_t i = trans_axis - 1; i >= 0; --i) {
+    y_strides.at(i) = stride;
+    stride *= x_dims.at(perm.at(i));
+  }
+  DimVector x_to_y_offset(trans_axis);
+  FOR_RANGE(int32_t, i, 0, trans_axis) { x_to_y_offset.at(perm.at(i)) = y_strides.at(i); }
+  DimVector x_index_digits(trans_axis, 0);
+  int64_t elem_cnt = 1;
+  for (int64_t dim : x_dims) { elem_cnt *= dim; }
+  FOR_RANGE(int64_t, x_idx, 0, elem_cnt / block_size) {
+    const int64_t y_idx = std::inner_product(x_to_y_offset.cbegin(), x_to_y_offset.cend(),
+                                             x_index_digits.cbegin(), 0);
+    if (block_size == 1) {
+      y[y_idx] = x[x_idx];
+    } else {
+      memcpy(y + block_size * y_idx, x + block_size * x_idx, block_size * sizeof(float));
+    }
+    for (int32_t i = trans_axis - 1; i >= 0; --i) {
+      if (++x_index_digits.at(i) < x_dims.at(i)) { break; }
+      x_index_digits.at(i) = 0;
+    }
+  }
+}
+
+enum TransposeImpl { kIndexWalk, kTiled, kTiledWithPool };
+
+void BenchmarkTranspose(BenchmarkState* state, TransposeImpl impl, const DimVector& x_dims,
+                        const std::vector<int32_t>& perm) {
+  int64_t elem_cnt = 1;
+  for (int64_t dim : x_dims) { elem_cnt *= dim; }
+  std::vector<float> x(elem_cnt, 1);
+  std::vector<float> y(elem_cnt);
+  if (impl == kTiledWithPool) { Global<ThreadPool>::New(4); }
+  while (state->KeepRunning()) {
+    if (impl == kIndexWalk) {
+      IndexWalkTranspose(x_dims, perm, x.data(), y.data());
+    } else {
+      HostTranspose(x_dims.size(), ShapeView(x_dims.data(), x_dims.size()), perm.data(),
+                    sizeof(float), x.data(), y.data());
+    }
+    DoNotOptimize(y.data());
+  }
+  if (impl == kTiledWithPool) { Global<ThreadPool>::Delete(); }
+  state->SetBytesProcessed(state->iterations() * elem_cnt * sizeof(float));
+}
+
+// NCHW to NHWC of a 32x64x56x56 activation
+void Nchw2Nhwc(BenchmarkState* state, TransposeImpl impl) {
+  BenchmarkTranspose(state, impl, {32, 64, 56, 56}, {0, 2, 3, 1});
+}
+
+// attention heads, (batch, seq, head, head_dim) to (batch, head, seq, head_dim)
+void SplitHeads(BenchmarkState* state, TransposeImpl impl) {
+  BenchmarkTranspose(state, impl, {16, 128, 16, 64}, {0, 2, 1, 3});
+}
+
+void Matrix2D(BenchmarkState* state, TransposeImpl impl) {
+  BenchmarkTranspose(state, impl, {2048, 2048}, {1, 0});
+}
+
+}  // namespace
+
+OF_BENCHMARK(TransposeIndexWalk_Nchw2Nhwc) { Nchw2Nhwc(state, kIndexWalk); }
+
+OF_BENCHMARK(TransposeTiled_Nchw2Nhwc) { Nchw2Nhwc(state, kTiled); }
+
+OF_BENCHMARK(TransposeTiledWithPool_Nchw2Nhwc) { Nchw2Nhwc(state, kTiledWithPool); }
+
+OF_BENCHMARK(TransposeIndexWalk_SplitHeads) { SplitHeads(state, kIndexWalk); }
+
+OF_BENCHMARK(TransposeTiled_SplitHeads) { SplitHeads(state, kTiled); }
+
+OF_BENCHMARK(TransposeTiledWithPool_SplitHeads) { SplitHeads(state, kTiledWithPool); }
+
+OF_BENCHMARK(TransposeIndexWalk_Matrix2D) { Matrix2D(state, kIndexWalk); }
+
+OF_BENCHMARK(TransposeTiled_Matrix2D) { Matrix2D(state, kTiled); }
+
+OF_BENCHMARK(TransposeTiledWithPool_Matrix2D) { Matrix2D(state, kTiledWithPool); }
+
+}  // namespace oneflow
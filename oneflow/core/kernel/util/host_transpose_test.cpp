@@ -0,0 +1,94 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/util/host_transpose.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+void NaiveTranspose(const DimVector& x_dims, const std::vector<int32_t>& perm, size_t elem_size,
+                    const char* x, char* y) {
+  const int64_t num_axes = x_dims.size();
+  int64_t elem_cnt = 1;
+  for (int64_t dim : x_dims) { elem_cnt *= dim; }
+  FOR_RANGE(int64_t, y_offset, 0, elem_cnt) {
+    DimVector x_index(num_axes);
+    int64_t remainder = y_offset;
+    for (int64_t i = num_axes - 1; i >= 0; --i) {
+      x_index.at(perm.at(i)) = remainder % x_dims.at(perm.at(i));
+      remainder /= x_dims.at(perm.at(i));
+    }
+    int64_t x_offset = 0;
+    FOR_RANGE(int64_t, i, 0, num_axes) { x_offset = x_offset * x_dims.at(i) + x_index.at(i); }
+    std::memcpy(y + y_offset * elem_size, x + x_offset * elem_size, elem_size);
+  }
+}
+
+void TestRandomTransposes(int64_t max_dim) {
+  std::mt19937 gen(0);
+  const std::vector<size_t> elem_sizes{1, 2, 4, 8, 12};
+  FOR_RANGE(int32_t, num_axes, 1, 7) {
+    FOR_RANGE(int32_t, trial, 0, 20) {
+      DimVector x_dims(num_axes);
+      int64_t elem_cnt = 1;
+      FOR_RANGE(int32_t, i, 0, num_axes) {
+        x_dims.at(i) = std::uniform_int_distribution<int64_t>(1, max_dim)(gen);
+        if (elem_cnt * x_dims.at(i) > (1 << 18)) { x_dims.at(i) = 1; }
+        elem_cnt *= x_dims.at(i);
+      }
+      std::vector<int32_t> perm(num_axes);
+      std::iota(perm.begin(), perm.end(), 0);
+      std::shuffle(perm.begin(), perm.end(), gen);
+      for (size_t elem_size : elem_sizes) {
+        std::vector<char> x(elem_cnt * elem_size);
+        FOR_RANGE(size_t, i, 0, x.size()) { x.at(i) = static_cast<char>(gen()); }
+        std::vector<char> expected(x.size());
+        std::vector<char> y(x.size());
+        NaiveTranspose(x_dims, perm, elem_size, x.data(), expected.data());
+        HostTranspose(num_axes, ShapeView(x_dims.data(), num_axes), perm.data(), elem_size,
+                      x.data(), y.data());
+        ASSERT_EQ(y, expected);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(HostTranspose, transpose) { TestRandomTransposes(6); }
+
+TEST(HostTranspose, parallel_transpose) {
+  Global<ThreadPool>::New(4);
+  TestRandomTransposes(40);
+  Global<ThreadPool>::Delete();
+}
+
+TEST(HostTranspose, transpose_2d) {
+  Global<ThreadPool>::New(4);
+  const DimVector x_dims{517, 1030};
+  const std::vector<int32_t> perm{1, 0};
+  std::vector<char> x(517 * 1030 * sizeof(float));
+  std::iota(x.begin(), x.end(), 0);
+  std::vector<char> expected(x.size());
+  std::vector<char> y(x.size());
+  NaiveTranspose(x_dims, perm, sizeof(float), x.data(), expected.data());
+  HostTranspose(2, ShapeView(x_dims.data(), 2), perm.data(), sizeof(float), x.data(), y.data());
+  ASSERT_EQ(y, expected);
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace oneflow
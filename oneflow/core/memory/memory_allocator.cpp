@@ -15,15 +15,32 @@ limitations under the License.
 */
 #include "oneflow/core/memory/memory_allocator.h"
 #include "oneflow/core/comm_network/comm_network.h"
+#include "oneflow/core/comm_network/shm/shm_comm_network.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/job/resource_desc.h"
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/register/blob.h"
 #include "oneflow/core/common/tensor_buffer.h"
 #include "oneflow/core/record/record.pb.h"
+#include "oneflow/core/vm/cpu_allocator.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include <map>
+#ifdef PLATFORM_POSIX
+#include <sys/mman.h>
+#endif
 
 namespace oneflow {
 
+namespace {
+
+const size_t kHostMemZeroTaskSize = 2 << 20;  // 2MiB, the size of a huge page
+const size_t kHostMemTouchStride = 4096;      // the smallest page size
+// unpinned host buffers of at least this size are mapped directly, the kernel hands out zeroed
+// pages so they need no clearing, only the first touch which decides their NUMA node
+const size_t kHostMemMapThreshold = 2 << 20;
+
+}  // namespace
+
 void* MemoryAllocatorImpl::Allocate(MemoryCase mem_case, size_t size) {
   void* ptr = nullptr;
   if (mem_case.has_host_mem()) {
@@ -38,8 +55,7 @@ void* MemoryAllocatorImpl::Allocate(MemoryCase mem_case, size_t size) {
       UNIMPLEMENTED();
 #endif
     } else {
-      ptr = malloc(size);
-      CHECK_NOTNULL(ptr);
+      ptr = AllocateUnPinnedHostMem(size);
     }
   } else if (mem_case.has_device_cuda_mem()) {
 #ifdef WITH_CUDA
@@ -54,7 +70,7 @@ void* MemoryAllocatorImpl::Allocate(MemoryCase mem_case, size_t size) {
   return ptr;
 }
 
-void MemoryAllocatorImpl::Deallocate(void* ptr, MemoryCase mem_case) {
+void MemoryAllocatorImpl::Deallocate(void* ptr, MemoryCase mem_case, size_t size) {
   if (mem_case.has_host_mem()) {
     if (mem_case.host_mem().has_cuda_pinned_mem()) {
 #ifdef WITH_CUDA
@@ -63,7 +79,7 @@ void MemoryAllocatorImpl::Deallocate(void* ptr, MemoryCase mem_case) {
       UNIMPLEMENTED();
 #endif
     } else {
-      free(ptr);
+      DeallocateUnPinnedHostMem(ptr, size);
     }
   } else if (mem_case.has_device_cuda_mem()) {
 #ifdef WITH_CUDA
@@ -78,38 +94,162 @@ void MemoryAllocatorImpl::Deallocate(void* ptr, MemoryCase mem_case) {
 }
 
 void* MemoryAllocatorImpl::AllocateUnPinnedHostMem(size_t size) {
-  void* ptr = malloc(size);
+  char* ptr = nullptr;
+  Global<vm::CpuAllocator>::Get()->Allocate(&ptr, size);
   CHECK_NOTNULL(ptr);
   return ptr;
 }
 
-void MemoryAllocatorImpl::DeallocateUnPinnedHostMem(void* ptr) { free(ptr); }
+void MemoryAllocatorImpl::DeallocateUnPinnedHostMem(void* ptr, size_t size) {
+  Global<vm::CpuAllocator>::Get()->Deallocate(static_cast<char*>(ptr), size);
+}
 
 MemoryAllocator::~MemoryAllocator() {
   for (std::function<void()> deleter : deleters_) { deleter(); }
 }
 
 char* MemoryAllocator::Allocate(MemoryCase mem_case, std::size_t size) {
-  const int memset_val = 0;
+  return AllocateBatch({std::make_pair(mem_case, size)}).front();
+}
+
+std::vector<char*> MemoryAllocator::AllocateBatch(
+    const std::vector<std::pair<MemoryCase, size_t>>& mem_case_size_pairs,
+    const std::vector<int64_t>& host_mem_cuda_device_ids) {
+  CHECK(host_mem_cuda_device_ids.empty()
+        || host_mem_cuda_device_ids.size() == mem_case_size_pairs.size());
+  std::vector<char*> ptrs;
+  std::vector<HostMemRange> host_ranges;
+  FOR_RANGE(size_t, i, 0, mem_case_size_pairs.size()) {
+    const MemoryCase& mem_case = mem_case_size_pairs.at(i).first;
+    const size_t host_range_num = host_ranges.size();
+    ptrs.push_back(
+        AllocateWithoutZeroingHostMem(mem_case, mem_case_size_pairs.at(i).second, &host_ranges));
+    if (host_ranges.size() == host_range_num) { continue; }
+    int64_t cuda_device_id = -1;
+    if (!host_mem_cuda_device_ids.empty()) {
+      cuda_device_id = host_mem_cuda_device_ids.at(i);
+    } else if (mem_case.host_mem().has_cuda_pinned_mem()) {
+      cuda_device_id = mem_case.host_mem().cuda_pinned_mem().device_id();
+    }
+    host_ranges.back().cuda_device_id = cuda_device_id;
+  }
+  ZeroHostMem(host_ranges);
+  return ptrs;
+}
+
+char* MemoryAllocator::AllocateWithoutZeroingHostMem(const MemoryCase& mem_case, size_t size,
+                                                     std::vector<HostMemRange>* host_ranges) {
+#ifdef PLATFORM_POSIX
+  if (mem_case.has_host_mem() && mem_case.host_mem().used_by_network()
+      && Global<ShmCommNet>::Get() != nullptr) {
+    // peers on this host read the memory through their own mapping of the segment
+    char* dptr = Global<ShmCommNet>::Get()->AllocateSharedMem(size);
+    host_ranges->push_back({dptr, size, true, -1});
+    const bool is_pinned = mem_case.host_mem().has_cuda_pinned_mem();
+    if (is_pinned) {
+#ifdef WITH_CUDA
+      OF_CUDA_CHECK(cudaHostRegister(dptr, size, cudaHostRegisterDefault));
+#else
+      UNIMPLEMENTED();
+#endif
+    }
+    deleters_.push_front([dptr, is_pinned]() {
+#ifdef WITH_CUDA
+      if (is_pinned) { OF_CUDA_CHECK(cudaHostUnregister(dptr)); }
+#endif
+      Global<ShmCommNet>::Get()->DeallocateSharedMem(dptr);
+    });
+    return dptr;
+  }
+  if (mem_case.has_host_mem() && !mem_case.host_mem().has_cuda_pinned_mem()
+      && size >= kHostMemMapThreshold) {
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    PCHECK(ptr != MAP_FAILED);
+    char* dptr = static_cast<char*>(ptr);
+    host_ranges->push_back({dptr, size, true, -1});
+    deleters_.push_front([dptr, size]() { PCHECK(munmap(dptr, size) == 0); });
+    return dptr;
+  }
+#endif
   char* dptr = static_cast<char*>(MemoryAllocatorImpl::Allocate(mem_case, size));
   if (mem_case.has_host_mem()) {
-    memset(dptr, memset_val, size);
+    host_ranges->push_back({dptr, size, false, -1});
   } else if (mem_case.has_device_cuda_mem()) {
 #ifdef WITH_CUDA
     CudaCurrentDeviceGuard guard(mem_case.device_cuda_mem().device_id());
-    OF_CUDA_CHECK(cudaMemset(dptr, memset_val, size));
+    OF_CUDA_CHECK(cudaMemset(dptr, 0, size));
 #else
     UNIMPLEMENTED();
 #endif
   } else {
     UNIMPLEMENTED();
   }
-  deleters_.push_front(std::bind(&MemoryAllocator::Deallocate, this, dptr, mem_case));
+  deleters_.push_front(std::bind(&MemoryAllocator::Deallocate, this, dptr, mem_case, size));
   return dptr;
 }
 
-void MemoryAllocator::Deallocate(char* dptr, MemoryCase mem_case) {
-  MemoryAllocatorImpl::Deallocate(static_cast<void*>(dptr), mem_case);
+// Zeroes the ranges on the threads of the pool, in tasks of about kHostMemZeroTaskSize bytes, so
+// that large buffers are split and many small ones are cleared together. Tasks of a GPU run with
+// the pool thread bound to the GPU's node, so that its host memory is first touched there.
+void MemoryAllocator::ZeroHostMem(const std::vector<HostMemRange>& ranges) {
+  std::map<int64_t, std::vector<HostMemRange>> cuda_device_id2ranges;
+  for (const HostMemRange& range : ranges) {
+    // zeroed pages of cpu actor threads are first touched by the thread writing them
+    if (range.is_zeroed && range.cuda_device_id == -1) { continue; }
+    cuda_device_id2ranges[range.cuda_device_id].push_back(range);
+  }
+  for (const auto& pair : cuda_device_id2ranges) {
+    const int64_t cuda_device_id = pair.first;
+    std::vector<HostMemRange> pieces;
+    std::vector<size_t> task_begins;
+    size_t task_size = kHostMemZeroTaskSize;
+    for (const HostMemRange& range : pair.second) {
+      for (size_t offset = 0; offset < range.size; offset += kHostMemZeroTaskSize) {
+        if (task_size >= kHostMemZeroTaskSize) {
+          task_begins.push_back(pieces.size());
+          task_size = 0;
+        }
+        const size_t piece_size = std::min(kHostMemZeroTaskSize, range.size - offset);
+        pieces.push_back({range.ptr + offset, piece_size, range.is_zeroed, cuda_device_id});
+        task_size += piece_size;
+      }
+    }
+    task_begins.push_back(pieces.size());
+    auto ZeroTasks = [&pieces, &task_begins](int64_t begin, int64_t end) {
+      FOR_RANGE(size_t, i, task_begins.at(begin), task_begins.at(end)) {
+        const HostMemRange& piece = pieces.at(i);
+        if (piece.is_zeroed) {
+          for (size_t offset = 0; offset < piece.size; offset += kHostMemTouchStride) {
+            piece.ptr[offset] = 0;
+          }
+        } else {
+          memset(piece.ptr, 0, piece.size);
+        }
+      }
+    };
+    auto ZeroTasksOnNode = [&ZeroTasks, cuda_device_id](int64_t begin, int64_t end) {
+      if (cuda_device_id == -1) {
+        ZeroTasks(begin, end);
+      } else {
+#ifdef WITH_CUDA
+        RunOnCudaDeviceLocalCpus(cuda_device_id, [&]() { ZeroTasks(begin, end); });
+#else
+        UNIMPLEMENTED();
+#endif
+      }
+    };
+    const int64_t task_num = task_begins.size() - 1;
+    ThreadPool* thread_pool = Global<ThreadPool>::Get();
+    if (thread_pool == nullptr || task_num <= 1) {
+      ZeroTasksOnNode(0, task_num);
+    } else {
+      thread_pool->ParallelFor(0, task_num, 1, ZeroTasksOnNode);
+    }
+  }
+}
+
+void MemoryAllocator::Deallocate(char* dptr, MemoryCase mem_case, size_t size) {
+  MemoryAllocatorImpl::Deallocate(static_cast<void*>(dptr), mem_case, size);
 }
 
 void InitNonPODTypeBlobIfNeed(MemoryAllocator* allocator, Blob* blob_ptr) {
@@ -28,11 +28,29 @@ class MemoryAllocator final {
   ~MemoryAllocator();
 
   char* Allocate(MemoryCase mem_case, std::size_t size);
+  // Allocates the buffers like Allocate(). host_mem_cuda_device_ids, empty or one per buffer,
+  // names the GPU whose actor threads use the host memory of a buffer, -1 for CPU actor threads.
+  // Large mapped buffers of CPU actor threads are not touched here, the owning actor thread
+  // faults their pages in on its node when it first writes them. The other host memory is
+  // zeroed on the threads of Global<ThreadPool>, bound to the node of its GPU if it has one.
+  std::vector<char*> AllocateBatch(
+      const std::vector<std::pair<MemoryCase, size_t>>& mem_case_size_pairs,
+      const std::vector<int64_t>& host_mem_cuda_device_ids = {});
   template<typename T>
   T* PlacementNew(T* mem_ptr);
 
  private:
-  void Deallocate(char* dptr, MemoryCase mem_case);
+  struct HostMemRange {
+    char* ptr;
+    size_t size;
+    // mapped pages arrive zeroed and are only faulted in
+    bool is_zeroed;
+    int64_t cuda_device_id;
+  };
+  static void ZeroHostMem(const std::vector<HostMemRange>& ranges);
+  char* AllocateWithoutZeroingHostMem(const MemoryCase& mem_case, size_t size,
+                                      std::vector<HostMemRange>* host_ranges);
+  void Deallocate(char* dptr, MemoryCase mem_case, size_t size);
 
   std::mutex deleters_mutex_;
   std::list<std::function<void()>> deleters_;
@@ -54,9 +72,9 @@ T* MemoryAllocator::PlacementNew(T* mem_ptr) {
 
 struct MemoryAllocatorImpl final {
   static void* Allocate(MemoryCase mem_case, size_t size);
-  static void Deallocate(void* ptr, MemoryCase mem_case);
+  static void Deallocate(void* ptr, MemoryCase mem_case, size_t size);
   static void* AllocateUnPinnedHostMem(size_t size);
-  static void DeallocateUnPinnedHostMem(void* ptr);
+  static void DeallocateUnPinnedHostMem(void* ptr, size_t size);
 };
 
 }  // namespace oneflow
@@ -0,0 +1,82 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/memory/memory_allocator.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include <malloc.h>
+
+namespace oneflow {
+
+namespace {
+
+// host buffers shaped like the register memory of a job, mostly small ones and a few large ones
+std::vector<std::pair<MemoryCase, size_t>> RegstLikeMemCaseSizePairs() {
+  MemoryCase host_mem_case;
+  host_mem_case.mutable_host_mem();
+  std::vector<std::pair<MemoryCase, size_t>> pairs;
+  FOR_RANGE(int64_t, i, 0, 1024) { pairs.emplace_back(host_mem_case, (16 << 10) << (i % 5)); }
+  FOR_RANGE(int64_t, i, 0, 8) { pairs.emplace_back(host_mem_case, 8 << 20); }
+  return pairs;
+}
+
+int64_t TotalSize(const std::vector<std::pair<MemoryCase, size_t>>& pairs) {
+  int64_t total_size = 0;
+  for (const auto& pair : pairs) { total_size += pair.second; }
+  return total_size;
+}
+
+// with touch_all, every page is also written once after the allocation, like the actor threads
+// do on their first pieces, which shows what deferring the first touch moves out of the startup
+void BenchmarkAllocate(BenchmarkState* state, bool is_batch, bool touch_all) {
+  Global<ThreadPool>::New(std::max<int32_t>(std::thread::hardware_concurrency(), 1));
+  const std::vector<std::pair<MemoryCase, size_t>> pairs = RegstLikeMemCaseSizePairs();
+  while (state->KeepRunning()) {
+    {
+      MemoryAllocator allocator;
+      std::vector<char*> ptrs;
+      if (is_batch) {
+        ptrs = allocator.AllocateBatch(pairs);
+      } else {
+        for (const auto& pair : pairs) {
+          ptrs.push_back(allocator.Allocate(pair.first, pair.second));
+        }
+      }
+      if (touch_all) {
+        FOR_RANGE(size_t, i, 0, pairs.size()) {
+          for (size_t offset = 0; offset < pairs.at(i).second; offset += 4096) {
+            ptrs.at(i)[offset] = 1;
+          }
+        }
+      }
+      DoNotOptimize(ptrs.data());
+    }
+    // gives the pages back, so that every iteration faults them in like the startup does
+    malloc_trim(0);
+  }
+  state->SetBytesProcessed(state->iterations() * TotalSize(pairs));
+  state->SetLabel(std::to_string(Global<ThreadPool>::Get()->thread_num()) + " pool threads");
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace
+
+OF_BENCHMARK(MemoryAllocatorAllocateOneByOne) { BenchmarkAllocate(state, false, false); }
+
+OF_BENCHMARK(MemoryAllocatorAllocateBatch) { BenchmarkAllocate(state, true, false); }
+
+OF_BENCHMARK(MemoryAllocatorAllocateBatchAndTouchAll) { BenchmarkAllocate(state, true, true); }
+
+}  // namespace oneflow
@@ -0,0 +1,75 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/memory/memory_allocator.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+std::vector<std::pair<MemoryCase, size_t>> HostMemCaseSizePairs() {
+  MemoryCase host_mem_case;
+  host_mem_case.mutable_host_mem();
+  std::vector<std::pair<MemoryCase, size_t>> pairs;
+  // single small buffers, buffers sharing a zeroing task with others, split ones and mapped ones
+  const std::vector<size_t> sizes = {1,       100,     4096,    5000,
+                                     1 << 20, (2 << 20) + 3, 7 << 20, 33 << 20};
+  for (size_t size : sizes) {
+    pairs.emplace_back(host_mem_case, size);
+    pairs.emplace_back(host_mem_case, size);
+  }
+  return pairs;
+}
+
+// the mapped buffers of cpu actor threads are left untouched, they still have to read as zero
+void CheckAllocateBatchZeroes(bool with_cuda_device_ids) {
+  const std::vector<std::pair<MemoryCase, size_t>> pairs = HostMemCaseSizePairs();
+  std::vector<int64_t> cuda_device_ids;
+  if (with_cuda_device_ids) { cuda_device_ids.resize(pairs.size(), -1); }
+  {
+    // leaves garbage behind for the buffers allocated next
+    MemoryAllocator allocator;
+    std::vector<char*> ptrs = allocator.AllocateBatch(pairs, cuda_device_ids);
+    FOR_RANGE(size_t, i, 0, pairs.size()) { std::memset(ptrs.at(i), 0xff, pairs.at(i).second); }
+  }
+  MemoryAllocator allocator;
+  std::vector<char*> ptrs = allocator.AllocateBatch(pairs, cuda_device_ids);
+  ASSERT_EQ(ptrs.size(), pairs.size());
+  FOR_RANGE(size_t, i, 0, pairs.size()) {
+    const char* ptr = ptrs.at(i);
+    ASSERT_TRUE(std::all_of(ptr, ptr + pairs.at(i).second, [](char c) { return c == 0; }))
+        << "buffer " << i << " of " << pairs.at(i).second << " bytes";
+  }
+  ASSERT_EQ(*allocator.Allocate(pairs.front().first, 64), 0);
+}
+
+}  // namespace
+
+TEST(MemoryAllocator, allocate_batch_zeroes_host_mem) { CheckAllocateBatchZeroes(false); }
+
+TEST(MemoryAllocator, allocate_batch_zeroes_host_mem_on_thread_pool) {
+  Global<ThreadPool>::New(4);
+  CheckAllocateBatchZeroes(false);
+  Global<ThreadPool>::Delete();
+}
+
+TEST(MemoryAllocator, allocate_batch_zeroes_host_mem_of_cpu_actor_threads) {
+  Global<ThreadPool>::New(4);
+  CheckAllocateBatchZeroes(true);
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace oneflow
@@ -0,0 +1,109 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ndarray/ndarray_apply_broadcast_binary.h"
+#include "oneflow/core/ndarray/ndarray_apply_broadcast_binary_core.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+// Computes y = a op b with the run-by-run engine, or with the per-element broadcast expression
+// every CPU broadcast took before. The shapes are given already simplified, as the dispatcher
+// hands them to the core, so NDIMS is their number of axes.
+template<int NDIMS, template<typename> class binary_func>
+void BenchmarkBroadcast(BenchmarkState* state, bool is_generic, const DimVector& a_dims,
+                        const DimVector& b_dims) {
+  CHECK_EQ(a_dims.size(), NDIMS);
+  CHECK_EQ(b_dims.size(), NDIMS);
+  DimVector y_dims(NDIMS);
+  FOR_RANGE(int32_t, i, 0, NDIMS) { y_dims[i] = std::max(a_dims[i], b_dims[i]); }
+  const Shape a_shape(a_dims);
+  const Shape b_shape(b_dims);
+  const Shape y_shape(y_dims);
+  std::vector<float> a(a_shape.elem_cnt());
+  FOR_RANGE(size_t, i, 0, a.size()) { a[i] = static_cast<float>(i % 1000) / 1000.f; }
+  std::vector<float> b(b_shape.elem_cnt());
+  FOR_RANGE(size_t, i, 0, b.size()) { b[i] = static_cast<float>(i % 77) / 77.f + 1.f; }
+  std::vector<float> y(y_shape.elem_cnt());
+  XpuVarNdarray<float> y_ndarray(y_shape, y.data());
+  XpuVarNdarray<const float> a_ndarray(a_shape, a.data());
+  XpuVarNdarray<const float> b_ndarray(b_shape, b.data());
+  Global<ThreadPool>::New(4);
+  while (state->KeepRunning()) {
+    if (is_generic) {
+      NdarrayApplyBroadcastBinaryCore<float, NDIMS, binary_func>::Apply(y_ndarray, a_ndarray,
+                                                                         b_ndarray);
+    } else {
+      NdarrayApplyBroadcastBinary<DeviceType::kCPU, float, binary_func>::Apply(
+          nullptr, y_ndarray, a_ndarray, b_ndarray);
+    }
+    DoNotOptimize(y.data());
+  }
+  Global<ThreadPool>::Delete();
+  state->SetBytesProcessed(state->iterations()
+                           * (a.size() + b.size() + y.size()) * sizeof(float));
+}
+
+// a scalar times 16M elements
+void ScalarVector(BenchmarkState* state, bool is_generic) {
+  BenchmarkBroadcast<1, BinaryFuncMul>(state, is_generic, {1}, {1 << 24});
+}
+
+// a bias added to every row of 4096x1024
+void Row(BenchmarkState* state, bool is_generic) {
+  BenchmarkBroadcast<2, BinaryFuncAdd>(state, is_generic, {4096, 1024}, {1, 1024});
+}
+
+// every row of 4096x1024 divided by its own scalar, as softmax does
+void Col(BenchmarkState* state, bool is_generic) {
+  BenchmarkBroadcast<2, BinaryFuncDiv>(state, is_generic, {4096, 1024}, {4096, 1});
+}
+
+// a per-channel scale of an NCHW batch 32x64x56x56, its spatial axes merged
+void Channel(BenchmarkState* state, bool is_generic) {
+  BenchmarkBroadcast<3, BinaryFuncMul>(state, is_generic, {32, 64, 3136}, {1, 64, 1});
+}
+
+// an outer sum of a column and a row, neither operand is full size
+void Outer(BenchmarkState* state, bool is_generic) {
+  BenchmarkBroadcast<2, BinaryFuncAdd>(state, is_generic, {4096, 1}, {1, 1024});
+}
+
+}  // namespace
+
+OF_BENCHMARK(BroadcastGeneric_ScalarVector) { ScalarVector(state, true); }
+
+OF_BENCHMARK(BroadcastRuns_ScalarVector) { ScalarVector(state, false); }
+
+OF_BENCHMARK(BroadcastGeneric_Row) { Row(state, true); }
+
+OF_BENCHMARK(BroadcastRuns_Row) { Row(state, false); }
+
+OF_BENCHMARK(BroadcastGeneric_Col) { Col(state, true); }
+
+OF_BENCHMARK(BroadcastRuns_Col) { Col(state, false); }
+
+OF_BENCHMARK(BroadcastGeneric_Channel) { Channel(state, true); }
+
+OF_BENCHMARK(BroadcastRuns_Channel) { Channel(state, false); }
+
+OF_BENCHMARK(BroadcastGeneric_Outer) { Outer(state, true); }
+
+OF_BENCHMARK(BroadcastRuns_Outer) { Outer(state, false); }
+
+}  // namespace oneflow
@@ -0,0 +1,73 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ndarray/ndarray_apply_broadcast_binary.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+void TestBroadcastSub(const DimVector& a_dim, const DimVector& b_dim) {
+  const Shape a_shape(a_dim);
+  const Shape b_shape(b_dim);
+  DimVector y_dim(a_dim.size());
+  FOR_RANGE(size_t, i, 0, a_dim.size()) { y_dim.at(i) = std::max(a_dim.at(i), b_dim.at(i)); }
+  const Shape y_shape(y_dim);
+  std::vector<float> a(a_shape.elem_cnt());
+  std::vector<float> b(b_shape.elem_cnt());
+  FOR_RANGE(size_t, i, 0, a.size()) { a.at(i) = static_cast<float>(i); }
+  FOR_RANGE(size_t, i, 0, b.size()) { b.at(i) = static_cast<float>(i * 3 + 1); }
+  std::vector<float> y(y_shape.elem_cnt());
+  NdarrayApplyBroadcastBinary<DeviceType::kCPU, float, BinaryFuncSub>::Apply(
+      nullptr, XpuVarNdarray<float>(y_shape, y.data()),
+      XpuVarNdarray<const float>(a_shape, a.data()),
+      XpuVarNdarray<const float>(b_shape, b.data()));
+  std::vector<int64_t> index(y_dim.size(), 0);
+  FOR_RANGE(int64_t, i, 0, y_shape.elem_cnt()) {
+    int64_t a_offset = 0;
+    int64_t b_offset = 0;
+    FOR_RANGE(size_t, axis, 0, y_dim.size()) {
+      a_offset = a_offset * a_dim.at(axis) + (a_dim.at(axis) == 1 ? 0 : index.at(axis));
+      b_offset = b_offset * b_dim.at(axis) + (b_dim.at(axis) == 1 ? 0 : index.at(axis));
+    }
+    ASSERT_EQ(y.at(i), a.at(a_offset) - b.at(b_offset));
+    for (int64_t axis = y_dim.size() - 1; axis >= 0; --axis) {
+      if (++index.at(axis) < y_dim.at(axis)) { break; }
+      index.at(axis) = 0;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(CpuNdarrayApplyBroadcastBinary, matches_naive_broadcast) {
+  Global<ThreadPool>::New(4);
+  TestBroadcastSub({1, 1}, {517, 300});
+  TestBroadcastSub({517, 300}, {1, 1});
+  TestBroadcastSub({517, 300}, {1, 300});
+  TestBroadcastSub({517, 300}, {517, 1});
+  TestBroadcastSub({517, 1}, {1, 300});
+  TestBroadcastSub({3, 1, 5, 7, 1}, {3, 4, 1, 7, 2});
+  TestBroadcastSub({2, 65, 1, 33}, {1, 65, 129, 1});
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -0,0 +1,43 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_NDARRAY_CPU_NDARRAY_PARALLEL_H_
+#define ONEFLOW_CORE_NDARRAY_CPU_NDARRAY_PARALLEL_H_
+
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+const int64_t kCpuNdarrayParallelGrainElemCnt = 32 * 1024;
+
+// ndarray routines are also used outside of a session, where there is no thread pool
+inline void CpuNdarrayParallelFor(int64_t num, int64_t grain,
+                                  const std::function<void(int64_t, int64_t)>& fn) {
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (thread_pool == nullptr || num <= grain) {
+    fn(0, num);
+  } else {
+    thread_pool->ParallelFor(0, num, grain, fn);
+  }
+}
+
+inline int64_t CpuNdarrayThreadNum() {
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  return thread_pool == nullptr ? 1 : thread_pool->thread_num();
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_NDARRAY_CPU_NDARRAY_PARALLEL_H_
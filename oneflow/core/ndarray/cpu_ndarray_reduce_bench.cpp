@@ -0,0 +1,116 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ndarray/ndarray_reduce_impl.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+// Reduces x of x_dims into y of y_dims with the given pattern, or with the axis-by-axis default
+// path every CPU reduction took before the patterns matched.
+template<template<DeviceType, typename, template<typename> class> class ReduceT,
+         template<typename> class binary_func>
+void BenchmarkReduce(BenchmarkState* state, bool is_default, const DimVector& x_dims,
+                     const DimVector& y_dims) {
+  const Shape x_shape(x_dims);
+  const Shape y_shape(y_dims);
+  std::vector<float> x(x_shape.elem_cnt());
+  FOR_RANGE(size_t, i, 0, x.size()) { x[i] = static_cast<float>(i % 1000) / 1000.f; }
+  std::vector<float> y(y_shape.elem_cnt());
+  std::vector<float> tmp(x.size());
+  XpuVarNdarray<float> y_ndarray(y_shape, y.data());
+  XpuVarNdarray<const float> x_ndarray(x_shape, x.data());
+  XpuVarNdarray<float> tmp_ndarray(x_shape, tmp.data());
+  CHECK((ReduceT<DeviceType::kCPU, float, binary_func>::Matched(y_ndarray, x_ndarray)));
+  Global<ThreadPool>::New(4);
+  while (state->KeepRunning()) {
+    if (is_default) {
+      NdarrayDefaultReduce<DeviceType::kCPU, float, binary_func>::Reduce(nullptr, y_ndarray,
+                                                                        x_ndarray, tmp_ndarray);
+    } else {
+      ReduceT<DeviceType::kCPU, float, binary_func>::Reduce(nullptr, y_ndarray, x_ndarray,
+                                                            tmp_ndarray);
+    }
+    DoNotOptimize(y.data());
+  }
+  Global<ThreadPool>::Delete();
+  state->SetBytesProcessed(state->iterations() * x.size() * sizeof(float));
+}
+
+// all of 16M elements
+template<template<typename> class binary_func>
+void Scalar(BenchmarkState* state, bool is_default) {
+  BenchmarkReduce<NdarrayScalarReduce, binary_func>(state, is_default, {1 << 24}, {1});
+}
+
+// the last axis of 4096x4096, as softmax does
+template<template<typename> class binary_func>
+void Row(BenchmarkState* state, bool is_default) {
+  BenchmarkReduce<NdarrayMatrixRowReduce, binary_func>(state, is_default, {4096, 4096},
+                                                       {4096, 1});
+}
+
+// the first axis of 32768x512, as a bias gradient does
+void Col(BenchmarkState* state, bool is_default) {
+  BenchmarkReduce<NdarrayMatrixColReduce, BinaryFuncSum>(state, is_default, {32768, 512},
+                                                         {1, 512});
+}
+
+// the middle axis of 32x512x256
+void CubeY(BenchmarkState* state, bool is_default) {
+  BenchmarkReduce<NdarrayXYZCubeYReduce, BinaryFuncSum>(state, is_default, {32, 512, 256},
+                                                        {32, 1, 256});
+}
+
+// all but the channel axis of an NCHW batch 32x256x32x32, as batch norm statistics do
+void CubeXZ(BenchmarkState* state, bool is_default) {
+  BenchmarkReduce<NdarrayXYZCubeXZReduce, BinaryFuncSum>(state, is_default, {32, 256, 1024},
+                                                         {1, 256, 1});
+}
+
+}  // namespace
+
+OF_BENCHMARK(ReduceDefault_ScalarSum) { Scalar<BinaryFuncSum>(state, true); }
+
+OF_BENCHMARK(ReducePattern_ScalarSum) { Scalar<BinaryFuncSum>(state, false); }
+
+OF_BENCHMARK(ReduceDefault_ScalarMax) { Scalar<BinaryFuncMax>(state, true); }
+
+OF_BENCHMARK(ReducePattern_ScalarMax) { Scalar<BinaryFuncMax>(state, false); }
+
+OF_BENCHMARK(ReduceDefault_RowSum) { Row<BinaryFuncSum>(state, true); }
+
+OF_BENCHMARK(ReducePattern_RowSum) { Row<BinaryFuncSum>(state, false); }
+
+OF_BENCHMARK(ReduceDefault_RowMax) { Row<BinaryFuncMax>(state, true); }
+
+OF_BENCHMARK(ReducePattern_RowMax) { Row<BinaryFuncMax>(state, false); }
+
+OF_BENCHMARK(ReduceDefault_ColSum) { Col(state, true); }
+
+OF_BENCHMARK(ReducePattern_ColSum) { Col(state, false); }
+
+OF_BENCHMARK(ReduceDefault_CubeYSum) { CubeY(state, true); }
+
+OF_BENCHMARK(ReducePattern_CubeYSum) { CubeY(state, false); }
+
+OF_BENCHMARK(ReduceDefault_CubeXZSum) { CubeXZ(state, true); }
+
+OF_BENCHMARK(ReducePattern_CubeXZSum) { CubeXZ(state, false); }
+
+}  // namespace oneflow
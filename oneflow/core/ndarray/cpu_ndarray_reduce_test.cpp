@@ -0,0 +1,112 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ndarray/ndarray_reduce_impl.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+// reduces x of shape [a, b, c] into y of shape [a or 1, b or 1, c or 1] in double
+std::vector<double> NaiveReduce(const std::vector<float>& x, const std::vector<int64_t>& x_dim,
+                                const std::vector<int64_t>& y_dim, bool is_max) {
+  const int64_t y_cnt = y_dim.at(0) * y_dim.at(1) * y_dim.at(2);
+  std::vector<double> y(y_cnt, is_max ? -1e30 : 0.0);
+  FOR_RANGE(int64_t, i, 0, x_dim.at(0)) {
+    FOR_RANGE(int64_t, j, 0, x_dim.at(1)) {
+      FOR_RANGE(int64_t, k, 0, x_dim.at(2)) {
+        const double v = x.at((i * x_dim.at(1) + j) * x_dim.at(2) + k);
+        const int64_t yi = y_dim.at(0) == 1 ? 0 : i;
+        const int64_t yj = y_dim.at(1) == 1 ? 0 : j;
+        const int64_t yk = y_dim.at(2) == 1 ? 0 : k;
+        double* out = &y.at((yi * y_dim.at(1) + yj) * y_dim.at(2) + yk);
+        *out = is_max ? std::max(*out, v) : *out + v;
+      }
+    }
+  }
+  return y;
+}
+
+template<template<DeviceType, typename, template<typename> class> class ReduceT,
+         template<typename> class binary_func>
+void TestReduce(const std::vector<int64_t>& x_dim, const std::vector<int64_t>& y_dim,
+                bool tmp_aliases_x = false) {
+  const bool is_max = std::is_same<binary_func<float>, BinaryFuncMax<float>>::value;
+  const int64_t x_cnt = x_dim.at(0) * x_dim.at(1) * x_dim.at(2);
+  const int64_t y_cnt = y_dim.at(0) * y_dim.at(1) * y_dim.at(2);
+  std::vector<float> x(x_cnt);
+  FOR_RANGE(int64_t, i, 0, x_cnt) { x.at(i) = static_cast<float>((i * 7919) % 1000) / 1000.f; }
+  std::vector<float> y(y_cnt);
+  std::vector<float> tmp(x_cnt);
+  DimVector x_shape_dim;
+  DimVector y_shape_dim;
+  FOR_RANGE(int64_t, i, 0, 3) {
+    // leading axes of size 1 on both sides are dropped to reach the 2-d patterns
+    if (x_dim.at(i) == 1 && y_dim.at(i) == 1) { continue; }
+    x_shape_dim.push_back(x_dim.at(i));
+    y_shape_dim.push_back(y_dim.at(i));
+  }
+  XpuVarNdarray<float> y_ndarray(Shape(y_shape_dim), y.data());
+  XpuVarNdarray<const float> x_ndarray(Shape(x_shape_dim), x.data());
+  // NdarrayUtil::ReduceSum is called with x and tmp pointing to the same buffer
+  XpuVarNdarray<float> tmp_ndarray(Shape(x_shape_dim), tmp_aliases_x ? x.data() : tmp.data());
+  const std::vector<double> expected = NaiveReduce(x, x_dim, y_dim, is_max);
+  ASSERT_TRUE((ReduceT<DeviceType::kCPU, float, binary_func>::Matched(y_ndarray, x_ndarray)));
+  ReduceT<DeviceType::kCPU, float, binary_func>::Reduce(nullptr, y_ndarray, x_ndarray,
+                                                        tmp_ndarray);
+  FOR_RANGE(int64_t, i, 0, y_cnt) {
+    ASSERT_NEAR(y.at(i), expected.at(i), 1e-5 * std::max(1.0, std::abs(expected.at(i))));
+  }
+}
+
+}  // namespace
+
+TEST(CpuNdarrayReduce, matches_naive_reduce) {
+  Global<ThreadPool>::New(4);
+  for (int64_t n : {1LL, 7LL, 1000LL, 300007LL}) {
+    TestReduce<NdarrayScalarReduce, BinaryFuncSum>({1, 1, n}, {1, 1, 1});
+    TestReduce<NdarrayScalarReduce, BinaryFuncMax>({1, 1, n}, {1, 1, 1});
+  }
+  TestReduce<NdarrayMatrixRowReduce, BinaryFuncSum>({1, 3, 200003}, {1, 3, 1});
+  TestReduce<NdarrayMatrixRowReduce, BinaryFuncSum>({1, 1001, 37}, {1, 1001, 1});
+  TestReduce<NdarrayMatrixRowReduce, BinaryFuncMax>({1, 1001, 37}, {1, 1001, 1});
+  TestReduce<NdarrayMatrixColReduce, BinaryFuncSum>({1, 100003, 3}, {1, 1, 3});
+  TestReduce<NdarrayMatrixColReduce, BinaryFuncSum>({1, 37, 2049}, {1, 1, 2049});
+  TestReduce<NdarrayMatrixColReduce, BinaryFuncMax>({1, 513, 1031}, {1, 1, 1031});
+  TestReduce<NdarrayXYZCubeYReduce, BinaryFuncSum>({2, 3001, 17}, {2, 1, 17});
+  TestReduce<NdarrayXYZCubeYReduce, BinaryFuncSum>({9, 65, 129}, {9, 1, 129});
+  TestReduce<NdarrayXYZCubeXZReduce, BinaryFuncSum>({31, 5, 1001}, {1, 5, 1});
+  TestReduce<NdarrayXYZCubeXZReduce, BinaryFuncMax>({3, 1025, 9}, {1, 1025, 1});
+  Global<ThreadPool>::Delete();
+}
+
+TEST(CpuNdarrayReduce, tmp_storage_aliases_x) {
+  Global<ThreadPool>::New(4);
+  TestReduce<NdarrayScalarReduce, BinaryFuncSum>({1, 1, 300007}, {1, 1, 1}, true);
+  TestReduce<NdarrayMatrixRowReduce, BinaryFuncSum>({1, 3, 200003}, {1, 3, 1}, true);
+  TestReduce<NdarrayMatrixColReduce, BinaryFuncSum>({1, 100003, 3}, {1, 1, 3}, true);
+  TestReduce<NdarrayXYZCubeYReduce, BinaryFuncSum>({2, 3001, 17}, {2, 1, 17}, true);
+  TestReduce<NdarrayXYZCubeXZReduce, BinaryFuncSum>({4, 2, 2}, {1, 2, 1}, true);
+  TestReduce<NdarrayXYZCubeXZReduce, BinaryFuncSum>({31, 5, 1001}, {1, 5, 1}, true);
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -14,15 +14,104 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/ndarray/ndarray_apply_broadcast_binary_core.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
 
 namespace oneflow {
 
+namespace {
+
+// y[i] = a[i] (op) b[i] over one run, an operand that is not full holds a single value
+template<typename T, typename RetT, template<typename> class binary_func>
+void ApplyBroadcastBinaryRun(const T* a, bool a_full, const T* b, bool b_full, int64_t n,
+                             RetT* y) {
+  if (a_full && b_full) {
+    FOR_RANGE(int64_t, i, 0, n) { y[i] = binary_func<T>::Invoke(a[i], b[i]); }
+  } else if (a_full) {
+    const T b_val = *b;
+    FOR_RANGE(int64_t, i, 0, n) { y[i] = binary_func<T>::Invoke(a[i], b_val); }
+  } else if (b_full) {
+    const T a_val = *a;
+    FOR_RANGE(int64_t, i, 0, n) { y[i] = binary_func<T>::Invoke(a_val, b[i]); }
+  } else {
+    std::fill(y, y + n, binary_func<T>::Invoke(*a, *b));
+  }
+}
+
+// Shapes arrive simplified by SimplifyBroadcastShapes, adjacent axes with the same broadcast
+// pattern are merged, so y is split into runs along the last axis. Each run is a vector-vector,
+// vector-scalar or scalar-vector loop; the outer axes are walked odometer-style with the
+// broadcast axes of a and b at stride 0. A scalar operand makes the whole of y one run.
+template<typename T, template<typename> class binary_func>
+void ApplyBroadcastBinary(
+    const XpuVarNdarray<typename BinaryFuncTrait<binary_func, T>::return_type>& y,
+    const XpuVarNdarray<const T>& a, const XpuVarNdarray<const T>& b) {
+  using RetT = typename BinaryFuncTrait<binary_func, T>::return_type;
+  const int64_t elem_cnt = y.shape().ElemNum();
+  if (elem_cnt == 0) { return; }
+  const T* a_ptr = a.ptr();
+  const T* b_ptr = b.ptr();
+  RetT* y_ptr = y.ptr();
+  if (a.shape().ElemNum() == 1 || b.shape().ElemNum() == 1) {
+    const bool a_full = a.shape().ElemNum() != 1;
+    const bool b_full = b.shape().ElemNum() != 1;
+    CpuNdarrayParallelFor(elem_cnt, kCpuNdarrayParallelGrainElemCnt,
+                          [&](int64_t begin, int64_t end) {
+                            ApplyBroadcastBinaryRun<T, RetT, binary_func>(
+                                a_ptr + (a_full ? begin : 0), a_full, b_ptr + (b_full ? begin : 0),
+                                b_full, end - begin, y_ptr + begin);
+                          });
+    return;
+  }
+  const int64_t num_axes = y.shape().NumAxes();
+  const int64_t inner = y.shape().At(num_axes - 1);
+  const bool a_full = a.shape().At(num_axes - 1) != 1 || inner == 1;
+  const bool b_full = b.shape().At(num_axes - 1) != 1 || inner == 1;
+  std::vector<int64_t> a_strides(num_axes);
+  std::vector<int64_t> b_strides(num_axes);
+  int64_t a_stride = 1;
+  int64_t b_stride = 1;
+  for (int64_t i = num_axes - 1; i >= 0; --i) {
+    a_strides[i] = a.shape().At(i) == 1 ? 0 : a_stride;
+    b_strides[i] = b.shape().At(i) == 1 ? 0 : b_stride;
+    a_stride *= a.shape().At(i);
+    b_stride *= b.shape().At(i);
+  }
+  const int64_t grain = std::max<int64_t>(1, kCpuNdarrayParallelGrainElemCnt / inner);
+  CpuNdarrayParallelFor(elem_cnt / inner, grain, [&](int64_t begin, int64_t end) {
+    std::vector<int64_t> index(num_axes, 0);
+    int64_t a_offset = 0;
+    int64_t b_offset = 0;
+    int64_t remaining = begin;
+    for (int64_t i = num_axes - 2; i >= 0; --i) {
+      index[i] = remaining % y.shape().At(i);
+      remaining /= y.shape().At(i);
+      a_offset += index[i] * a_strides[i];
+      b_offset += index[i] * b_strides[i];
+    }
+    FOR_RANGE(int64_t, row, begin, end) {
+      ApplyBroadcastBinaryRun<T, RetT, binary_func>(a_ptr + a_offset, a_full, b_ptr + b_offset,
+                                                    b_full, inner, y_ptr + row * inner);
+      for (int64_t i = num_axes - 2; i >= 0; --i) {
+        ++index[i];
+        a_offset += a_strides[i];
+        b_offset += b_strides[i];
+        if (index[i] < y.shape().At(i)) { break; }
+        a_offset -= a_strides[i] * index[i];
+        b_offset -= b_strides[i] * index[i];
+        index[i] = 0;
+      }
+    }
+  });
+}
+
+}  // namespace
+
 template<typename T, int NDIMS, template<typename> class binary_func>
 struct NdarrayApplyBroadcastBinaryCoreWrapper<DeviceType::kCPU, T, NDIMS, binary_func> final {
   static void Apply(DeviceCtx* ctx,
                     const XpuVarNdarray<typename BinaryFuncTrait<binary_func, T>::return_type>& y,
                     const XpuVarNdarray<const T>& a, const XpuVarNdarray<const T>& b) {
-    NdarrayApplyBroadcastBinaryCore<T, NDIMS, binary_func>::Apply(y, a, b);
+    ApplyBroadcastBinary<T, binary_func>(y, a, b);
   }
 };
 
@@ -31,7 +120,7 @@ struct NdarrayApplyBroadcastInplaceBinaryCoreWrapper<DeviceType::kCPU, T, NDIMS,
     final {
   static void InplaceApply(DeviceCtx* ctx, const XpuVarNdarray<T>& y,
                            const XpuVarNdarray<const T>& x) {
-    NdarrayApplyBroadcastBinaryCore<T, NDIMS, binary_func>::InplaceApply(y, x);
+    ApplyBroadcastBinary<T, binary_func>(y, XpuVarNdarray<const T>(y.shape(), y.ptr()), x);
   }
 };
 
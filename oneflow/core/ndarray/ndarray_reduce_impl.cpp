@@ -17,26 +17,229 @@ limitations under the License.
 #include "oneflow/core/common/preprocessor.h"
 #include "oneflow/core/ndarray/ndarray_reduce_impl.h"
 #include "oneflow/core/ndarray/binary_func.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
 
 namespace oneflow {
 
-#define SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(struct_name)                                            \
-  template<typename T, template<typename> class binary_func>                                       \
-  struct struct_name<DeviceType::kCPU, T, binary_func> final {                                     \
-    static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {              \
-      return false;                                                                                \
-    }                                                                                              \
-    static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x, \
-                       const XpuVarNdarray<T>& tmp_storage) {                                      \
-      UNIMPLEMENTED();                                                                             \
-    }                                                                                              \
-  }
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayScalarReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixRowReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixColReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayXYZCubeYReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayXYZCubeXZReduce);
-#undef SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL
+namespace {
+
+const int64_t kReduceLaneNum = 8;
+// runs up to this length are reduced with independent lanes, longer runs are split in halves
+// and combined pairwise, which keeps the rounding error of float sums at O(log(n))
+const int64_t kReduceBlockElemCnt = 1024;
+const int64_t kColReduceBlockSize = 512;
+
+template<typename T, template<typename> class binary_func>
+T ReduceContiguous(const T* x, int64_t n) {
+  if (n > kReduceBlockElemCnt) {
+    const int64_t half = static_cast<int64_t>(RoundUp(n / 2, kReduceBlockElemCnt));
+    return binary_func<T>::Invoke(ReduceContiguous<T, binary_func>(x, half),
+                                  ReduceContiguous<T, binary_func>(x + half, n - half));
+  }
+  T lanes[kReduceLaneNum];
+  FOR_RANGE(int64_t, k, 0, kReduceLaneNum) { lanes[k] = UnitOfBinaryFunc<T, binary_func>::Val(); }
+  const int64_t body = n / kReduceLaneNum * kReduceLaneNum;
+  for (int64_t i = 0; i < body; i += kReduceLaneNum) {
+    FOR_RANGE(int64_t, k, 0, kReduceLaneNum) {
+      lanes[k] = binary_func<T>::Invoke(lanes[k], x[i + k]);
+    }
+  }
+  FOR_RANGE(int64_t, i, body, n) {
+    lanes[i - body] = binary_func<T>::Invoke(lanes[i - body], x[i]);
+  }
+  FOR_RANGE(int64_t, k, 1, kReduceLaneNum) {
+    lanes[0] = binary_func<T>::Invoke(lanes[0], lanes[k]);
+  }
+  return lanes[0];
+}
+
+// splits x into one chunk per thread, the partial results are kept locally since callers may
+// pass x itself as tmp storage
+template<typename T, template<typename> class binary_func>
+T ParallelReduceContiguous(const T* x, int64_t elem_cnt) {
+  const int64_t chunk_num = std::min(
+      CpuNdarrayThreadNum(), std::max<int64_t>(1, elem_cnt / kCpuNdarrayParallelGrainElemCnt));
+  if (chunk_num == 1) { return ReduceContiguous<T, binary_func>(x, elem_cnt); }
+  const int64_t chunk_size = static_cast<int64_t>(
+      RoundUp((elem_cnt + chunk_num - 1) / chunk_num, kReduceBlockElemCnt));
+  std::vector<T> partial(chunk_num);
+  CpuNdarrayParallelFor(chunk_num, 1, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      const int64_t offset = std::min(i * chunk_size, elem_cnt);
+      const int64_t size = std::min(chunk_size, elem_cnt - offset);
+      partial[i] = ReduceContiguous<T, binary_func>(x + offset, size);
+    }
+  });
+  return ReduceContiguous<T, binary_func>(partial.data(), chunk_num);
+}
+
+// y[c] = reduce(x[r * ld + c] for r in [0, rows)) for c in [0, cols), rows are combined pairwise
+template<typename T, template<typename> class binary_func>
+void ColReduceSerial(const T* x, int64_t ld, int64_t rows, int64_t cols, T* y) {
+  if (rows * cols > kReduceBlockElemCnt && rows > 1) {
+    const int64_t half = rows / 2;
+    std::vector<T> upper(cols);
+    ColReduceSerial<T, binary_func>(x, ld, half, cols, upper.data());
+    ColReduceSerial<T, binary_func>(x + half * ld, ld, rows - half, cols, y);
+    FOR_RANGE(int64_t, c, 0, cols) { y[c] = binary_func<T>::Invoke(upper[c], y[c]); }
+    return;
+  }
+  FOR_RANGE(int64_t, c, 0, cols) { y[c] = UnitOfBinaryFunc<T, binary_func>::Val(); }
+  FOR_RANGE(int64_t, r, 0, rows) {
+    const T* row = x + r * ld;
+    FOR_RANGE(int64_t, c, 0, cols) { y[c] = binary_func<T>::Invoke(y[c], row[c]); }
+  }
+}
+
+// splits columns into blocks and, when there are too few blocks to occupy the pool, rows into
+// chunks whose partial results are combined afterwards
+template<typename T, template<typename> class binary_func>
+void ColReduce(const T* x, int64_t rows, int64_t cols, T* y) {
+  const int64_t col_block_num = (cols + kColReduceBlockSize - 1) / kColReduceBlockSize;
+  const int64_t max_chunk_num =
+      std::min(rows, std::max<int64_t>(1, rows * cols / kCpuNdarrayParallelGrainElemCnt));
+  const int64_t row_chunk_num =
+      std::min(std::max<int64_t>(1, CpuNdarrayThreadNum() / col_block_num), max_chunk_num);
+  const int64_t rows_per_chunk = (rows + row_chunk_num - 1) / row_chunk_num;
+  std::vector<T> partial_buf(row_chunk_num == 1 ? 0 : row_chunk_num * cols);
+  T* partial = row_chunk_num == 1 ? y : partial_buf.data();
+  const int64_t grain =
+      std::max<int64_t>(1, kCpuNdarrayParallelGrainElemCnt
+                               / (rows_per_chunk * std::min(cols, kColReduceBlockSize)));
+  CpuNdarrayParallelFor(row_chunk_num * col_block_num, grain, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      const int64_t chunk = i / col_block_num;
+      const int64_t col_begin = i % col_block_num * kColReduceBlockSize;
+      const int64_t col_end = std::min(col_begin + kColReduceBlockSize, cols);
+      const int64_t row_begin = chunk * rows_per_chunk;
+      const int64_t row_end = std::min(row_begin + rows_per_chunk, rows);
+      ColReduceSerial<T, binary_func>(x + row_begin * cols + col_begin, cols,
+                                      std::max<int64_t>(row_end - row_begin, 0),
+                                      col_end - col_begin, partial + chunk * cols + col_begin);
+    }
+  });
+  if (row_chunk_num > 1) { ColReduceSerial<T, binary_func>(partial, cols, row_chunk_num, cols, y); }
+}
+
+}  // namespace
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayScalarReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    return y.shape().ElemNum() == 1;
+  }
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    *y.ptr() = ParallelReduceContiguous<T, binary_func>(x.ptr(), x.shape().ElemNum());
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixRowReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (y.shape().ElemNum() == 1) { return false; }
+    return x.shape().NumAxes() == 2 && y.shape().NumAxes() == 2
+           && x.shape().At(0) == y.shape().At(0) && y.shape().At(1) == 1;
+  }
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    const int64_t rows = x.shape().At(0);
+    const int64_t cols = x.shape().At(1);
+    const T* x_ptr = x.ptr();
+    T* y_ptr = y.ptr();
+    if (rows < CpuNdarrayThreadNum() && cols >= kCpuNdarrayParallelGrainElemCnt) {
+      // too few rows to keep the pool busy, split every row instead
+      FOR_RANGE(int64_t, i, 0, rows) {
+        y_ptr[i] = ParallelReduceContiguous<T, binary_func>(x_ptr + i * cols, cols);
+      }
+      return;
+    }
+    const int64_t grain = std::max<int64_t>(1, kCpuNdarrayParallelGrainElemCnt / cols);
+    CpuNdarrayParallelFor(rows, grain, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        y_ptr[i] = ReduceContiguous<T, binary_func>(x_ptr + i * cols, cols);
+      }
+    });
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixColReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (y.shape().ElemNum() == 1) { return false; }
+    return x.shape().NumAxes() == 2 && y.shape().NumAxes() == 2 && y.shape().At(0) == 1
+           && x.shape().At(1) == y.shape().At(1);
+  }
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    ColReduce<T, binary_func>(x.ptr(), x.shape().At(0), x.shape().At(1), y.ptr());
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayXYZCubeYReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (y.shape().ElemNum() == 1) { return false; }
+    return x.shape().NumAxes() == 3 && y.shape().NumAxes() == 3
+           && x.shape().At(0) == y.shape().At(0) && y.shape().At(1) == 1
+           && x.shape().At(2) == y.shape().At(2);
+  }
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    const int64_t num_x = x.shape().At(0);
+    const int64_t num_y = x.shape().At(1);
+    const int64_t num_z = x.shape().At(2);
+    const T* x_ptr = x.ptr();
+    T* y_ptr = y.ptr();
+    if (num_x < CpuNdarrayThreadNum()) {
+      FOR_RANGE(int64_t, i, 0, num_x) {
+        ColReduce<T, binary_func>(x_ptr + i * num_y * num_z, num_y, num_z, y_ptr + i * num_z);
+      }
+      return;
+    }
+    const int64_t grain =
+        std::max<int64_t>(1, kCpuNdarrayParallelGrainElemCnt / (num_y * num_z));
+    CpuNdarrayParallelFor(num_x, grain, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        ColReduceSerial<T, binary_func>(x_ptr + i * num_y * num_z, num_z, num_y, num_z,
+                                        y_ptr + i * num_z);
+      }
+    });
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayXYZCubeXZReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (y.shape().ElemNum() == 1) { return false; }
+    return x.shape().NumAxes() == 3 && y.shape().NumAxes() == 3 && y.shape().At(0) == 1
+           && x.shape().At(1) == y.shape().At(1) && y.shape().At(2) == 1;
+  }
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    const int64_t num_x = x.shape().At(0);
+    const int64_t num_y = x.shape().At(1);
+    const int64_t num_z = x.shape().At(2);
+    const T* x_ptr = x.ptr();
+    T* y_ptr = y.ptr();
+    // partial[j * num_x + i] holds the reduction of the z-run at (i, j)
+    std::vector<T> partial(num_x * num_y);
+    const int64_t grain = std::max<int64_t>(1, kCpuNdarrayParallelGrainElemCnt / num_z);
+    CpuNdarrayParallelFor(num_x * num_y, grain, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, k, begin, end) {
+        const int64_t j = k / num_x;
+        const int64_t i = k % num_x;
+        partial[k] = ReduceContiguous<T, binary_func>(x_ptr + (i * num_y + j) * num_z, num_z);
+      }
+    });
+    const int64_t y_grain = std::max<int64_t>(1, kCpuNdarrayParallelGrainElemCnt / num_x);
+    CpuNdarrayParallelFor(num_y, y_grain, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, j, begin, end) {
+        y_ptr[j] = ReduceContiguous<T, binary_func>(partial.data() + j * num_x, num_x);
+      }
+    });
+  }
+};
 
 #define INSTANTIATE_NDARRAY_REDUCE_IMPL(dtype, binary_func)                                       \
   template struct NdarrayScalarReduce<DeviceType::kCPU, OF_PP_PAIR_FIRST(dtype), binary_func>;    \
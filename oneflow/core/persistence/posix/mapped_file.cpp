@@ -0,0 +1,64 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/posix/mapped_file.h"
+
+#ifdef PLATFORM_POSIX
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace fs {
+
+MappedFile::MappedFile(const std::string& fname) : fname_(fname), data_(nullptr), size_(0) {
+  const int fd = open(fname.c_str(), O_RDONLY);
+  PCHECK(fd >= 0) << "Fail to open file " << fname;
+  struct stat st;
+  PCHECK(fstat(fd, &st) == 0) << "Fail to stat file " << fname;
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ > 0) {
+    void* ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    PCHECK(ptr != MAP_FAILED) << "Fail to mmap file " << fname;
+    data_ = static_cast<const char*>(ptr);
+    PCHECK(madvise(ptr, size_, MADV_SEQUENTIAL) == 0);
+  }
+  PCHECK(close(fd) == 0);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) { PCHECK(munmap(const_cast<char*>(data_), size_) == 0); }
+}
+
+void MappedFile::WillNeed(size_t offset, size_t n) const {
+  if (offset >= size_) { return; }
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t begin = offset / page_size * page_size;
+  const size_t end = std::min(offset + n, size_);
+  PCHECK(madvise(const_cast<char*>(data_) + begin, end - begin, MADV_WILLNEED) == 0);
+}
+
+void MappedFile::AdviseRandomAccess() const {
+  if (data_ != nullptr) { PCHECK(madvise(const_cast<char*>(data_), size_, MADV_RANDOM) == 0); }
+}
+
+}  // namespace fs
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
@@ -0,0 +1,56 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_POSIX_MAPPED_FILE_H_
+#define ONEFLOW_CORE_PERSISTENCE_POSIX_MAPPED_FILE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/platform.h"
+
+#ifdef PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace fs {
+
+// A whole local file mapped read only, writing to the mapping faults.
+class MappedFile final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MappedFile);
+  explicit MappedFile(const std::string& fname);
+  ~MappedFile();
+
+  const std::string& fname() const { return fname_; }
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // asks the kernel to read [offset, offset + n) ahead
+  void WillNeed(size_t offset, size_t n) const;
+  // turns off the sequential readahead set up at open
+  void AdviseRandomAccess() const;
+
+ private:
+  std::string fname_;
+  const char* data_;
+  size_t size_;
+};
+
+}  // namespace fs
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_POSIX_MAPPED_FILE_H_
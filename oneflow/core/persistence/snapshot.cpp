@@ -17,6 +17,8 @@ limitations under the License.
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/persistence/persistent_in_stream.h"
 #include "oneflow/core/persistence/persistent_out_stream.h"
+#include "oneflow/core/persistence/snapshot_write_engine.h"
+#include "oneflow/core/job/job_set.pb.h"
 #include "oneflow/core/register/tensor_slice_copier.h"
 #include "oneflow/core/device/cpu_device_context.h"
 
@@ -28,10 +30,71 @@ std::string GenDataFilePath(const std::string& root, const std::string& key) {
   return JoinPath(root, key);
 }
 
+// runs not shorter than this are read straight into dst, shorter ones through a window buffer
+const int64_t kDirectReadMinByte = 64 * 1024;
+const int64_t kReadWindowByte = 16 * 1024 * 1024;
+
+// Reads a slice whose rows are not contiguous in the file. The slice is a set of equally sized
+// runs, one per index of the axes before the innermost partially covered axis. Only the byte
+// ranges the runs span are read.
+void ReadStridedSlice(const fs::RandomAccessFile& file, const Shape& logical_blob_shape,
+                      const TensorSliceView& slice, int64_t elem_size, char* dst) {
+  const int64_t num_axes = slice.shape().NumAxes();
+  int64_t split_axis = num_axes - 1;
+  while (split_axis >= 0
+         && slice.At(split_axis).size() == logical_blob_shape.At(split_axis)) {
+    split_axis -= 1;
+  }
+  CHECK_GE(split_axis, 0);
+  const int64_t run_size =
+      slice.At(split_axis).size() * logical_blob_shape.Count(split_axis + 1) * elem_size;
+  const int64_t run_num = slice.shape().Count(0, split_axis);
+  // file offsets of the runs increase with the run index
+  std::vector<int64_t> run_offsets(run_num);
+  FOR_RANGE(int64_t, i, 0, run_num) {
+    int64_t remainder = i;
+    int64_t offset = slice.At(split_axis).begin() * logical_blob_shape.Count(split_axis + 1);
+    for (int64_t axis = split_axis - 1; axis >= 0; --axis) {
+      const int64_t idx = remainder % slice.At(axis).size();
+      remainder /= slice.At(axis).size();
+      offset += (slice.At(axis).begin() + idx) * logical_blob_shape.Count(axis + 1);
+    }
+    run_offsets.at(i) = offset * elem_size;
+  }
+  if (run_size >= kDirectReadMinByte) {
+    FOR_RANGE(int64_t, i, 0, run_num) {
+      file.Read(run_offsets.at(i), run_size, dst + i * run_size);
+    }
+    return;
+  }
+  std::vector<char> window(std::max(kReadWindowByte, run_size));
+  int64_t i = 0;
+  while (i < run_num) {
+    const int64_t window_begin = run_offsets.at(i);
+    int64_t j = i + 1;
+    while (j < run_num
+           && run_offsets.at(j) + run_size - window_begin <= static_cast<int64_t>(window.size())) {
+      j += 1;
+    }
+    file.Read(window_begin, run_offsets.at(j - 1) + run_size - window_begin, window.data());
+    FOR_RANGE(int64_t, k, i, j) {
+      std::memcpy(dst + k * run_size, window.data() + run_offsets.at(k) - window_begin, run_size);
+    }
+    i = j;
+  }
+}
+
+// null outside of a session, files are written synchronously then
+SnapshotWriteEngine* GetSnapshotWriteEngine() { return Global<SnapshotWriteEngine>::Get(); }
+
 }  // namespace
 
 SnapshotReader::SnapshotReader(const std::string& snapshot_root_path)
-    : root_path_(snapshot_root_path) {}
+    : root_path_(snapshot_root_path) {
+  // the snapshot may still be being written by this process
+  SnapshotWriteEngine* engine = GetSnapshotWriteEngine();
+  if (engine != nullptr) { engine->WaitUntilDone(snapshot_root_path); }
+}
 
 bool SnapshotReader::HasKey(const std::string& key) const {
   const std::string path = GenDataFilePath(root_path_, key);
@@ -58,13 +121,9 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
         slice.At(0).begin() * slice.shape().Count(1) * GetSizeOfDataType(data_type));
     in_stream.ReadFully(dst, slice.shape().elem_cnt() * GetSizeOfDataType(data_type));
   } else {
-    std::vector<char> buffer(logical_blob_size);
-    PersistentInStream in_stream(SnapshotFS(), path);
-    in_stream.ReadFully(buffer.data(), logical_blob_size);
-    TensorSliceCopier copier(slice, logical_blob_slice, data_type);
-    CpuDeviceCtx device_ctx;
-    std::unique_ptr<MemoryCopier> host_memory_copier(NewDefaultMemoryCopier(DeviceType::kCPU));
-    copier.Copy(&device_ctx, *host_memory_copier, dst, buffer.data());
+    std::unique_ptr<fs::RandomAccessFile> file;
+    SnapshotFS()->NewRandomAccessFile(path, &file);
+    ReadStridedSlice(*file, logical_blob_shape, slice, GetSizeOfDataType(data_type), dst);
   }
 }
 
@@ -90,21 +149,57 @@ SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path)
   });
 }
 
-void SnapshotWriter::Write(const std::string& key, const char* data, size_t size) {
+std::string SnapshotWriter::CreateDataFilePath(const std::string& key) const {
   const std::string path = GenDataFilePath(root_path_, key);
   const std::string dir_path = Dirname(path);
   SnapshotFS()->CreateDirIfNotExist(dir_path);
   CHECK(!SnapshotFS()->FileExists(path));
-  PersistentOutStream out_stream(SnapshotFS(), path);
-  out_stream.Write(data, size);
+  return path;
+}
+
+void SnapshotWriter::Write(const std::string& key, const char* data, size_t size) {
+  const std::string path = CreateDataFilePath(key);
+  SnapshotWriteEngine* engine = GetSnapshotWriteEngine();
+  if (engine != nullptr) {
+    engine->Write(root_path_, path, data, size);
+    file_paths_.push_back(path);
+  } else {
+    PersistentOutStream out_stream(SnapshotFS(), path);
+    out_stream.Write(data, size);
+  }
 }
 
 void SnapshotWriter::Write(const std::string& key, const Blob* blob) {
   Write(key, blob->dptr<char>(), blob->ByteSizeOfBlobBody());
 }
 
+void SnapshotWriter::Write(const std::string& key, std::vector<char>&& data, size_t size) {
+  SnapshotWriteEngine* engine = GetSnapshotWriteEngine();
+  if (engine == nullptr) { return Write(key, data.data(), size); }
+  const std::string path = CreateDataFilePath(key);
+  engine->Write(root_path_, path, std::move(data), size);
+  file_paths_.push_back(path);
+}
+
+void SnapshotWriter::Flush() {
+  SnapshotWriteEngine* engine = GetSnapshotWriteEngine();
+  if (engine != nullptr) { engine->WaitUntilDone(file_paths_); }
+}
+
 void SnapshotWriter::Close() {
-  PersistentOutStream out_stream(SnapshotFS(), JoinPath(root_path_, "snapshot_done"));
+  const std::string done_path = JoinPath(root_path_, "snapshot_done");
+  SnapshotWriteEngine* engine = GetSnapshotWriteEngine();
+  if (engine != nullptr && Global<const IOConf>::Get()->enable_async_snapshot_save()) {
+    // snapshot_done is created once all files are written, the caller goes on with training
+    engine->Finish(root_path_, [done_path]() {
+      std::unique_ptr<fs::WritableFile> file;
+      SnapshotFS()->NewWritableFile(done_path, &file);
+      file->Close();
+    });
+  } else {
+    if (engine != nullptr) { engine->WaitUntilDone(root_path_); }
+    PersistentOutStream out_stream(SnapshotFS(), done_path);
+  }
 }
 
 }  // namespace oneflow
@@ -52,10 +52,17 @@ class SnapshotWriter final {
 
   void Write(const std::string& key, const char* data, size_t size);
   void Write(const std::string& key, const Blob* blob);
+  // takes over data, whose first size bytes are written
+  void Write(const std::string& key, std::vector<char>&& data, size_t size);
+  // blocks until every file written by this writer is on the file system
+  void Flush();
   void Close();
 
  private:
+  std::string CreateDataFilePath(const std::string& key) const;
+
   const std::string root_path_;
+  std::vector<std::string> file_paths_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,140 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/job/job_set.pb.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/persistence/snapshot_write_engine.h"
+
+namespace oneflow {
+
+namespace {
+
+const int64_t kVariableNum = 16;
+const size_t kVariableSize = 4 << 20;
+
+// a local snapshot fs and a scratch directory, both removed when it goes out of scope
+class SnapshotBenchDir final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SnapshotBenchDir);
+  SnapshotBenchDir() {
+    IOConf io_conf;
+    io_conf.mutable_data_fs_conf()->mutable_localfs_conf();
+    io_conf.mutable_snapshot_fs_conf()->mutable_localfs_conf();
+    Global<const IOConf>::New(io_conf);
+    std::string current_dir = GetCwd();
+    StringReplace(&current_dir, '\\', '/');
+    root_path_ = JoinPath(current_dir, "tmp_snapshot_bench");
+    SnapshotFS()->RecursivelyCreateDirIfNotExist(root_path_);
+  }
+  ~SnapshotBenchDir() {
+    SnapshotFS()->RecursivelyDeleteDir(root_path_);
+    Global<const IOConf>::Delete();
+  }
+
+  const std::string& root_path() const { return root_path_; }
+
+ private:
+  std::string root_path_;
+};
+
+// what a writer thread of the engine does for each file
+void WriteFile(const std::string& path, const std::vector<char>& data) {
+  std::unique_ptr<fs::WritableFile> file;
+  SnapshotFS()->NewWritableFile(path, &file);
+  file->Append(data.data(), data.size());
+  file->Close();
+}
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Saves kVariableNum variables per iteration. Without the engine every file is written before
+// the save returns. With it the variables are copied into staging buffers and written on the
+// writer threads, the label reports how long the save blocks the caller.
+void BenchmarkSnapshotSave(BenchmarkState* state, int32_t writer_thread_num) {
+  SnapshotBenchDir dir;
+  std::vector<char> variable(kVariableSize, 1);
+  std::unique_ptr<SnapshotWriteEngine> engine;
+  if (writer_thread_num > 0) {
+    engine.reset(new SnapshotWriteEngine(writer_thread_num, kVariableNum * kVariableSize));
+  }
+  int64_t blocked_ns = 0;
+  while (state->KeepRunning()) {
+    const int64_t start_ns = NowNs();
+    FOR_RANGE(int64_t, i, 0, kVariableNum) {
+      const std::string path = JoinPath(dir.root_path(), std::to_string(i));
+      if (engine) {
+        engine->Write(dir.root_path(), path, variable.data(), variable.size());
+      } else {
+        WriteFile(path, variable);
+      }
+    }
+    blocked_ns += NowNs() - start_ns;
+    if (engine) { engine->WaitUntilDone(dir.root_path()); }
+  }
+  state->SetBytesProcessed(state->iterations() * kVariableNum * kVariableSize);
+  state->SetLabel("save blocks " + std::to_string(blocked_ns / 1000 / state->iterations())
+                  + " us");
+}
+
+// Loads a slice of a [4096, 4096] float variable, or of a [64, 4096, 64] one for slices of
+// the middle axis. Slices that split the last axis are not contiguous in the file.
+void BenchmarkSnapshotLoadSlice(BenchmarkState* state, const Shape& logical_shape,
+                                const TensorSliceView& slice) {
+  SnapshotBenchDir dir;
+  std::vector<char> variable(logical_shape.elem_cnt() * sizeof(float), 1);
+  WriteFile(JoinPath(dir.root_path(), "variable"), variable);
+  std::vector<char> dst(slice.shape().elem_cnt() * sizeof(float));
+  SnapshotReader reader(dir.root_path());
+  while (state->KeepRunning()) {
+    reader.Read("variable", logical_shape, DataType::kFloat, slice, dst.data());
+    DoNotOptimize(dst.data());
+  }
+  state->SetBytesProcessed(state->iterations() * dst.size());
+}
+
+}  // namespace
+
+OF_BENCHMARK(SnapshotSaveSync) { BenchmarkSnapshotSave(state, 0); }
+
+OF_BENCHMARK(SnapshotSaveEngine_1Thread) { BenchmarkSnapshotSave(state, 1); }
+
+OF_BENCHMARK(SnapshotSaveEngine_4Threads) { BenchmarkSnapshotSave(state, 4); }
+
+OF_BENCHMARK(SnapshotLoadRows) {
+  BenchmarkSnapshotLoadSlice(state, Shape({4096, 4096}), TensorSliceView({{0, 2048}, {0, 4096}}));
+}
+
+OF_BENCHMARK(SnapshotLoadHalfColumns) {
+  BenchmarkSnapshotLoadSlice(state, Shape({4096, 4096}), TensorSliceView({{0, 4096}, {0, 2048}}));
+}
+
+OF_BENCHMARK(SnapshotLoadNarrowColumns) {
+  BenchmarkSnapshotLoadSlice(state, Shape({4096, 4096}), TensorSliceView({{0, 4096}, {0, 256}}));
+}
+
+OF_BENCHMARK(SnapshotLoadMiddleAxis) {
+  BenchmarkSnapshotLoadSlice(state, Shape({64, 4096, 64}),
+                             TensorSliceView({{0, 64}, {0, 1024}, {0, 64}}));
+}
+
+}  // namespace oneflow
@@ -0,0 +1,128 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/snapshot_write_engine.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+SnapshotWriteEngine::SnapshotWriteEngine(int32_t thread_num, size_t max_staging_bytes)
+    : max_staging_bytes_(max_staging_bytes),
+      staging_bytes_(0),
+      thread_pool_(new ThreadPool(thread_num)) {}
+
+SnapshotWriteEngine::~SnapshotWriteEngine() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return root_path2pending_write_num_.empty(); });
+  }
+  thread_pool_.reset();
+}
+
+void SnapshotWriteEngine::Write(const std::string& root_path, const std::string& file_path,
+                                const char* data, size_t size) {
+  AcquireStaging(root_path, file_path, size);
+  std::shared_ptr<char> staging(new char[size], std::default_delete<char[]>());
+  std::memcpy(staging.get(), data, size);
+  AddWriteWork(root_path, file_path, staging, size);
+}
+
+void SnapshotWriteEngine::Write(const std::string& root_path, const std::string& file_path,
+                                std::vector<char>&& data, size_t size) {
+  CHECK_LE(size, data.size());
+  AcquireStaging(root_path, file_path, size);
+  std::shared_ptr<std::vector<char>> owned(new std::vector<char>(std::move(data)));
+  AddWriteWork(root_path, file_path, std::shared_ptr<const char>(owned, owned->data()), size);
+}
+
+void SnapshotWriteEngine::WaitUntilDone(const std::string& root_path) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [&]() { return root_path2pending_write_num_.count(root_path) == 0; });
+}
+
+void SnapshotWriteEngine::WaitUntilDone(const std::vector<std::string>& file_paths) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (const std::string& file_path : file_paths) {
+    cond_.wait(lock, [&]() { return pending_file_paths_.count(file_path) == 0; });
+  }
+}
+
+void SnapshotWriteEngine::Finish(const std::string& root_path,
+                                 const std::function<void()>& Done) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (root_path2pending_write_num_.count(root_path) > 0) {
+      root_path2done_callbacks_[root_path].push_back(Done);
+      return;
+    }
+  }
+  Done();
+}
+
+void SnapshotWriteEngine::AcquireStaging(const std::string& root_path,
+                                         const std::string& file_path, size_t size) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // a write larger than the limit is let through alone
+  cond_.wait(lock, [&]() {
+    return staging_bytes_ == 0 || staging_bytes_ + size <= max_staging_bytes_;
+  });
+  staging_bytes_ += size;
+  root_path2pending_write_num_[root_path] += 1;
+  CHECK(pending_file_paths_.insert(file_path).second);
+}
+
+void SnapshotWriteEngine::AddWriteWork(const std::string& root_path, const std::string& file_path,
+                                       const std::shared_ptr<const char>& data, size_t size) {
+  thread_pool_->AddWork([this, root_path, file_path, data, size]() {
+    // the parent directory has been created by the caller
+    std::unique_ptr<fs::WritableFile> file;
+    SnapshotFS()->NewWritableFile(file_path, &file);
+    file->Append(data.get(), size);
+    file->Close();
+    OnWriteDone(root_path, file_path, size);
+  });
+}
+
+void SnapshotWriteEngine::OnWriteDone(const std::string& root_path, const std::string& file_path,
+                                      size_t size) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  staging_bytes_ -= size;
+  pending_file_paths_.erase(file_path);
+  while (true) {
+    auto it = root_path2pending_write_num_.find(root_path);
+    CHECK(it != root_path2pending_write_num_.end());
+    // a write issued while the callbacks ran runs the ones queued after it once it is done
+    if (it->second > 1) {
+      it->second -= 1;
+      break;
+    }
+    auto callback_it = root_path2done_callbacks_.find(root_path);
+    if (callback_it == root_path2done_callbacks_.end()) {
+      root_path2pending_write_num_.erase(it);
+      break;
+    }
+    std::vector<std::function<void()>> done_callbacks;
+    done_callbacks.swap(callback_it->second);
+    root_path2done_callbacks_.erase(callback_it);
+    // the last write of a root keeps it pending until the callbacks have run, so that waiters
+    // see the snapshot complete, Finish() calls meanwhile are queued and run on the next round
+    lock.unlock();
+    for (const auto& Done : done_callbacks) { Done(); }
+    lock.lock();
+  }
+  cond_.notify_all();
+}
+
+}  // namespace oneflow
@@ -0,0 +1,63 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_SNAPSHOT_WRITE_ENGINE_H_
+#define ONEFLOW_CORE_PERSISTENCE_SNAPSHOT_WRITE_ENGINE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+// Writes snapshot files on a pool of writer threads. Write() copies the data into a staging
+// buffer, or takes over a buffer the caller no longer needs, and returns. Staging memory is
+// bounded, Write() blocks while the pending bytes would exceed the limit. Writes are tracked per
+// snapshot root so that a snapshot can be waited for, or finished in the background.
+class SnapshotWriteEngine final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SnapshotWriteEngine);
+  SnapshotWriteEngine(int32_t thread_num, size_t max_staging_bytes);
+  ~SnapshotWriteEngine();
+
+  void Write(const std::string& root_path, const std::string& file_path, const char* data,
+             size_t size);
+  // writes the first size bytes of data
+  void Write(const std::string& root_path, const std::string& file_path, std::vector<char>&& data,
+             size_t size);
+  void WaitUntilDone(const std::string& root_path);
+  // waits for the writes of the given files only
+  void WaitUntilDone(const std::vector<std::string>& file_paths);
+  // Done is called once every write to root_path issued so far has finished
+  void Finish(const std::string& root_path, const std::function<void()>& Done);
+
+ private:
+  void AcquireStaging(const std::string& root_path, const std::string& file_path, size_t size);
+  void AddWriteWork(const std::string& root_path, const std::string& file_path,
+                    const std::shared_ptr<const char>& data, size_t size);
+  void OnWriteDone(const std::string& root_path, const std::string& file_path, size_t size);
+
+  size_t max_staging_bytes_;
+  size_t staging_bytes_;
+  HashMap<std::string, int64_t> root_path2pending_write_num_;
+  HashSet<std::string> pending_file_paths_;
+  HashMap<std::string, std::vector<std::function<void()>>> root_path2done_callbacks_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_SNAPSHOT_WRITE_ENGINE_H_
@@ -0,0 +1,127 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/job/job_set.pb.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/snapshot_write_engine.h"
+
+namespace oneflow {
+
+namespace {
+
+std::string ReadFile(const std::string& file_path) {
+  const uint64_t size = SnapshotFS()->GetFileSize(file_path);
+  std::unique_ptr<fs::RandomAccessFile> file;
+  SnapshotFS()->NewRandomAccessFile(file_path, &file);
+  std::string content(size, '\0');
+  if (size > 0) { file->Read(0, size, &content.at(0)); }
+  return content;
+}
+
+std::string Content4Index(int64_t i, size_t size) {
+  std::string content(size, '\0');
+  FOR_RANGE(size_t, j, 0, size) { content.at(j) = static_cast<char>((i * 31 + j) % 127); }
+  return content;
+}
+
+}  // namespace
+
+TEST(SnapshotWriteEngine, write_and_wait) {
+  IOConf io_conf;
+  io_conf.mutable_data_fs_conf()->mutable_localfs_conf();
+  io_conf.mutable_snapshot_fs_conf()->mutable_localfs_conf();
+  Global<const IOConf>::New(io_conf);
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string root_path = JoinPath(current_dir, "tmp_snapshot_write_engine_test");
+  SnapshotFS()->RecursivelyCreateDirIfNotExist(root_path);
+  const int64_t file_num = 16;
+  const size_t file_size = 1000;
+  std::vector<std::string> file_paths;
+  bool is_done = false;
+  {
+    // room for two files only, so that writes have to wait for staging memory
+    SnapshotWriteEngine engine(4, 2 * file_size);
+    FOR_RANGE(int64_t, i, 0, file_num) {
+      const std::string file_path = JoinPath(root_path, std::to_string(i));
+      const std::string content = Content4Index(i, file_size);
+      if (i % 2 == 0) {
+        engine.Write(root_path, file_path, content.data(), content.size());
+      } else {
+        // only the first file_size bytes of an owned buffer are written
+        std::vector<char> data(content.begin(), content.end());
+        data.resize(file_size * 2);
+        engine.Write(root_path, file_path, std::move(data), file_size);
+      }
+      file_paths.push_back(file_path);
+    }
+    engine.WaitUntilDone(std::vector<std::string>{file_paths.front(), file_paths.back()});
+    ASSERT_EQ(ReadFile(file_paths.back()), Content4Index(file_num - 1, file_size));
+    engine.Finish(root_path, [&]() { is_done = true; });
+    engine.WaitUntilDone(root_path);
+    ASSERT_TRUE(is_done);
+    bool is_done_at_once = false;
+    engine.Finish(root_path, [&]() { is_done_at_once = true; });
+    ASSERT_TRUE(is_done_at_once);
+  }
+  FOR_RANGE(int64_t, i, 0, file_num) {
+    ASSERT_EQ(ReadFile(file_paths.at(i)), Content4Index(i, file_size));
+  }
+  SnapshotFS()->RecursivelyDeleteDir(root_path);
+  Global<const IOConf>::Delete();
+}
+
+TEST(SnapshotWriteEngine, write_and_finish_while_finishing) {
+  IOConf io_conf;
+  io_conf.mutable_data_fs_conf()->mutable_localfs_conf();
+  io_conf.mutable_snapshot_fs_conf()->mutable_localfs_conf();
+  Global<const IOConf>::New(io_conf);
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string root_path = JoinPath(current_dir, "tmp_snapshot_write_engine_finish_test");
+  SnapshotFS()->RecursivelyCreateDirIfNotExist(root_path);
+  const std::string first_path = JoinPath(root_path, "0");
+  const std::string second_path = JoinPath(root_path, "1");
+  // large enough for the first write to be pending when Finish() is called
+  const std::string first_content = Content4Index(0, 8 << 20);
+  const std::string second_content = Content4Index(1, 1000);
+  bool is_queued_done = false;
+  bool is_second_done = false;
+  {
+    SnapshotWriteEngine engine(2, 16 << 20);
+    engine.Write(root_path, first_path, first_content.data(), first_content.size());
+    // Done of the completing write runs while the root is still pending: a Finish() from there is
+    // queued behind it, a Write() and Finish() from that one interleave with the completing write
+    engine.Finish(root_path, [&]() {
+      engine.Finish(root_path, [&]() {
+        is_queued_done = true;
+        engine.Write(root_path, second_path, second_content.data(), second_content.size());
+        engine.Finish(root_path, [&]() { is_second_done = true; });
+      });
+    });
+    engine.WaitUntilDone(root_path);
+    ASSERT_TRUE(is_queued_done);
+    ASSERT_TRUE(is_second_done);
+    ASSERT_EQ(ReadFile(second_path), second_content);
+  }
+  ASSERT_EQ(ReadFile(first_path), first_content);
+  SnapshotFS()->RecursivelyDeleteDir(root_path);
+  Global<const IOConf>::Delete();
+}
+
+}  // namespace oneflow
@@ -0,0 +1,333 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/record/ofrecord_view.h"
+
+// fixed32 and fixed64 values are copied out as they are stored on the wire
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "OFRecordView requires a little-endian target"
+#endif
+
+namespace oneflow {
+
+namespace {
+
+enum WireType {
+  kWireTypeVarint = 0,
+  kWireTypeFixed64 = 1,
+  kWireTypeLengthDelimited = 2,
+  kWireTypeFixed32 = 5,
+};
+
+struct WireField {
+  int32_t number;
+  int32_t wire_type;
+  // payload of the field, for varints the encoded bytes
+  const char* data;
+  size_t size;
+  uint64_t varint;
+};
+
+uint64_t ReadVarint(const char** cur, const char* end) {
+  uint64_t val = 0;
+  for (int32_t shift = 0; shift < 64; shift += 7) {
+    CHECK(*cur < end) << "truncated OFRecord";
+    const uint8_t byte = static_cast<uint8_t>(**cur);
+    *cur += 1;
+    val |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) { return val; }
+  }
+  LOG(FATAL) << "malformed varint in OFRecord";
+  return 0;
+}
+
+// reads the field starting at *cur and advances *cur past it
+void ReadField(const char** cur, const char* end, WireField* field) {
+  const uint64_t tag = ReadVarint(cur, end);
+  field->number = static_cast<int32_t>(tag >> 3);
+  field->wire_type = static_cast<int32_t>(tag & 7);
+  field->data = *cur;
+  field->varint = 0;
+  switch (field->wire_type) {
+    case kWireTypeVarint:
+      field->varint = ReadVarint(cur, end);
+      field->size = *cur - field->data;
+      break;
+    case kWireTypeFixed64: field->size = 8; break;
+    case kWireTypeLengthDelimited:
+      field->size = ReadVarint(cur, end);
+      field->data = *cur;
+      break;
+    case kWireTypeFixed32: field->size = 4; break;
+    default: LOG(FATAL) << "unsupported wire type " << field->wire_type << " in OFRecord";
+  }
+  CHECK_LE(field->size, static_cast<size_t>(end - field->data)) << "truncated OFRecord";
+  *cur = field->data + field->size;
+}
+
+int64_t CountVarints(const char* data, size_t size) {
+  int64_t cnt = 0;
+  FOR_RANGE(size_t, i, 0, size) {
+    if ((static_cast<uint8_t>(data[i]) & 0x80) == 0) { ++cnt; }
+  }
+  return cnt;
+}
+
+template<typename Src, typename T>
+struct FixedCopier {
+  static void Copy(const char* src, int64_t n, T* dst) {
+    FOR_RANGE(int64_t, i, 0, n) {
+      Src val;
+      std::memcpy(&val, src + i * sizeof(Src), sizeof(Src));
+      dst[i] = static_cast<T>(val);
+    }
+  }
+};
+
+template<typename T>
+struct FixedCopier<T, T> {
+  static void Copy(const char* src, int64_t n, T* dst) { std::memcpy(dst, src, n * sizeof(T)); }
+};
+
+int32_t FixedSize4Kind(OFRecordFeatureView::Kind kind) {
+  if (kind == OFRecordFeatureView::kFloatList) { return 4; }
+  if (kind == OFRecordFeatureView::kDoubleList) { return 8; }
+  return 0;
+}
+
+int32_t ScalarWireType4Kind(OFRecordFeatureView::Kind kind) {
+  if (kind == OFRecordFeatureView::kFloatList) { return kWireTypeFixed32; }
+  if (kind == OFRecordFeatureView::kDoubleList) { return kWireTypeFixed64; }
+  return kWireTypeVarint;
+}
+
+class ValueCounter final {
+ public:
+  explicit ValueCounter(OFRecordFeatureView::Kind kind) : kind_(kind), cnt_(0) {}
+
+  void operator()(const WireField& field) {
+    if (kind_ == OFRecordFeatureView::kBytesList) {
+      if (field.wire_type == kWireTypeLengthDelimited) { ++cnt_; }
+    } else if (field.wire_type == kWireTypeLengthDelimited) {
+      const int32_t fixed_size = FixedSize4Kind(kind_);
+      if (fixed_size > 0) {
+        CHECK_EQ(field.size % fixed_size, 0) << "malformed packed list in OFRecord";
+        cnt_ += field.size / fixed_size;
+      } else {
+        cnt_ += CountVarints(field.data, field.size);
+      }
+    } else if (field.wire_type == ScalarWireType4Kind(kind_)) {
+      ++cnt_;
+    }
+  }
+  int64_t cnt() const { return cnt_; }
+
+ private:
+  OFRecordFeatureView::Kind kind_;
+  int64_t cnt_;
+};
+
+class BytesFinder final {
+ public:
+  explicit BytesFinder(int64_t index) : index_(index), data_(nullptr), size_(0) {}
+
+  void operator()(const WireField& field) {
+    if (field.wire_type != kWireTypeLengthDelimited) { return; }
+    if (index_ == 0) {
+      data_ = field.data;
+      size_ = field.size;
+    }
+    --index_;
+  }
+  bool found() const { return index_ < 0; }
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  int64_t index_;
+  const char* data_;
+  size_t size_;
+};
+
+template<typename T>
+class ValueReader final {
+ public:
+  ValueReader(OFRecordFeatureView::Kind kind, T* dst, int64_t max_cnt)
+      : kind_(kind), dst_(dst), max_cnt_(max_cnt), cnt_(0) {}
+
+  void operator()(const WireField& field) {
+    if (field.wire_type == kWireTypeLengthDelimited) {
+      if (kind_ == OFRecordFeatureView::kFloatList) {
+        ReadPacked<float>(field);
+      } else if (kind_ == OFRecordFeatureView::kDoubleList) {
+        ReadPacked<double>(field);
+      } else {
+        const char* cur = field.data;
+        const char* end = field.data + field.size;
+        while (cur < end) { Append(ReadVarint(&cur, end)); }
+      }
+    } else if (field.wire_type == ScalarWireType4Kind(kind_)) {
+      if (kind_ == OFRecordFeatureView::kFloatList) {
+        ReadPacked<float>(field);
+      } else if (kind_ == OFRecordFeatureView::kDoubleList) {
+        ReadPacked<double>(field);
+      } else {
+        Append(field.varint);
+      }
+    }
+  }
+  int64_t cnt() const { return cnt_; }
+
+ private:
+  template<typename Src>
+  void ReadPacked(const WireField& field) {
+    CHECK_EQ(field.size % sizeof(Src), 0) << "malformed packed list in OFRecord";
+    const int64_t num = field.size / sizeof(Src);
+    const int64_t copy_num = std::max<int64_t>(std::min<int64_t>(num, max_cnt_ - cnt_), 0);
+    FixedCopier<Src, T>::Copy(field.data, copy_num, dst_ + cnt_);
+    cnt_ += num;
+  }
+
+  void Append(uint64_t varint) {
+    if (cnt_ < max_cnt_) {
+      // int32 values are sign-extended to 64 bits on the wire, truncation restores them
+      if (kind_ == OFRecordFeatureView::kInt32List) {
+        dst_[cnt_] = static_cast<T>(static_cast<int32_t>(varint));
+      } else {
+        dst_[cnt_] = static_cast<T>(static_cast<int64_t>(varint));
+      }
+    }
+    ++cnt_;
+  }
+
+  OFRecordFeatureView::Kind kind_;
+  T* dst_;
+  int64_t max_cnt_;
+  int64_t cnt_;
+};
+
+}  // namespace
+
+OFRecordFeatureView::OFRecordFeatureView(const char* data, size_t size)
+    : data_(data), size_(size), kind_begin_(0), kind_(kNone) {
+  const char* cur = data_;
+  const char* end = data_ + size_;
+  while (cur < end) {
+    const char* field_begin = cur;
+    WireField field;
+    ReadField(&cur, end, &field);
+    if (field.wire_type != kWireTypeLengthDelimited || field.number < kBytesList
+        || field.number > kInt64List) {
+      continue;
+    }
+    // a later field of another case replaces the list, repeated fields of one case are merged
+    if (field.number != kind_) {
+      kind_ = static_cast<Kind>(field.number);
+      kind_begin_ = field_begin - data_;
+    }
+  }
+}
+
+template<typename Visitor>
+void OFRecordFeatureView::ForEachListField(Visitor* visitor) const {
+  const char* cur = data_ + kind_begin_;
+  const char* end = data_ + size_;
+  while (cur < end) {
+    WireField field;
+    ReadField(&cur, end, &field);
+    if (field.number != kind_ || field.wire_type != kWireTypeLengthDelimited) { continue; }
+    const char* list_cur = field.data;
+    const char* list_end = field.data + field.size;
+    while (list_cur < list_end) {
+      WireField value_field;
+      ReadField(&list_cur, list_end, &value_field);
+      if (value_field.number == 1) { (*visitor)(value_field); }
+    }
+  }
+}
+
+int64_t OFRecordFeatureView::value_size() const {
+  if (kind_ == kNone) { return 0; }
+  ValueCounter counter(kind_);
+  ForEachListField(&counter);
+  return counter.cnt();
+}
+
+void OFRecordFeatureView::GetBytes(int64_t index, const char** data, size_t* size) const {
+  CHECK(has_bytes_list());
+  CHECK_GE(index, 0);
+  BytesFinder finder(index);
+  ForEachListField(&finder);
+  CHECK(finder.found()) << "bytes list index " << index << " out of range";
+  *data = finder.data();
+  *size = finder.size();
+}
+
+template<typename T>
+int64_t OFRecordFeatureView::ReadValues(T* dst, int64_t max_cnt) const {
+  CHECK(has_numeric_list());
+  ValueReader<T> reader(kind_, dst, max_cnt);
+  ForEachListField(&reader);
+  return reader.cnt();
+}
+
+#define INSTANTIATE_READ_VALUES(T) \
+  template int64_t OFRecordFeatureView::ReadValues<T>(T * dst, int64_t max_cnt) const;
+INSTANTIATE_READ_VALUES(char)
+INSTANTIATE_READ_VALUES(float)
+INSTANTIATE_READ_VALUES(double)
+INSTANTIATE_READ_VALUES(int8_t)
+INSTANTIATE_READ_VALUES(int32_t)
+INSTANTIATE_READ_VALUES(int64_t)
+INSTANTIATE_READ_VALUES(uint8_t)
+#undef INSTANTIATE_READ_VALUES
+
+bool OFRecordView::GetFeature(const std::string& name, OFRecordFeatureView* feature) const {
+  bool found = false;
+  const char* cur = data_;
+  const char* end = data_ + size_;
+  while (cur < end) {
+    WireField entry;
+    ReadField(&cur, end, &entry);
+    if (entry.number != 1 || entry.wire_type != kWireTypeLengthDelimited) { continue; }
+    // map entry: key = 1, value = 2, a missing key is the empty string
+    const char* key_data = nullptr;
+    size_t key_size = 0;
+    const char* value_data = nullptr;
+    size_t value_size = 0;
+    const char* entry_cur = entry.data;
+    const char* entry_end = entry.data + entry.size;
+    while (entry_cur < entry_end) {
+      WireField field;
+      ReadField(&entry_cur, entry_end, &field);
+      if (field.wire_type != kWireTypeLengthDelimited) { continue; }
+      if (field.number == 1) {
+        key_data = field.data;
+        key_size = field.size;
+      } else if (field.number == 2) {
+        value_data = field.data;
+        value_size = field.size;
+      }
+    }
+    if (key_size != name.size() || (key_size > 0 && std::memcmp(key_data, name.data(), key_size))) {
+      continue;
+    }
+    *feature = value_data ? OFRecordFeatureView(value_data, value_size) : OFRecordFeatureView();
+    found = true;
+  }
+  return found;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,80 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_RECORD_OFRECORD_VIEW_H_
+#define ONEFLOW_CORE_RECORD_OFRECORD_VIEW_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// One feature of a serialized OFRecord. Nothing is copied, the view points into the serialized
+// record, which has to outlive it. Numeric lists are accepted packed as well as unpacked.
+class OFRecordFeatureView final {
+ public:
+  enum Kind {
+    kNone = 0,
+    kBytesList = 1,
+    kFloatList = 2,
+    kDoubleList = 3,
+    kInt32List = 4,
+    kInt64List = 5,
+  };
+
+  OFRecordFeatureView() : data_(nullptr), size_(0), kind_begin_(0), kind_(kNone) {}
+  OFRecordFeatureView(const char* data, size_t size);
+  ~OFRecordFeatureView() = default;
+
+  Kind kind() const { return kind_; }
+  bool has_bytes_list() const { return kind_ == kBytesList; }
+  bool has_numeric_list() const { return kind_ != kNone && kind_ != kBytesList; }
+
+  // number of values in the list
+  int64_t value_size() const;
+  // the index-th value of a bytes list
+  void GetBytes(int64_t index, const char** data, size_t* size) const;
+  // converts the first min(value_size(), max_cnt) values of a numeric list to T, returns
+  // value_size()
+  template<typename T>
+  int64_t ReadValues(T* dst, int64_t max_cnt) const;
+
+ private:
+  template<typename Visitor>
+  void ForEachListField(Visitor* visitor) const;
+
+  const char* data_;
+  size_t size_;
+  // offset of the first list field after the last change of the oneof case
+  size_t kind_begin_;
+  Kind kind_;
+};
+
+// Serialized OFRecord which is scanned on demand instead of being parsed into a message
+class OFRecordView final {
+ public:
+  OFRecordView(const char* data, size_t size) : data_(data), size_(size) {}
+  ~OFRecordView() = default;
+
+  // the last entry named name wins, as in a parsed map; returns false if there is none
+  bool GetFeature(const std::string& name, OFRecordFeatureView* feature) const;
+
+ private:
+  const char* data_;
+  size_t size_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_RECORD_OFRECORD_VIEW_H_
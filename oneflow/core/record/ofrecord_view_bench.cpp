@@ -0,0 +1,124 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/record/ofrecord_view.h"
+#include "oneflow/core/record/record.pb.h"
+#include "oneflow/core/common/benchmark.h"
+
+namespace oneflow {
+
+namespace {
+
+// An ImageNet style record: a ~110KB encoded image next to its label and a few small features
+std::string NewImageRecord() {
+  OFRecord record;
+  auto* feature = record.mutable_feature();
+  std::string encoded(110 << 10, '\0');
+  FOR_RANGE(size_t, i, 0, encoded.size()) { encoded[i] = static_cast<char>(i * 131 % 251); }
+  (*feature)["encoded"].mutable_bytes_list()->add_value(encoded);
+  (*feature)["class/label"].mutable_int32_list()->add_value(417);
+  (*feature)["filename"].mutable_bytes_list()->add_value("n01440764_10026.JPEG");
+  (*feature)["height"].mutable_int32_list()->add_value(375);
+  (*feature)["width"].mutable_int32_list()->add_value(500);
+  return record.SerializeAsString();
+}
+
+// A CTR style record: 13 dense and 26 sparse single-value features
+std::string NewCtrRecord() {
+  OFRecord record;
+  auto* feature = record.mutable_feature();
+  FOR_RANGE(int32_t, i, 0, 13) {
+    (*feature)["dense_" + std::to_string(i)].mutable_float_list()->add_value(i * 0.5f);
+  }
+  FOR_RANGE(int32_t, i, 0, 26) {
+    (*feature)["sparse_" + std::to_string(i)].mutable_int64_list()->add_value(i * 1000003);
+  }
+  (*feature)["label"].mutable_int32_list()->add_value(1);
+  return record.SerializeAsString();
+}
+
+// Reads the feature named name out of every record, the way the decoders did before
+// lazy_decode (parse) or with it (view)
+void BenchmarkBytes(BenchmarkState* state, bool is_view, const std::string& serialized,
+                    const std::string& name) {
+  size_t total = 0;
+  while (state->KeepRunning()) {
+    const char* data = nullptr;
+    size_t size = 0;
+    if (is_view) {
+      OFRecordView view(serialized.data(), serialized.size());
+      OFRecordFeatureView feature;
+      CHECK(view.GetFeature(name, &feature));
+      feature.GetBytes(0, &data, &size);
+    } else {
+      OFRecord record;
+      CHECK(record.ParseFromArray(serialized.data(), serialized.size()));
+      const std::string& value = record.feature().at(name).bytes_list().value(0);
+      data = value.data();
+      size = value.size();
+    }
+    DoNotOptimize(data);
+    total += size;
+  }
+  DoNotOptimize(total);
+  state->SetItemsProcessed(state->iterations());
+  state->SetBytesProcessed(state->iterations() * serialized.size());
+}
+
+void BenchmarkInt(BenchmarkState* state, bool is_view, const std::string& serialized,
+                  const std::string& name) {
+  int64_t total = 0;
+  while (state->KeepRunning()) {
+    int32_t value = 0;
+    if (is_view) {
+      OFRecordView view(serialized.data(), serialized.size());
+      OFRecordFeatureView feature;
+      CHECK(view.GetFeature(name, &feature));
+      feature.ReadValues<int32_t>(&value, 1);
+    } else {
+      OFRecord record;
+      CHECK(record.ParseFromArray(serialized.data(), serialized.size()));
+      value = record.feature().at(name).int32_list().value(0);
+    }
+    total += value;
+  }
+  DoNotOptimize(total);
+  state->SetItemsProcessed(state->iterations());
+  state->SetBytesProcessed(state->iterations() * serialized.size());
+}
+
+}  // namespace
+
+OF_BENCHMARK(OFRecordParse_ImageEncoded) {
+  BenchmarkBytes(state, false, NewImageRecord(), "encoded");
+}
+
+OF_BENCHMARK(OFRecordView_ImageEncoded) {
+  BenchmarkBytes(state, true, NewImageRecord(), "encoded");
+}
+
+OF_BENCHMARK(OFRecordParse_ImageLabel) {
+  BenchmarkInt(state, false, NewImageRecord(), "class/label");
+}
+
+OF_BENCHMARK(OFRecordView_ImageLabel) {
+  BenchmarkInt(state, true, NewImageRecord(), "class/label");
+}
+
+OF_BENCHMARK(OFRecordParse_CtrLabel) { BenchmarkInt(state, false, NewCtrRecord(), "label"); }
+
+OF_BENCHMARK(OFRecordView_CtrLabel) { BenchmarkInt(state, true, NewCtrRecord(), "label"); }
+
+}  // namespace oneflow
@@ -0,0 +1,131 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/record/ofrecord_view.h"
+#include "oneflow/core/record/record.pb.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+OFRecord NewTestRecord() {
+  OFRecord record;
+  auto* feature = record.mutable_feature();
+  (*feature)["image"].mutable_bytes_list()->add_value("encoded image");
+  (*feature)["image"].mutable_bytes_list()->add_value(std::string("\0\1", 2));
+  FOR_RANGE(int32_t, i, 0, 100) {
+    (*feature)["float"].mutable_float_list()->add_value(i * 0.5f);
+    (*feature)["double"].mutable_double_list()->add_value(i * 0.25);
+    (*feature)["int32"].mutable_int32_list()->add_value(i - 50);
+    (*feature)["int64"].mutable_int64_list()->add_value((i - 50) * (int64_t(1) << 40));
+  }
+  (*feature)["empty"];
+  return record;
+}
+
+}  // namespace
+
+TEST(OFRecordView, bytes_list) {
+  const std::string serialized = NewTestRecord().SerializeAsString();
+  OFRecordView view(serialized.data(), serialized.size());
+  OFRecordFeatureView feature;
+  ASSERT_TRUE(view.GetFeature("image", &feature));
+  ASSERT_TRUE(feature.has_bytes_list());
+  ASSERT_EQ(feature.value_size(), 2);
+  const char* data = nullptr;
+  size_t size = 0;
+  feature.GetBytes(0, &data, &size);
+  ASSERT_EQ(std::string(data, size), "encoded image");
+  feature.GetBytes(1, &data, &size);
+  ASSERT_EQ(std::string(data, size), std::string("\0\1", 2));
+  ASSERT_TRUE(view.GetFeature("empty", &feature));
+  ASSERT_EQ(feature.kind(), OFRecordFeatureView::kNone);
+  ASSERT_FALSE(view.GetFeature("missing", &feature));
+}
+
+TEST(OFRecordView, numeric_list) {
+  const OFRecord record = NewTestRecord();
+  const std::string serialized = record.SerializeAsString();
+  OFRecordView view(serialized.data(), serialized.size());
+  OFRecordFeatureView feature;
+  std::vector<double> values(100);
+  ASSERT_TRUE(view.GetFeature("float", &feature));
+  ASSERT_EQ(feature.ReadValues(values.data(), 100), 100);
+  const auto& float_list = record.feature().at("float").float_list();
+  FOR_RANGE(int32_t, i, 0, 100) { ASSERT_EQ(values[i], float_list.value(i)); }
+  ASSERT_TRUE(view.GetFeature("double", &feature));
+  ASSERT_EQ(feature.value_size(), 100);
+  std::vector<float> float_values(10);
+  ASSERT_EQ(feature.ReadValues(float_values.data(), 10), 100);
+  FOR_RANGE(int32_t, i, 0, 10) { ASSERT_EQ(float_values[i], static_cast<float>(i * 0.25)); }
+  std::vector<int64_t> int_values(100);
+  ASSERT_TRUE(view.GetFeature("int32", &feature));
+  ASSERT_EQ(feature.ReadValues(int_values.data(), 100), 100);
+  FOR_RANGE(int32_t, i, 0, 100) { ASSERT_EQ(int_values[i], i - 50); }
+  ASSERT_TRUE(view.GetFeature("int64", &feature));
+  ASSERT_EQ(feature.ReadValues(int_values.data(), 100), 100);
+  FOR_RANGE(int32_t, i, 0, 100) { ASSERT_EQ(int_values[i], (i - 50) * (int64_t(1) << 40)); }
+}
+
+TEST(OFRecordView, unpacked_and_replaced_lists) {
+  // Feature { float_list { value: 1 value: 2 } } written unpacked, then a later int64_list
+  // replacing the float_list, and the last duplicated map entry has to win
+  std::string float_list;
+  float_list += '\x0d';
+  const float one = 1.f;
+  float_list.append(reinterpret_cast<const char*>(&one), 4);
+  float_list += '\x0d';
+  const float two = 2.f;
+  float_list.append(reinterpret_cast<const char*>(&two), 4);
+  std::string feature_bytes;
+  feature_bytes += '\x12';
+  feature_bytes += static_cast<char>(float_list.size());
+  feature_bytes += float_list;
+  Feature replaced;
+  replaced.mutable_int64_list()->add_value(7);
+  const std::string int64_feature = replaced.SerializeAsString();
+
+  OFRecordFeatureView feature(feature_bytes.data(), feature_bytes.size());
+  ASSERT_EQ(feature.kind(), OFRecordFeatureView::kFloatList);
+  std::vector<float> values(2);
+  ASSERT_EQ(feature.ReadValues(values.data(), 2), 2);
+  ASSERT_EQ(values[0], 1.f);
+  ASSERT_EQ(values[1], 2.f);
+
+  const std::string both = feature_bytes + int64_feature;
+  OFRecordFeatureView replaced_view(both.data(), both.size());
+  ASSERT_EQ(replaced_view.kind(), OFRecordFeatureView::kInt64List);
+  ASSERT_EQ(replaced_view.value_size(), 1);
+
+  OFRecord first;
+  (*first.mutable_feature())["x"] = replaced;
+  OFRecord second;
+  (*second.mutable_feature())["x"].mutable_float_list()->add_value(3.f);
+  const std::string merged = first.SerializeAsString() + second.SerializeAsString();
+  OFRecord parsed;
+  ASSERT_TRUE(parsed.ParseFromString(merged));
+  OFRecordView view(merged.data(), merged.size());
+  OFRecordFeatureView x;
+  ASSERT_TRUE(view.GetFeature("x", &x));
+  ASSERT_TRUE(parsed.feature().at("x").has_float_list());
+  ASSERT_EQ(x.kind(), OFRecordFeatureView::kFloatList);
+  ASSERT_EQ(x.value_size(), 1);
+}
+
+}  // namespace test
+
+}  // namespace oneflow
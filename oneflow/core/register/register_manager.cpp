@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/common/tensor_buffer.h"
 #include "oneflow/core/comm_network/comm_network.h"
 #include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/job/id_manager.h"
 #include "oneflow/core/memory/memory_case.pb.h"
 #include "oneflow/core/memory/memory_allocator.h"
 
@@ -33,31 +34,92 @@ void CheckBlobInRegstNotDisabled(const RegstDescProto& regst_desc) {
         == false);
 }
 
+// The GPU whose actor threads produce into each mem block, -1 for cpu actor threads, so that
+// host memory can be first touched on the node of the threads that use it.
+HashMap<int64_t, int64_t> MemBlockId2CudaDeviceId(const Plan& plan, int64_t this_machine_id) {
+  HashMap<int64_t, int64_t> mem_block_id2cuda_device_id;
+  for (const TaskProto& task : plan.task()) {
+    if (task.machine_id() != this_machine_id) { continue; }
+    int64_t cuda_device_id = -1;
+    if (Global<IDMgr>::Get()->GetDeviceTypeFromThrdId(task.thrd_id()) == DeviceType::kGPU) {
+      cuda_device_id = Global<IDMgr>::Get()->GetGpuPhyIdFromThrdId(task.thrd_id());
+    }
+    for (const auto& pair : task.produced_regst_desc()) {
+      for (int64_t mem_block_id :
+           {pair.second.mem_block_id(), pair.second.separated_header_mem_block_id()}) {
+        if (mem_block_id == -1) { continue; }
+        mem_block_id2cuda_device_id.emplace(mem_block_id, cuda_device_id);
+      }
+    }
+  }
+  return mem_block_id2cuda_device_id;
+}
+
 }  // namespace
 
 RegstMgr::RegstMgr(const Plan& plan) {
   int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
-  HashMap<int64_t, char*> chunk_id2ptr;
+  const double start_time = GetCurTime();
+  // chunks and mem blocks outside of chunks are allocated together, so that their host memory
+  // is zeroed in parallel however small the single buffers are
+  std::vector<const ChunkProto*> chunks;
+  std::vector<const MemBlockProto*> mem_blocks;
+  std::vector<std::pair<MemoryCase, size_t>> mem_case_size_pairs;
+  std::vector<int64_t> cuda_device_ids;
+  int64_t allocated_bytes = 0;
+  const HashMap<int64_t, int64_t> mem_block_id2cuda_device_id =
+      MemBlockId2CudaDeviceId(plan, this_machine_id);
+  auto CudaDeviceId4MemBlockId = [&](int64_t mem_block_id) -> int64_t {
+    const auto it = mem_block_id2cuda_device_id.find(mem_block_id);
+    return it == mem_block_id2cuda_device_id.end() ? -1 : it->second;
+  };
+  // a chunk is placed like its mem blocks if they all agree, on no particular node otherwise
+  HashMap<int64_t, int64_t> chunk_id2cuda_device_id;
+  for (const MemBlockProto& mem_block : plan.block_chunk_list().mem_block()) {
+    if (mem_block.machine_id() != this_machine_id || !mem_block.has_chunk_id()) { continue; }
+    const int64_t cuda_device_id = CudaDeviceId4MemBlockId(mem_block.mem_block_id());
+    auto it = chunk_id2cuda_device_id.emplace(mem_block.chunk_id(), cuda_device_id).first;
+    if (it->second != cuda_device_id) { it->second = -1; }
+  }
   for (const ChunkProto& chunk : plan.block_chunk_list().chunk()) {
     if (chunk.machine_id() != this_machine_id) { continue; }
     if (chunk.mem_size() == 0) { continue; }
-    char* chunk_ptr = Global<MemoryAllocator>::Get()->Allocate(chunk.mem_case(), chunk.mem_size());
-    CHECK(chunk_id2ptr.emplace(chunk.chunk_id(), chunk_ptr).second);
+    chunks.push_back(&chunk);
+    mem_case_size_pairs.emplace_back(chunk.mem_case(), chunk.mem_size());
+    const auto it = chunk_id2cuda_device_id.find(chunk.chunk_id());
+    cuda_device_ids.push_back(it == chunk_id2cuda_device_id.end() ? -1 : it->second);
+    allocated_bytes += chunk.mem_size();
   }
   for (const MemBlockProto& mem_block : plan.block_chunk_list().mem_block()) {
     if (mem_block.machine_id() != this_machine_id) { continue; }
     if (mem_block.mem_size() == 0) { continue; }
-    char* mem_block_ptr = nullptr;
-    if (mem_block.has_chunk_id()) {
-      CHECK(mem_block.has_chunk_offset());
-      CHECK(chunk_id2ptr.find(mem_block.chunk_id()) != chunk_id2ptr.end());
-      mem_block_ptr = chunk_id2ptr.at(mem_block.chunk_id()) + mem_block.chunk_offset();
-    } else {
-      mem_block_ptr =
-          Global<MemoryAllocator>::Get()->Allocate(mem_block.mem_case(), mem_block.mem_size());
-    }
+    if (mem_block.has_chunk_id()) { continue; }
+    mem_blocks.push_back(&mem_block);
+    mem_case_size_pairs.emplace_back(mem_block.mem_case(), mem_block.mem_size());
+    cuda_device_ids.push_back(CudaDeviceId4MemBlockId(mem_block.mem_block_id()));
+    allocated_bytes += mem_block.mem_size();
+  }
+  const std::vector<char*> ptrs =
+      Global<MemoryAllocator>::Get()->AllocateBatch(mem_case_size_pairs, cuda_device_ids);
+  HashMap<int64_t, char*> chunk_id2ptr;
+  FOR_RANGE(size_t, i, 0, chunks.size()) {
+    CHECK(chunk_id2ptr.emplace(chunks.at(i)->chunk_id(), ptrs.at(i)).second);
+  }
+  FOR_RANGE(size_t, i, 0, mem_blocks.size()) {
+    CHECK(mem_block_id2ptr_.emplace(mem_blocks.at(i)->mem_block_id(), ptrs.at(chunks.size() + i))
+              .second);
+  }
+  for (const MemBlockProto& mem_block : plan.block_chunk_list().mem_block()) {
+    if (mem_block.machine_id() != this_machine_id) { continue; }
+    if (mem_block.mem_size() == 0) { continue; }
+    if (!mem_block.has_chunk_id()) { continue; }
+    CHECK(mem_block.has_chunk_offset());
+    CHECK(chunk_id2ptr.find(mem_block.chunk_id()) != chunk_id2ptr.end());
+    char* mem_block_ptr = chunk_id2ptr.at(mem_block.chunk_id()) + mem_block.chunk_offset();
     CHECK(mem_block_id2ptr_.emplace(mem_block.mem_block_id(), mem_block_ptr).second);
   }
+  LOG(INFO) << "RegstMgr allocated and initialized " << allocated_bytes << " bytes in "
+            << (GetCurTime() - start_time) / 1e6 << " ms";
   for (const TaskProto& task : plan.task()) {
     if (task.machine_id() != this_machine_id) { continue; }
     for (const auto& pair : task.produced_regst_desc()) {
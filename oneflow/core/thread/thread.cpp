@@ -41,6 +41,15 @@ void Thread::EnqueueActorMsg(const ActorMsg& msg) {
   }
 }
 
+void Thread::EnqueueActorMsgBatch(const std::vector<ActorMsg>& msgs) {
+  if (Global<ResourceDesc, ForSession>::Get()->thread_enable_local_message_queue()
+      && std::this_thread::get_id() == actor_thread_.get_id()) {
+    for (const ActorMsg& msg : msgs) { local_msg_queue_.push(msg); }
+  } else {
+    msg_channel_.SendMany(msgs);
+  }
+}
+
 void Thread::PollMsgChannel(const ThreadCtx& thread_ctx) {
   while (true) {
     if (local_msg_queue_.empty()) {
@@ -18,13 +18,17 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/thread/cpu_thread.h"
 #include "oneflow/core/thread/gpu_thread.h"
-#include "oneflow/core/common/balanced_splitter.h"
-#include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/job/machine_context.h"
 #include "oneflow/core/job/global_for.h"
 
 namespace oneflow {
 
+namespace {
+
+const size_t kMultiThreadLoopBlockNumPerThread = 4;
+
+}  // namespace
+
 ThreadMgr::~ThreadMgr() {
   for (size_t i = 0; i < threads_.size(); ++i) {
     ActorMsg msg = ActorMsg::BuildCommandMsg(-1, ActorCmd::kStopThread);
@@ -70,18 +74,15 @@ void SingleThreadLoop(size_t num, std::function<void(size_t i)> Callback) {
   FOR_RANGE(size_t, i, 0, num) { Callback(i); }
 }
 
-void MultiThreadLoop(size_t num, std::function<void(size_t i)> Callback) {
-  size_t thread_num = Global<ThreadPool>::Get()->thread_num();
-  thread_num = std::min(num, thread_num);
-  BalancedSplitter bs(num, thread_num);
-  BlockingCounter bc(thread_num);
-  FOR_RANGE(size_t, range_id, 0, thread_num) {
-    Global<ThreadPool>::Get()->AddWork([&bc, &bs, range_id, Callback] {
-      FOR_RANGE(size_t, i, bs.At(range_id).begin(), bs.At(range_id).end()) { Callback(i); }
-      bc.Decrease();
-    });
+void MultiThreadLoop(size_t num, std::function<void(size_t i)> Callback, size_t grain_size) {
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (grain_size == 0) {
+    grain_size = std::max<size_t>(
+        1, num / (thread_pool->thread_num() * kMultiThreadLoopBlockNumPerThread));
   }
-  bc.WaitUntilCntEqualZero();
+  thread_pool->ParallelFor(0, num, grain_size, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) { Callback(i); }
+  });
 }
 
 }  // namespace oneflow
@@ -43,7 +43,9 @@ class ThreadMgr final {
 };
 
 void SingleThreadLoop(size_t num, std::function<void(size_t i)> Callback);
-void MultiThreadLoop(size_t num, std::function<void(size_t i)> Callback);
+// iterations are claimed dynamically by the ThreadPool workers in blocks of grain_size, a
+// grain_size of 0 gives every worker a few blocks
+void MultiThreadLoop(size_t num, std::function<void(size_t i)> Callback, size_t grain_size = 0);
 
 }  // namespace oneflow
 
@@ -17,28 +17,141 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+thread_local ThreadPool* tls_thread_pool = nullptr;
+thread_local int32_t tls_worker_id = -1;
+
+struct ParallelForCtx {
+  ParallelForCtx(int64_t begin, int64_t end, int64_t grain_size,
+                 const std::function<void(int64_t, int64_t)>* Callback)
+      : next(begin), end(end), grain_size(grain_size), remaining(end - begin), Callback(Callback) {}
+
+  // returns false when all ranges have been claimed
+  bool RunOneRange() {
+    const int64_t range_begin = next.fetch_add(grain_size, std::memory_order_relaxed);
+    if (range_begin >= end) { return false; }
+    const int64_t range_end = std::min(range_begin + grain_size, end);
+    (*Callback)(range_begin, range_end);
+    const int64_t cnt = range_end - range_begin;
+    if (remaining.fetch_sub(cnt, std::memory_order_acq_rel) == cnt) {
+      std::unique_lock<std::mutex> lck(mutex);
+      cond.notify_all();
+    }
+    return true;
+  }
+
+  void WaitUntilDone() {
+    std::unique_lock<std::mutex> lck(mutex);
+    cond.wait(lck, [this]() { return remaining.load(std::memory_order_acquire) == 0; });
+  }
+
+  std::atomic<int64_t> next;
+  const int64_t end;
+  const int64_t grain_size;
+  std::atomic<int64_t> remaining;
+  // only dereferenced after a range is claimed, which can't happen once the caller returned
+  const std::function<void(int64_t, int64_t)>* Callback;
+  std::mutex mutex;
+  std::condition_variable cond;
+};
+
+}  // namespace
+
 ThreadPool::ThreadPool(int32_t thread_num)
-    : work_chans_(thread_num), threads_(thread_num), work_cnt_(0) {
+    : threads_(thread_num),
+      work_cnt_(0),
+      pending_work_num_(0),
+      idle_worker_num_(0),
+      is_closed_(false) {
+  FOR_RANGE(int32_t, i, 0, thread_num) { work_queues_.emplace_back(new WorkQueue); }
   FOR_RANGE(int32_t, i, 0, thread_num) {
-    Channel<std::function<void()>>* chan = &(work_chans_.at(i));
-    threads_[i] = std::thread([chan]() {
-      std::function<void()> work;
-      while (chan->Receive(&work) == kChannelStatusSuccess) { work(); }
-    });
+    threads_[i] = std::thread([this, i]() { WorkerLoop(i); });
   }
 }
 
 ThreadPool::~ThreadPool() {
-  FOR_RANGE(int32_t, i, 0, work_chans_.size()) {
-    work_chans_.at(i).Close();
-    threads_.at(i).join();
+  {
+    std::unique_lock<std::mutex> lck(idle_mutex_);
+    is_closed_ = true;
+    idle_cond_.notify_all();
   }
+  for (std::thread& thread : threads_) { thread.join(); }
 }
 
 void ThreadPool::AddWork(const std::function<void()>& work) {
-  const size_t cur_chan_idx =
-      work_cnt_.fetch_add(1, std::memory_order_relaxed) % work_chans_.size();
-  work_chans_.at(cur_chan_idx).Send(work);
+  size_t queue_idx = 0;
+  if (tls_thread_pool == this) {
+    queue_idx = tls_worker_id;
+  } else {
+    queue_idx = work_cnt_.fetch_add(1, std::memory_order_relaxed) % work_queues_.size();
+  }
+  {
+    WorkQueue* queue = work_queues_.at(queue_idx).get();
+    std::unique_lock<std::mutex> lck(queue->mutex);
+    queue->works.push_back(work);
+  }
+  // pairs with WorkerLoop, which publishes itself as idle before it checks pending_work_num_,
+  // so either the worker sees this work or this sees the idle worker
+  pending_work_num_.fetch_add(1);
+  if (idle_worker_num_.load() > 0) {
+    std::unique_lock<std::mutex> lck(idle_mutex_);
+    idle_cond_.notify_one();
+  }
+}
+
+void ThreadPool::ParallelFor(int64_t begin, int64_t end, int64_t grain_size,
+                             const std::function<void(int64_t, int64_t)>& Callback) {
+  if (begin >= end) { return; }
+  CHECK_GT(grain_size, 0);
+  const int64_t range_num = (end - begin + grain_size - 1) / grain_size;
+  if (range_num == 1) { return Callback(begin, end); }
+  auto ctx = std::make_shared<ParallelForCtx>(begin, end, grain_size, &Callback);
+  const int64_t helper_num = std::min<int64_t>(range_num, thread_num()) - 1;
+  FOR_RANGE(int64_t, i, 0, helper_num) {
+    AddWork([ctx]() {
+      while (ctx->RunOneRange()) {}
+    });
+  }
+  while (ctx->RunOneRange()) {}
+  ctx->WaitUntilDone();
+}
+
+void ThreadPool::WorkerLoop(int32_t worker_id) {
+  tls_thread_pool = this;
+  tls_worker_id = worker_id;
+  std::function<void()> work;
+  while (true) {
+    if (PopOrSteal(worker_id, &work)) {
+      work();
+      work = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lck(idle_mutex_);
+    idle_worker_num_.fetch_add(1);
+    idle_cond_.wait(lck, [this]() { return pending_work_num_.load() > 0 || is_closed_; });
+    idle_worker_num_.fetch_sub(1);
+    if (is_closed_ && pending_work_num_.load(std::memory_order_acquire) == 0) { break; }
+  }
+}
+
+bool ThreadPool::PopOrSteal(int32_t worker_id, std::function<void()>* work) {
+  const int32_t queue_num = work_queues_.size();
+  FOR_RANGE(int32_t, i, 0, queue_num) {
+    WorkQueue* queue = work_queues_.at((worker_id + i) % queue_num).get();
+    std::unique_lock<std::mutex> lck(queue->mutex);
+    if (queue->works.empty()) { continue; }
+    if (i == 0) {
+      *work = std::move(queue->works.back());
+      queue->works.pop_back();
+    } else {
+      *work = std::move(queue->works.front());
+      queue->works.pop_front();
+    }
+    pending_work_num_.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+  }
+  return false;
 }
 
 }  // namespace oneflow
@@ -17,10 +17,12 @@ limitations under the License.
 #define ONEFLOW_CORE_THREAD_THREAD_POOL_H_
 
 #include "oneflow/core/common/util.h"
-#include "oneflow/core/common/channel.h"
 
 namespace oneflow {
 
+// Work-stealing thread pool.
+// Every worker owns a deque, it pops its own works from the back and steals from the front of
+// the other workers' deques when its own is empty.
 class ThreadPool final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(ThreadPool);
@@ -31,11 +33,31 @@ class ThreadPool final {
   int32_t thread_num() const { return threads_.size(); }
   void AddWork(const std::function<void()>& work);
 
+  // Calls Callback(range_begin, range_end) over [begin, end) split into ranges of grain_size.
+  // Ranges are claimed dynamically, so uneven per-element cost is balanced across workers. The
+  // calling thread takes part in the loop, which makes nested ParallelFor calls from inside a
+  // work safe.
+  void ParallelFor(int64_t begin, int64_t end, int64_t grain_size,
+                   const std::function<void(int64_t, int64_t)>& Callback);
+
  private:
-  std::vector<Channel<std::function<void()>>> work_chans_;
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> works;
+  };
+
+  void WorkerLoop(int32_t worker_id);
+  bool PopOrSteal(int32_t worker_id, std::function<void()>* work);
+
+  std::vector<std::unique_ptr<WorkQueue>> work_queues_;
   std::vector<std::thread> threads_;
 
   std::atomic<size_t> work_cnt_;
+  std::atomic<int64_t> pending_work_num_;
+  std::atomic<int32_t> idle_worker_num_;
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cond_;
+  bool is_closed_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,86 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/common/blocking_counter.h"
+
+namespace oneflow {
+
+namespace {
+
+const int32_t kThreadNum = 4;
+
+// the loop MultiThreadLoop used to run: one work per thread over a static split
+void StaticSplitLoop(ThreadPool* thread_pool, int64_t num,
+                     const std::function<void(int64_t, int64_t)>& Callback) {
+  const int64_t range_num = std::min<int64_t>(num, thread_pool->thread_num());
+  BalancedSplitter bs(num, range_num);
+  BlockingCounter bc(range_num);
+  FOR_RANGE(int64_t, range_id, 0, range_num) {
+    thread_pool->AddWork([&bc, &bs, &Callback, range_id]() {
+      Callback(bs.At(range_id).begin(), bs.At(range_id).end());
+      bc.Decrease();
+    });
+  }
+  bc.WaitUntilCntEqualZero();
+}
+
+// the grain MultiThreadLoop picks, about four blocks per thread
+void DynamicLoop(ThreadPool* thread_pool, int64_t num,
+                 const std::function<void(int64_t, int64_t)>& Callback) {
+  const int64_t grain_size = std::max<int64_t>(1, num / (thread_pool->thread_num() * 4));
+  thread_pool->ParallelFor(0, num, grain_size, Callback);
+}
+
+// element i costs i + 1 units when is_skewed, one unit otherwise
+void BenchmarkLoop(BenchmarkState* state, bool is_dynamic, int64_t num, bool is_skewed) {
+  ThreadPool thread_pool(kThreadNum);
+  std::vector<double> outs(num);
+  auto Callback = [&outs, is_skewed](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      double value = i;
+      const int64_t cost = is_skewed ? i + 1 : 1;
+      FOR_RANGE(int64_t, j, 0, cost) { value = value * 0.999 + 1; }
+      outs[i] = value;
+    }
+  };
+  while (state->KeepRunning()) {
+    if (is_dynamic) {
+      DynamicLoop(&thread_pool, num, Callback);
+    } else {
+      StaticSplitLoop(&thread_pool, num, Callback);
+    }
+    DoNotOptimize(outs.data());
+  }
+  state->SetItemsProcessed(state->iterations() * num);
+}
+
+}  // namespace
+
+OF_BENCHMARK(ThreadPoolStaticSplit_64) { BenchmarkLoop(state, false, 64, false); }
+
+OF_BENCHMARK(ThreadPoolParallelFor_64) { BenchmarkLoop(state, true, 64, false); }
+
+OF_BENCHMARK(ThreadPoolStaticSplit_1M) { BenchmarkLoop(state, false, 1 << 20, false); }
+
+OF_BENCHMARK(ThreadPoolParallelFor_1M) { BenchmarkLoop(state, true, 1 << 20, false); }
+
+OF_BENCHMARK(ThreadPoolStaticSplit_4KSkewed) { BenchmarkLoop(state, false, 4096, true); }
+
+OF_BENCHMARK(ThreadPoolParallelFor_4KSkewed) { BenchmarkLoop(state, true, 4096, true); }
+
+}  // namespace oneflow
@@ -0,0 +1,62 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/common/blocking_counter.h"
+
+namespace oneflow {
+
+TEST(ThreadPool, add_work) {
+  ThreadPool pool(4);
+  std::atomic<int64_t> sum(0);
+  BlockingCounter bc(1000);
+  FOR_RANGE(int64_t, i, 0, 1000) {
+    pool.AddWork([i, &sum, &bc]() {
+      sum += i;
+      bc.Decrease();
+    });
+  }
+  bc.WaitUntilCntEqualZero();
+  ASSERT_EQ(sum, 999 * 1000 / 2);
+}
+
+TEST(ThreadPool, parallel_for) {
+  ThreadPool pool(4);
+  FOR_RANGE(int64_t, grain_size, 1, 40) {
+    std::vector<int32_t> visits(1000, 0);
+    pool.ParallelFor(3, 1000, grain_size, [&](int64_t begin, int64_t end) {
+      ASSERT_LE(end - begin, grain_size);
+      FOR_RANGE(int64_t, i, begin, end) { visits[i] += 1; }
+    });
+    FOR_RANGE(int64_t, i, 0, 1000) { ASSERT_EQ(visits[i], i < 3 ? 0 : 1); }
+  }
+}
+
+TEST(ThreadPool, nested_parallel_for) {
+  ThreadPool pool(3);
+  std::vector<std::vector<int32_t>> visits(64, std::vector<int32_t>(64, 0));
+  pool.ParallelFor(0, 64, 1, [&](int64_t outer_begin, int64_t outer_end) {
+    FOR_RANGE(int64_t, i, outer_begin, outer_end) {
+      pool.ParallelFor(0, 64, 4, [&](int64_t begin, int64_t end) {
+        FOR_RANGE(int64_t, j, begin, end) { visits[i][j] += 1; }
+      });
+    }
+  });
+  for (const auto& row : visits) {
+    for (int32_t visit : row) { ASSERT_EQ(visit, 1); }
+  }
+}
+
+}  // namespace oneflow
@@ -13,18 +13,101 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <algorithm>
 #include <cstdlib>
 #include "oneflow/core/vm/cpu_allocator.h"
+#include "oneflow/core/vm/host_caching_allocator.h"
+#include "oneflow/core/vm/thread_local_cached_allocator.h"
 #include "oneflow/core/common/util.h"
 
 namespace oneflow {
 namespace vm {
 
 void CpuAllocator::Allocate(char** mem_ptr, std::size_t size) {
+  CachingAllocator* caching = cur_caching_allocator_.load();
+  if (caching != nullptr) {
+    caching->front_end->Allocate(mem_ptr, size);
+    if (*mem_ptr != nullptr) {
+      caching->state.fetch_add(1);
+      return;
+    }
+  }
   *mem_ptr = reinterpret_cast<char*>(std::malloc(size));
 }
 
-void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) { std::free(mem_ptr); }
+void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) {
+  CachingAllocator* caching = cur_caching_allocator_.load();
+  if (caching == nullptr || !caching->backend->Owns(mem_ptr)) {
+    caching = nullptr;
+    if (has_retired_caching_allocator_.load()) { caching = FindRetiredCachingAllocator(mem_ptr); }
+  }
+  if (caching != nullptr) {
+    caching->front_end->Deallocate(mem_ptr, size);
+    if (caching->state.fetch_sub(1) == (kRetiredBit | 1)) {
+      DestroyRetiredCachingAllocator(caching);
+    }
+  } else {
+    std::free(mem_ptr);
+  }
+}
+
+void CpuAllocator::EnableCaching(bool use_hugepage) {
+  DisableCaching();
+  std::unique_lock<std::mutex> lock(mutex_);
+  CachingAllocator* caching = new CachingAllocator();
+  caching->backend = new HostCachingAllocator(use_hugepage);
+  caching->front_end.reset(
+      new ThreadLocalCachedAllocator(std::unique_ptr<Allocator>(caching->backend)));
+  caching->state = 0;
+  caching_allocators_.emplace_back(caching);
+  cur_caching_allocator_ = caching;
+}
+
+void CpuAllocator::DisableCaching() {
+  CachingAllocator* caching = nullptr;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    caching = cur_caching_allocator_.exchange(nullptr);
+    if (caching == nullptr) { return; }
+    caching->backend->Seal();
+    has_retired_caching_allocator_ = true;
+  }
+  if (caching->state.fetch_or(kRetiredBit) == 0) { DestroyRetiredCachingAllocator(caching); }
+}
+
+size_t CpuAllocator::RetiredCachingAllocatorNum() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return caching_allocators_.size() - (cur_caching_allocator_.load() == nullptr ? 0 : 1);
+}
+
+CpuAllocator::CachingAllocator* CpuAllocator::FindRetiredCachingAllocator(const char* mem_ptr) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (const auto& caching : caching_allocators_) {
+    if (caching.get() != cur_caching_allocator_.load() && caching->backend->Owns(mem_ptr)) {
+      return caching.get();
+    }
+  }
+  return nullptr;
+}
+
+void CpuAllocator::DestroyRetiredCachingAllocator(CachingAllocator* caching) {
+  std::unique_ptr<CachingAllocator> retired;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = std::find_if(
+        caching_allocators_.begin(), caching_allocators_.end(),
+        [caching](const std::unique_ptr<CachingAllocator>& ptr) { return ptr.get() == caching; });
+    CHECK(it != caching_allocators_.end());
+    retired = std::move(*it);
+    caching_allocators_.erase(it);
+    // Deallocate() skips the search while only the current one is left
+    if (caching_allocators_.size() == (cur_caching_allocator_.load() == nullptr ? 0 : 1)) {
+      has_retired_caching_allocator_ = false;
+    }
+  }
+  // unmaps the reserved range outside the lock
+  retired.reset();
+}
 
 COMMAND(Global<CpuAllocator>::SetAllocated(new CpuAllocator()));
 
@@ -16,19 +16,55 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_VM_CPU_ALLOCATOR_H_
 #define ONEFLOW_CORE_VM_CPU_ALLOCATOR_H_
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "oneflow/core/vm/allocator.h"
 
 namespace oneflow {
 namespace vm {
 
+class HostCachingAllocator;
+
+// Host memory comes from a HostCachingAllocator between EnableCaching() and DisableCaching(),
+// which the session globals call, and from malloc/free otherwise. Deallocate() finds the
+// allocator a pointer came from, so memory may outlive the session which allocated it; a retired
+// caching allocator is destroyed with the last of its memory.
+// EnableCaching() and DisableCaching() must not race with Allocate().
 class CpuAllocator final : public Allocator {
  public:
-  explicit CpuAllocator() = default;
+  explicit CpuAllocator()
+      : cur_caching_allocator_(nullptr), has_retired_caching_allocator_(false) {}
   ~CpuAllocator() override = default;
 
   void Allocate(char** mem_ptr, std::size_t size) override;
   void Deallocate(char* mem_ptr, std::size_t size) override;
+
+  void EnableCaching(bool use_hugepage);
+  void DisableCaching();
+
+  // retired caching allocators which still own allocated memory
+  size_t RetiredCachingAllocatorNum();
+
+ private:
+  struct CachingAllocator {
+    HostCachingAllocator* backend;
+    std::unique_ptr<Allocator> front_end;
+    // the number of live allocations, kRetiredBit is set once the allocator is retired, so that
+    // exactly one thread sees the value drop to kRetiredBit and destroys it
+    std::atomic<int64_t> state;
+  };
+  static const int64_t kRetiredBit = static_cast<int64_t>(1) << 62;
+  CachingAllocator* FindRetiredCachingAllocator(const char* mem_ptr);
+  void DestroyRetiredCachingAllocator(CachingAllocator* caching);
+
+  std::atomic<CachingAllocator*> cur_caching_allocator_;
+  std::atomic<bool> has_retired_caching_allocator_;
+  std::mutex mutex_;
+  // retired ones are sealed but kept alive for the memory still allocated from them
+  std::vector<std::unique_ptr<CachingAllocator>> caching_allocators_;
 };
 
 }  // namespace vm
@@ -0,0 +1,81 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/cpu_allocator.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace vm {
+
+TEST(CpuAllocator, free_across_sessions) {
+  CpuAllocator allocator;
+  char* malloc_ptr = nullptr;
+  allocator.Allocate(&malloc_ptr, 4096);
+  ASSERT_TRUE(malloc_ptr != nullptr);
+
+  allocator.EnableCaching(false);
+  std::vector<char*> session_1_ptrs;
+  for (size_t size : {64, 4096, 4 << 20}) {
+    char* ptr = nullptr;
+    allocator.Allocate(&ptr, size);
+    ASSERT_TRUE(ptr != nullptr);
+    std::memset(ptr, 1, size);
+    session_1_ptrs.push_back(ptr);
+  }
+  allocator.DisableCaching();
+
+  char* malloc_ptr_2 = nullptr;
+  allocator.Allocate(&malloc_ptr_2, 4096);
+  allocator.EnableCaching(false);
+  char* session_2_ptr = nullptr;
+  allocator.Allocate(&session_2_ptr, 4096);
+
+  // every pointer goes back to the allocator it came from
+  allocator.Deallocate(malloc_ptr, 4096);
+  allocator.Deallocate(malloc_ptr_2, 4096);
+  ASSERT_EQ(allocator.RetiredCachingAllocatorNum(), 1);
+  allocator.Deallocate(session_1_ptrs.at(0), 64);
+  allocator.Deallocate(session_1_ptrs.at(1), 4096);
+  ASSERT_EQ(allocator.RetiredCachingAllocatorNum(), 1);
+  // the retired allocator goes away with the last of its memory
+  allocator.Deallocate(session_1_ptrs.at(2), 4 << 20);
+  ASSERT_EQ(allocator.RetiredCachingAllocatorNum(), 0);
+  allocator.Deallocate(session_2_ptr, 4096);
+  allocator.DisableCaching();
+  ASSERT_EQ(allocator.RetiredCachingAllocatorNum(), 0);
+}
+
+TEST(CpuAllocator, retire_after_free) {
+  CpuAllocator allocator;
+  allocator.EnableCaching(false);
+  char* ptr = nullptr;
+  allocator.Allocate(&ptr, 4096);
+  allocator.Deallocate(ptr, 4096);
+  // nothing is left in it, so DisableCaching destroys it right away
+  allocator.EnableCaching(false);
+  ASSERT_EQ(allocator.RetiredCachingAllocatorNum(), 0);
+  allocator.Allocate(&ptr, 4096);
+  allocator.DisableCaching();
+  ASSERT_EQ(allocator.RetiredCachingAllocatorNum(), 1);
+  // freed after the session through the search of retired allocators
+  allocator.Deallocate(ptr, 4096);
+  ASSERT_EQ(allocator.RetiredCachingAllocatorNum(), 0);
+  char* malloc_ptr = nullptr;
+  allocator.Allocate(&malloc_ptr, 4096);
+  allocator.Deallocate(malloc_ptr, 4096);
+}
+
+}  // namespace vm
+}  // namespace oneflow
@@ -0,0 +1,339 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/host_caching_allocator.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <limits>
+
+namespace oneflow {
+namespace vm {
+
+namespace {
+
+const size_t kBlockAlignSize = 2 << 20;       // 2MiB, the size of a huge page
+const size_t kMaxBlockGrowSize = 256 << 20;   // 256MiB
+const size_t kPieceSplitThreshold = 1 << 20;  // 1MiB
+const size_t kMinCachedFreeBytes = 64 << 20;  // 64MiB
+const size_t kSealedSize = std::numeric_limits<size_t>::max();
+
+size_t DefaultReservedSize() {
+  return 2 * static_cast<size_t>(sysconf(_SC_PHYS_PAGES)) * static_cast<size_t>(getpagesize());
+}
+
+}  // namespace
+
+constexpr size_t HostCachingAllocator::kAlignSize;
+constexpr int32_t HostCachingAllocator::kInvalidBinNum;
+constexpr int32_t HostCachingAllocator::kBinNumSize;
+
+HostCachingAllocator::HostCachingAllocator(bool use_hugepage, size_t reserved_size)
+    : Allocator(),
+      use_hugepage_(use_hugepage),
+      reserved_ptr_(nullptr),
+      reserved_size_(0),
+      mapped_size_(0),
+      owned_size_(0),
+      recycle_piece_list_(nullptr) {
+  reserved_size = RoundUp(reserved_size == 0 ? DefaultReservedSize() : reserved_size,
+                          kBlockAlignSize);
+  // one more huge page so that the range can be aligned to it
+  const size_t map_size = reserved_size + kBlockAlignSize;
+  void* ptr = mmap(nullptr, map_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                   -1, 0);
+  if (ptr == MAP_FAILED) {
+    PLOG(WARNING) << "HostCachingAllocator failed to reserve " << reserved_size << " bytes";
+  } else {
+    char* map_ptr = static_cast<char*>(ptr);
+    reserved_ptr_ = reinterpret_cast<char*>(
+        RoundUp(reinterpret_cast<uintptr_t>(map_ptr), kBlockAlignSize));
+    reserved_size_ = reserved_size;
+    const size_t head_size = reserved_ptr_ - map_ptr;
+    if (head_size > 0) { PCHECK(munmap(map_ptr, head_size) == 0); }
+    const size_t tail_size = map_size - head_size - reserved_size_;
+    if (tail_size > 0) { PCHECK(munmap(reserved_ptr_ + reserved_size_, tail_size) == 0); }
+  }
+  owned_size_ = reserved_size_;
+  bins_.resize(kBinNumSize);
+  for (int i = 0; i < kBinNumSize; ++i) {
+    size_t bin_size = BinSize4BinNum(i);
+    bins_.at(i).size = bin_size;
+    CHECK_EQ(BinNum4BinSize(bin_size), i);
+    CHECK_EQ(BinNum4BinSize(bin_size + kAlignSize - 1), i);
+    CHECK_EQ(BinNum4BinSize(bin_size * 2 - 1), i);
+    CHECK_EQ(BinNum4BinSize(bin_size * 2), i == (kBinNumSize - 1) ? i : i + 1);
+  }
+}
+
+HostCachingAllocator::~HostCachingAllocator() {
+  LOG(INFO) << "HostCachingAllocator allocs: " << stats_.num_allocs
+            << ", block allocs: " << stats_.num_block_allocs
+            << ", block releases: " << stats_.num_block_releases
+            << ", peak allocated bytes: " << stats_.peak_allocated_bytes
+            << ", reserved bytes: " << stats_.reserved_bytes;
+  if (reserved_ptr_ != nullptr) { PCHECK(munmap(reserved_ptr_, owned_size_) == 0); }
+}
+
+bool HostCachingAllocator::Owns(const char* mem_ptr) const {
+  return mem_ptr >= reserved_ptr_ && mem_ptr < reserved_ptr_ + owned_size_.load();
+}
+
+void HostCachingAllocator::Seal() {
+  const size_t mapped_size = mapped_size_.exchange(kSealedSize);
+  if (mapped_size == kSealedSize) { return; }
+  // Blocks claimed before the exchange all lie below mapped_size
+  owned_size_ = mapped_size;
+  if (mapped_size < reserved_size_) {
+    PCHECK(munmap(reserved_ptr_ + mapped_size, reserved_size_ - mapped_size) == 0);
+  }
+}
+
+void HostCachingAllocator::InsertPiece2Bin(Piece* piece) {
+  CHECK(piece->is_free && piece->bin_num == kInvalidBinNum);
+  int32_t bin_num = BinNum4BinSize(piece->size);
+  piece->bin_num = bin_num;
+  CHECK(bins_.at(bin_num).pieces.insert(piece).second);
+}
+
+void HostCachingAllocator::RemovePieceFromBin(Piece* piece) {
+  CHECK(piece->is_free);
+  CHECK_NE(piece->bin_num, kInvalidBinNum);
+  CHECK_GT(bins_.at(piece->bin_num).pieces.erase(piece), 0);
+  piece->bin_num = kInvalidBinNum;
+}
+
+HostCachingAllocator::Piece* HostCachingAllocator::AllocatePiece() {
+  if (recycle_piece_list_) {
+    Piece* ret = recycle_piece_list_;
+    recycle_piece_list_ = recycle_piece_list_->next;
+    return ret;
+  } else {
+    pieces_.emplace_back(new Piece());
+    return pieces_.at(pieces_.size() - 1).get();
+  }
+}
+
+void HostCachingAllocator::DeallocatePiece(Piece* piece) {
+  piece->ptr = nullptr;
+  piece->size = 0;
+  piece->bin_num = kInvalidBinNum;
+  piece->is_free = true;
+  piece->prev = nullptr;
+  piece->next = recycle_piece_list_;
+  recycle_piece_list_ = piece;
+}
+
+void HostCachingAllocator::MarkPiece(Piece* piece) {
+  CHECK_NOTNULL(piece->ptr);
+  CHECK(ptr2piece_.emplace(piece->ptr, piece).second);
+}
+
+void HostCachingAllocator::UnMarkPiece(Piece* piece) {
+  CHECK_NOTNULL(piece->ptr);
+  auto it = ptr2piece_.find(piece->ptr);
+  CHECK(it != ptr2piece_.end());
+  ptr2piece_.erase(it);
+}
+
+HostCachingAllocator::Piece* HostCachingAllocator::FindPiece(size_t aligned_size) {
+  CHECK_EQ(aligned_size % kAlignSize, 0);
+  Piece key;
+  key.size = aligned_size;
+  for (int32_t bin_num = BinNum4BinSize(aligned_size); bin_num < kBinNumSize; ++bin_num) {
+    Bin* bin = &bins_.at(bin_num);
+    // best fit, pieces in a bin are ordered by size
+    auto it = bin->pieces.lower_bound(&key);
+    if (it == bin->pieces.end()) { continue; }
+    Piece* piece = *it;
+    CHECK(piece->is_free);
+    CHECK_EQ(piece->bin_num, bin_num);
+    CHECK_GE(piece->size, aligned_size);
+    bin->pieces.erase(it);
+    piece->bin_num = kInvalidBinNum;
+    piece->is_free = false;
+    if (stats_.released_bytes > 0) {
+      Block* block = Block4Ptr(piece->ptr);
+      if (block->is_released) {
+        // the released pages fault in again as zeroed ones
+        block->is_released = false;
+        stats_.released_bytes -= block->size;
+      }
+    }
+    const size_t remain_size = piece->size - aligned_size;
+    if (remain_size > 0 && remain_size >= std::min(aligned_size, kPieceSplitThreshold)) {
+      Piece* new_piece = AllocatePiece();
+      new_piece->ptr = piece->ptr + aligned_size;
+      new_piece->size = remain_size;
+      piece->size = aligned_size;
+
+      Piece* next_p = piece->next;
+      piece->next = new_piece;
+      new_piece->prev = piece;
+      new_piece->next = next_p;
+      if (next_p != nullptr) { next_p->prev = new_piece; }
+
+      new_piece->is_free = true;
+      new_piece->bin_num = kInvalidBinNum;
+      InsertPiece2Bin(new_piece);
+      MarkPiece(new_piece);
+    }
+    return piece;
+  }
+  return nullptr;
+}
+
+void HostCachingAllocator::MergeNeighbourFreePiece(Piece* lhs, Piece* rhs) {
+  CHECK(lhs->is_free);
+  CHECK(rhs->is_free);
+  CHECK(lhs->next == rhs);
+  CHECK(lhs == rhs->prev);
+  CHECK(lhs->ptr + lhs->size == rhs->ptr);
+
+  lhs->size += rhs->size;
+  lhs->next = rhs->next;
+  if (rhs->next != nullptr) { rhs->next->prev = lhs; }
+  UnMarkPiece(rhs);
+  DeallocatePiece(rhs);
+}
+
+char* HostCachingAllocator::MapMemory(size_t size) {
+  size_t offset = mapped_size_.load();
+  do {
+    if (offset == kSealedSize || offset + size > reserved_size_) { return nullptr; }
+  } while (!mapped_size_.compare_exchange_weak(offset, offset + size));
+  char* ptr = reserved_ptr_ + offset;
+  if (mprotect(ptr, size, PROT_READ | PROT_WRITE) != 0) {
+    // give the range back unless a later Block or Seal() has taken over the tail
+    size_t expected = offset + size;
+    mapped_size_.compare_exchange_strong(expected, offset);
+    return nullptr;
+  }
+#ifdef MADV_HUGEPAGE
+  // the range is aligned to huge pages, so transparent huge pages can back whole Blocks
+  if (use_hugepage_) { madvise(ptr, size, MADV_HUGEPAGE); }
+#endif
+  return ptr;
+}
+
+bool HostCachingAllocator::AllocateBlockToExtendTotalMem(size_t aligned_size) {
+  size_t allocate_bytes = std::max(kBlockAlignSize, aligned_size);
+  // grow geometrically so that a workload with growing demand needs few blocks
+  allocate_bytes = std::max(allocate_bytes, std::min(stats_.reserved_bytes, kMaxBlockGrowSize));
+  allocate_bytes = RoundUp(allocate_bytes, kBlockAlignSize);
+
+  char* mem_ptr = MapMemory(allocate_bytes);
+  if (mem_ptr == nullptr && allocate_bytes > RoundUp(aligned_size, kBlockAlignSize)) {
+    allocate_bytes = RoundUp(aligned_size, kBlockAlignSize);
+    mem_ptr = MapMemory(allocate_bytes);
+  }
+  if (mem_ptr == nullptr) { return false; }
+
+  stats_.reserved_bytes += allocate_bytes;
+  stats_.num_block_allocs += 1;
+
+  Piece* piece = AllocatePiece();
+  piece->size = allocate_bytes;
+  piece->ptr = mem_ptr;
+  piece->prev = nullptr;
+  piece->next = nullptr;
+  piece->is_free = true;
+  piece->bin_num = kInvalidBinNum;
+  InsertPiece2Bin(piece);
+  MarkPiece(piece);
+
+  CHECK(mem_ptr2block_.emplace(mem_ptr, Block(piece)).second);
+  return true;
+}
+
+HostCachingAllocator::Block* HostCachingAllocator::Block4Ptr(char* ptr) {
+  auto it = mem_ptr2block_.upper_bound(ptr);
+  CHECK(it != mem_ptr2block_.begin());
+  --it;
+  CHECK_LT(ptr, it->first + it->second.size);
+  return &it->second;
+}
+
+void HostCachingAllocator::MaybeReleaseBlock(Piece* piece) {
+  if (piece->prev != nullptr || piece->next != nullptr) { return; }
+  const size_t cached_free_bytes =
+      stats_.reserved_bytes - stats_.allocated_bytes - stats_.released_bytes;
+  if (cached_free_bytes <= std::max(stats_.allocated_bytes, kMinCachedFreeBytes)) { return; }
+  Block* block = Block4Ptr(piece->ptr);
+  CHECK_EQ(block->ptr, piece->ptr);
+  CHECK_EQ(block->size, piece->size);
+  if (block->is_released) { return; }
+  // keeps the mapping, the pages are dropped and fault in zeroed on the next use
+  PCHECK(madvise(block->ptr, block->size, MADV_DONTNEED) == 0);
+  block->is_released = true;
+  stats_.released_bytes += block->size;
+  stats_.num_block_releases += 1;
+}
+
+void HostCachingAllocator::Allocate(char** mem_ptr, std::size_t size) {
+  // zero sized allocations still get a distinct pointer, as malloc does
+  const size_t aligned_size = RoundUp(std::max(size, static_cast<size_t>(1)), kAlignSize);
+
+  Piece* piece = FindPiece(aligned_size);
+  if (piece == nullptr) {
+    if (AllocateBlockToExtendTotalMem(aligned_size)) { piece = FindPiece(aligned_size); }
+  }
+  if (piece == nullptr) {
+    *mem_ptr = nullptr;
+    return;
+  }
+  CHECK_NOTNULL(piece->ptr);
+  CHECK(ptr2piece_.find(piece->ptr) != ptr2piece_.end());
+  stats_.num_allocs += 1;
+  stats_.allocated_bytes += piece->size;
+  stats_.peak_allocated_bytes = std::max(stats_.peak_allocated_bytes, stats_.allocated_bytes);
+  *mem_ptr = piece->ptr;
+}
+
+void HostCachingAllocator::Deallocate(char* mem_ptr, std::size_t size) {
+  if (mem_ptr == nullptr) { return; }
+
+  auto it = ptr2piece_.find(mem_ptr);
+  CHECK(it != ptr2piece_.end()) << "Error! : Try deallocate mem_ptr non-existent. mem ptr = "
+                                << static_cast<void*>(mem_ptr) << " size = " << size;
+  Piece* piece = it->second;
+  CHECK_NOTNULL(piece);
+  CHECK_EQ(piece->ptr, mem_ptr);
+  CHECK(!piece->is_free);
+
+  piece->is_free = true;
+  stats_.allocated_bytes -= piece->size;
+
+  Piece* last_piece_insert_to_bin = piece;
+  Piece* next_p = piece->next;
+  Piece* prev_p = piece->prev;
+
+  if (next_p != nullptr && next_p->is_free) {
+    CHECK_EQ(next_p->ptr, piece->ptr + piece->size);
+    RemovePieceFromBin(next_p);
+    MergeNeighbourFreePiece(piece, next_p);
+  }
+
+  if (prev_p != nullptr && prev_p->is_free) {
+    CHECK_EQ(piece->ptr, prev_p->ptr + prev_p->size);
+    RemovePieceFromBin(prev_p);
+    MergeNeighbourFreePiece(prev_p, piece);
+    last_piece_insert_to_bin = prev_p;
+  }
+  InsertPiece2Bin(last_piece_insert_to_bin);
+  MaybeReleaseBlock(last_piece_insert_to_bin);
+}
+
+}  // namespace vm
+}  // namespace oneflow
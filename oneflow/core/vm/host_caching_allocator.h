@@ -0,0 +1,135 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_VM_HOST_CACHING_ALLOCATOR_H_
+#define ONEFLOW_CORE_VM_HOST_CACHING_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include "oneflow/core/vm/allocator.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace vm {
+
+// Caching allocator for pageable host memory, it has the same Block/Piece/Bin structure as
+// CudaAllocator: Blocks are carved from one address range reserved up front, split into Pieces on
+// Allocate() and free neighbour Pieces are coalesced on Deallocate(). The pages of a Block which
+// becomes completely free are given back to the system once the cached free bytes exceed the
+// allocated ones. Allocate() returns nullptr when the range or the system runs out of memory.
+// Not thread safe except Owns() and Seal(), wrap it with a thread safe front end when shared.
+class HostCachingAllocator final : public Allocator {
+ public:
+  // reserved_size 0 reserves twice the physical memory of the host
+  explicit HostCachingAllocator(bool use_hugepage, size_t reserved_size = 0);
+  ~HostCachingAllocator() override;
+
+  void Allocate(char** mem_ptr, std::size_t size) override;
+  void Deallocate(char* mem_ptr, std::size_t size) override;
+
+  // whether mem_ptr may have come from this allocator
+  bool Owns(const char* mem_ptr) const;
+  // stops the allocator from growing and gives the unused part of the reserved range back,
+  // memory allocated before can still be freed
+  void Seal();
+
+  struct Stats {
+    int64_t num_allocs = 0;
+    int64_t num_block_allocs = 0;
+    int64_t num_block_releases = 0;
+    size_t allocated_bytes = 0;
+    size_t peak_allocated_bytes = 0;
+    size_t reserved_bytes = 0;
+    size_t released_bytes = 0;
+  };
+  const Stats& stats() const { return stats_; }
+
+ private:
+  static constexpr size_t kAlignSize = 64;
+  static constexpr int32_t kInvalidBinNum = -1;
+  static constexpr int32_t kBinNumSize = 26;
+
+  struct Piece {
+    size_t size = 0;
+    char* ptr = nullptr;
+    bool is_free = false;
+    Piece* prev = nullptr;
+    Piece* next = nullptr;
+    int32_t bin_num = kInvalidBinNum;
+  };
+
+  //    BinNum:   Bin0, Bin1, Bin2, Bin3, ..., Bin25
+  //    BinSize:  64,   128,  256,  512,  ..., 2GB
+  struct Bin {
+    size_t size = 0;
+
+    struct PieceCmp {
+      bool operator()(const Piece* lhs, const Piece* rhs) const {
+        if (lhs->size != rhs->size) { return lhs->size < rhs->size; }
+        return lhs->ptr < rhs->ptr;
+      }
+    };
+    std::set<Piece*, PieceCmp> pieces;
+  };
+
+  struct Block {
+    size_t size = 0;
+    char* ptr = nullptr;
+    Piece* start_piece = nullptr;
+    bool is_released = false;
+    Block(Piece* p) : size(p->size), ptr(p->ptr), start_piece(p) {}
+  };
+
+  size_t BinSize4BinNum(int32_t bin_num) { return kAlignSize << bin_num; }
+
+  int32_t BinNum4BinSize(size_t size) {
+    uint64_t value = std::max(size, kAlignSize) >> 6;
+    return std::min(kBinNumSize - 1, static_cast<int32_t>(63 ^ __builtin_clzll(value)));
+  }
+
+  Piece* FindPiece(size_t aligned_size);
+  void InsertPiece2Bin(Piece* piece);
+  void RemovePieceFromBin(Piece* piece);
+  Piece* AllocatePiece();
+  void DeallocatePiece(Piece* piece);
+  void MarkPiece(Piece* piece);
+  void UnMarkPiece(Piece* piece);
+  void MergeNeighbourFreePiece(Piece* lhs, Piece* rhs);
+
+  char* MapMemory(size_t size);
+  bool AllocateBlockToExtendTotalMem(size_t aligned_size);
+  Block* Block4Ptr(char* ptr);
+  void MaybeReleaseBlock(Piece* piece);
+
+  const bool use_hugepage_;
+  char* reserved_ptr_;
+  size_t reserved_size_;
+  // bytes of the reserved range handed out to Blocks, kSealedSize after Seal()
+  std::atomic<size_t> mapped_size_;
+  std::atomic<size_t> owned_size_;
+  Stats stats_;
+  std::map<char*, Block> mem_ptr2block_;
+
+  std::vector<Bin> bins_;
+  std::vector<std::unique_ptr<Piece>> pieces_;
+  HashMap<char*, Piece*> ptr2piece_;
+  Piece* recycle_piece_list_;
+};
+
+}  // namespace vm
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_VM_HOST_CACHING_ALLOCATOR_H_
@@ -0,0 +1,105 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <cstdlib>
+#include "oneflow/core/vm/host_caching_allocator.h"
+#include "oneflow/core/common/benchmark.h"
+
+namespace oneflow {
+namespace vm {
+
+namespace {
+
+const int64_t kLiveNum = 16;
+
+class MallocAllocator final : public Allocator {
+ public:
+  MallocAllocator() = default;
+  ~MallocAllocator() override = default;
+
+  void Allocate(char** mem_ptr, std::size_t size) override {
+    *mem_ptr = reinterpret_cast<char*>(std::malloc(size));
+  }
+  void Deallocate(char* mem_ptr, std::size_t size) override { std::free(mem_ptr); }
+};
+
+// allocates op_num blobs of min_size up to 2^10 min_size, keeping the last kLiveNum alive like
+// the blobs of eager ops, and writes every blob once as a kernel would; a zero fill right after
+// malloc would be folded into calloc and fault in nothing
+void BenchmarkHostAllocator(BenchmarkState* state, Allocator* allocator, int64_t op_num,
+                            size_t min_size) {
+  std::vector<std::pair<char*, size_t>> live(kLiveNum);
+  int64_t bytes = 0;
+  while (state->KeepRunning()) {
+    FOR_RANGE(int64_t, i, 0, op_num) {
+      std::pair<char*, size_t>* slot = &live.at(i % kLiveNum);
+      if (slot->first != nullptr) { allocator->Deallocate(slot->first, slot->second); }
+      slot->second = min_size << ((i * 7) % 11);
+      allocator->Allocate(&slot->first, slot->second);
+      CHECK_NOTNULL(slot->first);
+      std::memset(slot->first, 1, slot->second);
+      DoNotOptimize(slot->first);
+      bytes += slot->second;
+    }
+  }
+  for (const auto& pair : live) {
+    if (pair.first != nullptr) { allocator->Deallocate(pair.first, pair.second); }
+  }
+  state->SetItemsProcessed(state->iterations() * op_num);
+  state->SetBytesProcessed(bytes);
+}
+
+// 4KiB-4MiB blobs stay below the mmap threshold glibc adapts to, 64KiB-64MiB ones go past it
+void BenchmarkAllocatorOnBlobs(BenchmarkState* state, Allocator* allocator, bool is_large) {
+  if (is_large) {
+    BenchmarkHostAllocator(state, allocator, 256, 64 << 10);
+  } else {
+    BenchmarkHostAllocator(state, allocator, 4096, 4 << 10);
+  }
+}
+
+void BenchmarkMalloc(BenchmarkState* state, bool is_large) {
+  MallocAllocator allocator;
+  BenchmarkAllocatorOnBlobs(state, &allocator, is_large);
+}
+
+void BenchmarkCachingAllocator(BenchmarkState* state, bool use_hugepage, bool is_large) {
+  HostCachingAllocator allocator(use_hugepage);
+  BenchmarkAllocatorOnBlobs(state, &allocator, is_large);
+  state->SetLabel(std::to_string(allocator.stats().num_block_allocs) + " blocks, "
+                  + std::to_string(allocator.stats().num_block_releases) + " releases, "
+                  + std::to_string(allocator.stats().reserved_bytes >> 20) + " MiB reserved");
+}
+
+}  // namespace
+
+OF_BENCHMARK(HostAllocatorMallocSmallBlobs) { BenchmarkMalloc(state, false); }
+
+OF_BENCHMARK(HostCachingAllocatorSmallBlobs) { BenchmarkCachingAllocator(state, false, false); }
+
+OF_BENCHMARK(HostCachingAllocatorHugepageSmallBlobs) {
+  BenchmarkCachingAllocator(state, true, false);
+}
+
+OF_BENCHMARK(HostAllocatorMallocLargeBlobs) { BenchmarkMalloc(state, true); }
+
+OF_BENCHMARK(HostCachingAllocatorLargeBlobs) { BenchmarkCachingAllocator(state, false, true); }
+
+OF_BENCHMARK(HostCachingAllocatorHugepageLargeBlobs) {
+  BenchmarkCachingAllocator(state, true, true);
+}
+
+}  // namespace vm
+}  // namespace oneflow
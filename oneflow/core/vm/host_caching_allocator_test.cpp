@@ -0,0 +1,152 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/host_caching_allocator.h"
+#include "oneflow/core/vm/thread_safe_allocator.h"
+
+namespace oneflow {
+namespace vm {
+
+TEST(HostCachingAllocator, allocate_and_deallocate) {
+  std::unique_ptr<Allocator> allo(new HostCachingAllocator(false));
+  allo.reset(new SingleThreadOnlyAllocator(std::move(allo)));
+  Allocator* a = allo.get();
+  std::vector<char*> ptrs;
+  for (int i = 0; i < 512; ++i) {
+    char* ptr = nullptr;
+    a->Allocate(&ptr, 1);
+    ASSERT_TRUE(ptr != nullptr);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr) % 64, 0);
+    ptrs.push_back(ptr);
+  }
+  std::sort(ptrs.begin(), ptrs.end());
+  for (int i = 0; i < 512; ++i) {
+    if (i > 0) { ASSERT_TRUE(ptrs.at(i) - ptrs.at(i - 1) >= 64); }
+    a->Deallocate(ptrs.at(i), 1);
+  }
+
+  ptrs.clear();
+  for (int i = 0; i < 2048; ++i) {
+    char* ptr = nullptr;
+    a->Allocate(&ptr, 10000 + i);
+    ASSERT_TRUE(ptr != nullptr);
+    ptrs.push_back(ptr);
+  }
+  std::sort(ptrs.begin(), ptrs.end());
+  for (int i = 0; i < 2048; ++i) {
+    if (i > 0) { ASSERT_TRUE(ptrs.at(i) - ptrs.at(i - 1) >= 10000); }
+    a->Deallocate(ptrs.at(i), 0);
+  }
+
+  char* data_ptr_1 = nullptr;
+  a->Allocate(&data_ptr_1, 2048 * sizeof(float));
+  char* data_ptr_2 = nullptr;
+  a->Allocate(&data_ptr_2, 4096 * sizeof(double));
+  ASSERT_TRUE(data_ptr_1 != data_ptr_2);
+  if (data_ptr_1 < data_ptr_2) {
+    ASSERT_TRUE(data_ptr_1 + 2048 * sizeof(float) <= data_ptr_2);
+  } else {
+    ASSERT_TRUE(data_ptr_2 + 4096 * sizeof(double) <= data_ptr_1);
+  }
+  std::memset(data_ptr_1, 1, 2048 * sizeof(float));
+  std::memset(data_ptr_2, 2, 4096 * sizeof(double));
+  a->Deallocate(data_ptr_2, 4096 * sizeof(double));
+  a->Deallocate(data_ptr_1, 2048 * sizeof(float));
+}
+
+TEST(HostCachingAllocator, reuse_and_coalesce) {
+  HostCachingAllocator allocator(false);
+  char* ptr_1 = nullptr;
+  char* ptr_2 = nullptr;
+  allocator.Allocate(&ptr_1, 4096);
+  allocator.Allocate(&ptr_2, 4096);
+  const size_t reserved_bytes = allocator.stats().reserved_bytes;
+  ASSERT_EQ(allocator.stats().num_block_allocs, 1);
+  ASSERT_EQ(allocator.stats().allocated_bytes, 8192);
+  allocator.Deallocate(ptr_1, 4096);
+  allocator.Deallocate(ptr_2, 4096);
+  ASSERT_EQ(allocator.stats().allocated_bytes, 0);
+  ASSERT_EQ(allocator.stats().peak_allocated_bytes, 8192);
+
+  // the two freed neighbours are merged back, so a request covering both needs no new block
+  char* ptr_3 = nullptr;
+  allocator.Allocate(&ptr_3, 8192);
+  ASSERT_EQ(ptr_3, std::min(ptr_1, ptr_2));
+  ASSERT_EQ(allocator.stats().num_block_allocs, 1);
+  ASSERT_EQ(allocator.stats().reserved_bytes, reserved_bytes);
+  allocator.Deallocate(ptr_3, 8192);
+}
+
+TEST(HostCachingAllocator, release_free_block) {
+  const size_t size = 96 << 20;
+  HostCachingAllocator allocator(false, 512 << 20);
+  char* ptr_1 = nullptr;
+  allocator.Allocate(&ptr_1, size);
+  ASSERT_TRUE(ptr_1 != nullptr);
+  std::memset(ptr_1, 1, size);
+  allocator.Deallocate(ptr_1, size);
+  ASSERT_EQ(allocator.stats().num_block_releases, 1);
+  ASSERT_EQ(allocator.stats().released_bytes, size);
+
+  // the released block is reused and its pages come back zeroed
+  char* ptr_2 = nullptr;
+  allocator.Allocate(&ptr_2, size);
+  ASSERT_EQ(ptr_2, ptr_1);
+  ASSERT_EQ(allocator.stats().num_block_allocs, 1);
+  ASSERT_EQ(allocator.stats().released_bytes, 0);
+  ASSERT_EQ(ptr_2[0], 0);
+  ASSERT_EQ(ptr_2[size - 1], 0);
+
+  // small free blocks stay cached
+  char* ptr_3 = nullptr;
+  allocator.Allocate(&ptr_3, 4096);
+  allocator.Deallocate(ptr_3, 4096);
+  ASSERT_EQ(allocator.stats().num_block_releases, 1);
+  allocator.Deallocate(ptr_2, size);
+}
+
+TEST(HostCachingAllocator, owns_and_seal) {
+  HostCachingAllocator allocator(false, 32 << 20);
+  char* ptr_1 = nullptr;
+  allocator.Allocate(&ptr_1, 4096);
+  ASSERT_TRUE(ptr_1 != nullptr);
+  ASSERT_TRUE(allocator.Owns(ptr_1));
+  char stack_buf[16];
+  ASSERT_FALSE(allocator.Owns(stack_buf));
+  std::unique_ptr<char[]> heap_buf(new char[16]);
+  ASSERT_FALSE(allocator.Owns(heap_buf.get()));
+
+  // more than the reserved range
+  char* ptr_2 = nullptr;
+  allocator.Allocate(&ptr_2, 64 << 20);
+  ASSERT_TRUE(ptr_2 == nullptr);
+
+  allocator.Seal();
+  ASSERT_TRUE(allocator.Owns(ptr_1));
+  ASSERT_FALSE(allocator.Owns(ptr_1 + allocator.stats().reserved_bytes));
+  // a sealed allocator still serves from its free pieces but no longer grows
+  char* ptr_3 = nullptr;
+  allocator.Allocate(&ptr_3, 4096);
+  ASSERT_TRUE(ptr_3 != nullptr);
+  char* ptr_4 = nullptr;
+  allocator.Allocate(&ptr_4, 16 << 20);
+  ASSERT_TRUE(ptr_4 == nullptr);
+  allocator.Deallocate(ptr_3, 4096);
+  allocator.Deallocate(ptr_1, 4096);
+  ASSERT_EQ(allocator.stats().allocated_bytes, 0);
+}
+
+}  // namespace vm
+}  // namespace oneflow
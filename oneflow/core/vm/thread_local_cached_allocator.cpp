@@ -0,0 +1,230 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/thread_local_cached_allocator.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace vm {
+
+namespace {
+
+// size classes: 256B, then four classes per power of two up to 1MiB
+const size_t kMinClassSize = 256;
+const size_t kMaxCachedSize = 1 << 20;
+const int32_t kNumSizeClasses = 49;
+const size_t kMaxMagazineBytes = 2 << 20;
+const size_t kMaxMagazineLength = 64;
+const size_t kMaxThreadCacheBytes = 32 << 20;
+const int64_t kRebalanceInterval = 4096;
+
+int32_t SizeClass4Size(size_t size) {
+  if (size <= kMinClassSize) { return 0; }
+  const uint64_t value = size - 1;
+  const int32_t lg = 63 ^ __builtin_clzll(value);
+  const int32_t sub = static_cast<int32_t>((value >> (lg - 2)) & 3);
+  return (lg - 8) * 4 + sub + 1;
+}
+
+size_t Size4SizeClass(int32_t size_class) {
+  if (size_class == 0) { return kMinClassSize; }
+  const int32_t lg = 8 + (size_class - 1) / 4;
+  const int32_t sub = (size_class - 1) % 4;
+  return (static_cast<size_t>(1) << lg) + (sub + 1) * (static_cast<size_t>(1) << (lg - 2));
+}
+
+size_t MagazineCapacity4SizeClass(int32_t size_class) {
+  return std::max<size_t>(
+      2, std::min(kMaxMagazineLength, kMaxMagazineBytes / Size4SizeClass(size_class)));
+}
+
+}  // namespace
+
+struct ThreadLocalCachedAllocator::SharedBackend final {
+  SharedBackend() : is_closed(false) {}
+
+  std::mutex mutex;
+  // reset when the front end is destroyed, caches of other threads then drop their chunks
+  std::unique_ptr<Allocator> allocator;
+  // lets threads prune their caches of destroyed front ends without taking the mutex
+  std::atomic<bool> is_closed;
+};
+
+struct ThreadLocalCachedAllocator::ThreadCache final {
+  struct Magazine {
+    std::vector<char*> ptrs;
+    size_t low_water = 0;
+  };
+
+  explicit ThreadCache(const std::shared_ptr<SharedBackend>& backend)
+      : backend(backend), cached_bytes(0), op_cnt(0) {}
+  ~ThreadCache() {
+    FOR_RANGE(int32_t, i, 0, kNumSizeClasses) { Release(i, magazines[i].ptrs.size()); }
+  }
+
+  void Allocate(int32_t size_class, char** mem_ptr);
+  void Deallocate(int32_t size_class, char* mem_ptr);
+  void Refill(int32_t size_class);
+  // returns the num oldest chunks of the magazine to the backend
+  void Release(int32_t size_class, size_t num);
+  void MaybeRebalance();
+
+  std::shared_ptr<SharedBackend> backend;
+  std::array<Magazine, kNumSizeClasses> magazines;
+  size_t cached_bytes;
+  int64_t op_cnt;
+};
+
+void ThreadLocalCachedAllocator::ThreadCache::Allocate(int32_t size_class, char** mem_ptr) {
+  Magazine* magazine = &magazines[size_class];
+  if (magazine->ptrs.empty()) { Refill(size_class); }
+  if (magazine->ptrs.empty()) {
+    *mem_ptr = nullptr;
+    return;
+  }
+  *mem_ptr = magazine->ptrs.back();
+  magazine->ptrs.pop_back();
+  magazine->low_water = std::min(magazine->low_water, magazine->ptrs.size());
+  cached_bytes -= Size4SizeClass(size_class);
+  MaybeRebalance();
+}
+
+void ThreadLocalCachedAllocator::ThreadCache::Deallocate(int32_t size_class, char* mem_ptr) {
+  Magazine* magazine = &magazines[size_class];
+  const size_t class_size = Size4SizeClass(size_class);
+  if (cached_bytes + class_size > kMaxThreadCacheBytes) {
+    FOR_RANGE(int32_t, i, 0, kNumSizeClasses) {
+      Release(i, (magazines[i].ptrs.size() + 1) / 2);
+    }
+  }
+  if (magazine->ptrs.size() >= MagazineCapacity4SizeClass(size_class)) {
+    Release(size_class, (magazine->ptrs.size() + 1) / 2);
+  }
+  magazine->ptrs.push_back(mem_ptr);
+  cached_bytes += class_size;
+  MaybeRebalance();
+}
+
+void ThreadLocalCachedAllocator::ThreadCache::Refill(int32_t size_class) {
+  Magazine* magazine = &magazines[size_class];
+  const size_t class_size = Size4SizeClass(size_class);
+  const size_t num = std::max<size_t>(1, MagazineCapacity4SizeClass(size_class) / 2);
+  std::unique_lock<std::mutex> lock(backend->mutex);
+  CHECK(backend->allocator);
+  FOR_RANGE(size_t, i, 0, num) {
+    char* mem_ptr = nullptr;
+    backend->allocator->Allocate(&mem_ptr, class_size);
+    if (mem_ptr == nullptr) { break; }
+    magazine->ptrs.push_back(mem_ptr);
+    cached_bytes += class_size;
+  }
+}
+
+void ThreadLocalCachedAllocator::ThreadCache::Release(int32_t size_class, size_t num) {
+  if (num == 0) { return; }
+  Magazine* magazine = &magazines[size_class];
+  const size_t class_size = Size4SizeClass(size_class);
+  {
+    std::unique_lock<std::mutex> lock(backend->mutex);
+    if (backend->allocator) {
+      FOR_RANGE(size_t, i, 0, num) {
+        backend->allocator->Deallocate(magazine->ptrs.at(i), class_size);
+      }
+    }
+  }
+  magazine->ptrs.erase(magazine->ptrs.begin(), magazine->ptrs.begin() + num);
+  magazine->low_water = std::min(magazine->low_water, magazine->ptrs.size());
+  cached_bytes -= num * class_size;
+}
+
+void ThreadLocalCachedAllocator::ThreadCache::MaybeRebalance() {
+  if (++op_cnt % kRebalanceInterval != 0) { return; }
+  // chunks below the low water mark were not touched during the whole interval
+  FOR_RANGE(int32_t, i, 0, kNumSizeClasses) {
+    Release(i, (magazines[i].low_water + 1) / 2);
+    magazines[i].low_water = magazines[i].ptrs.size();
+  }
+}
+
+ThreadLocalCachedAllocator::ThreadLocalCachedAllocator(
+    std::unique_ptr<Allocator>&& backend_allocator)
+    : Allocator(), shared_backend_(new SharedBackend()) {
+  shared_backend_->allocator = std::move(backend_allocator);
+}
+
+ThreadLocalCachedAllocator::~ThreadLocalCachedAllocator() {
+  std::vector<std::unique_ptr<ThreadCache>>* thread_caches = MutThreadCaches();
+  thread_caches->erase(std::remove_if(thread_caches->begin(), thread_caches->end(),
+                                      [this](const std::unique_ptr<ThreadCache>& thread_cache) {
+                                        return thread_cache->backend == shared_backend_;
+                                      }),
+                       thread_caches->end());
+  std::unique_lock<std::mutex> lock(shared_backend_->mutex);
+  shared_backend_->allocator.reset();
+  shared_backend_->is_closed = true;
+}
+
+void ThreadLocalCachedAllocator::Allocate(char** mem_ptr, std::size_t size) {
+  if (size == 0 || size > kMaxCachedSize) {
+    std::unique_lock<std::mutex> lock(shared_backend_->mutex);
+    shared_backend_->allocator->Allocate(mem_ptr, size);
+  } else {
+    GetThreadCache()->Allocate(SizeClass4Size(size), mem_ptr);
+  }
+}
+
+void ThreadLocalCachedAllocator::Deallocate(char* mem_ptr, std::size_t size) {
+  if (size == 0 || size > kMaxCachedSize) {
+    std::unique_lock<std::mutex> lock(shared_backend_->mutex);
+    shared_backend_->allocator->Deallocate(mem_ptr, size);
+  } else {
+    GetThreadCache()->Deallocate(SizeClass4Size(size), mem_ptr);
+  }
+}
+
+size_t ThreadLocalCachedAllocator::ThreadCacheNum4CurrentThread() {
+  return MutThreadCaches()->size();
+}
+
+std::vector<std::unique_ptr<ThreadLocalCachedAllocator::ThreadCache>>*
+ThreadLocalCachedAllocator::MutThreadCaches() {
+  // one cache per front end used by the thread, flushed back to the backends when it exits
+  static thread_local std::vector<std::unique_ptr<ThreadCache>> thread_caches;
+  return &thread_caches;
+}
+
+ThreadLocalCachedAllocator::ThreadCache* ThreadLocalCachedAllocator::GetThreadCache() {
+  std::vector<std::unique_ptr<ThreadCache>>* thread_caches = MutThreadCaches();
+  for (const std::unique_ptr<ThreadCache>& thread_cache : *thread_caches) {
+    // the cache holds its backend, so the address cannot be reused by another front end
+    if (thread_cache->backend == shared_backend_) { return thread_cache.get(); }
+  }
+  thread_caches->erase(std::remove_if(thread_caches->begin(), thread_caches->end(),
+                                      [](const std::unique_ptr<ThreadCache>& thread_cache) {
+                                        return thread_cache->backend->is_closed.load();
+                                      }),
+                       thread_caches->end());
+  thread_caches->emplace_back(new ThreadCache(shared_backend_));
+  return thread_caches->back().get();
+}
+
+}  // namespace vm
+
+}  // namespace oneflow
@@ -0,0 +1,60 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_VM_THREAD_LOCAL_CACHED_ALLOCATOR_H_
+#define ONEFLOW_CORE_VM_THREAD_LOCAL_CACHED_ALLOCATOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "oneflow/core/vm/allocator.h"
+
+namespace oneflow {
+
+namespace vm {
+
+// Thread safe front end of a backend allocator. Every thread keeps a magazine of freed chunks
+// per size class, so most Allocate/Deallocate calls touch no lock at all. Magazines are refilled
+// from and flushed to the backend in batches under the backend mutex, and chunks which stay idle
+// are returned to the backend periodically.
+// Deallocate must be called with the size passed to Allocate, size 0 bypasses the magazines.
+// Meant for host memory: the backend cannot reclaim chunks cached by threads, which would defeat
+// the garbage collection a device allocator does when it runs out of memory.
+class ThreadLocalCachedAllocator final : public Allocator {
+ public:
+  explicit ThreadLocalCachedAllocator(std::unique_ptr<Allocator>&& backend_allocator);
+  ~ThreadLocalCachedAllocator() override;
+
+  void Allocate(char** mem_ptr, std::size_t size) override;
+  void Deallocate(char* mem_ptr, std::size_t size) override;
+
+  // caches the calling thread holds, including those of destroyed allocators not yet pruned
+  static size_t ThreadCacheNum4CurrentThread();
+
+ private:
+  struct SharedBackend;
+  struct ThreadCache;
+
+  static std::vector<std::unique_ptr<ThreadCache>>* MutThreadCaches();
+  ThreadCache* GetThreadCache();
+
+  std::shared_ptr<SharedBackend> shared_backend_;
+};
+
+}  // namespace vm
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_VM_THREAD_LOCAL_CACHED_ALLOCATOR_H_
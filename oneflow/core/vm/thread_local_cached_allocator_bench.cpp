@@ -0,0 +1,77 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <thread>
+#include "oneflow/core/vm/thread_local_cached_allocator.h"
+#include "oneflow/core/vm/thread_safe_allocator.h"
+#include "oneflow/core/vm/host_caching_allocator.h"
+#include "oneflow/core/common/benchmark.h"
+
+namespace oneflow {
+namespace vm {
+
+namespace {
+
+const int64_t kOpNumPerThread = 1 << 16;
+const int64_t kLiveNum = 16;
+
+// thread_num threads each allocate kOpNumPerThread chunks of 256B-64KiB, keeping the last
+// kLiveNum alive like the temporary blobs of eager ops; the threads start with empty caches
+void BenchmarkAllocator(BenchmarkState* state, bool is_cached, int64_t thread_num) {
+  std::unique_ptr<Allocator> backend(new HostCachingAllocator(false));
+  std::unique_ptr<Allocator> allocator;
+  if (is_cached) {
+    allocator.reset(new ThreadLocalCachedAllocator(std::move(backend)));
+  } else {
+    allocator.reset(new ThreadSafeAllocator(std::move(backend)));
+  }
+  while (state->KeepRunning()) {
+    std::vector<std::thread> threads;
+    FOR_RANGE(int64_t, t, 0, thread_num) {
+      threads.emplace_back([&allocator, t]() {
+        std::vector<std::pair<char*, size_t>> live(kLiveNum);
+        FOR_RANGE(int64_t, i, 0, kOpNumPerThread) {
+          std::pair<char*, size_t>* slot = &live.at(i % kLiveNum);
+          if (slot->first != nullptr) { allocator->Deallocate(slot->first, slot->second); }
+          slot->second = 256 << ((i * 7 + t) % 9);
+          allocator->Allocate(&slot->first, slot->second);
+          CHECK_NOTNULL(slot->first);
+        }
+        for (const auto& pair : live) { allocator->Deallocate(pair.first, pair.second); }
+      });
+    }
+    for (std::thread& thread : threads) { thread.join(); }
+  }
+  // an allocation and a deallocation per op
+  state->SetItemsProcessed(state->iterations() * thread_num * kOpNumPerThread * 2);
+  state->SetLabel(std::to_string(thread_num) + " thread(s)");
+}
+
+}  // namespace
+
+OF_BENCHMARK(ThreadSafeAllocator_1Thread) { BenchmarkAllocator(state, false, 1); }
+
+OF_BENCHMARK(ThreadLocalCachedAllocator_1Thread) { BenchmarkAllocator(state, true, 1); }
+
+OF_BENCHMARK(ThreadSafeAllocator_4Threads) { BenchmarkAllocator(state, false, 4); }
+
+OF_BENCHMARK(ThreadLocalCachedAllocator_4Threads) { BenchmarkAllocator(state, true, 4); }
+
+OF_BENCHMARK(ThreadSafeAllocator_32Threads) { BenchmarkAllocator(state, false, 32); }
+
+OF_BENCHMARK(ThreadLocalCachedAllocator_32Threads) { BenchmarkAllocator(state, true, 32); }
+
+}  // namespace vm
+}  // namespace oneflow
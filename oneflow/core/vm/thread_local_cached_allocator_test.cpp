@@ -0,0 +1,109 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <thread>
+#include "oneflow/core/vm/thread_local_cached_allocator.h"
+#include "oneflow/core/vm/host_caching_allocator.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace vm {
+
+TEST(ThreadLocalCachedAllocator, reuse_freed_chunk) {
+  ThreadLocalCachedAllocator allocator(
+      std::unique_ptr<Allocator>(new HostCachingAllocator(false)));
+  char* ptr_1 = nullptr;
+  allocator.Allocate(&ptr_1, 1000);
+  ASSERT_TRUE(ptr_1 != nullptr);
+  allocator.Deallocate(ptr_1, 1000);
+  char* ptr_2 = nullptr;
+  // same size class
+  allocator.Allocate(&ptr_2, 1010);
+  ASSERT_EQ(ptr_1, ptr_2);
+  allocator.Deallocate(ptr_2, 1010);
+
+  char* big_ptr = nullptr;
+  allocator.Allocate(&big_ptr, 4 << 20);
+  ASSERT_TRUE(big_ptr != nullptr);
+  std::memset(big_ptr, 0, 4 << 20);
+  allocator.Deallocate(big_ptr, 4 << 20);
+}
+
+TEST(ThreadLocalCachedAllocator, multi_thread) {
+  ThreadLocalCachedAllocator allocator(
+      std::unique_ptr<Allocator>(new HostCachingAllocator(false)));
+  const int64_t thread_num = 8;
+  const int64_t iter_num = 20000;
+  std::vector<std::vector<std::pair<char*, size_t>>> leftovers(thread_num);
+  std::vector<std::thread> threads;
+  FOR_RANGE(int64_t, t, 0, thread_num) {
+    threads.emplace_back([&allocator, &leftovers, t, iter_num]() {
+      std::vector<std::pair<char*, size_t>> live;
+      FOR_RANGE(int64_t, i, 0, iter_num) {
+        const size_t size = 1 + (i * 7919 + t * 104729) % (64 << 10);
+        char* ptr = nullptr;
+        allocator.Allocate(&ptr, size);
+        ASSERT_TRUE(ptr != nullptr);
+        std::memset(ptr, static_cast<int>(t), size);
+        live.emplace_back(ptr, size);
+        if (live.size() > 64) {
+          const std::pair<char*, size_t>& chunk = live.at(i % live.size());
+          ASSERT_EQ(chunk.first[0], static_cast<char>(t));
+          ASSERT_EQ(chunk.first[chunk.second - 1], static_cast<char>(t));
+          allocator.Deallocate(chunk.first, chunk.second);
+          live.at(i % live.size()) = live.back();
+          live.pop_back();
+        }
+      }
+      leftovers.at(t) = live;
+    });
+  }
+  for (std::thread& thread : threads) { thread.join(); }
+  // chunks may be freed by a thread other than the one which allocated them
+  for (const auto& live : leftovers) {
+    for (const auto& chunk : live) { allocator.Deallocate(chunk.first, chunk.second); }
+  }
+}
+
+TEST(ThreadLocalCachedAllocator, prune_caches_of_destroyed_allocators) {
+  std::thread thread([]() {
+    const size_t thread_cache_num = ThreadLocalCachedAllocator::ThreadCacheNum4CurrentThread();
+    std::unique_ptr<ThreadLocalCachedAllocator> outer(new ThreadLocalCachedAllocator(
+        std::unique_ptr<Allocator>(new HostCachingAllocator(false, 64 << 20))));
+    char* outer_ptr = nullptr;
+    outer->Allocate(&outer_ptr, 512);
+    FOR_RANGE(int32_t, i, 0, 100) {
+      ThreadLocalCachedAllocator allocator(
+          std::unique_ptr<Allocator>(new HostCachingAllocator(false, 64 << 20)));
+      char* ptr = nullptr;
+      allocator.Allocate(&ptr, 512);
+      allocator.Deallocate(ptr, 512);
+      ASSERT_EQ(ThreadLocalCachedAllocator::ThreadCacheNum4CurrentThread(),
+                thread_cache_num + 2);
+    }
+    // the cache of a front end destroyed on another thread goes on the next miss
+    std::thread([&outer]() { outer.reset(); }).join();
+    ThreadLocalCachedAllocator allocator(
+        std::unique_ptr<Allocator>(new HostCachingAllocator(false, 64 << 20)));
+    char* ptr = nullptr;
+    allocator.Allocate(&ptr, 512);
+    allocator.Deallocate(ptr, 512);
+    ASSERT_EQ(ThreadLocalCachedAllocator::ThreadCacheNum4CurrentThread(), thread_cache_num + 1);
+  });
+  thread.join();
+}
+
+}  // namespace vm
+}  // namespace oneflow
@@ -137,6 +137,13 @@ def StartGlobalSession():
         raise JobBuildAndInferError(error)
 
 
+def WaitUntilSnapshotWritten(snapshot_path):
+    error_str = oneflow_internal.WaitUntilSnapshotWritten(snapshot_path)
+    error = text_format.Parse(error_str, error_util.ErrorProto())
+    if error.HasField("error_type"):
+        raise JobBuildAndInferError(error)
+
+
 def StopGlobalSession():
     error_str = oneflow_internal.StopGlobalSession()
     error = text_format.Parse(error_str, error_util.ErrorProto())
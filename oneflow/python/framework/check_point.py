@@ -17,6 +17,7 @@ import datetime
 import os
 
 import numpy as np
+import oneflow.python.framework.c_api_util as c_api_util
 import oneflow.python.framework.hob as hob
 import oneflow.python.framework.job_instance as job_instance
 import oneflow.python.framework.session_context as session_ctx
@@ -46,6 +47,19 @@ class CheckPoint(object):
         assert type(path) is str
         enable_if.unique([lazy_checkpoint_save, eager_checkpoint_save])(path)
 
+    @session_ctx.try_init_default_session
+    def sync(self, path: str) -> None:
+        r"""Block until the checkpoint saved to `path` has been written by this process. Only
+        needed with `oneflow.config.enable_async_snapshot_save`, loading a checkpoint and closing
+        the session wait by themselves.
+
+        Args:
+            path: A `string` of path the checkpoint was saved to.
+        """
+        assert type(path) is str
+        session_ctx.GetDefaultSession().Sync()
+        c_api_util.WaitUntilSnapshotWritten(path)
+
     @session_ctx.try_init_default_session
     def init(self) -> None:
         r"""Initialize models by default initializer of op or Job.
@@ -118,6 +118,80 @@ def comm_net_worker_num(val):
     sess.config_proto.resource.comm_net_worker_num = val
 
 
+@oneflow_export("config.comm_net_stream_shard_num")
+def api_comm_net_stream_shard_num(val: int) -> None:
+    r"""Set up the number of threads which run the callbacks of finished network reads, the
+            read streams of the actors are spread over them. At most one thread per CPU core
+            is used.
+
+    Args:
+        val (int): number of threads
+    """
+    return enable_if.unique([comm_net_stream_shard_num, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def comm_net_stream_shard_num(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.comm_net_stream_shard_num = val
+
+
+@oneflow_export("config.comm_net_connection_num_per_peer")
+def api_comm_net_connection_num_per_peer(val: int) -> None:
+    r"""Set up the number of TCP connections to each peer in epoll mode network, large
+            transfers are split into chunks striped across the connections.
+
+    Args:
+        val (int): number of connections per peer
+    """
+    return enable_if.unique([comm_net_connection_num_per_peer, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def comm_net_connection_num_per_peer(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.comm_net_connection_num_per_peer = val
+
+
+@oneflow_export("config.comm_net_stripe_min_kbyte")
+def api_comm_net_stripe_min_kbyte(val: int) -> None:
+    r"""Set up the size from which a transfer in epoll mode network is striped across the
+            connections to its peer.
+
+    Args:
+        val (int): size in KB
+    """
+    return enable_if.unique([comm_net_stripe_min_kbyte, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def comm_net_stripe_min_kbyte(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.comm_net_stripe_min_kbyte = val
+
+
+@oneflow_export("config.enable_shm_comm_net")
+def api_enable_shm_comm_net(val: bool = True) -> None:
+    r"""Whether or not to use shared memory for the network when all machines run on the same
+            host. It is used automatically in that case if /dev/shm has room for the host memory
+            used by the network, set it to False to always use sockets.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([enable_shm_comm_net, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def enable_shm_comm_net(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.enable_shm_comm_net = val
+
+
 @oneflow_export("config.max_mdsave_worker_num")
 def api_max_mdsave_worker_num(val: int) -> None:
     r"""Set up max number of workers for mdsave process.
@@ -152,6 +226,41 @@ def enable_numa_aware_cuda_malloc_host(val):
     sess.config_proto.resource.enable_numa_aware_cuda_malloc_host = val
 
 
+@oneflow_export("config.enable_host_caching_allocator")
+def api_enable_host_caching_allocator(val: bool = True) -> None:
+    r"""Whether or not cache host memory in a size-binned allocator instead of calling
+    malloc/free for every allocation.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([enable_host_caching_allocator, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def enable_host_caching_allocator(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.enable_host_caching_allocator = val
+
+
+@oneflow_export("config.host_caching_allocator_use_hugepage")
+def api_host_caching_allocator_use_hugepage(val: bool = True) -> None:
+    r"""Whether or not back the host caching allocator with huge pages.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([host_caching_allocator_use_hugepage, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def host_caching_allocator_use_hugepage(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.host_caching_allocator_use_hugepage = val
+
+
 @oneflow_export("config.compute_thread_pool_size")
 def api_compute_thread_pool_size(val: int) -> None:
     r"""Set up the size of compute thread pool
@@ -255,6 +364,24 @@ def use_rdma(val=True):
     sess.config_proto.resource.use_rdma = val
 
 
+@oneflow_export("config.use_io_uring")
+def api_use_io_uring(val: bool = True) -> None:
+    r"""Whether use io_uring instead of epoll for data transmission in cluster nodes or not,
+          oneflow has to be built with BUILD_IO_URING.
+
+    Args:
+        val (bool, optional):  Defaults to True.
+    """
+    return enable_if.unique([use_io_uring, do_nothing])(val=val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def use_io_uring(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.use_io_uring = val
+
+
 @oneflow_export("config.thread_enable_local_message_queue")
 def api_thread_enable_local_message_queue(val: bool) -> None:
     """Whether or not enable thread using local  message queue.
@@ -340,6 +467,129 @@ def enable_model_io_v2(val):
     sess.config_proto.io_conf.enable_model_io_v2 = val
 
 
+@oneflow_export("config.enable_mmap_ofrecord_reader")
+def api_enable_mmap_ofrecord_reader(val: bool = True) -> None:
+    r"""Whether or not let ofrecord readers map local part files into memory and hand out
+    records without copying them.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([enable_mmap_ofrecord_reader, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def enable_mmap_ofrecord_reader(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.io_conf.enable_mmap_ofrecord_reader = val
+
+
+@oneflow_export("config.data_reader_num_workers")
+def api_data_reader_num_workers(val: int) -> None:
+    r"""Set up the number of workers which load and prepare batches for each data reader
+
+    Args:
+        val (int): e.g. 4
+    """
+    return enable_if.unique([data_reader_num_workers, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def data_reader_num_workers(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.io_conf.data_reader_num_workers = val
+
+
+@oneflow_export("config.data_reader_ordered_delivery")
+def api_data_reader_ordered_delivery(val: bool = True) -> None:
+    r"""Whether or not data readers deliver batches in the order they were loaded. When False,
+    a read takes whichever batch is ready first.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([data_reader_ordered_delivery, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def data_reader_ordered_delivery(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.io_conf.data_reader_ordered_delivery = val
+
+
+@oneflow_export("config.data_reader_max_prefetch_batches")
+def api_data_reader_max_prefetch_batches(val: int) -> None:
+    r"""Set up the maximum number of batches a data reader loads ahead
+
+    Args:
+        val (int): e.g. 16
+    """
+    return enable_if.unique([data_reader_max_prefetch_batches, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def data_reader_max_prefetch_batches(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.io_conf.data_reader_max_prefetch_batches = val
+
+
+
+@oneflow_export("config.snapshot_writer_thread_num")
+def api_snapshot_writer_thread_num(val: int) -> None:
+    r"""Set up the number of threads writing model snapshot files
+
+    Args:
+        val (int): e.g. 4
+    """
+    return enable_if.unique([snapshot_writer_thread_num, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def snapshot_writer_thread_num(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.io_conf.snapshot_writer_thread_num = val
+
+
+@oneflow_export("config.enable_async_snapshot_save")
+def api_enable_async_snapshot_save(val: bool = True) -> None:
+    r"""Whether or not to finish saving model snapshots in background while training goes on.
+    A snapshot is complete once its snapshot_done file exists, `CheckPoint.sync` waits for it.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([enable_async_snapshot_save, do_nothing])(val=val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def enable_async_snapshot_save(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.io_conf.enable_async_snapshot_save = val
+
+
+@oneflow_export("config.snapshot_staging_buffer_mbyte")
+def api_snapshot_staging_buffer_mbyte(val: int) -> None:
+    r"""Set up the size of host memory holding snapshot data not yet written
+
+    Args:
+        val (int): e.g. 1024
+    """
+    return enable_if.unique([snapshot_staging_buffer_mbyte, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def snapshot_staging_buffer_mbyte(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.io_conf.snapshot_staging_buffer_mbyte = val
+
+
 @oneflow_export("config.collect_act_event")
 def api_collect_act_event(val: bool = True) -> None:
     r"""Whether or not collect active event.
@@ -547,6 +797,109 @@ def nccl_fusion_max_ops(val):
     sess.config_proto.resource.collective_boxing_conf.nccl_fusion_max_ops = val
 
 
+@oneflow_export("config.collective_boxing.cpu_enable")
+def api_cpu_enable(val: bool) -> None:
+    r"""Whether or not use the cpu backend for collective boxing between cpu devices
+
+    Args:
+        val (bool): True or False
+    """
+    return enable_if.unique([cpu_enable, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_enable(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.collective_boxing_conf.cpu_enable = val
+
+
+@oneflow_export("config.collective_boxing.cpu_fusion_threshold_mb")
+def api_cpu_fusion_threshold_mb(val: int) -> None:
+    r"""Set up threshold for cpu collective boxing oprators fusion
+
+    Args:
+        val (int): int number, e.g. 10(mb)
+    """
+    return enable_if.unique([cpu_fusion_threshold_mb, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_fusion_threshold_mb(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.collective_boxing_conf.cpu_fusion_threshold_mb = val
+
+
+@oneflow_export("config.collective_boxing.cpu_fusion_all_reduce")
+def api_cpu_fusion_all_reduce(val: bool) -> None:
+    r"""Whether or not fuse all reduce ops of the cpu collective boxing backend
+
+    Args:
+        val (bool): True or False
+    """
+    return enable_if.unique([cpu_fusion_all_reduce, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_fusion_all_reduce(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.collective_boxing_conf.cpu_fusion_all_reduce = val
+
+
+@oneflow_export("config.collective_boxing.cpu_fusion_max_ops")
+def api_cpu_fusion_max_ops(val: int) -> None:
+    r"""Maximum number of ops for cpu collective boxing fusion.
+
+    Args:
+        val (int): Maximum number of ops
+    """
+    return enable_if.unique([cpu_fusion_max_ops, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_fusion_max_ops(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.collective_boxing_conf.cpu_fusion_max_ops = val
+
+
+@oneflow_export("config.collective_boxing.cpu_chunk_size_kb")
+def api_cpu_chunk_size_kb(val: int) -> None:
+    r"""Set up the size of the chunks cpu collective boxing splits messages into
+
+    Args:
+        val (int): int number, e.g. 512(kb)
+    """
+    return enable_if.unique([cpu_chunk_size_kb, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_chunk_size_kb(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.collective_boxing_conf.cpu_chunk_size_kb = val
+
+
+@oneflow_export("config.collective_boxing.cpu_tree_threshold_kb")
+def api_cpu_tree_threshold_kb(val: int) -> None:
+    r"""Set up the size below which cpu collective boxing all reduce uses tree algorithm
+    instead of ring algorithm
+
+    Args:
+        val (int): int number, e.g. 256(kb)
+    """
+    return enable_if.unique([cpu_tree_threshold_kb, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_tree_threshold_kb(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.collective_boxing_conf.cpu_tree_threshold_kb = val
+
+
 @enable_if.condition(hob.in_normal_mode & hob.session_initialized)
 def do_nothing(*args, **kwargs):
     print("Nothing happened because the session is running")
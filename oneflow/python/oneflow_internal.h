@@ -80,6 +80,10 @@ void StartGlobalSession(std::string* error_str) {
   return oneflow::StartGlobalSession().GetDataAndSerializedErrorProto(error_str);
 }
 
+void WaitUntilSnapshotWritten(const std::string& snapshot_path, std::string* error_str) {
+  return oneflow::WaitUntilSnapshotWritten(snapshot_path).GetDataAndSerializedErrorProto(error_str);
+}
+
 void StopGlobalSession(std::string* error_str) {
   return oneflow::StopGlobalSession().GetDataAndSerializedErrorProto(error_str);
 }
@@ -41,6 +41,7 @@ limitations under the License.
 #include "oneflow/core/framework/user_op_conf.h"
 #include "oneflow/core/framework/user_op_registry_manager.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
+#include "oneflow/core/persistence/snapshot_write_engine.h"
 #include "oneflow/core/vm/instruction.pb.h"
 #include "oneflow/core/vm/vm_util.h"
 #include "oneflow/core/vm/id_util.h"
@@ -162,6 +163,12 @@ Maybe<std::string> GetSerializedStructureGraph() {
   return job_ctx_mgr->structure_graph();
 }
 
+Maybe<void> WaitUntilSnapshotWritten(const std::string& snapshot_path) {
+  SnapshotWriteEngine* engine = Global<SnapshotWriteEngine>::Get();
+  if (engine != nullptr) { engine->WaitUntilDone(snapshot_path); }
+  return Maybe<void>::Ok();
+}
+
 Maybe<void> StopGlobalSession() {
   if (Global<Oneflow>::Get() == nullptr) { return Maybe<void>::Ok(); }
   CHECK_OR_RETURN(Global<MachineCtx>::Get()->IsThisMachineMaster());
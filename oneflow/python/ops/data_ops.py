@@ -288,6 +288,8 @@ def ofrecord_reader(
     random_shuffle: bool = False,
     shuffle_buffer_size: int = 1024,
     shuffle_after_epoch: bool = False,
+    global_shuffle: bool = False,
+    lazy_decode: bool = False,
     name: Optional[str] = None,
 ) -> remote_blob_util.BlobDef:
     r"""Get ofrecord object from ofrecord dataset.
@@ -301,6 +303,8 @@ def ofrecord_reader(
         random_shuffle (bool, optional): Determines records shuffled or not. Defaults to False.
         shuffle_buffer_size (int, optional): Shuffle buffer size. Defaults to 1024.
         shuffle_after_epoch (bool, optional): Shuffled or not after each epoch. Defaults to False.
+        global_shuffle (bool, optional): Index every record of every part and draw a new global permutation of all records each epoch, sharded across the devices. Defaults to False.
+        lazy_decode (bool, optional): Keep the records serialized in tensor buffers, the OFRecord decoders then read only the features they need from them instead of every record being parsed whole. Defaults to False.
         name (Optional[str], optional): Optional name. Defaults to None.
         
     Returns:
@@ -363,7 +367,9 @@ def ofrecord_reader(
         .Attr("random_shuffle", random_shuffle)
         .Attr("shuffle_buffer_size", shuffle_buffer_size)
         .Attr("shuffle_after_epoch", shuffle_after_epoch)
+        .Attr("global_shuffle", global_shuffle)
         .Attr("part_name_suffix_length", part_name_suffix_length)
+        .Attr("lazy_decode", lazy_decode)
         .Build()
         .InferAndTryRun()
         .RemoteBlobList()[0]
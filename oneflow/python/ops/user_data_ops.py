@@ -2188,6 +2188,7 @@ def ofrecord_image_classification_reader(
     random_shuffle: bool = False,
     shuffle_buffer_size: int = 1024,
     shuffle_after_epoch: bool = False,
+    global_shuffle: bool = False,
     color_space: str = "BGR",
     decode_buffer_size_per_thread: int = 32,
     num_decode_threads_per_machine: Optional[int] = None,
@@ -2206,6 +2207,7 @@ def ofrecord_image_classification_reader(
         random_shuffle (bool, optional): Whether to random shuffle the data. Defaults to False.
         shuffle_buffer_size (int, optional): The buffer size for shuffle data. Defaults to 1024.
         shuffle_after_epoch (bool, optional): Whether to shuffle the data after each epoch. Defaults to False.
+        global_shuffle (bool, optional): Whether to index every record of every part and draw a new global permutation of all records each epoch, sharded across the devices. Defaults to False.
         color_space (str, optional): The color space. Defaults to "BGR".
         decode_buffer_size_per_thread (int, optional): The decode buffer size for per thread. Defaults to 32.
         num_decode_threads_per_machine (Optional[int], optional): The amounts of decode threads for each machine. Defaults to None.
@@ -2263,6 +2265,7 @@ def ofrecord_image_classification_reader(
         .Attr("random_shuffle", random_shuffle)
         .Attr("shuffle_buffer_size", shuffle_buffer_size)
         .Attr("shuffle_after_epoch", shuffle_after_epoch)
+        .Attr("global_shuffle", global_shuffle)
         .Attr("part_name_suffix_length", part_name_suffix_length)
         .Attr("color_space", color_space)
         .Attr("image_feature_name", image_feature_name)
@@ -16,8 +16,8 @@ limitations under the License.
 #ifndef ONEFLOW_USER_DATA_DATA_READER_H_
 #define ONEFLOW_USER_DATA_DATA_READER_H_
 
-#include "oneflow/core/common/buffer.h"
 #include "oneflow/core/framework/op_kernel.h"
+#include "oneflow/core/job/job_set.pb.h"
 #include "oneflow/user/data/dataset.h"
 #include "oneflow/user/data/parser.h"
 
@@ -25,64 +25,185 @@ namespace oneflow {
 namespace data {
 
 static const int32_t kDataReaderBatchBufferSize = 4;
+// reads over which the prefetch depth is lowered when none of them had to wait
+static const int64_t kDataReaderPrefetchShrinkInterval = 100;
+static const int64_t kDataReaderStatsLogInterval = 1000;
+
+struct DataReaderStats {
+  int64_t num_reads = 0;
+  // reads which found no batch ready, the model was waiting on the data reader
+  int64_t num_starved_reads = 0;
+  // sum of the number of ready batches seen by reads, over num_reads it is the mean occupancy
+  int64_t sum_ready_batches = 0;
+  int32_t prefetch_depth = 0;
+};
 
+// Batches are loaded by io_conf.data_reader_num_workers workers. Calls to loader_->Next() are
+// serialized since datasets keep state, Parser::Prepare() runs in parallel on the workers. Up to
+// prefetch depth batches are loaded ahead, the depth starts at kDataReaderBatchBufferSize and
+// grows each time Read() has to wait, up to io_conf.data_reader_max_prefetch_batches. It shrinks
+// by one again after kDataReaderPrefetchShrinkInterval reads which all found more than one batch
+// ready. Batches are delivered in load order unless io_conf.data_reader_ordered_delivery is
+// false, in which case a read takes any ready batch.
 template<typename LoadTarget>
 class DataReader {
  public:
   using LoadTargetPtr = std::shared_ptr<LoadTarget>;
   using LoadTargetPtrList = std::vector<LoadTargetPtr>;
   DataReader(user_op::KernelInitContext* ctx)
-      : is_closed_(false), batch_buffer_(kDataReaderBatchBufferSize) {}
+      : is_closed_(false),
+        num_loading_batches_(0),
+        next_read_seq_(0),
+        num_shrink_window_reads_(0),
+        min_shrink_window_ready_batches_(0),
+        next_load_seq_(0) {
+    const IOConf* io_conf = Global<const IOConf>::Get();
+    num_workers_ = std::max<int32_t>(io_conf->data_reader_num_workers(), 1);
+    ordered_delivery_ = io_conf->data_reader_ordered_delivery();
+    max_prefetch_depth_ =
+        std::max<int32_t>(io_conf->data_reader_max_prefetch_batches(), kDataReaderBatchBufferSize);
+    stats_.prefetch_depth = kDataReaderBatchBufferSize;
+  }
   virtual ~DataReader() {
     Close();
-    if (load_thrd_.joinable()) { load_thrd_.join(); }
+    for (std::thread& worker : load_workers_) { worker.join(); }
+    if (stats_.num_reads > 0) { LogStats(); }
   }
 
   void Read(user_op::KernelComputeContext* ctx) {
-    CHECK(load_thrd_.joinable()) << "You should call StartLoadThread before read data";
-    auto batch_data = FetchBatchData();
-    parser_->Parse(batch_data, ctx);
+    CHECK(!load_workers_.empty()) << "You should call StartLoadThread before read data";
+    LoadedBatch batch = FetchBatchData();
+    parser_->ParsePrepared(batch.data, batch.prepared, ctx);
   }
 
   void Close() {
-    is_closed_.store(true);
-    bool buffer_drained = false;
-    while (!buffer_drained) {
-      std::shared_ptr<LoadTargetPtrList> abandoned_batch_data(nullptr);
-      auto status = batch_buffer_.TryReceive(&abandoned_batch_data);
-      CHECK_NE(status, BufferStatus::kBufferStatusErrorClosed);
-      buffer_drained = (status == BufferStatus::kBufferStatusEmpty);
-    }
-    batch_buffer_.Close();
+    std::unique_lock<std::mutex> lock(mutex_);
+    is_closed_ = true;
+    seq2ready_batch_.clear();
+    cond_.notify_all();
+  }
+
+  DataReaderStats GetStats() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return stats_;
   }
 
  protected:
   void StartLoadThread() {
-    if (load_thrd_.joinable()) { return; }
-    load_thrd_ = std::thread([this] {
-      while (!is_closed_.load() && LoadBatch()) {}
-    });
+    if (!load_workers_.empty()) { return; }
+    FOR_RANGE(int32_t, i, 0, num_workers_) {
+      load_workers_.emplace_back([this] {
+        while (LoadBatch()) {}
+      });
+    }
   }
 
   std::unique_ptr<Dataset<LoadTarget>> loader_;
   std::unique_ptr<Parser<LoadTarget>> parser_;
 
  private:
-  std::shared_ptr<LoadTargetPtrList> FetchBatchData() {
-    std::shared_ptr<LoadTargetPtrList> batch_data(nullptr);
-    CHECK_EQ(batch_buffer_.Receive(&batch_data), BufferStatus::kBufferStatusSuccess);
-    return batch_data;
+  struct LoadedBatch {
+    std::shared_ptr<LoadTargetPtrList> data;
+    std::shared_ptr<PreparedBatch> prepared;
+  };
+
+  bool IsBatchReady() const {
+    if (ordered_delivery_) { return seq2ready_batch_.count(next_read_seq_) > 0; }
+    return !seq2ready_batch_.empty();
+  }
+
+  LoadedBatch FetchBatchData() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stats_.num_reads += 1;
+    stats_.sum_ready_batches += seq2ready_batch_.size();
+    if (!IsBatchReady()) {
+      stats_.num_starved_reads += 1;
+      num_shrink_window_reads_ = 0;
+      if (stats_.prefetch_depth < max_prefetch_depth_) {
+        stats_.prefetch_depth += 1;
+        cond_.notify_all();
+      }
+      cond_.wait(lock, [this]() { return IsBatchReady() || is_closed_; });
+    } else {
+      UpdatePrefetchDepthOnReadyRead();
+    }
+    if (stats_.num_reads % kDataReaderStatsLogInterval == 0) { LogStats(); }
+    CHECK(!is_closed_);
+    auto it = ordered_delivery_ ? seq2ready_batch_.find(next_read_seq_) : seq2ready_batch_.begin();
+    LoadedBatch batch = std::move(it->second);
+    seq2ready_batch_.erase(it);
+    next_read_seq_ += 1;
+    cond_.notify_all();
+    return batch;
+  }
+
+  void UpdatePrefetchDepthOnReadyRead() {
+    const size_t num_ready = seq2ready_batch_.size();
+    if (num_shrink_window_reads_ == 0 || num_ready < min_shrink_window_ready_batches_) {
+      min_shrink_window_ready_batches_ = num_ready;
+    }
+    num_shrink_window_reads_ += 1;
+    if (num_shrink_window_reads_ < kDataReaderPrefetchShrinkInterval) { return; }
+    // a batch was always left over, so one less prefetched batch still keeps the model fed
+    if (min_shrink_window_ready_batches_ > 1
+        && stats_.prefetch_depth > kDataReaderBatchBufferSize) {
+      stats_.prefetch_depth -= 1;
+    }
+    num_shrink_window_reads_ = 0;
+  }
+
+  void LogStats() const {
+    LOG(INFO) << "DataReader reads: " << stats_.num_reads
+              << ", starved reads: " << stats_.num_starved_reads << ", mean ready batches: "
+              << static_cast<double>(stats_.sum_ready_batches) / stats_.num_reads
+              << ", prefetch depth: " << stats_.prefetch_depth;
   }
 
   bool LoadBatch() {
-    std::shared_ptr<LoadTargetPtrList> batch_data =
-        std::make_shared<LoadTargetPtrList>(std::move(loader_->Next()));
-    return batch_buffer_.Send(batch_data) == BufferStatus::kBufferStatusSuccess;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this]() {
+        return is_closed_
+               || num_loading_batches_ + seq2ready_batch_.size()
+                      < static_cast<size_t>(stats_.prefetch_depth);
+      });
+      if (is_closed_) { return false; }
+      num_loading_batches_ += 1;
+    }
+    int64_t seq = -1;
+    LoadedBatch batch;
+    {
+      std::unique_lock<std::mutex> lock(loader_mutex_);
+      seq = next_load_seq_++;
+      batch.data = std::make_shared<LoadTargetPtrList>(loader_->Next());
+    }
+    batch.prepared = parser_->Prepare(batch.data.get());
+    std::unique_lock<std::mutex> lock(mutex_);
+    num_loading_batches_ -= 1;
+    if (is_closed_) { return false; }
+    CHECK(seq2ready_batch_.emplace(seq, std::move(batch)).second);
+    cond_.notify_all();
+    return true;
   }
 
-  std::atomic<bool> is_closed_;
-  Buffer<std::shared_ptr<LoadTargetPtrList>> batch_buffer_;
-  std::thread load_thrd_;
+  int32_t num_workers_;
+  bool ordered_delivery_;
+  int32_t max_prefetch_depth_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  bool is_closed_;
+  size_t num_loading_batches_;
+  std::map<int64_t, LoadedBatch> seq2ready_batch_;
+  int64_t next_read_seq_;
+  int64_t num_shrink_window_reads_;
+  size_t min_shrink_window_ready_batches_;
+  DataReaderStats stats_;
+
+  std::mutex loader_mutex_;
+  int64_t next_load_seq_;
+
+  std::vector<std::thread> load_workers_;
 };
 
 }  // namespace data
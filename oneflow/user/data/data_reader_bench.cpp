@@ -0,0 +1,153 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <time.h>
+#include "oneflow/user/data/data_reader.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/record/record.pb.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+const int64_t kBatchSize = 32;
+
+// cycles over a fixed set of serialized CTR style records: 13 dense and 26 sparse features
+class SerializedRecordDataset final : public Dataset<std::string> {
+ public:
+  SerializedRecordDataset() : next_(0) {
+    OFRecord record;
+    auto* feature = record.mutable_feature();
+    FOR_RANGE(int32_t, i, 0, 13) {
+      (*feature)["dense_" + std::to_string(i)].mutable_float_list()->add_value(i * 0.5f);
+    }
+    FOR_RANGE(int32_t, i, 0, 26) {
+      (*feature)["sparse_" + std::to_string(i)].mutable_int64_list()->add_value(i * 1000003);
+    }
+    FOR_RANGE(int32_t, i, 0, kBatchSize) {
+      (*feature)["label"].mutable_int32_list()->Clear();
+      (*feature)["label"].mutable_int32_list()->add_value(i);
+      records_.push_back(record.SerializeAsString());
+    }
+  }
+  ~SerializedRecordDataset() override = default;
+
+  LoadTargetPtrList Next() override {
+    LoadTargetPtrList batch;
+    FOR_RANGE(int64_t, i, 0, kBatchSize) {
+      batch.emplace_back(new std::string(records_.at(next_++ % records_.size())));
+    }
+    return batch;
+  }
+
+ private:
+  std::vector<std::string> records_;
+  int64_t next_;
+};
+
+struct ParsedRecords final : public PreparedBatch {
+  std::vector<OFRecord> records;
+};
+
+// deserializes the records in Prepare() on the load workers, or on the reading thread as every
+// parser did before Prepare() existed
+class RecordParser final : public Parser<std::string> {
+ public:
+  explicit RecordParser(bool is_prepared) : is_prepared_(is_prepared), label_sum_(0) {}
+  ~RecordParser() override = default;
+
+  std::shared_ptr<PreparedBatch> Prepare(LoadTargetPtrList* batch_data) override {
+    if (!is_prepared_) { return nullptr; }
+    return ParseBatch(*batch_data);
+  }
+  void Parse(std::shared_ptr<LoadTargetPtrList> batch_data,
+             user_op::KernelComputeContext* ctx) override {
+    UNIMPLEMENTED();
+  }
+  void ParsePrepared(std::shared_ptr<LoadTargetPtrList> batch_data,
+                     std::shared_ptr<PreparedBatch> prepared,
+                     user_op::KernelComputeContext* ctx) override {
+    if (!prepared) { prepared = ParseBatch(*batch_data); }
+    for (const OFRecord& record : dynamic_cast<ParsedRecords*>(prepared.get())->records) {
+      label_sum_ += record.feature().at("label").int32_list().value(0);
+    }
+  }
+
+  int64_t label_sum() const { return label_sum_; }
+
+ private:
+  static std::shared_ptr<ParsedRecords> ParseBatch(const LoadTargetPtrList& batch_data) {
+    std::shared_ptr<ParsedRecords> parsed(new ParsedRecords());
+    parsed->records.resize(batch_data.size());
+    FOR_RANGE(size_t, i, 0, batch_data.size()) {
+      CHECK(parsed->records.at(i).ParseFromString(*batch_data.at(i)));
+    }
+    return parsed;
+  }
+
+  bool is_prepared_;
+  int64_t label_sum_;
+};
+
+class RecordDataReader final : public DataReader<std::string> {
+ public:
+  explicit RecordDataReader(bool is_prepared) : DataReader<std::string>(nullptr) {
+    loader_.reset(new SerializedRecordDataset());
+    parser_.reset(new RecordParser(is_prepared));
+    StartLoadThread();
+  }
+  ~RecordDataReader() override = default;
+
+  int64_t label_sum() const { return dynamic_cast<RecordParser*>(parser_.get())->label_sum(); }
+};
+
+int64_t ThreadCpuTimeNs() {
+  timespec ts;
+  PCHECK(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// the label reports the CPU time the reading thread, the compute thread of the reader kernel,
+// spends per batch
+void BenchmarkDataReader(BenchmarkState* state, bool is_prepared, int32_t num_workers) {
+  IOConf io_conf;
+  io_conf.set_data_reader_num_workers(num_workers);
+  Global<const IOConf>::New(io_conf);
+  int64_t read_cpu_time_ns = 0;
+  {
+    RecordDataReader reader(is_prepared);
+    const int64_t start_ns = ThreadCpuTimeNs();
+    while (state->KeepRunning()) { reader.Read(nullptr); }
+    read_cpu_time_ns = ThreadCpuTimeNs() - start_ns;
+    DoNotOptimize(reader.label_sum());
+  }
+  Global<const IOConf>::Delete();
+  state->SetItemsProcessed(state->iterations() * kBatchSize);
+  state->SetLabel(std::to_string(num_workers) + " worker(s), reader thread "
+                  + std::to_string(read_cpu_time_ns / 1000 / state->iterations())
+                  + " us CPU per batch");
+}
+
+}  // namespace
+
+OF_BENCHMARK(DataReaderParseOnRead_1Worker) { BenchmarkDataReader(state, false, 1); }
+
+OF_BENCHMARK(DataReaderPrepare_1Worker) { BenchmarkDataReader(state, true, 1); }
+
+OF_BENCHMARK(DataReaderPrepare_4Workers) { BenchmarkDataReader(state, true, 4); }
+
+}  // namespace data
+}  // namespace oneflow
@@ -0,0 +1,125 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include "oneflow/user/data/data_reader.h"
+
+namespace oneflow {
+namespace data {
+
+namespace test {
+
+std::atomic<int64_t> live_prepared_num(0);
+
+class CountingDataset final : public Dataset<int64_t> {
+ public:
+  explicit CountingDataset(int64_t slow_batch_num) : slow_batch_num_(slow_batch_num), next_(0) {}
+  ~CountingDataset() override = default;
+
+  LoadTargetPtrList Next() override {
+    if (next_ < slow_batch_num_) { std::this_thread::sleep_for(std::chrono::milliseconds(2)); }
+    LoadTargetPtrList batch;
+    batch.emplace_back(new int64_t(next_++));
+    return batch;
+  }
+
+ private:
+  int64_t slow_batch_num_;
+  int64_t next_;
+};
+
+struct CountingPrepared final : public PreparedBatch {
+  explicit CountingPrepared(int64_t value) : value(value) { live_prepared_num += 1; }
+  ~CountingPrepared() override { live_prepared_num -= 1; }
+  int64_t value;
+};
+
+class CountingParser final : public Parser<int64_t> {
+ public:
+  CountingParser() = default;
+  ~CountingParser() override = default;
+
+  std::shared_ptr<PreparedBatch> Prepare(LoadTargetPtrList* batch_data) override {
+    return std::make_shared<CountingPrepared>(*batch_data->at(0) * 2);
+  }
+  void Parse(std::shared_ptr<LoadTargetPtrList> batch_data,
+             user_op::KernelComputeContext* ctx) override {
+    UNIMPLEMENTED();
+  }
+  void ParsePrepared(std::shared_ptr<LoadTargetPtrList> batch_data,
+                     std::shared_ptr<PreparedBatch> prepared,
+                     user_op::KernelComputeContext* ctx) override {
+    CHECK_EQ(dynamic_cast<CountingPrepared*>(prepared.get())->value, *batch_data->at(0) * 2);
+    values.push_back(*batch_data->at(0));
+  }
+
+  std::vector<int64_t> values;
+};
+
+class CountingDataReader final : public DataReader<int64_t> {
+ public:
+  explicit CountingDataReader(int64_t slow_batch_num) : DataReader<int64_t>(nullptr) {
+    loader_.reset(new CountingDataset(slow_batch_num));
+    parser_.reset(new CountingParser());
+    StartLoadThread();
+  }
+  ~CountingDataReader() override = default;
+
+  const std::vector<int64_t>& values() const {
+    return dynamic_cast<CountingParser*>(parser_.get())->values;
+  }
+};
+
+void TestDataReader(int32_t num_workers, int64_t num_reads) {
+  IOConf io_conf;
+  io_conf.set_data_reader_num_workers(num_workers);
+  Global<const IOConf>::New(io_conf);
+  {
+    CountingDataReader reader(0);
+    FOR_RANGE(int64_t, i, 0, num_reads) { reader.Read(nullptr); }
+    ASSERT_EQ(reader.values().size(), num_reads);
+    FOR_RANGE(int64_t, i, 0, num_reads) { ASSERT_EQ(reader.values().at(i), i); }
+    ASSERT_EQ(reader.GetStats().num_reads, num_reads);
+  }
+  // batches still queued at destruction are dropped with what Prepare() made of them
+  ASSERT_EQ(live_prepared_num.load(), 0);
+  Global<const IOConf>::Delete();
+}
+
+TEST(DataReader, single_worker) { TestDataReader(1, 300); }
+
+TEST(DataReader, multi_worker) { TestDataReader(4, 300); }
+
+TEST(DataReader, shrink_prefetch_depth) {
+  Global<const IOConf>::New(IOConf());
+  {
+    // reads wait for the slow first batches, which deepens the prefetch
+    CountingDataReader reader(8);
+    FOR_RANGE(int64_t, i, 0, 8) { reader.Read(nullptr); }
+    ASSERT_GT(reader.GetStats().prefetch_depth, kDataReaderBatchBufferSize);
+    // a consumer slower than the loader always finds spare batches
+    FOR_RANGE(int64_t, i, 0, 12 * kDataReaderPrefetchShrinkInterval) {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      reader.Read(nullptr);
+    }
+    ASSERT_EQ(reader.GetStats().prefetch_depth, kDataReaderBatchBufferSize);
+  }
+  Global<const IOConf>::Delete();
+}
+
+}  // namespace test
+
+}  // namespace data
+}  // namespace oneflow
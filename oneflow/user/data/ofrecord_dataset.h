@@ -17,15 +17,72 @@ limitations under the License.
 #define ONEFLOW_USER_DATA_OFRECORD_DATASET_H_
 
 #include "oneflow/user/data/dataset.h"
+#include "oneflow/user/data/random_permutation.h"
 #include "oneflow/core/common/balanced_splitter.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/framework/op_kernel.h"
 #include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/posix/mapped_file.h"
 #include "oneflow/core/job/job_set.pb.h"
 
 namespace oneflow {
 namespace data {
 
+#ifdef PLATFORM_POSIX
+
+// A mapped ofrecord part file along with the offsets of its records, each record is an int64
+// length followed by that many bytes
+class OFRecordMappedPart final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OFRecordMappedPart);
+  explicit OFRecordMappedPart(const std::string& fname) : file_(new fs::MappedFile(fname)) {
+    size_t offset = 0;
+    while (offset < file_->size()) {
+      int64_t record_size = -1;
+      CHECK_LE(offset + sizeof(int64_t), file_->size()) << "truncated record in " << fname;
+      std::memcpy(&record_size, file_->data() + offset, sizeof(int64_t));
+      CHECK_GT(record_size, 0) << "bad record in " << fname;
+      offset += sizeof(int64_t);
+      CHECK_LE(offset + record_size, file_->size()) << "truncated record in " << fname;
+      record_offsets_.push_back(offset);
+      record_sizes_.push_back(record_size);
+      offset += record_size;
+    }
+  }
+  ~OFRecordMappedPart() = default;
+
+  size_t record_num() const { return record_offsets_.size(); }
+
+  // the buffer refers to the record bytes inside the mapping
+  void ShareRecord(size_t index, TensorBuffer* tensor) const {
+    ShareBytes(record_offsets_.at(index), record_sizes_.at(index), tensor);
+  }
+  void ShareBytes(size_t offset, int64_t size, TensorBuffer* tensor) const {
+    tensor->ShareMem(file_, file_->data() + offset, Shape({size}), DataType::kChar);
+  }
+
+  size_t RecordOffset(size_t index) const { return record_offsets_.at(index); }
+  size_t RecordEnd(size_t index) const {
+    return record_offsets_.at(index) + record_sizes_.at(index);
+  }
+  void WillNeed(size_t offset, size_t n) const { file_->WillNeed(offset, n); }
+  void AdviseRandomAccess() const { file_->AdviseRandomAccess(); }
+
+ private:
+  std::shared_ptr<fs::MappedFile> file_;
+  std::vector<size_t> record_offsets_;
+  std::vector<int64_t> record_sizes_;
+};
+
+#endif  // PLATFORM_POSIX
+
+// where a record lives, offset points past the int64 length
+struct OFRecordLocation {
+  int32_t part_id;
+  int32_t size;
+  int64_t offset;
+};
+
 class OFRecordDataset final : public Dataset<TensorBuffer> {
  public:
   using LoadTargetPtr = std::shared_ptr<TensorBuffer>;
@@ -34,6 +91,9 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
   OFRecordDataset(user_op::KernelInitContext* ctx) {
     current_epoch_ = 0;
     shuffle_after_epoch_ = ctx->Attr<bool>("shuffle_after_epoch");
+    global_shuffle_ = ctx->Attr<bool>("global_shuffle");
+    const int64_t seed = ctx->Attr<int64_t>("seed");
+    global_shuffle_seed_ = seed == -1 ? kOneflowDatasetSeed : seed;
 
     // in stream
     data_part_num_ = ctx->Attr<int32_t>("data_part_num");
@@ -51,13 +111,24 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
 
     parallel_id_ = ctx->parallel_ctx().parallel_id();
     parallel_num_ = ctx->parallel_ctx().parallel_num();
+    save_to_local_ = Global<const IOConf>::Get()->save_downloaded_file_to_local_fs();
+    use_mmap_ =
+        Global<const IOConf>::Get()->enable_mmap_ofrecord_reader() && DataFS() == LocalFS();
+    if (global_shuffle_) {
+      BuildGlobalIndex();
+      GenLocalSampleIds();
+      return;
+    }
     CHECK_LE(parallel_num_, data_part_num_);
     BalancedSplitter bs(data_part_num_, parallel_num_);
     range_ = bs.At(parallel_id_);
     std::vector<std::string> local_file_paths = GetLocalFilePaths();
-    save_to_local_ = Global<const IOConf>::Get()->save_downloaded_file_to_local_fs();
-    in_stream_.reset(
-        new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_, save_to_local_));
+    if (use_mmap_) {
+      OpenMappedParts(local_file_paths);
+    } else {
+      in_stream_.reset(new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_,
+                                              save_to_local_));
+    }
   }
   ~OFRecordDataset() = default;
 
@@ -71,6 +142,8 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
 
  private:
   void ReadSample(TensorBuffer& tensor) {
+    if (global_shuffle_) { return ReadGlobalShuffledSample(&tensor); }
+    if (use_mmap_) { return ReadMappedSample(&tensor); }
     int64_t OFRecord_size = -1;
     char* size_ptr = reinterpret_cast<char*>(&OFRecord_size);
     if (in_stream_->ReadFully(size_ptr, sizeof(int64_t)) != 0) {
@@ -88,9 +161,161 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
     std::mt19937 g(kOneflowDatasetSeed + current_epoch_);
     std::shuffle(data_file_paths_.begin(), data_file_paths_.end(), g);
     std::vector<std::string> local_file_paths = GetLocalFilePaths();
-    in_stream_.reset(new PersistentInStream(DataFS(), local_file_paths, false, save_to_local_));
+    if (use_mmap_) {
+      OpenMappedParts(local_file_paths);
+    } else {
+      in_stream_.reset(new PersistentInStream(DataFS(), local_file_paths, false, save_to_local_));
+    }
+  }
+
+  // the location of every record of every part, each rank reads the headers of all parts once
+  void BuildGlobalIndex() {
+    FOR_RANGE(int32_t, part_id, 0, data_part_num_) {
+      const std::string& path = data_file_paths_.at(part_id);
+      if (use_mmap_) {
+        AppendMappedPartLocations(part_id, path);
+        continue;
+      }
+      std::unique_ptr<fs::RandomAccessFile> file;
+      DataFS()->NewRandomAccessFile(path, &file);
+      AppendPartLocations(part_id, path, file.get());
+      part_files_.emplace_back(std::move(file));
+    }
+    CHECK_GE(record_locations_.size(), static_cast<size_t>(parallel_num_));
   }
 
+  void AppendPartLocations(int32_t part_id, const std::string& path,
+                           const fs::RandomAccessFile* file) {
+    const uint64_t file_size = DataFS()->GetFileSize(path);
+    // a read of the local fs costs about as much as copying 4KiB out of the page cache
+    const uint64_t chunk_record_size =
+        DataFS() == LocalFS() ? kLocalIndexChunkRecordSize : kIndexReadSize;
+    std::vector<char> buf;
+    uint64_t buf_offset = 0;
+    uint64_t offset = 0;
+    int64_t record_size = 0;
+    while (offset < file_size) {
+      CHECK_LE(offset + sizeof(int64_t), file_size) << "truncated record in " << path;
+      if (offset < buf_offset || offset + sizeof(int64_t) > buf_offset + buf.size()) {
+        // the headers of small records come many to a read, a large record gets a read of its
+        // own header only
+        const uint64_t read_size = std::min<uint64_t>(
+            file_size - offset, static_cast<uint64_t>(record_size) < chunk_record_size
+                                    ? kIndexReadSize
+                                    : sizeof(int64_t));
+        buf.resize(read_size);
+        file->Read(offset, read_size, buf.data());
+        buf_offset = offset;
+      }
+      std::memcpy(&record_size, buf.data() + (offset - buf_offset), sizeof(int64_t));
+      offset += sizeof(int64_t);
+      AppendRecordLocation(part_id, offset, record_size, file_size, path);
+      offset += record_size;
+    }
+  }
+
+  void AppendRecordLocation(int32_t part_id, int64_t offset, int64_t record_size,
+                            uint64_t file_size, const std::string& path) {
+    CHECK_GT(record_size, 0) << "bad record in " << path;
+    CHECK_LE(record_size, GetMaxVal<int32_t>()) << "bad record in " << path;
+    CHECK_LE(offset + record_size, file_size) << "truncated record in " << path;
+    OFRecordLocation location;
+    location.part_id = part_id;
+    location.size = static_cast<int32_t>(record_size);
+    location.offset = offset;
+    record_locations_.push_back(location);
+  }
+
+  // Every rank draws the same permutation of all records for the epoch and takes every
+  // parallel_num-th of it, computing only its own share. The tail that does not divide evenly is
+  // skipped so that all ranks read the same number of samples.
+  void GenLocalSampleIds() {
+    RandomPermutation permutation(record_locations_.size(), global_shuffle_seed_ + current_epoch_);
+    const int64_t local_sample_num = permutation.size() / parallel_num_;
+    local_sample_ids_.resize(local_sample_num);
+    FOR_RANGE(int64_t, i, 0, local_sample_num) {
+      local_sample_ids_.at(i) = permutation.At(i * parallel_num_ + parallel_id_);
+    }
+    cur_sample_idx_ = 0;
+  }
+
+  void ReadGlobalShuffledSample(TensorBuffer* tensor) {
+    if (cur_sample_idx_ == local_sample_ids_.size()) {
+      current_epoch_ += 1;
+      GenLocalSampleIds();
+    }
+    const OFRecordLocation& location = record_locations_.at(local_sample_ids_.at(cur_sample_idx_));
+    cur_sample_idx_ += 1;
+    if (use_mmap_) { return ShareMappedBytes(location, tensor); }
+    tensor->Resize(Shape({location.size}), DataType::kChar);
+    part_files_.at(location.part_id)
+        ->Read(location.offset, location.size, tensor->mut_data<char>());
+  }
+
+#ifdef PLATFORM_POSIX
+  void AppendMappedPartLocations(int32_t part_id, const std::string& path) {
+    std::shared_ptr<OFRecordMappedPart>& part = path2mapped_part_[path];
+    if (!part) { part.reset(new OFRecordMappedPart(path)); }
+    part->AdviseRandomAccess();
+    FOR_RANGE(size_t, i, 0, part->record_num()) {
+      const int64_t offset = part->RecordOffset(i);
+      AppendRecordLocation(part_id, offset, part->RecordEnd(i) - offset, part->RecordEnd(i), path);
+    }
+    global_mapped_parts_.push_back(part.get());
+  }
+
+  void ShareMappedBytes(const OFRecordLocation& location, TensorBuffer* tensor) {
+    global_mapped_parts_.at(location.part_id)->ShareBytes(location.offset, location.size, tensor);
+  }
+
+  void OpenMappedParts(const std::vector<std::string>& local_file_paths) {
+    cur_parts_.clear();
+    size_t record_num = 0;
+    for (const std::string& path : local_file_paths) {
+      // parts stay mapped across epochs, the offset index is built once per part
+      std::shared_ptr<OFRecordMappedPart>& part = path2mapped_part_[path];
+      if (!part) { part.reset(new OFRecordMappedPart(path)); }
+      record_num += part->record_num();
+      cur_parts_.push_back(part.get());
+    }
+    CHECK_GT(record_num, 0);
+    cur_part_idx_ = 0;
+    cur_record_idx_ = 0;
+    readahead_end_ = 0;
+  }
+
+  void ReadMappedSample(TensorBuffer* tensor) {
+    while (cur_record_idx_ >= cur_parts_.at(cur_part_idx_)->record_num()) {
+      cur_part_idx_ += 1;
+      cur_record_idx_ = 0;
+      readahead_end_ = 0;
+      if (cur_part_idx_ == cur_parts_.size()) {
+        if (shuffle_after_epoch_) {
+          ShuffleAfterEpoch();
+        } else {
+          cur_part_idx_ = 0;
+        }
+      }
+    }
+    const OFRecordMappedPart* part = cur_parts_.at(cur_part_idx_);
+    // the next window is requested once half of the current one has been consumed
+    if (part->RecordEnd(cur_record_idx_) > readahead_end_) {
+      const size_t offset = part->RecordOffset(cur_record_idx_);
+      part->WillNeed(offset, kReadaheadSize);
+      readahead_end_ = offset + kReadaheadSize / 2;
+    }
+    part->ShareRecord(cur_record_idx_, tensor);
+    cur_record_idx_ += 1;
+  }
+#else
+  void AppendMappedPartLocations(int32_t part_id, const std::string& path) { UNIMPLEMENTED(); }
+  void ShareMappedBytes(const OFRecordLocation& location, TensorBuffer* tensor) {
+    UNIMPLEMENTED();
+  }
+  void OpenMappedParts(const std::vector<std::string>& local_file_paths) { UNIMPLEMENTED(); }
+  void ReadMappedSample(TensorBuffer* tensor) { UNIMPLEMENTED(); }
+#endif  // PLATFORM_POSIX
+
   std::vector<std::string> GetLocalFilePaths() {
     std::vector<std::string> ret;
     for (int i = range_.begin(); i < range_.end(); ++i) { ret.push_back(data_file_paths_.at(i)); }
@@ -107,6 +332,26 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
   std::vector<std::string> data_file_paths_;
   bool save_to_local_;
   std::unique_ptr<PersistentInStream> in_stream_;
+
+  static constexpr uint64_t kIndexReadSize = 1 << 20;
+  static constexpr uint64_t kLocalIndexChunkRecordSize = 4 << 10;
+  bool global_shuffle_;
+  int64_t global_shuffle_seed_;
+  std::vector<OFRecordLocation> record_locations_;
+  std::vector<std::unique_ptr<fs::RandomAccessFile>> part_files_;
+  std::vector<int64_t> local_sample_ids_;
+  size_t cur_sample_idx_;
+
+  bool use_mmap_;
+#ifdef PLATFORM_POSIX
+  static constexpr size_t kReadaheadSize = 16 << 20;
+  HashMap<std::string, std::shared_ptr<OFRecordMappedPart>> path2mapped_part_;
+  std::vector<const OFRecordMappedPart*> global_mapped_parts_;
+  std::vector<const OFRecordMappedPart*> cur_parts_;
+  size_t cur_part_idx_;
+  size_t cur_record_idx_;
+  size_t readahead_end_;
+#endif  // PLATFORM_POSIX
 };
 
 }  // namespace data
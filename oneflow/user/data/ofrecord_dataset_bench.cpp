@@ -0,0 +1,195 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <time.h>
+#include "oneflow/user/data/ofrecord_dataset.h"
+#include "oneflow/user/data/random_shuffle_dataset.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+const int32_t kPartNum = 8;
+const int64_t kRecordNumPerPart = 4096;
+const int64_t kRecordSize = 4096;
+const int32_t kShuffleBufferSize = 1024;
+
+class BenchKernelInitContext final : public user_op::KernelInitContext {
+ public:
+  explicit BenchKernelInitContext(user_op::UserOpConfWrapper&& conf)
+      : user_op::KernelInitContext(std::move(conf)) {
+    parallel_ctx_.set_parallel_id(0);
+    parallel_ctx_.set_parallel_num(1);
+  }
+  ~BenchKernelInitContext() override = default;
+
+  DeviceCtx* device_ctx() override { UNIMPLEMENTED(); }
+  DeviceType device_type() const override { return DeviceType::kCPU; }
+  const ParallelContext& parallel_ctx() const override { return parallel_ctx_; }
+  const user_op::TensorDesc* TensorDesc4ArgNameAndIndex(const std::string&,
+                                                        int32_t) const override {
+    UNIMPLEMENTED();
+  }
+  const SbpParallel& SbpParallel4ArgNameAndIndex(const std::string&, int32_t) const override {
+    UNIMPLEMENTED();
+  }
+  const user_op::TensorDesc* LogicalTensorDesc4ArgNameAndIndex(const std::string&,
+                                                               int32_t) const override {
+    UNIMPLEMENTED();
+  }
+  const ParallelDesc& parallel_desc() const override { UNIMPLEMENTED(); }
+  const std::vector<std::pair<std::string, int32_t>>& inputs() const override {
+    UNIMPLEMENTED();
+  }
+  const std::vector<std::pair<std::string, int32_t>>& outputs() const override {
+    UNIMPLEMENTED();
+  }
+
+ private:
+  ParallelContext parallel_ctx_;
+};
+
+// kPartNum part files of kRecordNumPerPart records of kRecordSize bytes each, removed with the
+// io conf when the data set goes out of scope
+class OFRecordPartFiles final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OFRecordPartFiles);
+  explicit OFRecordPartFiles(bool use_mmap) {
+    IOConf io_conf;
+    io_conf.mutable_data_fs_conf()->mutable_localfs_conf();
+    io_conf.mutable_snapshot_fs_conf()->mutable_localfs_conf();
+    io_conf.set_enable_mmap_ofrecord_reader(use_mmap);
+    Global<const IOConf>::New(io_conf);
+    std::string current_dir = GetCwd();
+    StringReplace(&current_dir, '\\', '/');
+    data_dir_ = JoinPath(current_dir, "tmp_ofrecord_dataset_bench");
+    DataFS()->RecursivelyCreateDirIfNotExist(data_dir_);
+    std::string record(kRecordSize, '\0');
+    FOR_RANGE(int32_t, part_id, 0, kPartNum) {
+      std::unique_ptr<fs::WritableFile> file;
+      DataFS()->NewWritableFile(JoinPath(data_dir_, "part-" + std::to_string(part_id)), &file);
+      FOR_RANGE(int64_t, i, 0, kRecordNumPerPart) {
+        const int64_t record_id = part_id * kRecordNumPerPart + i;
+        std::memcpy(&record.at(0), &record_id, sizeof(int64_t));
+        file->Append(reinterpret_cast<const char*>(&kRecordSize), sizeof(int64_t));
+        file->Append(record.data(), record.size());
+      }
+      file->Close();
+    }
+  }
+  ~OFRecordPartFiles() {
+    DataFS()->RecursivelyDeleteDir(data_dir_);
+    Global<const IOConf>::Delete();
+  }
+
+  BenchKernelInitContext* NewInitContext(bool shuffle_after_epoch, bool global_shuffle) const {
+    return new BenchKernelInitContext(user_op::UserOpConfWrapperBuilder("reader")
+                                          .Op("OFRecordReader")
+                                          .Attr<std::string>("data_dir", data_dir_)
+                                          .Attr<int32_t>("data_part_num", kPartNum)
+                                          .Attr<std::string>("part_name_prefix", "part-")
+                                          .Attr<int32_t>("part_name_suffix_length", -1)
+                                          .Attr<int64_t>("seed", 1)
+                                          .Attr<int32_t>("shuffle_buffer_size", kShuffleBufferSize)
+                                          .Attr<bool>("shuffle_after_epoch", shuffle_after_epoch)
+                                          .Attr<bool>("global_shuffle", global_shuffle)
+                                          .Build());
+  }
+
+ private:
+  std::string data_dir_;
+};
+
+int64_t ProcessCpuTimeNs() {
+  timespec ts;
+  PCHECK(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Reads the parts in order through the buffered stream, which copies every record twice, or
+// shares the records from the mappings. The label reports the CPU time of the process, kernel
+// time included, per record.
+void BenchmarkOFRecordDatasetInOrder(BenchmarkState* state, bool use_mmap) {
+  OFRecordPartFiles part_files(use_mmap);
+  std::unique_ptr<BenchKernelInitContext> ctx(part_files.NewInitContext(false, false));
+  OFRecordDataset dataset(ctx.get());
+  int64_t sum = 0;
+  const int64_t start_ns = ProcessCpuTimeNs();
+  while (state->KeepRunning()) {
+    for (const auto& sample : dataset.Next()) { sum += *sample->data<int64_t>(); }
+  }
+  const int64_t cpu_time_ns = ProcessCpuTimeNs() - start_ns;
+  DoNotOptimize(sum);
+  state->SetItemsProcessed(state->iterations());
+  state->SetBytesProcessed(state->iterations() * kRecordSize);
+  state->SetLabel(std::to_string(cpu_time_ns / state->iterations()) + " ns CPU per record");
+}
+
+std::string KiB(int64_t bytes) { return std::to_string(bytes / 1024) + " KiB"; }
+
+// The buffer shuffle reads the parts in order, the order of the parts changing each epoch, and
+// swaps every record with a random one of the shuffle buffer. The global shuffle reads the records
+// of one permutation of all parts at random.
+void BenchmarkOFRecordDataset(BenchmarkState* state, bool global_shuffle, bool use_mmap) {
+  OFRecordPartFiles part_files(use_mmap);
+  std::unique_ptr<BenchKernelInitContext> ctx(
+      part_files.NewInitContext(!global_shuffle, global_shuffle));
+  std::unique_ptr<Dataset<TensorBuffer>> dataset(new OFRecordDataset(ctx.get()));
+  if (!global_shuffle) {
+    dataset.reset(new RandomShuffleDataset<TensorBuffer>(ctx.get(), std::move(dataset)));
+  }
+  int64_t sum = 0;
+  while (state->KeepRunning()) {
+    for (const auto& sample : dataset->Next()) { sum += *sample->data<int64_t>(); }
+  }
+  DoNotOptimize(sum);
+  state->SetItemsProcessed(state->iterations());
+  state->SetBytesProcessed(state->iterations() * kRecordSize);
+  const int64_t record_num = kPartNum * kRecordNumPerPart;
+  if (global_shuffle) {
+    state->SetLabel("index " + KiB(record_num * (sizeof(OFRecordLocation) + sizeof(int64_t))));
+  } else {
+    state->SetLabel("shuffle buffer " + KiB(kShuffleBufferSize * kRecordSize));
+  }
+}
+
+}  // namespace
+
+OF_BENCHMARK(OFRecordDatasetSequential) { BenchmarkOFRecordDatasetInOrder(state, false); }
+
+OF_BENCHMARK(OFRecordDatasetSequentialMmap) { BenchmarkOFRecordDatasetInOrder(state, true); }
+
+OF_BENCHMARK(OFRecordDatasetBufferShuffle) { BenchmarkOFRecordDataset(state, false, false); }
+
+OF_BENCHMARK(OFRecordDatasetBufferShuffleMmap) { BenchmarkOFRecordDataset(state, false, true); }
+
+OF_BENCHMARK(OFRecordDatasetGlobalShuffle) { BenchmarkOFRecordDataset(state, true, false); }
+
+OF_BENCHMARK(OFRecordDatasetGlobalShuffleMmap) { BenchmarkOFRecordDataset(state, true, true); }
+
+// reading the headers of all parts, once per data set on every rank
+OF_BENCHMARK(OFRecordDatasetGlobalIndex) {
+  OFRecordPartFiles part_files(false);
+  std::unique_ptr<BenchKernelInitContext> ctx(part_files.NewInitContext(false, true));
+  while (state->KeepRunning()) { OFRecordDataset dataset(ctx.get()); }
+  state->SetItemsProcessed(state->iterations() * kPartNum * kRecordNumPerPart);
+}
+
+}  // namespace data
+}  // namespace oneflow
@@ -28,22 +28,64 @@ class OFRecordParser final : public Parser<TensorBuffer> {
  public:
   using LoadTargetPtr = std::shared_ptr<TensorBuffer>;
   using LoadTargetPtrList = std::vector<LoadTargetPtr>;
-  OFRecordParser() = default;
+  OFRecordParser() : OFRecordParser(false) {}
+  // with lazy_decode the serialized records are handed to the decoders as tensor buffers, which
+  // look up the features they need in place instead of parsing whole records
+  explicit OFRecordParser(bool lazy_decode) : lazy_decode_(lazy_decode) {}
   ~OFRecordParser() = default;
 
+  std::shared_ptr<PreparedBatch> Prepare(LoadTargetPtrList* batch_data) override {
+    if (lazy_decode_) { return nullptr; }
+    std::shared_ptr<PreparedRecords> prepared(new PreparedRecords());
+    prepared->records.resize(batch_data->size());
+    FOR_RANGE(size_t, i, 0, batch_data->size()) {
+      const TensorBuffer* buffer = batch_data->at(i).get();
+      CHECK(prepared->records.at(i).ParseFromArray(buffer->data<char>(),
+                                                   buffer->shape().elem_cnt()));
+    }
+    return prepared;
+  }
+
   void Parse(std::shared_ptr<LoadTargetPtrList> batch_data,
              user_op::KernelComputeContext* ctx) override {
+    ParsePrepared(batch_data, nullptr, ctx);
+  }
+
+  void ParsePrepared(std::shared_ptr<LoadTargetPtrList> batch_data,
+                     std::shared_ptr<PreparedBatch> prepared,
+                     user_op::KernelComputeContext* ctx) override {
     user_op::Tensor* out_tensor = ctx->Tensor4ArgNameAndIndex("out", 0);
-    OFRecord* dptr = out_tensor->mut_dptr<OFRecord>();
-    MultiThreadLoop(batch_data->size(), [&](size_t i) {
-      TensorBuffer* buffer = batch_data->at(i).get();
-      CHECK(dptr[i].ParseFromArray(buffer->data<char>(), buffer->shape().elem_cnt()));
-    });
+    if (lazy_decode_) {
+      TensorBuffer* buffers = out_tensor->mut_dptr<TensorBuffer>();
+      FOR_RANGE(size_t, i, 0, batch_data->size()) { buffers[i].Swap(batch_data->at(i).get()); }
+    } else {
+      ParseRecords(*batch_data, dynamic_cast<PreparedRecords*>(prepared.get()), out_tensor);
+    }
     if (batch_data->size() != out_tensor->shape().elem_cnt()) {
       CHECK_EQ(out_tensor->mut_shape()->NumAxes(), 1);
       out_tensor->mut_shape()->Set(0, batch_data->size());
     }
   }
+
+ private:
+  struct PreparedRecords final : public PreparedBatch {
+    std::vector<OFRecord> records;
+  };
+
+  void ParseRecords(const LoadTargetPtrList& batch_data, PreparedRecords* prepared,
+                    user_op::Tensor* out_tensor) {
+    OFRecord* dptr = out_tensor->mut_dptr<OFRecord>();
+    MultiThreadLoop(batch_data.size(), [&](size_t i) {
+      if (prepared != nullptr) {
+        dptr[i].Swap(&prepared->records.at(i));
+      } else {
+        const TensorBuffer* buffer = batch_data.at(i).get();
+        CHECK(dptr[i].ParseFromArray(buffer->data<char>(), buffer->shape().elem_cnt()));
+      }
+    });
+  }
+
+  bool lazy_decode_;
 };
 
 }  // namespace data
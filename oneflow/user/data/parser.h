@@ -22,6 +22,12 @@ limitations under the License.
 namespace oneflow {
 namespace data {
 
+// What Parser::Prepare() derives from a batch, it is queued and dropped along with the batch
+class PreparedBatch {
+ public:
+  virtual ~PreparedBatch() = default;
+};
+
 template<typename LoadTarget>
 class Parser {
  public:
@@ -30,8 +36,17 @@ class Parser {
   Parser() = default;
   virtual ~Parser() = default;
 
+  // Called on a data reader worker, possibly concurrently for different batches, before the
+  // batch is queued. Work which needs no kernel context can be done here instead of in Parse(),
+  // its result is handed to ParsePrepared() with the batch.
+  virtual std::shared_ptr<PreparedBatch> Prepare(LoadTargetPtrList* batch_data) { return nullptr; }
   virtual void Parse(std::shared_ptr<LoadTargetPtrList> batch_data,
                      user_op::KernelComputeContext* ctx) = 0;
+  virtual void ParsePrepared(std::shared_ptr<LoadTargetPtrList> batch_data,
+                             std::shared_ptr<PreparedBatch> prepared,
+                             user_op::KernelComputeContext* ctx) {
+    Parse(batch_data, ctx);
+  }
 };
 
 }  // namespace data
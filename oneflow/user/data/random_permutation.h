@@ -0,0 +1,81 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_RANDOM_PERMUTATION_H_
+#define ONEFLOW_USER_DATA_RANDOM_PERMUTATION_H_
+
+#include <array>
+#include <random>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace data {
+
+// A pseudo random permutation of [0, size) computed one element at a time, so that a rank can
+// take its share of a shuffled index space without materializing all of it. It is a four round
+// Feistel network over the smallest domain of an even number of bits covering size, elements
+// mapped past size are sent through the network again until they fall inside.
+class RandomPermutation final {
+ public:
+  RandomPermutation(int64_t size, uint64_t seed) : size_(size), half_bits_(1) {
+    CHECK_GE(size, 0);
+    while ((static_cast<uint64_t>(1) << (2 * half_bits_)) < static_cast<uint64_t>(size)) {
+      half_bits_ += 1;
+    }
+    half_mask_ = (static_cast<uint64_t>(1) << half_bits_) - 1;
+    std::mt19937_64 gen(seed);
+    for (uint64_t& key : keys_) { key = gen(); }
+  }
+  ~RandomPermutation() = default;
+
+  int64_t size() const { return size_; }
+
+  int64_t At(int64_t index) const {
+    CHECK_GE(index, 0);
+    CHECK_LT(index, size_);
+    uint64_t value = static_cast<uint64_t>(index);
+    do { value = Encrypt(value); } while (value >= static_cast<uint64_t>(size_));
+    return static_cast<int64_t>(value);
+  }
+
+ private:
+  uint64_t Encrypt(uint64_t value) const {
+    uint64_t left = value >> half_bits_;
+    uint64_t right = value & half_mask_;
+    for (uint64_t key : keys_) {
+      const uint64_t next_right = left ^ (Mix(right ^ key) & half_mask_);
+      left = right;
+      right = next_right;
+    }
+    return (left << half_bits_) | right;
+  }
+
+  // the finalizer of splitmix64
+  static uint64_t Mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  int64_t size_;
+  int32_t half_bits_;
+  uint64_t half_mask_;
+  std::array<uint64_t, 4> keys_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_RANDOM_PERMUTATION_H_
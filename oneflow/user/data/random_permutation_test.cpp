@@ -0,0 +1,57 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/random_permutation.h"
+
+namespace oneflow {
+namespace data {
+
+namespace test {
+
+TEST(RandomPermutation, bijective) {
+  for (int64_t size : {0, 1, 2, 3, 5, 64, 1000, 4097}) {
+    RandomPermutation permutation(size, 7);
+    std::vector<bool> seen(size, false);
+    FOR_RANGE(int64_t, i, 0, size) {
+      const int64_t value = permutation.At(i);
+      ASSERT_GE(value, 0);
+      ASSERT_LT(value, size);
+      ASSERT_FALSE(seen.at(value));
+      seen.at(value) = true;
+    }
+  }
+}
+
+TEST(RandomPermutation, seeded) {
+  const int64_t size = 10000;
+  RandomPermutation permutation(size, 1);
+  RandomPermutation same_permutation(size, 1);
+  RandomPermutation other_permutation(size, 2);
+  int64_t num_fixed = 0;
+  int64_t num_same = 0;
+  FOR_RANGE(int64_t, i, 0, size) {
+    ASSERT_EQ(permutation.At(i), same_permutation.At(i));
+    if (permutation.At(i) == i) { num_fixed += 1; }
+    if (permutation.At(i) == other_permutation.At(i)) { num_same += 1; }
+  }
+  // a random permutation has one fixed point and one match with another on average
+  ASSERT_LT(num_fixed, 20);
+  ASSERT_LT(num_same, 20);
+}
+
+}  // namespace test
+
+}  // namespace data
+}  // namespace oneflow
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
 
 namespace oneflow {
 
@@ -25,7 +26,30 @@ class LayerNormCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const bool scale = ctx->Attr<bool>("scale");
+    const bool center = ctx->Attr<bool>("center");
+    user_op::Tensor* normalized = scale ? ctx->Tensor4ArgNameAndIndex("normalized", 0) : y;
+    const T epsilon = static_cast<T>(ctx->Attr<double>("epsilon"));
+    const T* gamma_ptr = scale ? ctx->Tensor4ArgNameAndIndex("gamma", 0)->dptr<T>() : nullptr;
+    const T* beta_ptr = center ? ctx->Tensor4ArgNameAndIndex("beta", 0)->dptr<T>() : nullptr;
+    int64_t param_size = 0;
+    if (scale) {
+      param_size = ctx->Tensor4ArgNameAndIndex("gamma", 0)->shape().elem_cnt();
+    } else if (center) {
+      param_size = ctx->Tensor4ArgNameAndIndex("beta", 0)->shape().elem_cnt();
+    }
+    const int64_t row_num = mean->shape().elem_cnt();
+    CHECK_EQ(x->shape().elem_cnt() % row_num, 0);
+    const int64_t n = x->shape().elem_cnt() / row_num;
+    LayerNormCpuKernelUtil<T>::Forward(row_num, n, epsilon, x->dptr<T>(), gamma_ptr, beta_ptr,
+                                       param_size, normalized->mut_dptr<T>(), y->mut_dptr<T>(),
+                                       mean->mut_dptr<T>(), inv_variance->mut_dptr<T>());
+  };
 };
 
 #define REGISTER_LAYER_NORM_CPU_KERNEL(dtype)             \
@@ -45,7 +69,18 @@ class LayerNormGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const int64_t row_num = mean->shape().elem_cnt();
+    CHECK_EQ(x->shape().elem_cnt() % row_num, 0);
+    const int64_t n = x->shape().elem_cnt() / row_num;
+    LayerNormCpuKernelUtil<T>::Backward(row_num, n, dy->dptr<T>(), x->dptr<T>(), mean->dptr<T>(),
+                                        inv_variance->dptr<T>(), dx->mut_dptr<T>());
+  };
 };
 
 #define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)        \
@@ -65,7 +100,29 @@ class LayerNormParamGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    user_op::Tensor* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+    user_op::Tensor* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+    user_op::Tensor* normalized_diff = ctx->Tensor4ArgNameAndIndex("normalized_diff", 0);
+    user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const int64_t elem_cnt = dy->shape().elem_cnt();
+    if (beta_diff != nullptr || gamma_diff != nullptr) {
+      const int64_t m = (beta_diff != nullptr ? beta_diff : gamma_diff)->shape().elem_cnt();
+      const T* normalized_ptr =
+          gamma_diff != nullptr ? ctx->Tensor4ArgNameAndIndex("normalized", 0)->dptr<T>()
+                                : nullptr;
+      LayerNormCpuKernelUtil<T>::ParamBackward(
+          elem_cnt, m, dy->dptr<T>(), normalized_ptr,
+          gamma_diff != nullptr ? gamma_diff->mut_dptr<T>() : nullptr,
+          beta_diff != nullptr ? beta_diff->mut_dptr<T>() : nullptr);
+    }
+    if (normalized_diff != nullptr) {
+      LayerNormCpuKernelUtil<T>::NormalizedDiff(
+          elem_cnt, gamma != nullptr ? gamma->shape().elem_cnt() : elem_cnt, dy->dptr<T>(),
+          gamma != nullptr ? gamma->dptr<T>() : nullptr, normalized_diff->mut_dptr<T>());
+    }
+  };
 };
 
 #define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(dtype)  \
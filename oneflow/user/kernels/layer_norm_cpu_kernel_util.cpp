@@ -0,0 +1,223 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
+#include "oneflow/core/common/data_type.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
+
+namespace oneflow {
+
+namespace {
+
+// independent accumulators per row, so that the statistics loop can be vectorized
+const int64_t kWelfordLaneNum = 8;
+
+template<typename T>
+void WelfordCombine(T b_mean, T b_m2, int64_t b_count, T* mean, T* m2, int64_t* count) {
+  if (b_count == 0) { return; }
+  const int64_t new_count = *count + b_count;
+  const T nb_over_n = static_cast<T>(b_count) / static_cast<T>(new_count);
+  const T delta = b_mean - *mean;
+  *mean += delta * nb_over_n;
+  *m2 += b_m2 + delta * delta * static_cast<T>(*count) * nb_over_n;
+  *count = new_count;
+}
+
+// single pass mean and biased variance of a row
+template<typename T>
+void RowMeanVariance(const T* x, int64_t n, T* mean, T* variance) {
+  T lane_mean[kWelfordLaneNum] = {0};
+  T lane_m2[kWelfordLaneNum] = {0};
+  const int64_t vec_n = n / kWelfordLaneNum * kWelfordLaneNum;
+  int64_t lane_count = 0;
+  for (int64_t i = 0; i < vec_n; i += kWelfordLaneNum) {
+    lane_count += 1;
+    const T inv_count = static_cast<T>(1) / static_cast<T>(lane_count);
+    FOR_RANGE(int64_t, l, 0, kWelfordLaneNum) {
+      const T delta = x[i + l] - lane_mean[l];
+      lane_mean[l] += delta * inv_count;
+      lane_m2[l] += delta * (x[i + l] - lane_mean[l]);
+    }
+  }
+  T row_mean = 0;
+  T row_m2 = 0;
+  int64_t count = 0;
+  FOR_RANGE(int64_t, l, 0, kWelfordLaneNum) {
+    WelfordCombine(lane_mean[l], lane_m2[l], lane_count, &row_mean, &row_m2, &count);
+  }
+  FOR_RANGE(int64_t, i, vec_n, n) {
+    count += 1;
+    const T delta = x[i] - row_mean;
+    row_mean += delta / static_cast<T>(count);
+    row_m2 += delta * (x[i] - row_mean);
+  }
+  *mean = row_mean;
+  *variance = row_m2 / static_cast<T>(n);
+}
+
+void ParallelForRows(int64_t row_num, int64_t row_size,
+                     const std::function<void(int64_t, int64_t)>& Callback) {
+  const int64_t grain_size = std::max<int64_t>(1, kCpuNdarrayParallelGrainElemCnt / row_size);
+  CpuNdarrayParallelFor(row_num, grain_size, Callback);
+}
+
+// gamma and beta cover the last param_size elements, which may span several rows or a part of
+// one row
+template<typename T>
+void AffineRow(const T* normalized, const T* gamma, const T* beta, int64_t param_offset,
+               int64_t param_size, int64_t n, T* y) {
+  if (param_offset == 0 && param_size == n) {
+    if (gamma != nullptr && beta != nullptr) {
+      FOR_RANGE(int64_t, j, 0, n) { y[j] = normalized[j] * gamma[j] + beta[j]; }
+    } else if (gamma != nullptr) {
+      FOR_RANGE(int64_t, j, 0, n) { y[j] = normalized[j] * gamma[j]; }
+    } else {
+      FOR_RANGE(int64_t, j, 0, n) { y[j] = normalized[j] + beta[j]; }
+    }
+    return;
+  }
+  int64_t k = param_offset;
+  FOR_RANGE(int64_t, j, 0, n) {
+    T v = normalized[j];
+    if (gamma != nullptr) { v *= gamma[k]; }
+    if (beta != nullptr) { v += beta[k]; }
+    y[j] = v;
+    k += 1;
+    if (k == param_size) { k = 0; }
+  }
+}
+
+}  // namespace
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::Forward(int64_t row_num, int64_t row_size, T epsilon, const T* x,
+                                        const T* gamma, const T* beta, int64_t param_size,
+                                        T* normalized, T* y, T* mean, T* inv_variance) {
+  const int64_t n = row_size;
+  ParallelForRows(row_num, n, [=](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      const T* x_i = x + i * n;
+      T* normalized_i = normalized + i * n;
+      T row_mean = 0;
+      T row_variance = 0;
+      RowMeanVariance(x_i, n, &row_mean, &row_variance);
+      const T inv_std = static_cast<T>(1) / std::sqrt(row_variance + epsilon);
+      mean[i] = row_mean;
+      inv_variance[i] = inv_std;
+      FOR_RANGE(int64_t, j, 0, n) { normalized_i[j] = (x_i[j] - row_mean) * inv_std; }
+      if (gamma != nullptr || beta != nullptr) {
+        AffineRow(normalized_i, gamma, beta, (i * n) % param_size, param_size, n, y + i * n);
+      }
+    }
+  });
+}
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::Backward(int64_t row_num, int64_t row_size, const T* dy,
+                                         const T* x, const T* mean, const T* inv_variance,
+                                         T* dx) {
+  const int64_t n = row_size;
+  const T inv_n = static_cast<T>(1) / static_cast<T>(n);
+  // dx = inv_std * (dy - mean(dy) - normalized * mean(dy * normalized)), as the batch norm
+  // backward with unit scale on the gpu
+  ParallelForRows(row_num, n, [=](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      const T* dy_i = dy + i * n;
+      const T* x_i = x + i * n;
+      T* dx_i = dx + i * n;
+      const T row_mean = mean[i];
+      const T inv_std = inv_variance[i];
+      T sum_dy = 0;
+      T sum_dy_normalized = 0;
+      FOR_RANGE(int64_t, j, 0, n) {
+        sum_dy += dy_i[j];
+        sum_dy_normalized += dy_i[j] * (x_i[j] - row_mean) * inv_std;
+      }
+      const T mean_dy = sum_dy * inv_n;
+      const T mean_dy_normalized = sum_dy_normalized * inv_n;
+      FOR_RANGE(int64_t, j, 0, n) {
+        const T normalized = (x_i[j] - row_mean) * inv_std;
+        dx_i[j] = inv_std * (dy_i[j] - mean_dy - normalized * mean_dy_normalized);
+      }
+    }
+  });
+}
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::ParamBackward(int64_t elem_cnt, int64_t param_size, const T* dy,
+                                              const T* normalized, T* gamma_diff,
+                                              T* beta_diff) {
+  const int64_t m = param_size;
+  CHECK_EQ(elem_cnt % m, 0);
+  const int64_t n = elem_cnt / m;
+  // rows are split into chunks which reduce into their own partial sums
+  const int64_t chunk_num = std::max<int64_t>(
+      1, std::min<int64_t>({CpuNdarrayThreadNum(), n, elem_cnt / kCpuNdarrayParallelGrainElemCnt}));
+  std::vector<T> partial_beta_diff(beta_diff != nullptr ? chunk_num * m : 0, 0);
+  std::vector<T> partial_gamma_diff(gamma_diff != nullptr ? chunk_num * m : 0, 0);
+  CpuNdarrayParallelFor(chunk_num, 1, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, chunk, begin, end) {
+      const int64_t row_begin = n * chunk / chunk_num;
+      const int64_t row_end = n * (chunk + 1) / chunk_num;
+      T* beta_sum = beta_diff != nullptr ? partial_beta_diff.data() + chunk * m : nullptr;
+      T* gamma_sum = gamma_diff != nullptr ? partial_gamma_diff.data() + chunk * m : nullptr;
+      FOR_RANGE(int64_t, i, row_begin, row_end) {
+        const T* dy_i = dy + i * m;
+        if (beta_sum != nullptr) {
+          FOR_RANGE(int64_t, j, 0, m) { beta_sum[j] += dy_i[j]; }
+        }
+        if (gamma_sum != nullptr) {
+          const T* normalized_i = normalized + i * m;
+          FOR_RANGE(int64_t, j, 0, m) { gamma_sum[j] += dy_i[j] * normalized_i[j]; }
+        }
+      }
+    }
+  });
+  FOR_RANGE(int64_t, j, 0, m) {
+    if (beta_diff != nullptr) {
+      T sum = 0;
+      FOR_RANGE(int64_t, chunk, 0, chunk_num) { sum += partial_beta_diff[chunk * m + j]; }
+      beta_diff[j] = sum;
+    }
+    if (gamma_diff != nullptr) {
+      T sum = 0;
+      FOR_RANGE(int64_t, chunk, 0, chunk_num) { sum += partial_gamma_diff[chunk * m + j]; }
+      gamma_diff[j] = sum;
+    }
+  }
+}
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::NormalizedDiff(int64_t elem_cnt, int64_t param_size, const T* dy,
+                                               const T* gamma, T* normalized_diff) {
+  if (gamma == nullptr) {
+    std::memcpy(normalized_diff, dy, elem_cnt * sizeof(T));
+    return;
+  }
+  const int64_t m = param_size;
+  CHECK_EQ(elem_cnt % m, 0);
+  ParallelForRows(elem_cnt / m, m, [=](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      FOR_RANGE(int64_t, j, 0, m) { normalized_diff[i * m + j] = dy[i * m + j] * gamma[j]; }
+    }
+  });
+}
+
+#define INSTANTIATE_LAYER_NORM_CPU_KERNEL_UTIL(type_cpp, type_proto) \
+  template struct LayerNormCpuKernelUtil<type_cpp>;
+OF_PP_FOR_EACH_TUPLE(INSTANTIATE_LAYER_NORM_CPU_KERNEL_UTIL, FLOATING_DATA_TYPE_SEQ);
+#undef INSTANTIATE_LAYER_NORM_CPU_KERNEL_UTIL
+
+}  // namespace oneflow
@@ -0,0 +1,41 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// x is row_num rows of row_size elements, gamma and beta cover the last param_size elements and
+// may be nullptr. Rows are split across Global<ThreadPool>, or run inline when there is none.
+template<typename T>
+struct LayerNormCpuKernelUtil {
+  static void Forward(int64_t row_num, int64_t row_size, T epsilon, const T* x, const T* gamma,
+                      const T* beta, int64_t param_size, T* normalized, T* y, T* mean,
+                      T* inv_variance);
+  static void Backward(int64_t row_num, int64_t row_size, const T* dy, const T* x, const T* mean,
+                       const T* inv_variance, T* dx);
+  // column sums over elem_cnt / param_size rows, gamma_diff or beta_diff may be nullptr
+  static void ParamBackward(int64_t elem_cnt, int64_t param_size, const T* dy, const T* normalized,
+                            T* gamma_diff, T* beta_diff);
+  static void NormalizedDiff(int64_t elem_cnt, int64_t param_size, const T* dy, const T* gamma,
+                             T* normalized_diff);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
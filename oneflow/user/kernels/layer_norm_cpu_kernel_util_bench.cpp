@@ -0,0 +1,115 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+// Bytes are counted as the tensors each pass must touch once: forward reads x and writes
+// normalized and y, backward reads dy and x and writes dx. The Stream benchmarks move the same
+// bytes with plain loops and stand for the memory bandwidth the kernels can reach. The kernels
+// split rows across Global<ThreadPool>, so one is created as the runtime would.
+
+void BenchmarkForward(BenchmarkState* state, int64_t row_num, int64_t row_size) {
+  const int64_t elem_cnt = row_num * row_size;
+  std::vector<float> x(elem_cnt);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) { x[i] = static_cast<float>(i % 97) * 0.01f; }
+  std::vector<float> gamma(row_size, 1.5f);
+  std::vector<float> beta(row_size, 0.5f);
+  std::vector<float> normalized(elem_cnt);
+  std::vector<float> y(elem_cnt);
+  std::vector<float> mean(row_num);
+  std::vector<float> inv_variance(row_num);
+  Global<ThreadPool>::New(4);
+  while (state->KeepRunning()) {
+    LayerNormCpuKernelUtil<float>::Forward(row_num, row_size, 1e-5f, x.data(), gamma.data(),
+                                           beta.data(), row_size, normalized.data(), y.data(),
+                                           mean.data(), inv_variance.data());
+    DoNotOptimize(y.data());
+  }
+  Global<ThreadPool>::Delete();
+  state->SetBytesProcessed(state->iterations() * elem_cnt * sizeof(float) * 3);
+}
+
+void BenchmarkBackward(BenchmarkState* state, int64_t row_num, int64_t row_size) {
+  const int64_t elem_cnt = row_num * row_size;
+  std::vector<float> dy(elem_cnt, 0.25f);
+  std::vector<float> x(elem_cnt);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) { x[i] = static_cast<float>(i % 97) * 0.01f; }
+  std::vector<float> mean(row_num, 0.48f);
+  std::vector<float> inv_variance(row_num, 3.5f);
+  std::vector<float> dx(elem_cnt);
+  Global<ThreadPool>::New(4);
+  while (state->KeepRunning()) {
+    LayerNormCpuKernelUtil<float>::Backward(row_num, row_size, dy.data(), x.data(), mean.data(),
+                                            inv_variance.data(), dx.data());
+    DoNotOptimize(dx.data());
+  }
+  Global<ThreadPool>::Delete();
+  state->SetBytesProcessed(state->iterations() * elem_cnt * sizeof(float) * 3);
+}
+
+void BenchmarkForwardStream(BenchmarkState* state, int64_t elem_cnt) {
+  std::vector<float> x(elem_cnt, 1.0f);
+  std::vector<float> normalized(elem_cnt);
+  std::vector<float> y(elem_cnt);
+  while (state->KeepRunning()) {
+    FOR_RANGE(int64_t, i, 0, elem_cnt) {
+      normalized[i] = x[i];
+      y[i] = x[i];
+    }
+    DoNotOptimize(y.data());
+  }
+  state->SetBytesProcessed(state->iterations() * elem_cnt * sizeof(float) * 3);
+}
+
+void BenchmarkBackwardStream(BenchmarkState* state, int64_t elem_cnt) {
+  std::vector<float> dy(elem_cnt, 1.0f);
+  std::vector<float> x(elem_cnt, 1.0f);
+  std::vector<float> dx(elem_cnt);
+  while (state->KeepRunning()) {
+    FOR_RANGE(int64_t, i, 0, elem_cnt) { dx[i] = dy[i] + x[i]; }
+    DoNotOptimize(dx.data());
+  }
+  state->SetBytesProcessed(state->iterations() * elem_cnt * sizeof(float) * 3);
+}
+
+// BERT-base activations, 32 sequences of 128 tokens with hidden size 768
+const int64_t kBertRowNum = 32 * 128;
+const int64_t kBertRowSize = 768;
+
+}  // namespace
+
+OF_BENCHMARK(LayerNormForward_Bert) { BenchmarkForward(state, kBertRowNum, kBertRowSize); }
+
+OF_BENCHMARK(LayerNormForward_WideRows) { BenchmarkForward(state, 256, 12288); }
+
+OF_BENCHMARK(LayerNormForwardStream_Bert) {
+  BenchmarkForwardStream(state, kBertRowNum * kBertRowSize);
+}
+
+OF_BENCHMARK(LayerNormBackward_Bert) { BenchmarkBackward(state, kBertRowNum, kBertRowSize); }
+
+OF_BENCHMARK(LayerNormBackward_WideRows) { BenchmarkBackward(state, 256, 12288); }
+
+OF_BENCHMARK(LayerNormBackwardStream_Bert) {
+  BenchmarkBackwardStream(state, kBertRowNum * kBertRowSize);
+}
+
+}  // namespace oneflow
@@ -0,0 +1,151 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+std::vector<double> RandomVector(int64_t size, std::mt19937* gen) {
+  std::uniform_real_distribution<double> dis(-2.0, 2.0);
+  std::vector<double> vec(size);
+  // an offset far from zero, which a naive one pass variance would not survive
+  for (double& value : vec) { value = 100.0 + dis(*gen); }
+  return vec;
+}
+
+template<typename T>
+std::vector<T> Cast(const std::vector<double>& vec) {
+  return std::vector<T>(vec.begin(), vec.end());
+}
+
+template<typename T>
+void TestLayerNorm(int64_t row_num, int64_t row_size, int64_t param_size, double tolerance) {
+  std::mt19937 gen(row_num * 131 + row_size * 7 + param_size);
+  const int64_t elem_cnt = row_num * row_size;
+  const double epsilon = 1e-5;
+  const std::vector<double> x = RandomVector(elem_cnt, &gen);
+  const std::vector<double> dy = RandomVector(elem_cnt, &gen);
+  const std::vector<double> gamma = RandomVector(param_size, &gen);
+  const std::vector<double> beta = RandomVector(param_size, &gen);
+  std::vector<double> normalized(elem_cnt);
+  std::vector<double> y(elem_cnt);
+  std::vector<double> mean(row_num);
+  std::vector<double> inv_std(row_num);
+  std::vector<double> dx(elem_cnt);
+  std::vector<double> gamma_diff(param_size, 0);
+  std::vector<double> beta_diff(param_size, 0);
+  FOR_RANGE(int64_t, i, 0, row_num) {
+    double sum = 0;
+    FOR_RANGE(int64_t, j, 0, row_size) { sum += x[i * row_size + j]; }
+    mean[i] = sum / row_size;
+    double square_sum = 0;
+    FOR_RANGE(int64_t, j, 0, row_size) {
+      square_sum += (x[i * row_size + j] - mean[i]) * (x[i * row_size + j] - mean[i]);
+    }
+    inv_std[i] = 1.0 / std::sqrt(square_sum / row_size + epsilon);
+    double sum_dy = 0;
+    double sum_dy_normalized = 0;
+    FOR_RANGE(int64_t, j, 0, row_size) {
+      const int64_t k = i * row_size + j;
+      normalized[k] = (x[k] - mean[i]) * inv_std[i];
+      y[k] = normalized[k] * gamma[k % param_size] + beta[k % param_size];
+      sum_dy += dy[k];
+      sum_dy_normalized += dy[k] * normalized[k];
+    }
+    FOR_RANGE(int64_t, j, 0, row_size) {
+      const int64_t k = i * row_size + j;
+      dx[k] = inv_std[i]
+              * (dy[k] - sum_dy / row_size - normalized[k] * sum_dy_normalized / row_size);
+    }
+  }
+  FOR_RANGE(int64_t, k, 0, elem_cnt) {
+    gamma_diff[k % param_size] += dy[k] * normalized[k];
+    beta_diff[k % param_size] += dy[k];
+  }
+
+  const std::vector<T> x_t = Cast<T>(x);
+  const std::vector<T> dy_t = Cast<T>(dy);
+  const std::vector<T> gamma_t = Cast<T>(gamma);
+  const std::vector<T> beta_t = Cast<T>(beta);
+  std::vector<T> normalized_t(elem_cnt);
+  std::vector<T> y_t(elem_cnt);
+  std::vector<T> mean_t(row_num);
+  std::vector<T> inv_std_t(row_num);
+  LayerNormCpuKernelUtil<T>::Forward(row_num, row_size, static_cast<T>(epsilon), x_t.data(),
+                                     gamma_t.data(), beta_t.data(), param_size,
+                                     normalized_t.data(), y_t.data(), mean_t.data(),
+                                     inv_std_t.data());
+  FOR_RANGE(int64_t, i, 0, row_num) {
+    ASSERT_NEAR(mean_t[i], mean[i], tolerance * 100);
+    ASSERT_NEAR(inv_std_t[i] / inv_std[i], 1.0, tolerance);
+  }
+  FOR_RANGE(int64_t, k, 0, elem_cnt) {
+    ASSERT_NEAR(normalized_t[k], normalized[k], tolerance * 10);
+    ASSERT_NEAR(y_t[k], y[k], tolerance * 1000);
+  }
+  std::vector<T> dx_t(elem_cnt);
+  LayerNormCpuKernelUtil<T>::Backward(row_num, row_size, dy_t.data(), x_t.data(), mean_t.data(),
+                                      inv_std_t.data(), dx_t.data());
+  FOR_RANGE(int64_t, k, 0, elem_cnt) { ASSERT_NEAR(dx_t[k], dx[k], tolerance * 1000); }
+  std::vector<T> gamma_diff_t(param_size);
+  std::vector<T> beta_diff_t(param_size);
+  LayerNormCpuKernelUtil<T>::ParamBackward(elem_cnt, param_size, dy_t.data(),
+                                           normalized_t.data(), gamma_diff_t.data(),
+                                           beta_diff_t.data());
+  const double sum_tolerance = tolerance * 100 * (elem_cnt / param_size);
+  FOR_RANGE(int64_t, j, 0, param_size) {
+    ASSERT_NEAR(gamma_diff_t[j], gamma_diff[j], sum_tolerance * 10);
+    ASSERT_NEAR(beta_diff_t[j], beta_diff[j], sum_tolerance * 100);
+  }
+  std::vector<T> normalized_diff_t(elem_cnt);
+  LayerNormCpuKernelUtil<T>::NormalizedDiff(elem_cnt, param_size, dy_t.data(), gamma_t.data(),
+                                            normalized_diff_t.data());
+  FOR_RANGE(int64_t, k, 0, elem_cnt) {
+    ASSERT_EQ(normalized_diff_t[k], dy_t[k] * gamma_t[k % param_size]);
+  }
+  LayerNormCpuKernelUtil<T>::NormalizedDiff(elem_cnt, param_size, dy_t.data(), nullptr,
+                                            normalized_diff_t.data());
+  ASSERT_EQ(normalized_diff_t, dy_t);
+}
+
+template<typename T>
+void TestLayerNormShapes(double tolerance) {
+  Global<ThreadPool>::New(4);
+  // params of one row, of a part of a row and spanning several rows, row sizes which are not a
+  // multiple of the welford lanes
+  TestLayerNorm<T>(64, 768, 768, tolerance);
+  TestLayerNorm<T>(37, 13, 13, tolerance);
+  TestLayerNorm<T>(16, 96, 32, tolerance);
+  TestLayerNorm<T>(16, 5, 20, tolerance);
+  TestLayerNorm<T>(4096, 64, 64, tolerance);
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace
+
+TEST(LayerNormCpuKernelUtil, float) { TestLayerNormShapes<float>(1e-5); }
+
+TEST(LayerNormCpuKernelUtil, double) { TestLayerNormShapes<double>(1e-12); }
+
+// outside of a session there is no thread pool and the rows run inline
+TEST(LayerNormCpuKernelUtil, float_without_thread_pool) {
+  TestLayerNorm<float>(37, 13, 13, 1e-5);
+  TestLayerNorm<float>(4096, 64, 64, 1e-5);
+}
+
+}  // namespace oneflow
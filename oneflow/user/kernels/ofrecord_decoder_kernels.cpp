@@ -24,6 +24,7 @@ limitations under the License.
 #include "oneflow/user/image/image_util.h"
 #include "oneflow/user/kernels/random_crop_kernel_state.h"
 #include "oneflow/user/kernels/op_kernel_state_wrapper.h"
+#include "oneflow/user/kernels/ofrecord_decoder_util.h"
 #include "oneflow/user/kernels/random_seed_util.h"
 
 #include <opencv2/opencv.hpp>
@@ -32,40 +33,17 @@ namespace oneflow {
 
 namespace {
 
-template<typename T>
-void DecodeOneRawOFRecord(const Feature& feature, T* dptr, int64_t sample_elem_cnt,
-                          bool dim1_varying_length, bool auto_zero_padding) {
-  if (feature.has_bytes_list()) {
-    CHECK_EQ(feature.bytes_list().value_size(), 1);
-    const auto& value0 = feature.bytes_list().value(0);
-    auto in_dptr = reinterpret_cast<const int8_t*>(value0.c_str());
-    sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, value0.size());
-    CopyElem<int8_t, T>(in_dptr, dptr, sample_elem_cnt);
-  }
-#define DEFINE_ONE_ELIF(PbT, CppT)                                                                \
-  else if (feature.has_##PbT##_list()) {                                                          \
-    const auto& list = feature.PbT##_list();                                                      \
-    const CppT* in_dptr = list.value().data();                                                    \
-    const int64_t padding_elem_num = auto_zero_padding ? sample_elem_cnt - list.value_size() : 0; \
-    if (dim1_varying_length || auto_zero_padding) {                                               \
-      CHECK_LE(list.value_size(), sample_elem_cnt);                                               \
-      sample_elem_cnt = list.value_size();                                                        \
-    } else {                                                                                      \
-      CHECK_EQ(sample_elem_cnt, list.value_size());                                               \
-    }                                                                                             \
-    CopyElem<CppT, T>(in_dptr, dptr, sample_elem_cnt);                                            \
-    if (padding_elem_num > 0) {                                                                   \
-      std::memset(dptr + sample_elem_cnt, 0, padding_elem_num * sizeof(T));                       \
-    }                                                                                             \
-  }
-  DEFINE_ONE_ELIF(float, float)
-  DEFINE_ONE_ELIF(double, double)
-  DEFINE_ONE_ELIF(int32, int32_t)
-  DEFINE_ONE_ELIF(int64, int64_t)
-#undef DEFINE_ONE_ELIF
-  else {
-    UNIMPLEMENTED();
-  }
+// in is either a blob of parsed OFRecords or, when the reader decodes lazily, a blob of tensor
+// buffers holding serialized records
+bool IsSerializedRecordBlob(const user_op::Tensor* in_blob) {
+  return in_blob->data_type() == DataType::kTensorBuffer;
+}
+
+OFRecordFeatureView GetFeatureView(const TensorBuffer& record, const std::string& name) {
+  OFRecordFeatureView feature;
+  CHECK(OFRecordView(record.data<char>(), record.shape().elem_cnt()).GetFeature(name, &feature))
+      << "Field " << name << " not found";
+  return feature;
 }
 
 }  // namespace
@@ -84,30 +62,41 @@ class OFRecordRawDecoderKernel final : public user_op::OpKernel {
     int64_t record_num = in_blob->shape().At(0);
     int64_t sample_elem_cnt = out_blob->shape().Count(1);
     CHECK(record_num > 0);
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     T* out_dptr = out_blob->mut_dptr<T>();
     const std::string& name = ctx->Attr<std::string>("name");
 
     bool auto_zero_padding = ctx->Attr<bool>("auto_zero_padding");
     bool dim1_varying_length = ctx->Attr<bool>("dim1_varying_length");
 
+    if (IsSerializedRecordBlob(in_blob)) {
+      const TensorBuffer* records = in_blob->dptr<TensorBuffer>();
+      MultiThreadLoop(record_num, [&](size_t i) {
+        T* dptr = out_dptr + i * sample_elem_cnt;
+        const OFRecordFeatureView feature = GetFeatureView(records[i], name);
+        DecodeOneRawOFRecord(feature, dptr, sample_elem_cnt, dim1_varying_length,
+                             auto_zero_padding);
+      });
+      return;
+    }
+    const OFRecord* records = in_blob->dptr<OFRecord>();
     MultiThreadLoop(record_num, [&](size_t i) {
       const OFRecord& record = *(records + i);
       T* dptr = out_dptr + i * sample_elem_cnt;
       CHECK(record.feature().find(name) != record.feature().end())
           << "Field " << name << " not found";
       const Feature& feature = record.feature().at(name);
-      DecodeOneRawOFRecord(feature, dptr, sample_elem_cnt, auto_zero_padding, dim1_varying_length);
+      DecodeOneRawOFRecord(feature, dptr, sample_elem_cnt, dim1_varying_length, auto_zero_padding);
     });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
-#define REGISTER_RAW_DECODER_KERNEL(dtype)                                      \
-  REGISTER_USER_KERNEL("ofrecord_raw_decoder")                                  \
-      .SetCreateFn<OFRecordRawDecoderKernel<dtype>>()                           \
-      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                       \
-                       & (user_op::HobDataType("in", 0) == DataType::kOFRecord) \
+#define REGISTER_RAW_DECODER_KERNEL(dtype)                                              \
+  REGISTER_USER_KERNEL("ofrecord_raw_decoder")                                          \
+      .SetCreateFn<OFRecordRawDecoderKernel<dtype>>()                                   \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                               \
+                       & ((user_op::HobDataType("in", 0) == DataType::kOFRecord)        \
+                          | (user_op::HobDataType("in", 0) == DataType::kTensorBuffer)) \
                        & (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
 
 REGISTER_RAW_DECODER_KERNEL(char)
@@ -120,19 +109,37 @@ REGISTER_RAW_DECODER_KERNEL(uint8_t)
 
 namespace {
 
-void DecodeRandomCropImageFromOneRecord(const OFRecord& record, TensorBuffer* buffer,
-                                        const std::string& name, const std::string& color_space,
-                                        RandomCropGenerator* random_crop_gen) {
+void GetEncodedImage(const user_op::Tensor* in_blob, int64_t index, const std::string& name,
+                     const char** data, size_t* size) {
+  if (IsSerializedRecordBlob(in_blob)) {
+    const OFRecordFeatureView feature = GetFeatureView(in_blob->dptr<TensorBuffer>()[index], name);
+    CHECK(feature.has_bytes_list());
+    CHECK(feature.value_size() == 1);
+    feature.GetBytes(0, data, size);
+    return;
+  }
+  const OFRecord& record = in_blob->dptr<OFRecord>()[index];
   CHECK(record.feature().find(name) != record.feature().end()) << "Field " << name << " not found";
   const Feature& feature = record.feature().at(name);
   CHECK(feature.has_bytes_list());
   CHECK(feature.bytes_list().value_size() == 1);
   const std::string& src_data = feature.bytes_list().value(0);
+  *data = src_data.data();
+  *size = src_data.size();
+}
+
+void DecodeRandomCropImageFromOneRecord(const user_op::Tensor* in_blob, int64_t index,
+                                        TensorBuffer* buffer, const std::string& name,
+                                        const std::string& color_space,
+                                        RandomCropGenerator* random_crop_gen) {
+  const char* src_data = nullptr;
+  size_t src_size = 0;
+  GetEncodedImage(in_blob, index, name, &src_data, &src_size);
 
   // cv::_InputArray image_data(src_data.data(), src_data.size());
   // cv::Mat image = cv::imdecode(image_data, cv::IMREAD_ANYCOLOR);
   cv::Mat image =
-      cv::imdecode(cv::Mat(1, src_data.size(), CV_8UC1, (void*)(src_data.data())),  // NOLINT
+      cv::imdecode(cv::Mat(1, src_size, CV_8UC1, (void*)(src_data)),  // NOLINT
                    ImageUtil::IsColor(color_space) ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE);
   int W = image.cols;
   int H = image.rows;
@@ -194,16 +201,14 @@ class OFRecordImageDecoderRandomCropKernel final : public user_op::OpKernel {
     CHECK(record_num > 0);
     user_op::Tensor* in_blob = ctx->Tensor4ArgNameAndIndex("in", 0);
     CHECK_EQ(out_blob->shape(), in_blob->shape());
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     TensorBuffer* buffers = out_blob->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
     const std::string& color_space = ctx->Attr<std::string>("color_space");
 
     MultiThreadLoop(record_num, [&](size_t i) {
-      const OFRecord& record = *(records + i);
       TensorBuffer* buffer = buffers + i;
       RandomCropGenerator* gen = crop_window_generators->GetGenerator(i);
-      DecodeRandomCropImageFromOneRecord(record, buffer, name, color_space, gen);
+      DecodeRandomCropImageFromOneRecord(in_blob, i, buffer, name, color_space, gen);
     });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
@@ -212,7 +217,8 @@ class OFRecordImageDecoderRandomCropKernel final : public user_op::OpKernel {
 REGISTER_USER_KERNEL("ofrecord_image_decoder_random_crop")
     .SetCreateFn<OFRecordImageDecoderRandomCropKernel>()
     .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")
-                     & (user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                     & ((user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                        | (user_op::HobDataType("in", 0) == DataType::kTensorBuffer))
                      & (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
 class OFRecordImageDecoderKernel final : public user_op::OpKernel {
@@ -227,15 +233,13 @@ class OFRecordImageDecoderKernel final : public user_op::OpKernel {
     CHECK(record_num > 0);
     user_op::Tensor* in_blob = ctx->Tensor4ArgNameAndIndex("in", 0);
     CHECK_EQ(out_blob->shape(), in_blob->shape());
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     TensorBuffer* buffers = out_blob->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
     const std::string& color_space = ctx->Attr<std::string>("color_space");
 
     MultiThreadLoop(record_num, [&](size_t i) {
-      const OFRecord& record = *(records + i);
       TensorBuffer* buffer = buffers + i;
-      DecodeRandomCropImageFromOneRecord(record, buffer, name, color_space, nullptr);
+      DecodeRandomCropImageFromOneRecord(in_blob, i, buffer, name, color_space, nullptr);
     });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
@@ -244,7 +248,8 @@ class OFRecordImageDecoderKernel final : public user_op::OpKernel {
 REGISTER_USER_KERNEL("ofrecord_image_decoder")
     .SetCreateFn<OFRecordImageDecoderKernel>()
     .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")
-                     & (user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                     & ((user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                        | (user_op::HobDataType("in", 0) == DataType::kTensorBuffer))
                      & (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
 }  // namespace oneflow
@@ -0,0 +1,90 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_OFRECORD_DECODER_UTIL_H_
+#define ONEFLOW_USER_KERNELS_OFRECORD_DECODER_UTIL_H_
+
+#include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/record/ofrecord_view.h"
+#include "oneflow/core/record/record.pb.h"
+
+namespace oneflow {
+
+// decodes one feature into sample_elem_cnt elements at dptr, a shorter feature is allowed with
+// dim1_varying_length and zero padded with auto_zero_padding
+template<typename T>
+void DecodeOneRawOFRecord(const Feature& feature, T* dptr, int64_t sample_elem_cnt,
+                          bool dim1_varying_length, bool auto_zero_padding) {
+  if (feature.has_bytes_list()) {
+    CHECK_EQ(feature.bytes_list().value_size(), 1);
+    const auto& value0 = feature.bytes_list().value(0);
+    auto in_dptr = reinterpret_cast<const int8_t*>(value0.c_str());
+    sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, value0.size());
+    CopyElem<int8_t, T>(in_dptr, dptr, sample_elem_cnt);
+  }
+#define DEFINE_ONE_ELIF(PbT, CppT)                                                                \
+  else if (feature.has_##PbT##_list()) {                                                          \
+    const auto& list = feature.PbT##_list();                                                      \
+    const CppT* in_dptr = list.value().data();                                                    \
+    const int64_t padding_elem_num = auto_zero_padding ? sample_elem_cnt - list.value_size() : 0; \
+    if (dim1_varying_length || auto_zero_padding) {                                               \
+      CHECK_LE(list.value_size(), sample_elem_cnt);                                               \
+      sample_elem_cnt = list.value_size();                                                        \
+    } else {                                                                                      \
+      CHECK_EQ(sample_elem_cnt, list.value_size());                                               \
+    }                                                                                             \
+    CopyElem<CppT, T>(in_dptr, dptr, sample_elem_cnt);                                            \
+    if (padding_elem_num > 0) {                                                                   \
+      std::memset(dptr + sample_elem_cnt, 0, padding_elem_num * sizeof(T));                       \
+    }                                                                                             \
+  }
+  DEFINE_ONE_ELIF(float, float)
+  DEFINE_ONE_ELIF(double, double)
+  DEFINE_ONE_ELIF(int32, int32_t)
+  DEFINE_ONE_ELIF(int64, int64_t)
+#undef DEFINE_ONE_ELIF
+  else {
+    UNIMPLEMENTED();
+  }
+}
+
+template<typename T>
+void DecodeOneRawOFRecord(const OFRecordFeatureView& feature, T* dptr, int64_t sample_elem_cnt,
+                          bool dim1_varying_length, bool auto_zero_padding) {
+  if (feature.has_bytes_list()) {
+    CHECK_EQ(feature.value_size(), 1);
+    const char* value0 = nullptr;
+    size_t value0_size = 0;
+    feature.GetBytes(0, &value0, &value0_size);
+    sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, value0_size);
+    CopyElem<int8_t, T>(reinterpret_cast<const int8_t*>(value0), dptr, sample_elem_cnt);
+  } else if (feature.has_numeric_list()) {
+    const int64_t value_size = feature.ReadValues(dptr, sample_elem_cnt);
+    if (dim1_varying_length || auto_zero_padding) {
+      CHECK_LE(value_size, sample_elem_cnt);
+    } else {
+      CHECK_EQ(sample_elem_cnt, value_size);
+    }
+    if (auto_zero_padding && value_size < sample_elem_cnt) {
+      std::memset(dptr + value_size, 0, (sample_elem_cnt - value_size) * sizeof(T));
+    }
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_OFRECORD_DECODER_UTIL_H_
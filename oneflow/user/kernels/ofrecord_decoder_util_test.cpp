@@ -0,0 +1,61 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/ofrecord_decoder_util.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+template<typename T>
+void TestDecodeShortFeature(bool dim1_varying_length, bool auto_zero_padding) {
+  OFRecord record;
+  auto* list = (*record.mutable_feature())["x"].mutable_int32_list();
+  FOR_RANGE(int32_t, i, 0, 3) { list->add_value(i + 1); }
+  const std::string serialized = record.SerializeAsString();
+  OFRecordFeatureView feature;
+  ASSERT_TRUE(OFRecordView(serialized.data(), serialized.size()).GetFeature("x", &feature));
+  // the tail keeps its old value unless it is zero padded
+  const T expected_tail = auto_zero_padding ? 0 : 7;
+  std::vector<T> parsed(8, 7);
+  DecodeOneRawOFRecord(record.feature().at("x"), parsed.data(), 8, dim1_varying_length,
+                       auto_zero_padding);
+  std::vector<T> viewed(8, 7);
+  DecodeOneRawOFRecord(feature, viewed.data(), 8, dim1_varying_length, auto_zero_padding);
+  FOR_RANGE(int32_t, i, 0, 8) {
+    const T expected = i < 3 ? static_cast<T>(i + 1) : expected_tail;
+    ASSERT_EQ(parsed[i], expected);
+    ASSERT_EQ(viewed[i], expected);
+  }
+}
+
+}  // namespace
+
+TEST(DecodeOneRawOFRecord, auto_zero_padding) {
+  TestDecodeShortFeature<float>(false, true);
+  TestDecodeShortFeature<int64_t>(false, true);
+  TestDecodeShortFeature<int8_t>(true, true);
+}
+
+TEST(DecodeOneRawOFRecord, dim1_varying_length) {
+  TestDecodeShortFeature<float>(true, false);
+  TestDecodeShortFeature<int32_t>(true, false);
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -15,8 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/kernels/op_kernel_state_wrapper.h"
-#include "oneflow/user/utils/pool_util.h"
-#include "oneflow/core/common/eigen_util.h"
+#include "oneflow/user/kernels/pool_cpu_kernel_util.h"
 
 namespace oneflow {
 
@@ -34,313 +33,31 @@ struct PoolOpKernelState final : public user_op::OpKernelState {
 };
 
 template<typename T>
-struct PoolCpuKernelUtil {
- public:
-  typedef std::function<T()> ForwardInitialize;
-  typedef std::function<void(const T& lhs, T& rhs)> CFirstProcess;
-  typedef std::function<void(const int64_t in_col, const int64_t out_col,
-                             ConstEigenMatrixMap<T>& in_mat, EigenMatrixMap<T>& out_mat)>
-      CLastProcess;
-  typedef std::function<void(const int64_t size, T& out)> CFirstFinalize;
-  typedef std::function<void(const int64_t size, const int64_t col, EigenMatrixMap<T>& out_mat)>
-      CLastFinalize;
-  typedef std::function<void(const T& in, const T& out, const T& out_diff, const int64_t size,
-                             T& in_diff)>
-      CFirstProcessGrad;
-  typedef std::function<void(const int64_t out_col, const int64_t in_col, const int64_t size,
-                             ConstEigenArrayMap<T>& out_arr, ConstEigenArrayMap<T>& in_arr,
-                             ConstEigenArrayMap<T>& out_diff_arr, EigenArrayMap<T>& in_diff_arr)>
-      CLastProcessGrad;
-
-  static void CFirstForward(const Params3D& params_3d, const user_op::Tensor* in_blob,
-                            user_op::Tensor* out_blob, const ForwardInitialize& initialize,
-                            const CFirstProcess& process, const CFirstFinalize& finalize) {
-    const Shape& in = params_3d.GetXShape5D();
-    const Shape& out = params_3d.GetYShape5D();
-    const std::vector<int32_t>& pool_size = params_3d.pool_size_3d();
-    const std::vector<int32_t>& strides = params_3d.strides_3d();
-    const std::vector<int32_t>& padding_before = params_3d.padding_before_3d();
-
-    const T* input = in_blob->dptr<T>();
-    T* output = out_blob->mut_dptr<T>();
-    FOR_RANGE(int64_t, n, 0, in.At(0)) {
-      FOR_RANGE(int64_t, c, 0, in.At(1)) {
-        FOR_RANGE(int64_t, pd, 0, out.At(2)) {
-          int64_t dstart = pd * strides.at(0) - padding_before.at(0);
-          int64_t dend = std::min(dstart + pool_size.at(0), in.At(2));
-          dstart = std::max(dstart, static_cast<int64_t>(0));
-          FOR_RANGE(int64_t, ph, 0, out.At(3)) {
-            int64_t hstart = ph * strides.at(1) - padding_before.at(1);
-            int64_t hend = std::min(hstart + pool_size.at(1), in.At(3));
-            hstart = std::max(hstart, static_cast<int64_t>(0));
-            FOR_RANGE(int64_t, pw, 0, out.At(4)) {
-              int64_t wstart = pw * strides.at(2) - padding_before.at(2);
-              int64_t wend = std::min(wstart + pool_size.at(2), in.At(4));
-              wstart = std::max(wstart, static_cast<int64_t>(0));
-
-              const int64_t pool_index = pd * out.Count(3) + ph * out.At(4) + pw;
-              T res = initialize();
-              FOR_RANGE(int64_t, d, dstart, dend) {
-                FOR_RANGE(int64_t, h, hstart, hend) {
-                  FOR_RANGE(int64_t, w, wstart, wend) {
-                    const int64_t input_index = d * in.Count(3) + h * in.At(4) + w;
-                    process(input[input_index], res);
-                  }
-                }
-              }
-              finalize((dend - dstart) * (hend - hstart) * (wend - wstart), res);
-              output[pool_index] = res;
-            }
-          }
-        }
-        input += in.Count(2);
-        output += out.Count(2);
-      }
-    }
-  }
-
-  static void CFirstBackward(const Params3D& params_3d, const user_op::Tensor* out_diff_blob,
-                             const user_op::Tensor* out_blob, const user_op::Tensor* in_blob,
-                             user_op::Tensor* in_diff_blob, const CFirstProcessGrad& process) {
-    const Shape& in = params_3d.GetXShape5D();
-    const Shape& out = params_3d.GetYShape5D();
-    const std::vector<int32_t>& pool_size = params_3d.pool_size_3d();
-    const std::vector<int32_t>& strides = params_3d.strides_3d();
-    const std::vector<int32_t>& padding_before = params_3d.padding_before_3d();
-
-    const T* output_diff = out_diff_blob->dptr<T>();
-    const T* output = out_blob->dptr<T>();
-    const T* input = in_blob->dptr<T>();
-    std::memset(in_diff_blob->mut_dptr<T>(), T(0), in.elem_cnt() * sizeof(T));
-    T* input_diff = in_diff_blob->mut_dptr<T>();
-    FOR_RANGE(int64_t, n, 0, in.At(0)) {
-      FOR_RANGE(int64_t, c, 0, in.At(1)) {
-        FOR_RANGE(int64_t, pd, 0, out.At(2)) {
-          int64_t dstart = pd * strides.at(0) - padding_before.at(0);
-          int64_t dend = std::min(dstart + pool_size.at(0), in.At(2));
-          dstart = std::max(dstart, static_cast<int64_t>(0));
-          FOR_RANGE(int64_t, ph, 0, out.At(3)) {
-            int64_t hstart = ph * strides.at(1) - padding_before.at(1);
-            int64_t hend = std::min(hstart + pool_size.at(1), in.At(3));
-            hstart = std::max(hstart, static_cast<int64_t>(0));
-            FOR_RANGE(int64_t, pw, 0, out.At(4)) {
-              int64_t wstart = pw * strides.at(2) - padding_before.at(2);
-              int64_t wend = std::min(wstart + pool_size.at(2), in.At(4));
-              wstart = std::max(wstart, static_cast<int64_t>(0));
-
-              const int64_t size = (dend - dstart) * (hend - hstart) * (wend - wstart);
-              const int64_t pool_index = pd * out.Count(3) + ph * out.At(4) + pw;
-              FOR_RANGE(int64_t, d, dstart, dend) {
-                FOR_RANGE(int64_t, h, hstart, hend) {
-                  FOR_RANGE(int64_t, w, wstart, wend) {
-                    const int64_t index = d * in.Count(3) + h * in.At(4) + w;
-                    process(input[index], output[pool_index], output_diff[pool_index], size,
-                            input_diff[index]);
-                  }
-                }
-              }
-            }
-          }
-        }
-        // offset
-        input += in.Count(2);
-        input_diff += in.Count(2);
-        output += out.Count(2);
-        output_diff += out.Count(2);
-      }
-    }
-  }
-
-  static void CLastForward(const Params3D& params_3d, const user_op::Tensor* in_blob,
-                           user_op::Tensor* out_blob, const ForwardInitialize& forward_initialize,
-                           const CLastProcess& process, const CLastFinalize& finalize) {
-    const Shape& in = params_3d.GetXShape5D();
-    const Shape& out = params_3d.GetYShape5D();
-    const std::vector<int32_t>& pool_size = params_3d.pool_size_3d();
-    const std::vector<int32_t>& strides = params_3d.strides_3d();
-    const std::vector<int32_t>& padding_before = params_3d.padding_before_3d();
-
-    ConstEigenMatrixMap<T> in_mat(in_blob->dptr<T>(), in.At(1), in.elem_cnt() / in.At(1));
-    EigenMatrixMap<T> out_mat(out_blob->mut_dptr<T>(), out.At(1), out.elem_cnt() / out.At(1));
-    FOR_RANGE(int64_t, n, 0, in.At(0)) {
-      FOR_RANGE(int64_t, pd, 0, out.At(2)) {
-        int64_t dstart = pd * strides.at(0) - padding_before.at(0);
-        int64_t dend = std::min(dstart + pool_size.at(0), in.At(2));
-        dstart = std::max(dstart, static_cast<int64_t>(0));
-        FOR_RANGE(int64_t, ph, 0, out.At(3)) {
-          int64_t hstart = ph * strides.at(1) - padding_before.at(1);
-          int64_t hend = std::min(hstart + pool_size.at(1), in.At(3));
-          hstart = std::max(hstart, static_cast<int64_t>(0));
-          FOR_RANGE(int64_t, pw, 0, out.At(4)) {
-            int64_t wstart = pw * strides.at(2) - padding_before.at(2);
-            int64_t wend = std::min(wstart + pool_size.at(2), in.At(4));
-            wstart = std::max(wstart, static_cast<int64_t>(0));
-            const int out_col = ((n * out.At(2) + pd) * out.At(3) + ph) * out.At(4) + pw;
-            out_mat.col(out_col).setConstant(forward_initialize());
-            FOR_RANGE(int64_t, d, dstart, dend) {
-              FOR_RANGE(int64_t, h, hstart, hend) {
-                FOR_RANGE(int64_t, w, wstart, wend) {
-                  const int in_col = ((n * in.At(2) + d) * in.At(3) + h) * in.At(4) + w;
-                  process(in_col, out_col, in_mat, out_mat);
-                }
-              }
-            }
-            finalize((hend - hstart) * (wend - wstart) * (dend - dstart), out_col, out_mat);
-          }
-        }
-      }
-    }
-  }
-
-  static void CLastBackward(const Params3D& params_3d, const user_op::Tensor* out_diff_blob,
-                            const user_op::Tensor* out_blob, const user_op::Tensor* in_blob,
-                            user_op::Tensor* in_diff_blob, const CLastProcessGrad& process) {
-    const Shape& in = params_3d.GetXShape5D();
-    const Shape& out = params_3d.GetYShape5D();
-    const std::vector<int32_t>& pool_size = params_3d.pool_size_3d();
-    const std::vector<int32_t>& strides = params_3d.strides_3d();
-    const std::vector<int32_t>& padding_before = params_3d.padding_before_3d();
-
-    // caffe2 implementation: need check
-    ConstEigenArrayMap<T> out_mat(out_blob->dptr<T>(), out.At(1), out.elem_cnt() / out.At(1));
-    ConstEigenArrayMap<T> in_mat(in_blob->dptr<T>(), in.At(1), in.elem_cnt() / in.At(1));
-    ConstEigenArrayMap<T> out_diff_mat(out_diff_blob->dptr<T>(), out.At(1),
-                                       out.elem_cnt() / out.At(1));
-    std::memset(in_diff_blob->mut_dptr<T>(), T(0), in.elem_cnt() * sizeof(T));
-    EigenArrayMap<T> in_diff_mat(in_diff_blob->mut_dptr<T>(), in.At(1), in.elem_cnt() / in.At(1));
-    FOR_RANGE(int64_t, n, 0, in.At(0)) {
-      FOR_RANGE(int64_t, pd, 0, out.At(2)) {
-        int64_t dstart = pd * strides.at(0) - padding_before.at(0);
-        int64_t dend = std::min(dstart + pool_size.at(0), in.At(2));
-        dstart = std::max(dstart, static_cast<int64_t>(0));
-        FOR_RANGE(int64_t, ph, 0, out.At(3)) {
-          int64_t hstart = ph * strides.at(1) - padding_before.at(1);
-          int64_t hend = std::min(hstart + pool_size.at(1), in.At(3));
-          hstart = std::max(hstart, static_cast<int64_t>(0));
-          FOR_RANGE(int64_t, pw, 0, out.At(4)) {
-            int64_t wstart = pw * strides.at(2) - padding_before.at(2);
-            int64_t wend = std::min(wstart + pool_size.at(2), in.At(4));
-            wstart = std::max(wstart, static_cast<int64_t>(0));
-            const int64_t pool_index = ((n * out.At(2) + pd) * out.At(3) + ph) * out.At(4) + pw;
-            const int64_t size = (dend - dstart) * (hend - hstart) * (wend - wstart);
-            FOR_RANGE(int64_t, d, dstart, dend) {
-              FOR_RANGE(int64_t, h, hstart, hend) {
-                FOR_RANGE(int64_t, w, wstart, wend) {
-                  const int64_t input_index = ((n * in.At(2) + d) * in.At(3) + h) * in.At(4) + w;
-                  process(pool_index, input_index, size, out_mat, in_mat, out_diff_mat,
-                          in_diff_mat);
-                }
-              }
-            }
-          }
-        }
-      }
-    }
-  }
-
-  static void AvgFWCompute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) {
-    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
-    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
-    auto* pool_state = dynamic_cast<PoolOpKernelState*>(state);
-    CHECK(pool_state != nullptr);
-    pool_state->Update(x->shape());
-    const std::string& data_format = ctx->Attr<std::string>("data_format");
-    if (data_format == "channels_first") {
-      CFirstForward(pool_state->GetParams3D(), x, y, GetZeroVal<T>,
-                    [](const T& lhs, T& rhs) { rhs += lhs; },
-                    [](const int64_t size, T& out) { out /= size; });
-    } else if (data_format == "channels_last") {
-      CLastForward(pool_state->GetParams3D(), x, y, GetZeroVal<T>,
-                   [](const int64_t in_col, const int64_t out_col, ConstEigenMatrixMap<T>& in_mat,
-                      EigenMatrixMap<T>& out_mat) { out_mat.col(out_col) += in_mat.col(in_col); },
-                   [](const int64_t size, const int64_t col, EigenMatrixMap<T>& out_mat) {
-                     out_mat.col(col) /= size;
-                   });
-    } else {
-      UNIMPLEMENTED();
-    }
-  }
-
-  static void AvgBWCompute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) {
-    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
-    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
-    const user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
-    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
-    auto* pool_state = dynamic_cast<PoolOpKernelState*>(state);
-    CHECK(pool_state != nullptr);
-    pool_state->Update(x->shape());
-    const std::string& data_format = ctx->Attr<std::string>("data_format");
-    if (data_format == "channels_first") {
-      CFirstBackward(pool_state->GetParams3D(), dy, y, x, dx,
-                     [](const T& in, const T& out, const T& out_diff, const int64_t size,
-                        T& in_diff) { in_diff += (out_diff / static_cast<T>(size)); });
-    } else if (data_format == "channels_last") {
-      CLastBackward(pool_state->GetParams3D(), dy, y, x, dx,
-                    [](const int64_t out_col, const int64_t in_col, const int64_t size,
-                       ConstEigenArrayMap<T>& out_arr, ConstEigenArrayMap<T>& in_arr,
-                       ConstEigenArrayMap<T>& out_diff_arr, EigenArrayMap<T>& in_diff_arr) {
-                      in_diff_arr.col(in_col) += out_diff_arr.col(out_col) / static_cast<T>(size);
-                    });
-    } else {
-      UNIMPLEMENTED();
-    }
-  }
-
-  static void MaxFWCompute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) {
-    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
-    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
-    auto* pool_state = dynamic_cast<PoolOpKernelState*>(state);
-    CHECK(pool_state != nullptr);
-    pool_state->Update(x->shape());
-    const std::string& data_format = ctx->Attr<std::string>("data_format");
-    if (data_format == "channels_first") {
-      CFirstForward(pool_state->GetParams3D(), x, y, GetMinVal<T>,
-                    [](const T& lhs, T& rhs) {
-                      if (lhs > rhs) { rhs = lhs; }
-                    },
-                    [](const int64_t size, T& out) {});
-    } else if (data_format == "channels_last") {
-      CLastForward(pool_state->GetParams3D(), x, y, GetMinVal<T>,
-                   [](const int64_t in_col, const int64_t out_col, ConstEigenMatrixMap<T>& in_mat,
-                      EigenMatrixMap<T>& out_mat) {
-                     out_mat.col(out_col) = out_mat.col(out_col).cwiseMax(in_mat.col(in_col));
-                   },
-                   [](const int64_t size, const int64_t col, EigenMatrixMap<T>& out_mat) {});
-    } else {
-      UNIMPLEMENTED();
-    }
-  }
+void PoolForward(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+                 void (*Forward)(const Params3D&, const std::string&, const T*, T*)) {
+  const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+  user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+  auto* pool_state = dynamic_cast<PoolOpKernelState*>(state);
+  CHECK(pool_state != nullptr);
+  pool_state->Update(x->shape());
+  Forward(pool_state->GetParams3D(), ctx->Attr<std::string>("data_format"), x->dptr<T>(),
+          y->mut_dptr<T>());
+}
 
-  static void MaxBWCompute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) {
-    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
-    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
-    const user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
-    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
-    auto* pool_state = dynamic_cast<PoolOpKernelState*>(state);
-    CHECK(pool_state != nullptr);
-    pool_state->Update(x->shape());
-    const std::string& data_format = ctx->Attr<std::string>("data_format");
-    if (data_format == "channels_first") {
-      CFirstBackward(
-          pool_state->GetParams3D(), dy, y, x, dx,
-          [](const T& in, const T& out, const T& out_diff, const int64_t size, T& in_diff) {
-            if (in == out) { in_diff += out_diff; }
-          });
-    } else if (data_format == "channels_last") {
-      CLastBackward(
-          pool_state->GetParams3D(), dy, y, x, dx,
-          [](const int64_t out_col, const int64_t in_col, const int64_t size,
-             ConstEigenArrayMap<T>& out_arr, ConstEigenArrayMap<T>& in_arr,
-             ConstEigenArrayMap<T>& out_diff_arr, EigenArrayMap<T>& in_diff_arr) {
-            in_diff_arr.col(in_col) +=
-                out_diff_arr.col(out_col)
-                * (in_arr.col(in_col).cwiseEqual(out_arr.col(out_col)).template cast<T>());
-          });
-    } else {
-      UNIMPLEMENTED();
-    }
-  }
-};
+template<typename T>
+void PoolBackward(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+                  void (*Backward)(const Params3D&, const std::string&, const T*, const T*,
+                                   const T*, T*)) {
+  const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+  const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+  const user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+  user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+  auto* pool_state = dynamic_cast<PoolOpKernelState*>(state);
+  CHECK(pool_state != nullptr);
+  pool_state->Update(x->shape());
+  Backward(pool_state->GetParams3D(), ctx->Attr<std::string>("data_format"), dy->dptr<T>(),
+           y->dptr<T>(), x->dptr<T>(), dx->mut_dptr<T>());
+}
 
 std::shared_ptr<user_op::OpKernelState> DoCreateOpKernelState(user_op::KernelInitContext* ctx,
                                                               const int32_t& dim) {
@@ -375,7 +92,7 @@ class AvgPool1DCpuKernel final : public user_op::OpKernel {
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
-    PoolCpuKernelUtil<T>::AvgFWCompute(ctx, state);
+    PoolForward<T>(ctx, state, PoolCpuKernelUtil<T>::AvgForward);
   };
 };
 
@@ -393,7 +110,7 @@ class AvgPool1DGradCpuKernel final : public user_op::OpKernel {
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
-    PoolCpuKernelUtil<T>::AvgBWCompute(ctx, state);
+    PoolBackward<T>(ctx, state, PoolCpuKernelUtil<T>::AvgBackward);
   };
 };
 
@@ -411,7 +128,7 @@ class AvgPool2DCpuKernel final : public user_op::OpKernel {
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
-    PoolCpuKernelUtil<T>::AvgFWCompute(ctx, state);
+    PoolForward<T>(ctx, state, PoolCpuKernelUtil<T>::AvgForward);
   };
 };
 
@@ -429,7 +146,7 @@ class AvgPool2DGradCpuKernel final : public user_op::OpKernel {
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
-    PoolCpuKernelUtil<T>::AvgBWCompute(ctx, state);
+    PoolBackward<T>(ctx, state, PoolCpuKernelUtil<T>::AvgBackward);
   };
 };
 
@@ -447,7 +164,7 @@ class AvgPool3DCpuKernel final : public user_op::OpKernel {
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
-    PoolCpuKernelUtil<T>::AvgFWCompute(ctx, state);
+    PoolForward<T>(ctx, state, PoolCpuKernelUtil<T>::AvgForward);
   };
 };
 
@@ -465,7 +182,7 @@ class AvgPool3DGradCpuKernel final : public user_op::OpKernel {
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
-    PoolCpuKernelUtil<T>::AvgBWCompute(ctx, state);
+    PoolBackward<T>(ctx, state, PoolCpuKernelUtil<T>::AvgBackward);
   };
 };
 
@@ -483,7 +200,7 @@ class MaxPool1DCpuKernel final : public user_op::OpKernel {
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
-    PoolCpuKernelUtil<T>::MaxFWCompute(ctx, state);
+    PoolForward<T>(ctx, state, PoolCpuKernelUtil<T>::MaxForward);
   };
 };
 
@@ -501,7 +218,7 @@ class MaxPool1DGradCpuKernel final : public user_op::OpKernel {
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
-    PoolCpuKernelUtil<T>::MaxBWCompute(ctx, state);
+    PoolBackward<T>(ctx, state, PoolCpuKernelUtil<T>::MaxBackward);
   };
 };
 
@@ -519,7 +236,7 @@ class MaxPool2DCpuKernel final : public user_op::OpKernel {
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
-    PoolCpuKernelUtil<T>::MaxFWCompute(ctx, state);
+    PoolForward<T>(ctx, state, PoolCpuKernelUtil<T>::MaxForward);
   };
 };
 
@@ -537,7 +254,7 @@ class MaxPool2DGradCpuKernel final : public user_op::OpKernel {
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
-    PoolCpuKernelUtil<T>::MaxBWCompute(ctx, state);
+    PoolBackward<T>(ctx, state, PoolCpuKernelUtil<T>::MaxBackward);
   };
 };
 
@@ -555,7 +272,7 @@ class MaxPool3DCpuKernel final : public user_op::OpKernel {
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
-    PoolCpuKernelUtil<T>::MaxFWCompute(ctx, state);
+    PoolForward<T>(ctx, state, PoolCpuKernelUtil<T>::MaxForward);
   };
 };
 
@@ -573,7 +290,7 @@ class MaxPool3DGradCpuKernel final : public user_op::OpKernel {
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
-    PoolCpuKernelUtil<T>::MaxBWCompute(ctx, state);
+    PoolBackward<T>(ctx, state, PoolCpuKernelUtil<T>::MaxBackward);
   };
 };
 
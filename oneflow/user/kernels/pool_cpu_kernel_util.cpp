@@ -0,0 +1,319 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/pool_cpu_kernel_util.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
+
+namespace oneflow {
+
+namespace {
+
+// channels_last gradients are split across channel blocks of this size
+const int64_t kChannelBlockSize = 64;
+
+template<typename T>
+struct AvgPoolCore {
+  static T Initial() { return GetZeroVal<T>(); }
+  static void Reduce(const T in, T* acc) { *acc += in; }
+  static T Finalize(const T acc, const int64_t size) { return acc / static_cast<T>(size); }
+  static T Grad(const T in, const T out, const T out_diff, const int64_t size) {
+    return out_diff / static_cast<T>(size);
+  }
+};
+
+template<typename T>
+struct MaxPoolCore {
+  static T Initial() { return GetMinVal<T>(); }
+  static void Reduce(const T in, T* acc) { *acc = in > *acc ? in : *acc; }
+  static T Finalize(const T acc, const int64_t size) { return acc; }
+  static T Grad(const T in, const T out, const T out_diff, const int64_t size) {
+    return in == out ? out_diff : GetZeroVal<T>();
+  }
+};
+
+// [start, end) of the clipped input window of every output position, per spatial axis
+struct PoolWindows {
+  std::vector<int64_t> start[3];
+  std::vector<int64_t> end[3];
+
+  PoolWindows(const Params3D& params_3d, const Shape& in, const Shape& out) {
+    FOR_RANGE(int32_t, i, 0, 3) {
+      FOR_RANGE(int64_t, p, 0, out.At(2 + i)) {
+        const int64_t window_start =
+            p * params_3d.strides_3d().at(i) - params_3d.padding_before_3d().at(i);
+        end[i].push_back(std::min(window_start + params_3d.pool_size_3d().at(i), in.At(2 + i)));
+        start[i].push_back(std::max(window_start, static_cast<int64_t>(0)));
+      }
+    }
+  }
+
+  int64_t Size(int64_t pd, int64_t ph, int64_t pw) const {
+    return (end[0][pd] - start[0][pd]) * (end[1][ph] - start[1][ph])
+           * (end[2][pw] - start[2][pw]);
+  }
+};
+
+void ParallelForPool(int64_t work_num, int64_t elem_cnt_per_work,
+                     const std::function<void(int64_t, int64_t)>& Callback) {
+  const int64_t grain_size = std::max<int64_t>(
+      1, kCpuNdarrayParallelGrainElemCnt / std::max<int64_t>(1, elem_cnt_per_work));
+  CpuNdarrayParallelFor(work_num, grain_size, Callback);
+}
+
+// one (n, c) plane of a 2d pooling whose windows are kh x kw; windows clipped by the border
+// take the generic loop
+template<typename T, typename Core, int32_t kh, int32_t kw>
+void CFirstForwardPlane2D(const PoolWindows& windows, const Shape& in, const Shape& out,
+                          const T* input, T* output) {
+  const int64_t in_w = in.At(4);
+  FOR_RANGE(int64_t, ph, 0, out.At(3)) {
+    const int64_t hstart = windows.start[1][ph];
+    const int64_t hend = windows.end[1][ph];
+    FOR_RANGE(int64_t, pw, 0, out.At(4)) {
+      const int64_t wstart = windows.start[2][pw];
+      const int64_t wend = windows.end[2][pw];
+      T res = Core::Initial();
+      if (hend - hstart == kh && wend - wstart == kw) {
+        const T* window = input + hstart * in_w + wstart;
+        for (int32_t h = 0; h < kh; ++h) {
+          for (int32_t w = 0; w < kw; ++w) { Core::Reduce(window[h * in_w + w], &res); }
+        }
+      } else {
+        FOR_RANGE(int64_t, h, hstart, hend) {
+          FOR_RANGE(int64_t, w, wstart, wend) { Core::Reduce(input[h * in_w + w], &res); }
+        }
+      }
+      output[ph * out.At(4) + pw] = Core::Finalize(res, (hend - hstart) * (wend - wstart));
+    }
+  }
+}
+
+template<typename T, typename Core>
+void CFirstForwardPlane(const PoolWindows& windows, const Shape& in, const Shape& out,
+                        const T* input, T* output) {
+  FOR_RANGE(int64_t, pd, 0, out.At(2)) {
+    FOR_RANGE(int64_t, ph, 0, out.At(3)) {
+      FOR_RANGE(int64_t, pw, 0, out.At(4)) {
+        T res = Core::Initial();
+        FOR_RANGE(int64_t, d, windows.start[0][pd], windows.end[0][pd]) {
+          FOR_RANGE(int64_t, h, windows.start[1][ph], windows.end[1][ph]) {
+            const T* input_row = input + d * in.Count(3) + h * in.At(4);
+            FOR_RANGE(int64_t, w, windows.start[2][pw], windows.end[2][pw]) {
+              Core::Reduce(input_row[w], &res);
+            }
+          }
+        }
+        output[(pd * out.At(3) + ph) * out.At(4) + pw] =
+            Core::Finalize(res, windows.Size(pd, ph, pw));
+      }
+    }
+  }
+}
+
+template<typename T, typename Core>
+void CFirstForward(const Params3D& params_3d, const T* input, T* output) {
+  const Shape in = params_3d.GetXShape5D();
+  const Shape out = params_3d.GetYShape5D();
+  const PoolWindows windows(params_3d, in, out);
+  const std::vector<int32_t>& pool_size = params_3d.pool_size_3d();
+  void (*ForwardPlane)(const PoolWindows&, const Shape&, const Shape&, const T*, T*) =
+      CFirstForwardPlane<T, Core>;
+  if (in.At(2) == 1 && out.At(2) == 1 && pool_size.at(0) == 1) {
+    if (pool_size.at(1) == 2 && pool_size.at(2) == 2) {
+      ForwardPlane = CFirstForwardPlane2D<T, Core, 2, 2>;
+    } else if (pool_size.at(1) == 3 && pool_size.at(2) == 3) {
+      ForwardPlane = CFirstForwardPlane2D<T, Core, 3, 3>;
+    }
+  }
+  ParallelForPool(in.At(0) * in.At(1), in.Count(2), [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, plane, begin, end) {
+      ForwardPlane(windows, in, out, input + plane * in.Count(2), output + plane * out.Count(2));
+    }
+  });
+}
+
+template<typename T, typename Core>
+void CFirstBackward(const Params3D& params_3d, const T* output_diff, const T* output,
+                    const T* input, T* input_diff) {
+  const Shape in = params_3d.GetXShape5D();
+  const Shape out = params_3d.GetYShape5D();
+  const PoolWindows windows(params_3d, in, out);
+  // planes are independent, overlapping windows only accumulate within a plane
+  ParallelForPool(in.At(0) * in.At(1), in.Count(2), [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, plane, begin, end) {
+      const T* plane_output_diff = output_diff + plane * out.Count(2);
+      const T* plane_output = output + plane * out.Count(2);
+      const T* plane_input = input + plane * in.Count(2);
+      T* plane_input_diff = input_diff + plane * in.Count(2);
+      std::fill(plane_input_diff, plane_input_diff + in.Count(2), GetZeroVal<T>());
+      FOR_RANGE(int64_t, pd, 0, out.At(2)) {
+        FOR_RANGE(int64_t, ph, 0, out.At(3)) {
+          FOR_RANGE(int64_t, pw, 0, out.At(4)) {
+            const int64_t pool_index = (pd * out.At(3) + ph) * out.At(4) + pw;
+            const int64_t size = windows.Size(pd, ph, pw);
+            FOR_RANGE(int64_t, d, windows.start[0][pd], windows.end[0][pd]) {
+              FOR_RANGE(int64_t, h, windows.start[1][ph], windows.end[1][ph]) {
+                FOR_RANGE(int64_t, w, windows.start[2][pw], windows.end[2][pw]) {
+                  const int64_t index = d * in.Count(3) + h * in.At(4) + w;
+                  plane_input_diff[index] +=
+                      Core::Grad(plane_input[index], plane_output[pool_index],
+                                 plane_output_diff[pool_index], size);
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  });
+}
+
+// the data is n, d, h, w, c; every window reduces whole channel vectors, which vectorizes
+template<typename T, typename Core>
+void CLastForward(const Params3D& params_3d, const T* input, T* output) {
+  const Shape in = params_3d.GetXShape5D();
+  const Shape out = params_3d.GetYShape5D();
+  const PoolWindows windows(params_3d, in, out);
+  const int64_t channel_num = in.At(1);
+  // a work is an output row (n, pd, ph)
+  const int64_t row_num = out.At(0) * out.At(2) * out.At(3);
+  ParallelForPool(row_num, out.At(4) * channel_num, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, row, begin, end) {
+      const int64_t ph = row % out.At(3);
+      const int64_t pd = (row / out.At(3)) % out.At(2);
+      const int64_t n = row / (out.At(3) * out.At(2));
+      FOR_RANGE(int64_t, pw, 0, out.At(4)) {
+        T* out_vec = output + (row * out.At(4) + pw) * channel_num;
+        FOR_RANGE(int64_t, c, 0, channel_num) { out_vec[c] = Core::Initial(); }
+        FOR_RANGE(int64_t, d, windows.start[0][pd], windows.end[0][pd]) {
+          FOR_RANGE(int64_t, h, windows.start[1][ph], windows.end[1][ph]) {
+            FOR_RANGE(int64_t, w, windows.start[2][pw], windows.end[2][pw]) {
+              const T* in_vec =
+                  input + (((n * in.At(2) + d) * in.At(3) + h) * in.At(4) + w) * channel_num;
+              FOR_RANGE(int64_t, c, 0, channel_num) { Core::Reduce(in_vec[c], out_vec + c); }
+            }
+          }
+        }
+        const int64_t size = windows.Size(pd, ph, pw);
+        FOR_RANGE(int64_t, c, 0, channel_num) { out_vec[c] = Core::Finalize(out_vec[c], size); }
+      }
+    }
+  });
+}
+
+template<typename T, typename Core>
+void CLastBackward(const Params3D& params_3d, const T* output_diff, const T* output,
+                   const T* input, T* input_diff) {
+  const Shape in = params_3d.GetXShape5D();
+  const Shape out = params_3d.GetYShape5D();
+  const PoolWindows windows(params_3d, in, out);
+  const int64_t channel_num = in.At(1);
+  const int64_t spatial_in = in.Count(2);
+  const int64_t spatial_out = out.Count(2);
+  // a work is a block of channels of one sample, overlapping windows never cross works
+  const int64_t block_num = (channel_num + kChannelBlockSize - 1) / kChannelBlockSize;
+  ParallelForPool(in.At(0) * block_num, spatial_in * kChannelBlockSize, [&](int64_t begin,
+                                                                            int64_t end) {
+    FOR_RANGE(int64_t, work, begin, end) {
+      const int64_t n = work / block_num;
+      const int64_t c_begin = (work % block_num) * kChannelBlockSize;
+      const int64_t c_end = std::min(c_begin + kChannelBlockSize, channel_num);
+      FOR_RANGE(int64_t, i, 0, spatial_in) {
+        T* in_diff_vec = input_diff + (n * spatial_in + i) * channel_num;
+        FOR_RANGE(int64_t, c, c_begin, c_end) { in_diff_vec[c] = GetZeroVal<T>(); }
+      }
+      FOR_RANGE(int64_t, pd, 0, out.At(2)) {
+        FOR_RANGE(int64_t, ph, 0, out.At(3)) {
+          FOR_RANGE(int64_t, pw, 0, out.At(4)) {
+            const int64_t pool_offset =
+                (n * spatial_out + (pd * out.At(3) + ph) * out.At(4) + pw) * channel_num;
+            const T* out_vec = output + pool_offset;
+            const T* out_diff_vec = output_diff + pool_offset;
+            const int64_t size = windows.Size(pd, ph, pw);
+            FOR_RANGE(int64_t, d, windows.start[0][pd], windows.end[0][pd]) {
+              FOR_RANGE(int64_t, h, windows.start[1][ph], windows.end[1][ph]) {
+                FOR_RANGE(int64_t, w, windows.start[2][pw], windows.end[2][pw]) {
+                  const int64_t in_offset =
+                      (n * spatial_in + (d * in.At(3) + h) * in.At(4) + w) * channel_num;
+                  const T* in_vec = input + in_offset;
+                  T* in_diff_vec = input_diff + in_offset;
+                  FOR_RANGE(int64_t, c, c_begin, c_end) {
+                    in_diff_vec[c] += Core::Grad(in_vec[c], out_vec[c], out_diff_vec[c], size);
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  });
+}
+
+template<typename T, typename Core>
+void Forward(const Params3D& params_3d, const std::string& data_format, const T* x, T* y) {
+  if (data_format == "channels_first") {
+    CFirstForward<T, Core>(params_3d, x, y);
+  } else if (data_format == "channels_last") {
+    CLastForward<T, Core>(params_3d, x, y);
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+template<typename T, typename Core>
+void Backward(const Params3D& params_3d, const std::string& data_format, const T* dy, const T* y,
+              const T* x, T* dx) {
+  if (data_format == "channels_first") {
+    CFirstBackward<T, Core>(params_3d, dy, y, x, dx);
+  } else if (data_format == "channels_last") {
+    CLastBackward<T, Core>(params_3d, dy, y, x, dx);
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+}  // namespace
+
+template<typename T>
+void PoolCpuKernelUtil<T>::AvgForward(const Params3D& params_3d, const std::string& data_format,
+                                      const T* x, T* y) {
+  Forward<T, AvgPoolCore<T>>(params_3d, data_format, x, y);
+}
+
+template<typename T>
+void PoolCpuKernelUtil<T>::AvgBackward(const Params3D& params_3d, const std::string& data_format,
+                                       const T* dy, const T* y, const T* x, T* dx) {
+  Backward<T, AvgPoolCore<T>>(params_3d, data_format, dy, y, x, dx);
+}
+
+template<typename T>
+void PoolCpuKernelUtil<T>::MaxForward(const Params3D& params_3d, const std::string& data_format,
+                                      const T* x, T* y) {
+  Forward<T, MaxPoolCore<T>>(params_3d, data_format, x, y);
+}
+
+template<typename T>
+void PoolCpuKernelUtil<T>::MaxBackward(const Params3D& params_3d, const std::string& data_format,
+                                       const T* dy, const T* y, const T* x, T* dx) {
+  Backward<T, MaxPoolCore<T>>(params_3d, data_format, dy, y, x, dx);
+}
+
+#define INSTANTIATE_POOL_CPU_KERNEL_UTIL(type_cpp, type_proto) \
+  template struct PoolCpuKernelUtil<type_cpp>;
+OF_PP_FOR_EACH_TUPLE(INSTANTIATE_POOL_CPU_KERNEL_UTIL, FLOATING_DATA_TYPE_SEQ);
+#undef INSTANTIATE_POOL_CPU_KERNEL_UTIL
+
+}  // namespace oneflow
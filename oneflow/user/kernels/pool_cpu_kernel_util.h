@@ -0,0 +1,40 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_POOL_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_POOL_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/user/utils/pool_util.h"
+
+namespace oneflow {
+
+// x and y are laid out as data_format says, "channels_first" or "channels_last". Work is split
+// across Global<ThreadPool>, or runs inline when there is none.
+template<typename T>
+struct PoolCpuKernelUtil {
+  static void AvgForward(const Params3D& params_3d, const std::string& data_format, const T* x,
+                         T* y);
+  static void AvgBackward(const Params3D& params_3d, const std::string& data_format, const T* dy,
+                          const T* y, const T* x, T* dx);
+  static void MaxForward(const Params3D& params_3d, const std::string& data_format, const T* x,
+                         T* y);
+  // the gradient goes to every input of the window which equals the output
+  static void MaxBackward(const Params3D& params_3d, const std::string& data_format, const T* dy,
+                          const T* y, const T* x, T* dx);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_POOL_CPU_KERNEL_UTIL_H_
@@ -0,0 +1,134 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/pool_cpu_kernel_util.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+// the channels_first forward the pooling kernels ran before, with a std::function call per input
+template<typename T>
+void CallbackPoolForward(const Params3D& params_3d, const T* input, T* output,
+                         const std::function<T()>& initialize,
+                         const std::function<void(const T& lhs, T& rhs)>& process,
+                         const std::function<void(const int64_t size, T& out)>& finalize) {
+  const Shape& in = params_3d.GetXShape5D();
+  const Shape& out = params_3d.GetYShape5D();
+  const std::vector<int32_t>& pool_size = params_3d.pool_size_3d();
+  const std::vector<int32_t>& strides = params_3d.strides_3d();
+  const std::vector<int32_t>& padding_before = params_3d.padding_before_3d();
+  FOR_RANGE(int64_t, n, 0, in.At(0)) {
+    FOR_RANGE(int64_t, c, 0, in.At(1)) {
+      FOR_RANGE(int64_t, pd, 0, out.At(2)) {
+        int64_t dstart = pd * strides.at(0) - padding_before.at(0);
+        int64_t dend = std::min(dstart + pool_size.at(0), in.At(2));
+        dstart = std::max(dstart, static_cast<int64_t>(0));
+        FOR_RANGE(int64_t, ph, 0, out.At(3)) {
+          int64_t hstart = ph * strides.at(1) - padding_before.at(1);
+          int64_t hend = std::min(hstart + pool_size.at(1), in.At(3));
+          hstart = std::max(hstart, static_cast<int64_t>(0));
+          FOR_RANGE(int64_t, pw, 0, out.At(4)) {
+            int64_t wstart = pw * strides.at(2) - padding_before.at(2);
+            int64_t wend = std::min(wstart + pool_size.at(2), in.At(4));
+            wstart = std::max(wstart, static_cast<int64_t>(0));
+            T res = initialize();
+            FOR_RANGE(int64_t, d, dstart, dend) {
+              FOR_RANGE(int64_t, h, hstart, hend) {
+                FOR_RANGE(int64_t, w, wstart, wend) {
+                  process(input[d * in.Count(3) + h * in.At(4) + w], res);
+                }
+              }
+            }
+            finalize((dend - dstart) * (hend - hstart) * (wend - wstart), res);
+            output[pd * out.Count(3) + ph * out.At(4) + pw] = res;
+          }
+        }
+      }
+      input += in.Count(2);
+      output += out.Count(2);
+    }
+  }
+}
+
+enum PoolImpl { kCallback, kSpecialized };
+
+void BenchmarkPool(BenchmarkState* state, PoolImpl impl, bool is_max, const DimVector& x_dims,
+                   const std::string& data_format, int32_t window, int32_t stride,
+                   int32_t padding) {
+  const Shape x_shape(x_dims);
+  const Params3D params_3d(2, x_shape, data_format, "customized", {padding, padding},
+                           {padding, padding}, {window, window}, {stride, stride}, false);
+  std::vector<float> x(x_shape.elem_cnt());
+  FOR_RANGE(size_t, i, 0, x.size()) { x[i] = static_cast<float>(i % 251); }
+  std::vector<float> y(params_3d.GetYShape().elem_cnt());
+  Global<ThreadPool>::New(4);
+  while (state->KeepRunning()) {
+    if (impl == kCallback && is_max) {
+      CallbackPoolForward<float>(
+          params_3d, x.data(), y.data(), []() { return GetMinVal<float>(); },
+          [](const float& lhs, float& rhs) { rhs = std::max(lhs, rhs); },
+          [](const int64_t size, float& out) {});
+    } else if (impl == kCallback) {
+      CallbackPoolForward<float>(
+          params_3d, x.data(), y.data(), []() { return 0.0f; },
+          [](const float& lhs, float& rhs) { rhs += lhs; },
+          [](const int64_t size, float& out) { out /= size; });
+    } else if (is_max) {
+      PoolCpuKernelUtil<float>::MaxForward(params_3d, data_format, x.data(), y.data());
+    } else {
+      PoolCpuKernelUtil<float>::AvgForward(params_3d, data_format, x.data(), y.data());
+    }
+    DoNotOptimize(y.data());
+  }
+  Global<ThreadPool>::Delete();
+  state->SetBytesProcessed(state->iterations() * x.size() * sizeof(float));
+}
+
+// the ResNet stem, 3x3 stride 2 max pooling of 8x64x112x112 with padding 1
+void StemMaxPool(BenchmarkState* state, PoolImpl impl, const std::string& data_format) {
+  const DimVector x_dims = data_format == "channels_first" ? DimVector{8, 64, 112, 112}
+                                                           : DimVector{8, 112, 112, 64};
+  BenchmarkPool(state, impl, true, x_dims, data_format, 3, 2, 1);
+}
+
+// the ResNet-50 head, 7x7 average pooling of 32x2048x7x7 down to one value per channel
+void HeadAvgPool(BenchmarkState* state, PoolImpl impl, const std::string& data_format) {
+  const DimVector x_dims =
+      data_format == "channels_first" ? DimVector{32, 2048, 7, 7} : DimVector{32, 7, 7, 2048};
+  BenchmarkPool(state, impl, false, x_dims, data_format, 7, 1, 0);
+}
+
+}  // namespace
+
+OF_BENCHMARK(PoolCallback_StemMax) { StemMaxPool(state, kCallback, "channels_first"); }
+
+OF_BENCHMARK(PoolSpecialized_StemMax) { StemMaxPool(state, kSpecialized, "channels_first"); }
+
+OF_BENCHMARK(PoolSpecialized_StemMaxChannelsLast) {
+  StemMaxPool(state, kSpecialized, "channels_last");
+}
+
+OF_BENCHMARK(PoolCallback_HeadAvg) { HeadAvgPool(state, kCallback, "channels_first"); }
+
+OF_BENCHMARK(PoolSpecialized_HeadAvg) { HeadAvgPool(state, kSpecialized, "channels_first"); }
+
+OF_BENCHMARK(PoolSpecialized_HeadAvgChannelsLast) {
+  HeadAvgPool(state, kSpecialized, "channels_last");
+}
+
+}  // namespace oneflow
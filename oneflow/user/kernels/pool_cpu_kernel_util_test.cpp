@@ -0,0 +1,166 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/pool_cpu_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+// offset of (n, c, d, h, w) in a 5d shape of n, c, d, h, w, stored in the given data format
+int64_t Offset5D(const Shape& shape, bool channels_last, int64_t n, int64_t c, int64_t d,
+                 int64_t h, int64_t w) {
+  if (channels_last) {
+    return (((n * shape.At(2) + d) * shape.At(3) + h) * shape.At(4) + w) * shape.At(1) + c;
+  }
+  return (((n * shape.At(1) + c) * shape.At(2) + d) * shape.At(3) + h) * shape.At(4) + w;
+}
+
+// naive pooling over the clipped windows, in both directions
+void NaivePool(const Params3D& params_3d, bool channels_last, bool is_max,
+               const std::vector<double>& x, const std::vector<double>& dy,
+               std::vector<double>* y, std::vector<double>* dx) {
+  const Shape in = params_3d.GetXShape5D();
+  const Shape out = params_3d.GetYShape5D();
+  y->assign(out.elem_cnt(), 0);
+  dx->assign(in.elem_cnt(), 0);
+  FOR_RANGE(int64_t, n, 0, out.At(0)) {
+    FOR_RANGE(int64_t, c, 0, out.At(1)) {
+      FOR_RANGE(int64_t, pd, 0, out.At(2)) {
+        FOR_RANGE(int64_t, ph, 0, out.At(3)) {
+          FOR_RANGE(int64_t, pw, 0, out.At(4)) {
+            const int64_t p[3] = {pd, ph, pw};
+            int64_t start[3];
+            int64_t end[3];
+            FOR_RANGE(int32_t, i, 0, 3) {
+              const int64_t window_start =
+                  p[i] * params_3d.strides_3d().at(i) - params_3d.padding_before_3d().at(i);
+              start[i] = std::max<int64_t>(window_start, 0);
+              end[i] = std::min<int64_t>(window_start + params_3d.pool_size_3d().at(i),
+                                         in.At(2 + i));
+            }
+            std::vector<int64_t> offsets;
+            FOR_RANGE(int64_t, d, start[0], end[0]) {
+              FOR_RANGE(int64_t, h, start[1], end[1]) {
+                FOR_RANGE(int64_t, w, start[2], end[2]) {
+                  offsets.push_back(Offset5D(in, channels_last, n, c, d, h, w));
+                }
+              }
+            }
+            const int64_t out_offset = Offset5D(out, channels_last, n, c, pd, ph, pw);
+            double res = is_max ? GetMinVal<double>() : 0;
+            for (int64_t offset : offsets) {
+              res = is_max ? std::max(res, x.at(offset)) : res + x.at(offset);
+            }
+            if (!is_max) { res /= offsets.size(); }
+            y->at(out_offset) = res;
+            for (int64_t offset : offsets) {
+              if (!is_max) {
+                dx->at(offset) += dy.at(out_offset) / offsets.size();
+              } else if (x.at(offset) == res) {
+                dx->at(offset) += dy.at(out_offset);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template<typename T>
+void TestRandomPools(const std::string& data_format) {
+  const bool channels_last = data_format == "channels_last";
+  std::mt19937 gen(channels_last ? 1 : 0);
+  auto RandInt = [&](int32_t low, int32_t high) {
+    return std::uniform_int_distribution<int32_t>(low, high)(gen);
+  };
+  const std::vector<std::string> paddings{"valid", "same_upper", "customized"};
+  FOR_RANGE(int32_t, dim, 1, 4) {
+    FOR_RANGE(int32_t, trial, 0, 30) {
+      std::vector<int32_t> pool_size;
+      std::vector<int32_t> strides;
+      std::vector<int32_t> padding_before;
+      std::vector<int32_t> padding_after;
+      DimVector spatial;
+      FOR_RANGE(int32_t, i, 0, dim) {
+        // 2x2 and 3x3 windows take the unrolled channels_first path
+        pool_size.push_back(trial % 3 == 0 ? 2 : RandInt(1, 4));
+        if (trial % 3 == 1) { pool_size.back() = 3; }
+        strides.push_back(RandInt(1, 3));
+        padding_before.push_back(RandInt(0, pool_size.back() - 1));
+        padding_after.push_back(RandInt(0, pool_size.back() - 1));
+        spatial.push_back(RandInt(pool_size.back(), dim == 3 ? 7 : 13));
+      }
+      DimVector x_dims{RandInt(1, 3)};
+      const int64_t channel_num = RandInt(1, 70);
+      if (!channels_last) { x_dims.push_back(channel_num); }
+      x_dims.insert(x_dims.end(), spatial.begin(), spatial.end());
+      if (channels_last) { x_dims.push_back(channel_num); }
+      const Shape x_shape(x_dims);
+      const Params3D params_3d(dim, x_shape, data_format, paddings.at(trial % paddings.size()),
+                               padding_before, padding_after, pool_size, strides, false);
+      const int64_t x_cnt = x_shape.elem_cnt();
+      const int64_t y_cnt = params_3d.GetYShape().elem_cnt();
+      // few distinct values, so that max windows often hold ties
+      std::vector<double> x(x_cnt);
+      for (double& value : x) { value = RandInt(-8, 8); }
+      std::vector<double> dy(y_cnt);
+      for (double& value : dy) { value = RandInt(-100, 100) / 8.0; }
+      const std::vector<T> x_t(x.begin(), x.end());
+      const std::vector<T> dy_t(dy.begin(), dy.end());
+      for (bool is_max : {false, true}) {
+        std::vector<double> y;
+        std::vector<double> dx;
+        NaivePool(params_3d, channels_last, is_max, x, dy, &y, &dx);
+        std::vector<T> y_t(y_cnt);
+        std::vector<T> dx_t(x_cnt);
+        if (is_max) {
+          PoolCpuKernelUtil<T>::MaxForward(params_3d, data_format, x_t.data(), y_t.data());
+          PoolCpuKernelUtil<T>::MaxBackward(params_3d, data_format, dy_t.data(), y_t.data(),
+                                            x_t.data(), dx_t.data());
+        } else {
+          PoolCpuKernelUtil<T>::AvgForward(params_3d, data_format, x_t.data(), y_t.data());
+          PoolCpuKernelUtil<T>::AvgBackward(params_3d, data_format, dy_t.data(), y_t.data(),
+                                            x_t.data(), dx_t.data());
+        }
+        FOR_RANGE(int64_t, i, 0, y_cnt) { ASSERT_NEAR(y_t.at(i), y.at(i), 1e-4); }
+        FOR_RANGE(int64_t, i, 0, x_cnt) { ASSERT_NEAR(dx_t.at(i), dx.at(i), 1e-3); }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(PoolCpuKernelUtil, channels_first) {
+  Global<ThreadPool>::New(4);
+  TestRandomPools<float>("channels_first");
+  TestRandomPools<double>("channels_first");
+  Global<ThreadPool>::Delete();
+}
+
+TEST(PoolCpuKernelUtil, channels_last) {
+  Global<ThreadPool>::New(4);
+  TestRandomPools<float>("channels_last");
+  TestRandomPools<double>("channels_last");
+  Global<ThreadPool>::Delete();
+}
+
+// outside of a session there is no thread pool and the work runs inline
+TEST(PoolCpuKernelUtil, without_thread_pool) { TestRandomPools<float>("channels_first"); }
+
+}  // namespace oneflow
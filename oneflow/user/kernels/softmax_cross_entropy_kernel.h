@@ -46,7 +46,8 @@ class SoftmaxCrossEntropyKernel final : public user_op::OpKernel {
     const int64_t num_classes = label->shape().At(num_axes - 1);
     SoftmaxKernelUtil<device_type, T>::ComputeProb(
         ctx->device_ctx(), num_instances, num_classes, prediction->dptr<T>(), prob->mut_dptr<T>(),
-        tmp_buffer->mut_dptr(), tmp_buffer->shape().elem_cnt());
+        tmp_buffer ? tmp_buffer->mut_dptr() : nullptr,
+        tmp_buffer ? tmp_buffer->shape().elem_cnt() : 0);
     CrossEntropyKernelUtil<device_type, T>::ComputeEntropy(ctx->device_ctx(), num_instances,
                                                            num_classes, prob->dptr<T>(),
                                                            label->dptr<T>(), out->mut_dptr<T>());
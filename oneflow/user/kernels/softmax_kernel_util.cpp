@@ -16,6 +16,10 @@ limitations under the License.
 #include "oneflow/user/kernels/softmax_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.cuh"
 #include "oneflow/core/ndarray/ndarray_util.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace oneflow {
 
@@ -36,18 +40,233 @@ size_t GetReduceTempStorageSize(int64_t n, int64_t w) {
   return GetCudaAlignedSize(n * w * sizeof(T));
 }
 
+// five ndarray passes: max, sub, exp, sum, div
+template<DeviceType device_type, typename T>
+struct SoftmaxImpl {
+  static size_t GetComputeProbTempStorageSizeInBytes(int64_t n, int64_t w) {
+    return GetProbTmpSize<T>(n, w) + GetReduceTempStorageSize<T>(n, w);
+  }
+
+  static size_t GetComputeDiffTempStorageSizeInBytes(int64_t n, int64_t w) {
+    return GetDiffTmpSize<T>(n, w) + GetReduceTempStorageSize<T>(n, w);
+  }
+
+  static void ComputeProb(DeviceCtx* ctx, const int64_t n, const int64_t w, const T* in, T* prob,
+                          void* temp_storage, const size_t temp_storage_bytes) {
+    auto Val = NdarrayUtil<device_type, T>::GetValNdarrayBuilder();
+    auto Var = NdarrayUtil<device_type, T>::GetVarNdarrayBuilder();
+    const size_t min_temp_storage_bytes = GetComputeProbTempStorageSizeInBytes(n, w);
+    CHECK_GE(temp_storage_bytes, min_temp_storage_bytes);
+    const size_t reduce_temp_storage_bytes = GetReduceTempStorageSize<T>(n, w);
+    T* reduce_storage = reinterpret_cast<T*>(temp_storage);
+    auto reduce_storage_var =
+        Var({static_cast<int64_t>(reduce_temp_storage_bytes / sizeof(T))}, reduce_storage);
+    T* tmp = reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(temp_storage)
+                                  + reduce_temp_storage_bytes);
+    // max | tmp[i] = Max_j(in[i][j])
+    NdarrayUtil<device_type, T>::ReduceMax(ctx, Var({n, 1}, tmp), Val({n, w}, in),
+                                           reduce_storage_var);
+    // sub | prob[i][j] = in[i][j] - tmp[i]
+    NdarrayUtil<device_type, T>::BroadcastSub(ctx, Var({n, w}, prob), Val({n, w}, in),
+                                              Val({n, 1}, tmp));
+    // exp | prob[i][j] = exp(prob[i][j])
+    NdarrayUtil<device_type, T>::InplaceExp(ctx, Var({n, w}, prob));
+    // sum | tmp[i] = Sum_j(prob[i][j])
+    NdarrayUtil<device_type, T>::ReduceSum(ctx, Var({n, 1}, tmp), Val({n, w}, prob),
+                                           reduce_storage_var);
+    // div | prob[i][j] /= tmp[i]
+    NdarrayUtil<device_type, T>::InplaceBroadcastDiv(ctx, Var({n, w}, prob), Val({n, 1}, tmp));
+  }
+
+  static void ComputeDiff(DeviceCtx* ctx, const int64_t n, const int64_t w, const T* dy,
+                          const T* out, T* dx, void* temp_storage,
+                          const size_t temp_storage_bytes) {
+    auto Val = NdarrayUtil<device_type, T>::GetValNdarrayBuilder();
+    auto Var = NdarrayUtil<device_type, T>::GetVarNdarrayBuilder();
+    const size_t min_temp_storage_bytes = GetComputeProbTempStorageSizeInBytes(n, w);
+    CHECK_GE(temp_storage_bytes, min_temp_storage_bytes);
+    const size_t reduce_temp_storage_bytes = GetReduceTempStorageSize<T>(n, w);
+    T* reduce_storage = reinterpret_cast<T*>(temp_storage);
+    auto reduce_storage_var =
+        Var({static_cast<int64_t>(reduce_temp_storage_bytes / sizeof(T))}, reduce_storage);
+    T* sum_vec = reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(temp_storage)
+                                      + reduce_temp_storage_bytes);
+    // it's safe to use dx as tmp
+    // dot product | get dot product sum_vec[i] from out[i] * dy[i]
+    T* tmp = dx;
+    NdarrayUtil<device_type, T>::Mul(ctx, Var({n * w}, tmp), Val({n * w}, out),
+                                     Val({n * w}, dy));
+    NdarrayUtil<device_type, T>::ReduceSum(ctx, Var({n, 1}, sum_vec), Val({n, w}, tmp),
+                                           reduce_storage_var);
+    // sub | dx[i][j] = dy[i][j] - sum_vec[i]
+    NdarrayUtil<device_type, T>::BroadcastSub(ctx, Var({n, w}, dx), Val({n, w}, dy),
+                                              Val({n, 1}, sum_vec));
+    // elementwise multiplication | dx[i][j] *= out[i][j]
+    NdarrayUtil<device_type, T>::InplaceMul(ctx, Var({n * w}, dx), Val({n * w}, out));
+  }
+};
+
+const int64_t kSoftmaxLaneNum = 8;
+// a row is exponentiated block by block against its running max, remembering the max each
+// block was shifted by, so that the final pass only rescales and needs no n x w scratch
+const int64_t kSoftmaxBlockSize = 256;
+
+#if defined(__SSE2__)
+// Cephes style expf on four lanes, NaN is propagated and inputs are clamped to the range where
+// the result neither overflows nor becomes denormal
+inline __m128 Exp4(__m128 x) {
+  x = _mm_min_ps(_mm_set1_ps(88.3762626647949f), x);
+  x = _mm_max_ps(_mm_set1_ps(-88.3762626647949f), x);
+  const __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+  __m128 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+  n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, fx), _mm_set1_ps(1.0f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(0.693359375f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(-2.12194440e-4f)));
+  __m128 y = _mm_set1_ps(1.9875691500E-4f);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507E-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073E-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894E-2f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459E-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201E-1f));
+  y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), x), _mm_set1_ps(1.0f));
+  const __m128i pow2n =
+      _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(0x7f)), 23);
+  return _mm_mul_ps(y, _mm_castsi128_ps(pow2n));
+}
+#endif
+
+template<typename T>
+T RowMax(const T* x, int64_t n) {
+  T lanes[kSoftmaxLaneNum];
+  std::fill(lanes, lanes + kSoftmaxLaneNum, -std::numeric_limits<T>::infinity());
+  const int64_t vec_n = n / kSoftmaxLaneNum * kSoftmaxLaneNum;
+  for (int64_t i = 0; i < vec_n; i += kSoftmaxLaneNum) {
+    FOR_RANGE(int64_t, k, 0, kSoftmaxLaneNum) { lanes[k] = std::max(lanes[k], x[i + k]); }
+  }
+  FOR_RANGE(int64_t, i, vec_n, n) { lanes[0] = std::max(lanes[0], x[i]); }
+  return *std::max_element(lanes, lanes + kSoftmaxLaneNum);
+}
+
+template<typename T>
+T Dot(const T* x, const T* y, int64_t n) {
+  T lanes[kSoftmaxLaneNum] = {0};
+  const int64_t vec_n = n / kSoftmaxLaneNum * kSoftmaxLaneNum;
+  for (int64_t i = 0; i < vec_n; i += kSoftmaxLaneNum) {
+    FOR_RANGE(int64_t, k, 0, kSoftmaxLaneNum) { lanes[k] += x[i + k] * y[i + k]; }
+  }
+  FOR_RANGE(int64_t, i, vec_n, n) { lanes[0] += x[i] * y[i]; }
+  return std::accumulate(lanes, lanes + kSoftmaxLaneNum, static_cast<T>(0));
+}
+
+// y[i] = exp(x[i] - shift), returns the sum of y
+template<typename T>
+T ExpShiftedAndSum(const T* x, T shift, T* y, int64_t n) {
+  T sum = 0;
+  FOR_RANGE(int64_t, i, 0, n) {
+    y[i] = std::exp(x[i] - shift);
+    sum += y[i];
+  }
+  return sum;
+}
+
+#if defined(__SSE2__)
+inline float ExpShiftedAndSum(const float* x, float shift, float* y, int64_t n) {
+  const __m128 shift4 = _mm_set1_ps(shift);
+  __m128 sum4 = _mm_setzero_ps();
+  const int64_t vec_n = n / 4 * 4;
+  for (int64_t i = 0; i < vec_n; i += 4) {
+    const __m128 y4 = Exp4(_mm_sub_ps(_mm_loadu_ps(x + i), shift4));
+    _mm_storeu_ps(y + i, y4);
+    sum4 = _mm_add_ps(sum4, y4);
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, sum4);
+  float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  FOR_RANGE(int64_t, i, vec_n, n) {
+    y[i] = std::exp(x[i] - shift);
+    sum += y[i];
+  }
+  return sum;
+}
+#endif
+
+template<typename T>
+void SoftmaxRow(const T* x, int64_t w, T* y, std::vector<T>* block_shift) {
+  const int64_t block_num = (w + kSoftmaxBlockSize - 1) / kSoftmaxBlockSize;
+  block_shift->resize(block_num);
+  T max = -std::numeric_limits<T>::infinity();
+  T sum = 0;
+  FOR_RANGE(int64_t, b, 0, block_num) {
+    const int64_t offset = b * kSoftmaxBlockSize;
+    const int64_t size = std::min(kSoftmaxBlockSize, w - offset);
+    const T block_max = RowMax(x + offset, size);
+    if (block_max > max) {
+      sum *= std::exp(max - block_max);
+      max = block_max;
+    }
+    if (max == -std::numeric_limits<T>::infinity()) {
+      // masked so far, shifting by -inf would give NaN, the block is rescaled by exp(-inf) = 0
+      // once a finite max shows up
+      std::fill(y + offset, y + offset + size, static_cast<T>(0));
+    } else {
+      sum += ExpShiftedAndSum(x + offset, max, y + offset, size);
+    }
+    block_shift->at(b) = max;
+  }
+  const T inv_sum = static_cast<T>(1) / sum;
+  FOR_RANGE(int64_t, b, 0, block_num) {
+    const int64_t offset = b * kSoftmaxBlockSize;
+    const int64_t size = std::min(kSoftmaxBlockSize, w - offset);
+    const T shift = block_shift->at(b);
+    const T scale = shift == max ? inv_sum : std::exp(shift - max) * inv_sum;
+    T* block_y = y + offset;
+    FOR_RANGE(int64_t, i, 0, size) { block_y[i] *= scale; }
+  }
+}
+
+// online max and sum over each row, two passes over the row and no temp storage
+template<typename T>
+struct SoftmaxImpl<DeviceType::kCPU, T> {
+  static size_t GetComputeProbTempStorageSizeInBytes(int64_t n, int64_t w) { return 0; }
+  static size_t GetComputeDiffTempStorageSizeInBytes(int64_t n, int64_t w) { return 0; }
+
+  static void ComputeProb(DeviceCtx* ctx, const int64_t n, const int64_t w, const T* in, T* prob,
+                          void* temp_storage, const size_t temp_storage_bytes) {
+    const int64_t grain_size = std::max<int64_t>(1, kCpuNdarrayParallelGrainElemCnt / w);
+    CpuNdarrayParallelFor(n, grain_size, [&](int64_t begin, int64_t end) {
+      std::vector<T> block_shift;
+      FOR_RANGE(int64_t, i, begin, end) { SoftmaxRow(in + i * w, w, prob + i * w, &block_shift); }
+    });
+  }
+
+  static void ComputeDiff(DeviceCtx* ctx, const int64_t n, const int64_t w, const T* dy,
+                          const T* out, T* dx, void* temp_storage,
+                          const size_t temp_storage_bytes) {
+    const int64_t grain_size = std::max<int64_t>(1, kCpuNdarrayParallelGrainElemCnt / w);
+    CpuNdarrayParallelFor(n, grain_size, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        const T* row_dy = dy + i * w;
+        const T* row_out = out + i * w;
+        T* row_dx = dx + i * w;
+        const T dot = Dot(row_out, row_dy, w);
+        FOR_RANGE(int64_t, j, 0, w) { row_dx[j] = row_out[j] * (row_dy[j] - dot); }
+      }
+    });
+  }
+};
+
 }  // namespace
 
 template<DeviceType device_type, typename T>
 size_t SoftmaxKernelUtil<device_type, T>::GetComputeProbTempStorageSizeInBytes(int64_t n,
                                                                                int64_t w) {
-  return GetProbTmpSize<T>(n, w) + GetReduceTempStorageSize<T>(n, w);
+  return SoftmaxImpl<device_type, T>::GetComputeProbTempStorageSizeInBytes(n, w);
 }
 
 template<DeviceType device_type, typename T>
 size_t SoftmaxKernelUtil<device_type, T>::GetComputeDiffTempStorageSizeInBytes(int64_t n,
                                                                                int64_t w) {
-  return GetDiffTmpSize<T>(n, w) + GetReduceTempStorageSize<T>(n, w);
+  return SoftmaxImpl<device_type, T>::GetComputeDiffTempStorageSizeInBytes(n, w);
 }
 
 template<DeviceType device_type, typename T>
@@ -55,30 +274,7 @@ void SoftmaxKernelUtil<device_type, T>::ComputeProb(DeviceCtx* ctx, const int64_
                                                     const int64_t w, const T* in, T* prob,
                                                     void* temp_storage,
                                                     const size_t temp_storage_bytes) {
-  auto Val = NdarrayUtil<device_type, T>::GetValNdarrayBuilder();
-  auto Var = NdarrayUtil<device_type, T>::GetVarNdarrayBuilder();
-  const size_t min_temp_storage_bytes =
-      SoftmaxKernelUtil<device_type, T>::GetComputeProbTempStorageSizeInBytes(n, w);
-  CHECK_GE(temp_storage_bytes, min_temp_storage_bytes);
-  const size_t reduce_temp_storage_bytes = GetReduceTempStorageSize<T>(n, w);
-  T* reduce_storage = reinterpret_cast<T*>(temp_storage);
-  auto reduce_storage_var =
-      Var({static_cast<int64_t>(reduce_temp_storage_bytes / sizeof(T))}, reduce_storage);
-  T* tmp = reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(temp_storage)
-                                + reduce_temp_storage_bytes);
-  // max | tmp[i] = Max_j(in[i][j])
-  NdarrayUtil<device_type, T>::ReduceMax(ctx, Var({n, 1}, tmp), Val({n, w}, in),
-                                         reduce_storage_var);
-  // sub | prob[i][j] = in[i][j] - tmp[i]
-  NdarrayUtil<device_type, T>::BroadcastSub(ctx, Var({n, w}, prob), Val({n, w}, in),
-                                            Val({n, 1}, tmp));
-  // exp | prob[i][j] = exp(prob[i][j])
-  NdarrayUtil<device_type, T>::InplaceExp(ctx, Var({n, w}, prob));
-  // sum | tmp[i] = Sum_j(prob[i][j])
-  NdarrayUtil<device_type, T>::ReduceSum(ctx, Var({n, 1}, tmp), Val({n, w}, prob),
-                                         reduce_storage_var);
-  // div | prob[i][j] /= tmp[i]
-  NdarrayUtil<device_type, T>::InplaceBroadcastDiv(ctx, Var({n, w}, prob), Val({n, 1}, tmp));
+  SoftmaxImpl<device_type, T>::ComputeProb(ctx, n, w, in, prob, temp_storage, temp_storage_bytes);
 }
 
 template<DeviceType device_type, typename T>
@@ -86,28 +282,8 @@ void SoftmaxKernelUtil<device_type, T>::ComputeDiff(DeviceCtx* ctx, const int64_
                                                     const int64_t w, const T* dy, const T* out,
                                                     T* dx, void* temp_storage,
                                                     const size_t temp_storage_bytes) {
-  auto Val = NdarrayUtil<device_type, T>::GetValNdarrayBuilder();
-  auto Var = NdarrayUtil<device_type, T>::GetVarNdarrayBuilder();
-  const size_t min_temp_storage_bytes =
-      SoftmaxKernelUtil<device_type, T>::GetComputeProbTempStorageSizeInBytes(n, w);
-  CHECK_GE(temp_storage_bytes, min_temp_storage_bytes);
-  const size_t reduce_temp_storage_bytes = GetReduceTempStorageSize<T>(n, w);
-  T* reduce_storage = reinterpret_cast<T*>(temp_storage);
-  auto reduce_storage_var =
-      Var({static_cast<int64_t>(reduce_temp_storage_bytes / sizeof(T))}, reduce_storage);
-  T* sum_vec = reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(temp_storage)
-                                    + reduce_temp_storage_bytes);
-  // it's safe to use dx as tmp
-  // dot product | get dot product sum_vec[i] from out[i] * dy[i]
-  T* tmp = dx;
-  NdarrayUtil<device_type, T>::Mul(ctx, Var({n * w}, tmp), Val({n * w}, out), Val({n * w}, dy));
-  NdarrayUtil<device_type, T>::ReduceSum(ctx, Var({n, 1}, sum_vec), Val({n, w}, tmp),
-                                         reduce_storage_var);
-  // sub | dx[i][j] = dy[i][j] - sum_vec[i]
-  NdarrayUtil<device_type, T>::BroadcastSub(ctx, Var({n, w}, dx), Val({n, w}, dy),
-                                            Val({n, 1}, sum_vec));
-  // elementwise multiplication | dx[i][j] *= out[i][j]
-  NdarrayUtil<device_type, T>::InplaceMul(ctx, Var({n * w}, dx), Val({n * w}, out));
+  SoftmaxImpl<device_type, T>::ComputeDiff(ctx, n, w, dy, out, dx, temp_storage,
+                                           temp_storage_bytes);
 }
 
 #define INSTANTIATE_SOFTMAX_KERNEL_UTIL(device_type, data_type) \
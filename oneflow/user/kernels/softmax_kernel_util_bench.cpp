@@ -0,0 +1,107 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/softmax_kernel_util.h"
+#include "oneflow/core/common/benchmark.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+// the five passes the ndarray softmax made, written as plain loops: row max, subtract, exp,
+// row sum, divide, with the row results in a separate buffer
+void FivePassSoftmax(int64_t n, int64_t w, const float* in, float* prob, float* row_buf) {
+  FOR_RANGE(int64_t, i, 0, n) {
+    float row_max = in[i * w];
+    FOR_RANGE(int64_t, j, 1, w) { row_max = std::max(row_max, in[i * w + j]); }
+    row_buf[i] = row_max;
+  }
+  FOR_RANGE(int64_t, i, 0, n) {
+    FOR_RANGE(int64_t, j, 0, w) { prob[i * w + j] = in[i * w + j] - row_buf[i]; }
+  }
+  FOR_RANGE(int64_t, k, 0, n * w) { prob[k] = std::exp(prob[k]); }
+  FOR_RANGE(int64_t, i, 0, n) {
+    float row_sum = 0;
+    FOR_RANGE(int64_t, j, 0, w) { row_sum += prob[i * w + j]; }
+    row_buf[i] = row_sum;
+  }
+  FOR_RANGE(int64_t, i, 0, n) {
+    FOR_RANGE(int64_t, j, 0, w) { prob[i * w + j] /= row_buf[i]; }
+  }
+}
+
+enum SoftmaxVariant { kFivePass, kFused, kFusedDiff };
+
+// GB/s counts the input and output rows once, dy is counted too for the diff
+void BenchmarkSoftmax(BenchmarkState* state, SoftmaxVariant variant, int64_t n, int64_t w) {
+  std::vector<float> in(n * w);
+  FOR_RANGE(int64_t, i, 0, n * w) { in[i] = static_cast<float>((i * 7919) % 2000) / 100.f; }
+  std::vector<float> prob(n * w);
+  std::vector<float> dx(n * w);
+  std::vector<float> row_buf(n);
+  Global<ThreadPool>::New(4);
+  SoftmaxKernelUtil<DeviceType::kCPU, float>::ComputeProb(nullptr, n, w, in.data(), prob.data(),
+                                                          nullptr, 0);
+  while (state->KeepRunning()) {
+    if (variant == kFivePass) {
+      FivePassSoftmax(n, w, in.data(), prob.data(), row_buf.data());
+    } else if (variant == kFused) {
+      SoftmaxKernelUtil<DeviceType::kCPU, float>::ComputeProb(nullptr, n, w, in.data(),
+                                                              prob.data(), nullptr, 0);
+    } else {
+      SoftmaxKernelUtil<DeviceType::kCPU, float>::ComputeDiff(nullptr, n, w, in.data(),
+                                                              prob.data(), dx.data(), nullptr, 0);
+    }
+    DoNotOptimize(prob.data());
+    DoNotOptimize(dx.data());
+  }
+  Global<ThreadPool>::Delete();
+  const int64_t tensor_num = variant == kFusedDiff ? 3 : 2;
+  state->SetBytesProcessed(state->iterations() * n * w * sizeof(float) * tensor_num);
+}
+
+// logits of 64 tokens over a 32000 word vocabulary
+const int64_t kVocabRowNum = 64;
+const int64_t kVocabSize = 32000;
+// attention scores of 16 sequences, 12 heads and 128 tokens
+const int64_t kAttentionRowNum = 16 * 12 * 128;
+const int64_t kAttentionRowSize = 128;
+
+}  // namespace
+
+OF_BENCHMARK(SoftmaxFivePass_Vocab) {
+  BenchmarkSoftmax(state, kFivePass, kVocabRowNum, kVocabSize);
+}
+
+OF_BENCHMARK(SoftmaxFused_Vocab) { BenchmarkSoftmax(state, kFused, kVocabRowNum, kVocabSize); }
+
+OF_BENCHMARK(SoftmaxFusedDiff_Vocab) {
+  BenchmarkSoftmax(state, kFusedDiff, kVocabRowNum, kVocabSize);
+}
+
+OF_BENCHMARK(SoftmaxFivePass_Attention) {
+  BenchmarkSoftmax(state, kFivePass, kAttentionRowNum, kAttentionRowSize);
+}
+
+OF_BENCHMARK(SoftmaxFused_Attention) {
+  BenchmarkSoftmax(state, kFused, kAttentionRowNum, kAttentionRowSize);
+}
+
+OF_BENCHMARK(SoftmaxFusedDiff_Attention) {
+  BenchmarkSoftmax(state, kFusedDiff, kAttentionRowNum, kAttentionRowSize);
+}
+
+}  // namespace oneflow
@@ -0,0 +1,105 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/softmax_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+const double kInf = std::numeric_limits<double>::infinity();
+
+// logits in [-10, 10), entries of a row in [masked_begin, masked_end) are set to -inf
+std::vector<double> RandomLogits(int64_t n, int64_t w, int64_t masked_begin, int64_t masked_end,
+                                 std::mt19937* gen) {
+  std::uniform_real_distribution<double> dis(-10.0, 10.0);
+  std::vector<double> logits(n * w);
+  FOR_RANGE(int64_t, i, 0, n) {
+    FOR_RANGE(int64_t, j, 0, w) {
+      logits[i * w + j] = (j >= masked_begin && j < masked_end) ? -kInf : dis(*gen);
+    }
+  }
+  return logits;
+}
+
+template<typename T>
+void TestSoftmax(int64_t n, int64_t w, int64_t masked_begin, int64_t masked_end,
+                 double tolerance) {
+  std::mt19937 gen(n * 131 + w * 7 + masked_end);
+  const std::vector<double> in = RandomLogits(n, w, masked_begin, masked_end, &gen);
+  std::uniform_real_distribution<double> dis(-1.0, 1.0);
+  std::vector<double> dy(n * w);
+  for (double& value : dy) { value = dis(gen); }
+  std::vector<double> prob(n * w);
+  std::vector<double> dx(n * w);
+  FOR_RANGE(int64_t, i, 0, n) {
+    const double* row_in = in.data() + i * w;
+    const double row_max = *std::max_element(row_in, row_in + w);
+    double sum = 0;
+    FOR_RANGE(int64_t, j, 0, w) { sum += std::exp(row_in[j] - row_max); }
+    double dot = 0;
+    FOR_RANGE(int64_t, j, 0, w) {
+      prob[i * w + j] = std::exp(row_in[j] - row_max) / sum;
+      dot += prob[i * w + j] * dy[i * w + j];
+    }
+    FOR_RANGE(int64_t, j, 0, w) { dx[i * w + j] = prob[i * w + j] * (dy[i * w + j] - dot); }
+  }
+
+  const std::vector<T> in_t(in.begin(), in.end());
+  const std::vector<T> dy_t(dy.begin(), dy.end());
+  std::vector<T> prob_t(n * w);
+  std::vector<T> dx_t(n * w);
+  SoftmaxKernelUtil<DeviceType::kCPU, T>::ComputeProb(nullptr, n, w, in_t.data(), prob_t.data(),
+                                                      nullptr, 0);
+  FOR_RANGE(int64_t, k, 0, n * w) { ASSERT_NEAR(prob_t[k], prob[k], tolerance); }
+  // the diff takes the reference prob, so that it is checked on its own
+  const std::vector<T> out_t(prob.begin(), prob.end());
+  SoftmaxKernelUtil<DeviceType::kCPU, T>::ComputeDiff(nullptr, n, w, dy_t.data(), out_t.data(),
+                                                      dx_t.data(), nullptr, 0);
+  FOR_RANGE(int64_t, k, 0, n * w) { ASSERT_NEAR(dx_t[k], dx[k], tolerance); }
+}
+
+template<typename T>
+void TestSoftmaxShapes(double tolerance) {
+  // row sizes which are not a multiple of the 4 wide exp or of the 256 element blocks
+  TestSoftmax<T>(7, 1, 0, 0, tolerance);
+  TestSoftmax<T>(33, 3, 0, 0, tolerance);
+  TestSoftmax<T>(16, 255, 0, 0, tolerance);
+  TestSoftmax<T>(16, 257, 0, 0, tolerance);
+  TestSoftmax<T>(5, 1001, 0, 0, tolerance);
+  TestSoftmax<T>(2, 32000, 0, 0, tolerance);
+  // -inf blocks in front of finite ones, inside one block and at the end of the row
+  TestSoftmax<T>(4, 512, 0, 256, tolerance);
+  TestSoftmax<T>(4, 1030, 0, 700, tolerance);
+  TestSoftmax<T>(4, 515, 100, 300, tolerance);
+  TestSoftmax<T>(4, 771, 256, 771, tolerance);
+  TestSoftmax<T>(4, 513, 0, 512, tolerance);
+}
+
+}  // namespace
+
+TEST(SoftmaxKernelUtil, float) { TestSoftmaxShapes<float>(1e-6); }
+
+TEST(SoftmaxKernelUtil, double) { TestSoftmaxShapes<double>(1e-14); }
+
+TEST(SoftmaxKernelUtil, float_thread_pool) {
+  Global<ThreadPool>::New(4);
+  TestSoftmax<float>(4096, 64, 0, 0, 1e-6);
+  TestSoftmax<float>(256, 1030, 0, 700, 1e-6);
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace oneflow
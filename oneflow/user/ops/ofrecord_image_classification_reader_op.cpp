@@ -29,6 +29,7 @@ REGISTER_CPU_ONLY_USER_OP("ofrecord_image_classification_reader")
     .Attr<int64_t>("seed", UserOpAttrType::kAtInt64, -1)
     .Attr<int32_t>("shuffle_buffer_size", UserOpAttrType::kAtInt32, 1024)
     .Attr<bool>("shuffle_after_epoch", UserOpAttrType::kAtBool, false)
+    .Attr<bool>("global_shuffle", UserOpAttrType::kAtBool, false)
     .Attr<std::string>("color_space", UserOpAttrType::kAtString, "BGR")
     .Attr<std::string>("image_feature_name", UserOpAttrType::kAtString, "encoded")
     .Attr<std::string>("label_feature_name", UserOpAttrType::kAtString, "class/label")